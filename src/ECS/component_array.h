@@ -1,89 +1,168 @@
 #pragma once
 
 #include "entity.h"
+#include "sparse_array.h"
 
-#include <array>
+#include <algorithm>
 #include <cassert>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 
 namespace ECS {
+    /**
+     * Number of components stored in a single page of a component array. Should be a power of two.
+     * Pages are allocated on demand, so the memory used by a component array is proportional to the number of stored components
+     */
+    constexpr std::uint32_t COMPONENT_PAGE_SIZE = 1024;
+
+    /**
+     * Number of empty pages we keep allocated at the end of the array when components are removed.
+     * This prevents allocating and freeing a page each time the array size oscillates around the page boundary
+     */
+    constexpr std::uint32_t COMPONENT_SPARE_PAGES = 1;
+
     class IComponentArray {
     public:
         virtual ~IComponentArray() = default;
 
         virtual void EntityDestroyed(FEntity Entity) = 0;
+        /// Amount of memory in bytes that is currently allocated to store components
+        virtual size_t GetAllocatedMemory() = 0;
+    };
+
+    /// Contiguous part of a component array. Components inside the range are stored one after another both on host and on device
+    template<typename T>
+    struct TComponentRange
+    {
+        T* Data = nullptr;
+        uint32_t FirstIndex = 0;
+        uint32_t Count = 0;
     };
 
     template<typename T>
     class TComponentArray : public IComponentArray {
     public:
         void InsertData(FEntity Entity, T Component) {
-            assert(EntityToIndexMap.find(Entity) == EntityToIndexMap.end() && "Entity already has that component!");
+            assert(!HasData(Entity) && "Entity already has that component!");
+
+            uint32_t NewIndex = ArraySize;
 
-            size_t NewIndex = ArraySize;
-            EntityToIndexMap[Entity] = NewIndex;
-            IndexToEntityMap[NewIndex] = Entity;
-            ComponentArray[NewIndex] = Component;
+            if (NewIndex == Pages.size() * COMPONENT_PAGE_SIZE)
+            {
+                Pages.emplace_back(std::make_unique<T[]>(COMPONENT_PAGE_SIZE));
+            }
+
+            EntityToIndex[Entity] = NewIndex;
+            IndexToEntity.push_back(Entity);
+            At(NewIndex) = Component;
             ++ArraySize;
         }
 
         void RemoveData(FEntity Entity) {
-            assert(EntityToIndexMap.find(Entity) != EntityToIndexMap.end() && "removing non-existing component!");
+            assert(HasData(Entity) && "removing non-existing component!");
 
-            size_t IndexOfRemovedEntity = EntityToIndexMap[Entity];
-            size_t IndexOfLastElement = ArraySize - 1;
-            ComponentArray[IndexOfRemovedEntity] = ComponentArray[IndexOfLastElement];
+            uint32_t IndexOfRemovedEntity = EntityToIndex[Entity];
+            uint32_t IndexOfLastElement = ArraySize - 1;
+            At(IndexOfRemovedEntity) = At(IndexOfLastElement);
 
-            FEntity EntityOfLastElement = IndexToEntityMap[IndexOfLastElement];
-            EntityToIndexMap[EntityOfLastElement] = IndexOfRemovedEntity;
-            IndexToEntityMap[IndexOfRemovedEntity] = EntityOfLastElement;
+            FEntity EntityOfLastElement = IndexToEntity[IndexOfLastElement];
+            EntityToIndex[EntityOfLastElement] = IndexOfRemovedEntity;
+            IndexToEntity[IndexOfRemovedEntity] = EntityOfLastElement;
 
-            EntityToIndexMap.erase(Entity);
-            IndexToEntityMap.erase(IndexOfLastElement);
+            EntityToIndex[Entity] = INVALID_SPARSE_INDEX;
+            IndexToEntity.pop_back();
 
             --ArraySize;
+            ++LayoutVersion;
+
+            ReleaseUnusedPages();
+        }
+
+        /// Check whether the entity has this component
+        bool HasData(FEntity Entity)
+        {
+            return EntityToIndex.Contains(Entity);
         }
 
         /// Get data of a single entity
         T& GetData(FEntity Entity)
         {
-            assert(EntityToIndexMap.find(Entity) != EntityToIndexMap.end() && "Entity doesn't have such component!");
+            assert(HasData(Entity) && "Entity doesn't have such component!");
 
-            return ComponentArray[EntityToIndexMap[Entity]];
+            return At(EntityToIndex.Get(Entity));
         }
 
-		/// Get data of a single entity
-		T& GetDataByIndex(uint32_t ComponentIndex)
-		{
-			assert(EntityToIndexMap.size() >= ComponentIndex && "Index is greater than the size of the component array!");
+        /// Get data of a single entity
+        T& GetDataByIndex(uint32_t ComponentIndex)
+        {
+            assert(ArraySize > ComponentIndex && "Index is greater than the size of the component array!");
 
-			return ComponentArray[ComponentIndex];
-		}
+            return At(ComponentIndex);
+        }
 
         /// Get index of the stored entity's component.
         uint32_t GetIndex(FEntity Entity)
         {
-            assert(EntityToIndexMap.find(Entity) != EntityToIndexMap.end() && "Entity doesn't have such component!");
+            assert(HasData(Entity) && "Entity doesn't have such component!");
+
+            return EntityToIndex.Get(Entity);
+        }
+
+        /// Changes every time a removal moves a component to another index. Indices cached with the same version are still valid
+        uint64_t GetLayoutVersion() const
+        {
+            return LayoutVersion;
+        }
+
+        /// Get the entity that owns the component stored at the index
+        FEntity GetEntity(uint32_t ComponentIndex)
+        {
+            assert(ArraySize > ComponentIndex && "Index is greater than the size of the component array!");
 
-            return EntityToIndexMap[Entity];
+            return IndexToEntity[ComponentIndex];
         }
 
         /// Get the offset for the stored entity's component.
+        /// Offsets are computed as if the whole array was contiguous, so they can be used directly as device buffer offsets
         uint32_t GetOffset(FEntity Entity)
         {
-            assert(EntityToIndexMap.find(Entity) != EntityToIndexMap.end() && "Entity doesn't have such component!");
+            assert(HasData(Entity) && "Entity doesn't have such component!");
 
-            return EntityToIndexMap[Entity] * sizeof(T);
+            return EntityToIndex.Get(Entity) * sizeof(T);
         }
 
-        /// Get all data from the component array (Needed when we upload this data to GPU)
-        T* Data() {
-            return ComponentArray.data();
+        /// Get contiguous ranges covering all the stored components, one per allocated page
+        std::vector<TComponentRange<T>> GetRanges()
+        {
+            std::vector<TComponentRange<T>> Ranges;
+
+            for (uint32_t FirstIndex = 0; FirstIndex < ArraySize; FirstIndex += COMPONENT_PAGE_SIZE)
+            {
+                uint32_t Count = std::min<uint32_t>(COMPONENT_PAGE_SIZE, ArraySize - FirstIndex);
+                Ranges.push_back({Pages[FirstIndex / COMPONENT_PAGE_SIZE].get(), FirstIndex, Count});
+            }
+
+            return Ranges;
         }
 
+        /// Gather all components into a single contiguous vector (Needed when we process all components at once, e.g. to build an alias table)
+        std::vector<T> GatherData()
+        {
+            std::vector<T> Result;
+            Result.reserve(ArraySize);
+
+            for (auto& Range : GetRanges())
+            {
+                Result.insert(Result.end(), Range.Data, Range.Data + Range.Count);
+            }
+
+            return Result;
+        }
+
+        /// Get a pointer to the entity's component. Memory is contiguous only inside a single page
         void* Data(FEntity Entity)
         {
-            return ComponentArray.data() + EntityToIndexMap[Entity];
+            return &At(EntityToIndex.Get(Entity));
         }
 
         /// Get the total size of component's array
@@ -91,16 +170,41 @@ namespace ECS {
             return ArraySize * sizeof(T);
         }
 
+        size_t GetAllocatedMemory() override
+        {
+            return Pages.size() * COMPONENT_PAGE_SIZE * sizeof(T) + Pages.capacity() * sizeof(std::unique_ptr<T[]>)
+                + IndexToEntity.capacity() * sizeof(FEntity) + EntityToIndex.GetAllocatedMemory();
+        }
+
         void EntityDestroyed(FEntity Entity) override {
-            if (EntityToIndexMap.find(Entity) != EntityToIndexMap.end()) {
+            if (HasData(Entity)) {
                 RemoveData(Entity);
             }
         }
 
     private:
-        std::array <T, MAX_ENTITIES> ComponentArray;
-        std::unordered_map <FEntity, size_t> EntityToIndexMap;
-        std::unordered_map <size_t, FEntity> IndexToEntityMap;
-        size_t ArraySize;
+        T& At(size_t Index)
+        {
+            return Pages[Index / COMPONENT_PAGE_SIZE][Index % COMPONENT_PAGE_SIZE];
+        }
+
+        /// Free pages at the end of the array, keeping COMPONENT_SPARE_PAGES empty pages allocated
+        void ReleaseUnusedPages()
+        {
+            size_t UsedPages = (ArraySize + COMPONENT_PAGE_SIZE - 1) / COMPONENT_PAGE_SIZE;
+
+            while (Pages.size() > UsedPages + COMPONENT_SPARE_PAGES)
+            {
+                Pages.pop_back();
+            }
+        }
+
+        std::vector<std::unique_ptr<T[]>> Pages;
+        /// Sparse array: entity -> index of its component in the dense array
+        FSparseArray EntityToIndex;
+        /// Dense array: index of the component -> entity
+        std::vector<FEntity> IndexToEntity;
+        uint32_t ArraySize = 0;
+        uint64_t LayoutVersion = 0;
     };
-}
\ No newline at end of file
+}
@@ -2,23 +2,64 @@
 
 #include "component_array.h"
 
+#include <array>
+#include <atomic>
 #include <memory>
-#include <unordered_map>
+#include <stdexcept>
 
 namespace ECS
 {
+    /**
+     * Process-wide counter used to give each component type a dense index.
+     * Indices address arrays of MAX_COMPONENTS entries, so running out of them is an error in release builds too
+     */
+    inline std::uint32_t NextComponentTypeIndex()
+    {
+        static std::atomic<std::uint32_t> Counter{0};
+        std::uint32_t Index = Counter++;
+
+        if (Index >= MAX_COMPONENTS)
+        {
+            throw std::runtime_error("Too many component types, increase MAX_COMPONENTS!");
+        }
+
+        return Index;
+    }
+
+    /**
+     * Dense index of the component type, the same for all component managers.
+     * A per type template variable would be initialized during static initialization, in an unspecified order across translation units,
+     * so a component manager constructed from another translation unit could read it before it's assigned. A function-local static is assigned on the first use instead.
+     * It's not the same as FComponentType, which depends on the order of registration and defines the signature bit
+     */
+    template<typename T>
+    std::uint32_t GetComponentTypeIndex()
+    {
+        static const std::uint32_t Index = NextComponentTypeIndex();
+        return Index;
+    }
+
+    /**
+     * Marks component types that were not registered in the component manager
+     */
+    constexpr FComponentType INVALID_COMPONENT_TYPE = std::numeric_limits<FComponentType>::max();
+
     class FComponentManager
     {
     public:
+        FComponentManager()
+        {
+            ComponentTypes.fill(INVALID_COMPONENT_TYPE);
+        }
+
         template<typename T>
         void RegisterComponent()
         {
-            const char* TypeName = typeid(T).name();
+            assert(ComponentTypes[GetComponentTypeIndex<T>()] == INVALID_COMPONENT_TYPE && "Registering component types more that once!");
+            assert(NextComponentType < MAX_COMPONENTS && "Too many components registered!");
 
-            assert(ComponentTypes.find(TypeName) == ComponentTypes.end() && "Registering component types more that once!");
-
-            ComponentTypes.insert({TypeName, NextComponentType});
-            ComponentArrays.insert({TypeName, std::make_shared<TComponentArray<T>>()});
+            ComponentTypes[GetComponentTypeIndex<T>()] = NextComponentType;
+            ComponentArrays[NextComponentType] = std::make_unique<TComponentArray<T>>();
 
             ++NextComponentType;
         }
@@ -26,11 +67,9 @@ namespace ECS
         template<typename T>
         FComponentType GetComponentType()
         {
-            const char* TypeName = typeid(T).name();
-
-            assert(ComponentTypes.find(TypeName) != ComponentTypes.end() && "Component type not registered!");
+            assert(ComponentTypes[GetComponentTypeIndex<T>()] != INVALID_COMPONENT_TYPE && "Component type not registered!");
 
-            return ComponentTypes[TypeName];
+            return ComponentTypes[GetComponentTypeIndex<T>()];
         }
 
         template<typename T>
@@ -60,9 +99,15 @@ namespace ECS
         /// It's here just to call ComponentArray's method and being called by Coordinator method.
         /// Making all private fields public could solve this problem. If it's a problem
         template<typename T>
-        T* Data()
+        std::vector<T> GatherData()
+        {
+            return GetComponentArray<T>()->GatherData();
+        }
+
+        template<typename T>
+        std::vector<TComponentRange<T>> GetRanges()
         {
-            return GetComponentArray<T>()->Data();
+            return GetComponentArray<T>()->GetRanges();
         }
 
         template<typename T>
@@ -83,6 +128,12 @@ namespace ECS
             return GetComponentArray<T>()->GetIndex(Entity);
         }
 
+        template<typename T>
+        uint64_t GetLayoutVersion()
+        {
+            return GetComponentArray<T>()->GetLayoutVersion();
+        }
+
         /// It's here just to call ComponentArray's method and being called by Coordinator method.
         /// Making all private fields public could solve this problem. If it's a problem
         template<typename T>
@@ -93,26 +144,37 @@ namespace ECS
 
         void EntityDestroyed(FEntity Entity)
         {
-            for (auto const& Pair : ComponentArrays)
+            for (FComponentType Type = 0; Type < NextComponentType; ++Type)
             {
-                auto const& Component = Pair.second;
+                ComponentArrays[Type]->EntityDestroyed(Entity);
+            }
+        }
+        /// Total amount of memory allocated by all registered component arrays
+        size_t GetAllocatedMemory()
+        {
+            size_t Result = 0;
 
-                Component->EntityDestroyed(Entity);
+            for (FComponentType Type = 0; Type < NextComponentType; ++Type)
+            {
+                Result += ComponentArrays[Type]->GetAllocatedMemory();
             }
+
+            return Result;
         }
+
     private:
-        std::unordered_map<const char*, FComponentType> ComponentTypes{};
-        std::unordered_map<const char*, std::shared_ptr<IComponentArray>> ComponentArrays{};
+        /// Component type index -> component type (signature bit)
+        std::array<FComponentType, MAX_COMPONENTS> ComponentTypes{};
+        /// Component type -> component array
+        std::array<std::unique_ptr<IComponentArray>, MAX_COMPONENTS> ComponentArrays{};
         FComponentType NextComponentType{};
 
         template<typename T>
-        std::shared_ptr<TComponentArray<T>> GetComponentArray()
+        TComponentArray<T>* GetComponentArray()
         {
-            const char* TypeName = typeid(T).name();
-
-            assert(ComponentTypes.find(TypeName) != ComponentTypes.end() && "Component not registered before use!");
+            assert(ComponentTypes[GetComponentTypeIndex<T>()] != INVALID_COMPONENT_TYPE && "Component not registered before use!");
 
-            return std::static_pointer_cast<TComponentArray<T>>(ComponentArrays[TypeName]);
+            return static_cast<TComponentArray<T>*>(ComponentArrays[ComponentTypes[GetComponentTypeIndex<T>()]].get());
         }
     };
 
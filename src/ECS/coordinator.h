@@ -31,6 +31,18 @@ namespace ECS
         {
             EntityManager->DestroyEntity(Entity);
             ComponentManager->EntityDestroyed(Entity);
+            SystemManager->EntityDestroyed(Entity);
+        }
+
+        /// Get a handle, that can be used to detect whether the entity was destroyed
+        FEntityHandle GetHandle(FEntity Entity)
+        {
+            return EntityManager->GetHandle(Entity);
+        }
+
+        bool IsValid(const FEntityHandle& Handle)
+        {
+            return EntityManager->IsValid(Handle);
         }
 
         template<typename T>
@@ -111,12 +123,18 @@ namespace ECS
             return SystemManager->template GetSystem<T>();
         }
 
-        /// Returns a pointer to the ComponentArray's data. Perhaps we should return const pointer.
-        /// TODO: Check whether const can be applied
+        /// Returns a contiguous copy of the ComponentArray's data. Component arrays are paged, so they can't be accessed through a single pointer.
+        template<typename T>
+        std::vector<T> GatherData()
+        {
+            return ComponentManager->GatherData<T>();
+        }
+
+        /// Returns contiguous ranges of the ComponentArray's data, one per page.
         template<typename T>
-        T* Data()
+        std::vector<ECS::TComponentRange<T>> GetRanges()
         {
-            return ComponentManager->Data<T>();
+            return ComponentManager->GetRanges<T>();
         }
 
         template<typename T>
@@ -17,6 +17,11 @@ namespace ECS
      */
     constexpr std::uint32_t MAX_ENTITIES = 2 * 1024 * 1024;
 
+    /**
+     * Per-entity storage (like signatures) grows by this number of entities, when new entities are created
+     */
+    constexpr std::uint32_t ENTITY_CHUNK_SIZE = 4096;
+
      /**
      * Component type is just a custom type for uint8
      */
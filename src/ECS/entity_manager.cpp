@@ -1,25 +1,32 @@
 #include "entity_manager.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace ECS
 {
-    FEntityManager::FEntityManager()
+    FEntity FEntityManager::CreateEntity()
     {
-        for (FEntity Entity = 0; Entity < MAX_ENTITIES - 1; ++Entity)
+        assert(LivingEntitiesCount < MAX_ENTITIES && "To many entities, can't create more!");
+
+        FEntity ID;
+
+        if (!AvailableEntities.empty())
         {
-            AvailableEntities.push(Entity);
+            ID = AvailableEntities.back();
+            AvailableEntities.pop_back();
         }
+        else
+        {
+            ID = NextEntity++;
 
-		Signatures.resize(MAX_ENTITIES - 1, 0);
-    }
-
-    FEntity FEntityManager::CreateEntity()
-    {
-        assert(LivingEntitiesCount < MAX_ENTITIES && "To many entities, can't create more!");
+            if (ID >= Signatures.size())
+            {
+                Grow();
+            }
+        }
 
-        FEntity ID = AvailableEntities.front();
-        AvailableEntities.pop();
+        Alive[ID] = true;
         ++LivingEntitiesCount;
 
         return ID;
@@ -27,24 +34,48 @@ namespace ECS
 
     void FEntityManager::DestroyEntity(FEntity Entity)
     {
-        assert(Entity < MAX_ENTITIES && "Entity out of range!");
+        assert(Entity < NextEntity && "Entity out of range!");
+        assert(Alive[Entity] && "Destroying entity that is not alive!");
 
         Signatures[Entity].reset();
-        AvailableEntities.push(Entity);
+        ++Generations[Entity];
+        Alive[Entity] = false;
+        AvailableEntities.push_back(Entity);
         --LivingEntitiesCount;
     }
 
     void FEntityManager::SetSignature(FEntity Entity, FSignature Signature)
     {
-        assert(Entity < MAX_ENTITIES && "Entity out of range!");
+        assert(Entity < NextEntity && "Entity out of range!");
 
         Signatures[Entity] = Signature;
     }
 
     FSignature FEntityManager::GetSignature(FEntity Entity)
     {
-        assert(Entity < MAX_ENTITIES && "Entity out of range!");
+        assert(Entity < NextEntity && "Entity out of range!");
 
         return Signatures[Entity];
     }
-}
\ No newline at end of file
+
+    FEntityHandle FEntityManager::GetHandle(FEntity Entity)
+    {
+        assert(Entity < NextEntity && "Entity out of range!");
+
+        return {Entity, Generations[Entity]};
+    }
+
+    bool FEntityManager::IsValid(const FEntityHandle& Handle)
+    {
+        return Handle.Entity < NextEntity && Alive[Handle.Entity] && Generations[Handle.Entity] == Handle.Generation;
+    }
+
+    void FEntityManager::Grow()
+    {
+        size_t NewSize = std::min<size_t>(Signatures.size() + ENTITY_CHUNK_SIZE, MAX_ENTITIES);
+
+        Signatures.resize(NewSize);
+        Generations.resize(NewSize, 0);
+        Alive.resize(NewSize, false);
+    }
+}
@@ -2,29 +2,47 @@
 
 #include "entity.h"
 
-#include <queue>
 #include <vector>
 
 namespace ECS
 {
+    /**
+     * Entity together with the generation it was created in. Entity IDs are reused after destruction,
+     * so a handle allows to detect that the entity it refers to was destroyed.
+     */
+    struct FEntityHandle
+    {
+        FEntity Entity = INVALID_ENTITY;
+        uint32_t Generation = 0;
+    };
+
     class FEntityManager
     {
     public:
-        /// In constructor we just fill in the array of available entities
-        FEntityManager();
-        /// Fetch a new entity from array of available entities
+        FEntityManager() = default;
+        /// Reuse a destroyed entity if there's any, otherwise take the next unused one
         FEntity CreateEntity();
-        /// Push destroyed entity into array of available entities
+        /// Push destroyed entity into array of available entities and bump its generation
         void DestroyEntity(FEntity Entity);
         /// Set entity's signature, to mark it has according components
         void SetSignature(FEntity Entity, FSignature Signature);
         /// With signature you can check whether entity has component or not
         FSignature GetSignature(FEntity Entity);
+        /// Get a handle that can be checked for staleness later
+        FEntityHandle GetHandle(FEntity Entity);
+        /// Check whether the entity referenced by the handle is still alive
+        bool IsValid(const FEntityHandle& Handle);
 
     private:
-        std::queue<FEntity> AvailableEntities{};
+        /// Grow per-entity storage by chunks, so that it's proportional to the number of entities ever created
+        void Grow();
+
+        std::vector<FEntity> AvailableEntities{};
         std::vector<FSignature> Signatures{};
+        std::vector<uint32_t> Generations{};
+        std::vector<bool> Alive{};
+        FEntity NextEntity{};
         uint32_t LivingEntitiesCount{};
     };
 
-}
\ No newline at end of file
+}
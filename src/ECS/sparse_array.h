@@ -0,0 +1,81 @@
+#pragma once
+
+#include "entity.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace ECS
+{
+    /**
+     * Number of entries in a single page of a sparse array. Should be a power of two.
+     * Pages are allocated only for ranges of entities that are actually stored
+     */
+    constexpr std::uint32_t SPARSE_PAGE_SIZE = 4096;
+
+    /**
+     * Marks entities that are not stored in a sparse array
+     */
+    constexpr std::uint32_t INVALID_SPARSE_INDEX = UINT32_MAX;
+
+    /**
+     * Paged array that maps an entity to an index in some dense array.
+     */
+    class FSparseArray
+    {
+    public:
+        /// Get the index stored for the entity, or INVALID_SPARSE_INDEX if there's none
+        uint32_t Get(FEntity Entity) const
+        {
+            uint32_t Page = Entity / SPARSE_PAGE_SIZE;
+
+            if (Page >= Pages.size() || Pages[Page] == nullptr)
+            {
+                return INVALID_SPARSE_INDEX;
+            }
+
+            return Pages[Page][Entity % SPARSE_PAGE_SIZE];
+        }
+
+        bool Contains(FEntity Entity) const
+        {
+            return Get(Entity) != INVALID_SPARSE_INDEX;
+        }
+
+        /// Access the entity's entry, allocating the page if needed
+        uint32_t& operator[](FEntity Entity)
+        {
+            uint32_t Page = Entity / SPARSE_PAGE_SIZE;
+
+            if (Page >= Pages.size())
+            {
+                Pages.resize(Page + 1);
+            }
+
+            if (Pages[Page] == nullptr)
+            {
+                Pages[Page] = std::make_unique<uint32_t[]>(SPARSE_PAGE_SIZE);
+                std::fill_n(Pages[Page].get(), SPARSE_PAGE_SIZE, INVALID_SPARSE_INDEX);
+            }
+
+            return Pages[Page][Entity % SPARSE_PAGE_SIZE];
+        }
+
+        /// Amount of memory in bytes that is currently allocated by the sparse array
+        size_t GetAllocatedMemory() const
+        {
+            size_t Result = Pages.capacity() * sizeof(std::unique_ptr<uint32_t[]>);
+
+            for (auto& Page : Pages)
+            {
+                Result += Page ? SPARSE_PAGE_SIZE * sizeof(uint32_t) : 0;
+            }
+
+            return Result;
+        }
+
+    private:
+        std::vector<std::unique_ptr<uint32_t[]>> Pages;
+    };
+}
@@ -4,24 +4,101 @@ namespace ECS
 {
     namespace SYSTEMS
     {
+        bool FEntitySet::insert(FEntity Entity)
+        {
+            uint32_t& Index = Sparse[Entity];
+
+            if (Index != INVALID_SPARSE_INDEX)
+            {
+                return false;
+            }
+
+            Index = Dense.size();
+            Dense.push_back(Entity);
+            return true;
+        }
+
+        bool FEntitySet::erase(FEntity Entity)
+        {
+            uint32_t Index = Sparse.Get(Entity);
+
+            if (Index == INVALID_SPARSE_INDEX)
+            {
+                return false;
+            }
+
+            FEntity LastEntity = Dense.back();
+            Dense[Index] = LastEntity;
+            Sparse[LastEntity] = Index;
+
+            Dense.pop_back();
+            Sparse[Entity] = INVALID_SPARSE_INDEX;
+            return true;
+        }
+
+        bool FEntitySet::contains(FEntity Entity) const
+        {
+            return Sparse.Contains(Entity);
+        }
+
+        size_t FEntitySet::size() const
+        {
+            return Dense.size();
+        }
+
+        bool FEntitySet::empty() const
+        {
+            return Dense.empty();
+        }
+
+        std::vector<FEntity>::iterator FEntitySet::begin()
+        {
+            return Dense.begin();
+        }
+
+        std::vector<FEntity>::iterator FEntitySet::end()
+        {
+            return Dense.end();
+        }
+
         void FSystem::RegisterEntity(FEntity Entity)
         {
             Entities.insert(Entity);
+            bEntitiesSorted = false;
         }
 
         void FSystem::UnregisterEntity(FEntity Entity)
         {
             Entities.erase(Entity);
+            bEntitiesSorted = false;
+        }
+
+        void FSystem::DisableSorting()
+        {
+            SortKey = nullptr;
+            GetSortKeyVersion = nullptr;
         }
 
-        std::set<FEntity>::iterator  FSystem::begin()
+        std::vector<FEntity>::iterator FSystem::begin()
         {
+            if (SortKey != nullptr && (!bEntitiesSorted || GetSortKeyVersion(SortComponentManager) != SortedKeyVersion))
+            {
+                Entities.Sort([this](FEntity Entity){ return SortKey(SortComponentManager, Entity); });
+                SortedKeyVersion = GetSortKeyVersion(SortComponentManager);
+                bEntitiesSorted = true;
+            }
+
             return Entities.begin();
         }
 
-        std::set<FEntity>::iterator  FSystem::end()
+        std::vector<FEntity>::iterator FSystem::end()
         {
             return Entities.end();
         }
+
+        size_t FSystem::size() const
+        {
+            return Entities.size();
+        }
     }
 }
@@ -2,24 +2,85 @@
 
 #include "entity.h"
 #include "component_manager.h"
+#include "sparse_array.h"
 
+#include <algorithm>
 #include <cassert>
-#include <set>
+#include <vector>
 
 namespace ECS
 {
     namespace SYSTEMS
     {
+        /**
+         * Set of entities stored as a dense array, so it can be iterated linearly.
+         * Entity -> position in the dense array is kept in a sparse array, so insertion and removal are O(1).
+         * Removal moves the last entity into the place of the removed one, so the order of entities is not preserved.
+         */
+        class FEntitySet
+        {
+        public:
+            /// Add entity to the set, does nothing if it's already there
+            bool insert(FEntity Entity);
+            /// Remove entity from the set, does nothing if it's not there
+            bool erase(FEntity Entity);
+            bool contains(FEntity Entity) const;
+            size_t size() const;
+            bool empty() const;
+
+            std::vector<FEntity>::iterator begin();
+            std::vector<FEntity>::iterator end();
+
+            /// Reorder entities using the key, the key is evaluated once per entity
+            template<typename KeyFunction>
+            void Sort(KeyFunction Key)
+            {
+                std::vector<std::pair<uint32_t, FEntity>> Keys;
+                Keys.reserve(Dense.size());
+
+                for (auto Entity : Dense)
+                {
+                    Keys.emplace_back(Key(Entity), Entity);
+                }
+
+                std::sort(Keys.begin(), Keys.end());
+
+                for (uint32_t i = 0; i < Keys.size(); ++i)
+                {
+                    Dense[i] = Keys[i].second;
+                    Sparse[Dense[i]] = i;
+                }
+            }
+
+        private:
+            std::vector<FEntity> Dense;
+            FSparseArray Sparse;
+        };
+
         class FSystem
         {
         public:
             FSystem() = default;
-            std::set<FEntity>::iterator begin();
-            std::set<FEntity>::iterator end();
+            /// If sorting by component index is enabled, entities are sorted before the iteration begins
+            std::vector<FEntity>::iterator begin();
+            std::vector<FEntity>::iterator end();
+            size_t size() const;
 
             virtual void RegisterEntity(FEntity Entity);
             virtual void UnregisterEntity(FEntity Entity);
 
+            /// Iterate entities in the order their T components are stored in the component manager, so the iteration walks component memory linearly
+            template<typename T>
+            void EnableSortingByComponentIndex(FComponentManager* ComponentManager = GetComponentManager())
+            {
+                SortComponentManager = ComponentManager;
+                SortKey = [](FComponentManager* ComponentManager, FEntity Entity){ return ComponentManager->GetIndex<T>(Entity); };
+                GetSortKeyVersion = [](FComponentManager* ComponentManager){ return ComponentManager->GetLayoutVersion<T>(); };
+                bEntitiesSorted = false;
+            }
+
+            void DisableSorting();
+
             template<typename T>
             T& GetComponent(FEntity Entity)
             {
@@ -34,8 +95,16 @@ namespace ECS
 				return Component;
 			};
 
-        public:
-            std::set<FEntity> Entities;
+        private:
+            /// Only reachable through begin() and end(), so that the iteration can't skip the sorting
+            FEntitySet Entities;
+            /// Component indices can change whenever any entity's signature changes, so we resort lazily
+            FComponentManager* SortComponentManager = nullptr;
+            uint32_t (*SortKey)(FComponentManager*, FEntity) = nullptr;
+            /// Removing a component from any entity, even one outside of the system, can move components of the system's entities
+            uint64_t (*GetSortKeyVersion)(FComponentManager*) = nullptr;
+            uint64_t SortedKeyVersion = 0;
+            bool bEntitiesSorted = false;
         };
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,261 @@
+#include "frame_graph.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace
+{
+	/// What the passes executed so far did to a resource
+	struct FResourceState
+	{
+		/// Stages and accesses of the last write, zero if there's nothing to synchronize with
+		uint32_t WriteStages = 0;
+		uint32_t WriteAccess = 0;
+		/// Stages that already see the last write
+		uint32_t VisibleStages = 0;
+		/// Stages that read the resource after the last write, they must finish before the next write
+		uint32_t ReadStages = 0;
+	};
+}
+
+bool FFrameGraphResourceAccess::IsRead() const
+{
+	return (Access & ~FRAME_GRAPH_WRITE_ACCESS_MASK) != 0;
+}
+
+bool FFrameGraphResourceAccess::IsWrite() const
+{
+	return (Access & FRAME_GRAPH_WRITE_ACCESS_MASK) != 0;
+}
+
+bool FFrameGraphBarrier::IsEmpty() const
+{
+	return SrcStages == 0 && DstStages == 0;
+}
+
+FFrameGraphBarrier& FFrameGraphBarrier::operator+=(const FFrameGraphBarrier& Other)
+{
+	SrcStages |= Other.SrcStages;
+	DstStages |= Other.DstStages;
+	SrcAccess |= Other.SrcAccess;
+	DstAccess |= Other.DstAccess;
+	return *this;
+}
+
+std::vector<uint32_t> FCompiledFrameGraph::GetPassOrder() const
+{
+	std::vector<uint32_t> Order;
+
+	for (auto& Batch : Batches)
+	{
+		for (auto& Step : Batch.Steps)
+		{
+			Order.insert(Order.end(), Step.Passes.begin(), Step.Passes.end());
+		}
+	}
+
+	return Order;
+}
+
+uint32_t FCompiledFrameGraph::GetBarrierCount() const
+{
+	uint32_t BarrierCount = 0;
+
+	for (auto& Batch : Batches)
+	{
+		for (auto& Step : Batch.Steps)
+		{
+			BarrierCount += Step.Barrier.IsEmpty() ? 0 : 1;
+		}
+	}
+
+	return BarrierCount;
+}
+
+uint32_t FFrameGraph::AddPass(const FFrameGraphPass& Pass)
+{
+	Passes.push_back(Pass);
+	return Passes.size() - 1;
+}
+
+const std::vector<FFrameGraphPass>& FFrameGraph::GetPasses() const
+{
+	return Passes;
+}
+
+FCompiledFrameGraph FFrameGraph::Compile() const
+{
+	/// Topological sort: a pass goes one level after the latest pass it depends on, so every level only depends on the previous ones
+	std::vector<uint32_t> Levels(Passes.size(), 0);
+	{
+		std::unordered_map<std::string, int> LastWriteLevel;
+		std::unordered_map<std::string, int> LastReadLevel;
+
+		for (uint32_t i = 0; i < Passes.size(); ++i)
+		{
+			int Level = 0;
+
+			for (auto& Access : Passes[i].Accesses)
+			{
+				auto WriteLevel = LastWriteLevel.find(Access.Resource);
+
+				if (WriteLevel != LastWriteLevel.end())
+				{
+					Level = std::max(Level, WriteLevel->second + 1);
+				}
+
+				auto ReadLevel = LastReadLevel.find(Access.Resource);
+
+				if (Access.IsWrite() && ReadLevel != LastReadLevel.end())
+				{
+					Level = std::max(Level, ReadLevel->second + 1);
+				}
+			}
+
+			for (auto& Access : Passes[i].Accesses)
+			{
+				if (Access.IsWrite())
+				{
+					LastWriteLevel[Access.Resource] = Level;
+					LastReadLevel.erase(Access.Resource);
+				}
+			}
+
+			for (auto& Access : Passes[i].Accesses)
+			{
+				if (!Access.IsWrite())
+				{
+					auto ReadLevel = LastReadLevel.find(Access.Resource);
+					LastReadLevel[Access.Resource] = (ReadLevel == LastReadLevel.end()) ? Level : std::max(ReadLevel->second, Level);
+				}
+			}
+
+			Levels[i] = Level;
+		}
+	}
+
+	/// Passes of every level, grouped by queue, in the order they were added
+	std::map<uint32_t, std::map<uint32_t, std::vector<uint32_t>>> LevelsQueuesPasses;
+
+	for (uint32_t i = 0; i < Passes.size(); ++i)
+	{
+		LevelsQueuesPasses[Levels[i]][Passes[i].Queue].push_back(i);
+	}
+
+	FCompiledFrameGraph CompiledFrameGraph;
+	std::unordered_map<std::string, FResourceState> ResourceStates;
+	uint32_t PassPosition = 0;
+
+	for (auto& [Level, QueuesPasses] : LevelsQueuesPasses)
+	{
+		std::vector<uint32_t> Queues;
+
+		for (auto& [Queue, QueuePasses] : QueuesPasses)
+		{
+			Queues.push_back(Queue);
+		}
+
+		/// Passes on the queue of the current batch go first, so that they don't start a new submit
+		if (!CompiledFrameGraph.Batches.empty())
+		{
+			auto CurrentQueue = std::find(Queues.begin(), Queues.end(), CompiledFrameGraph.Batches.back().Queue);
+
+			if (CurrentQueue != Queues.end())
+			{
+				std::rotate(Queues.begin(), CurrentQueue, CurrentQueue + 1);
+			}
+		}
+
+		for (auto Queue : Queues)
+		{
+			if (CompiledFrameGraph.Batches.empty() || CompiledFrameGraph.Batches.back().Queue != Queue)
+			{
+				/// Semaphores between submits make all previous writes visible to everything
+				CompiledFrameGraph.Batches.push_back({Queue, {}});
+				ResourceStates.clear();
+			}
+
+			FFrameGraphStep Step;
+			Step.Passes = QueuesPasses[Queue];
+
+			for (auto PassIndex : Step.Passes)
+			{
+				auto& Pass = Passes[PassIndex];
+
+				/// Read after write
+				for (auto& Access : Pass.Accesses)
+				{
+					auto& State = ResourceStates[Access.Resource];
+
+					if (Access.IsRead() && State.WriteStages != 0 && (Access.Stages & ~State.VisibleStages) != 0)
+					{
+						Step.Barrier += {State.WriteStages, Access.Stages, State.WriteAccess, Access.Access & ~FRAME_GRAPH_WRITE_ACCESS_MASK};
+					}
+				}
+
+				/// Write after read only needs the reads to finish, write after write also needs the previous write to be visible
+				for (auto& Access : Pass.Accesses)
+				{
+					auto& State = ResourceStates[Access.Resource];
+
+					if (!Access.IsWrite())
+					{
+						continue;
+					}
+
+					if (State.ReadStages != 0)
+					{
+						Step.Barrier += {State.ReadStages, Access.Stages, 0, 0};
+					}
+					else if (State.WriteStages != 0)
+					{
+						Step.Barrier += {State.WriteStages, Access.Stages, State.WriteAccess, Access.Access & FRAME_GRAPH_WRITE_ACCESS_MASK};
+					}
+				}
+
+				std::set<std::string> WrittenResources;
+
+				for (auto& Access : Pass.Accesses)
+				{
+					if (Access.IsWrite())
+					{
+						ResourceStates[Access.Resource] = {Access.Stages, Access.Access & FRAME_GRAPH_WRITE_ACCESS_MASK, 0, 0};
+						WrittenResources.insert(Access.Resource);
+					}
+				}
+
+				/// Reading what the pass writes itself doesn't have to be synchronized with anything later
+				for (auto& Access : Pass.Accesses)
+				{
+					if (Access.IsRead() && WrittenResources.count(Access.Resource) == 0)
+					{
+						auto& State = ResourceStates[Access.Resource];
+						State.VisibleStages |= Access.Stages;
+						State.ReadStages |= Access.Stages;
+					}
+				}
+
+				for (auto& Access : Pass.Accesses)
+				{
+					auto Lifetime = CompiledFrameGraph.ResourceLifetimes.find(Access.Resource);
+
+					if (Lifetime == CompiledFrameGraph.ResourceLifetimes.end())
+					{
+						CompiledFrameGraph.ResourceLifetimes[Access.Resource] = {PassPosition, PassPosition};
+					}
+					else
+					{
+						Lifetime->second.LastPass = PassPosition;
+					}
+				}
+
+				++PassPosition;
+			}
+
+			CompiledFrameGraph.Batches.back().Steps.push_back(Step);
+		}
+	}
+
+	return CompiledFrameGraph;
+}
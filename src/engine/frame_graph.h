@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Pipeline stages a pass accesses resources at. Mirror VkPipelineStageFlagBits
+enum FrameGraphStage {FRAME_GRAPH_STAGE_DRAW_INDIRECT 					= 1u,
+					  FRAME_GRAPH_STAGE_COMPUTE_SHADER 					= 1u << 1,
+					  FRAME_GRAPH_STAGE_RAY_TRACING_SHADER 				= 1u << 2,
+					  FRAME_GRAPH_STAGE_FRAGMENT_SHADER 				= 1u << 3,
+					  FRAME_GRAPH_STAGE_COLOR_ATTACHMENT_OUTPUT 		= 1u << 4,
+					  FRAME_GRAPH_STAGE_TRANSFER 						= 1u << 5,
+					  FRAME_GRAPH_STAGE_ACCELERATION_STRUCTURE_BUILD 	= 1u << 6};
+
+/// Kinds of memory accesses, mirror VkAccessFlagBits
+enum FrameGraphAccess {FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ 			= 1u,
+					   FRAME_GRAPH_ACCESS_SHADER_READ 					= 1u << 1,
+					   FRAME_GRAPH_ACCESS_SHADER_WRITE 					= 1u << 2,
+					   FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE 		= 1u << 3,
+					   FRAME_GRAPH_ACCESS_TRANSFER_READ 				= 1u << 4,
+					   FRAME_GRAPH_ACCESS_TRANSFER_WRITE 				= 1u << 5,
+					   FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_READ 	= 1u << 6,
+					   FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_WRITE 	= 1u << 7};
+
+constexpr uint32_t FRAME_GRAPH_ACCESS_SHADER_READ_WRITE = FRAME_GRAPH_ACCESS_SHADER_READ | FRAME_GRAPH_ACCESS_SHADER_WRITE;
+constexpr uint32_t FRAME_GRAPH_WRITE_ACCESS_MASK = FRAME_GRAPH_ACCESS_SHADER_WRITE | FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE | FRAME_GRAPH_ACCESS_TRANSFER_WRITE |
+												   FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_WRITE;
+
+/**
+ * A buffer or an image, given by its name, accessed by a pass
+ */
+struct FFrameGraphResourceAccess
+{
+	std::string Resource;
+	/// FrameGraphStage flags
+	uint32_t Stages = 0;
+	/// FrameGraphAccess flags
+	uint32_t Access = 0;
+
+	bool IsRead() const;
+	bool IsWrite() const;
+};
+
+struct FFrameGraphPass
+{
+	std::string Name;
+	/// Passes on different queues go to different submits, which are chained with semaphores
+	uint32_t Queue = 0;
+	std::vector<FFrameGraphResourceAccess> Accesses;
+};
+
+/**
+ * Global memory barrier, executed before a step
+ */
+struct FFrameGraphBarrier
+{
+	uint32_t SrcStages = 0;
+	uint32_t DstStages = 0;
+	uint32_t SrcAccess = 0;
+	uint32_t DstAccess = 0;
+
+	bool IsEmpty() const;
+	FFrameGraphBarrier& operator+=(const FFrameGraphBarrier& Other);
+};
+
+/**
+ * Passes that don't depend on each other, executed after a single barrier
+ */
+struct FFrameGraphStep
+{
+	FFrameGraphBarrier Barrier;
+	std::vector<uint32_t> Passes;
+};
+
+/**
+ * Steps executed by a single submit
+ */
+struct FFrameGraphBatch
+{
+	uint32_t Queue = 0;
+	std::vector<FFrameGraphStep> Steps;
+};
+
+/**
+ * Range of the execution order, given by FCompiledFrameGraph::GetPassOrder, in which a resource is used
+ */
+struct FFrameGraphResourceLifetime
+{
+	uint32_t FirstPass = 0;
+	uint32_t LastPass = 0;
+};
+
+struct FCompiledFrameGraph
+{
+	std::vector<FFrameGraphBatch> Batches;
+	std::unordered_map<std::string, FFrameGraphResourceLifetime> ResourceLifetimes;
+
+	/// Indices of the passes in the order they are executed
+	std::vector<uint32_t> GetPassOrder() const;
+	uint32_t GetBarrierCount() const;
+};
+
+/**
+ * Passes of a frame and the resources they access.
+ * Passes are added in the order they would be executed one by one, which defines the result of the frame.
+ * Compiling the graph sorts the passes topologically, so that independent passes share a step,
+ * and puts the barriers required by the accesses in front of the steps. Resources are expected to keep their layouts between passes,
+ * so the barriers are memory barriers only.
+ * The renderer turns the compiled graph into command buffers and submits them
+ */
+class FFrameGraph
+{
+public:
+	/// Returns the index of the pass
+	uint32_t AddPass(const FFrameGraphPass& Pass);
+	const std::vector<FFrameGraphPass>& GetPasses() const;
+
+	/// Passes that access the same resource, with at least one of them writing it, are never reordered or put into the same step.
+	/// Barriers aren't needed between submits, as the semaphores chaining them synchronize everything
+	FCompiledFrameGraph Compile() const;
+
+private:
+	std::vector<FFrameGraphPass> Passes;
+};
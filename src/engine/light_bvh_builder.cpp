@@ -0,0 +1,378 @@
+#include "light_bvh_builder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	/// Number of buckets the lights are binned into along every axis when looking for a split
+	constexpr uint32_t LIGHT_BVH_BUCKETS_COUNT = 12;
+
+	struct FCone
+	{
+		FVector3 Axis;
+		float CosTheta;
+	};
+
+	FCone UnionCones(const FCone& A, const FCone& B)
+	{
+		/// Omnidirectional lights are the usual case, their cones hold everything
+		if (A.CosTheta <= -1.f || B.CosTheta <= -1.f)
+		{
+			return {A.Axis, -1.f};
+		}
+
+		float ThetaA = std::acos(clamp(A.CosTheta, -1.f, 1.f));
+		float ThetaB = std::acos(clamp(B.CosTheta, -1.f, 1.f));
+		float ThetaD = std::acos(clamp(dot(A.Axis, B.Axis), -1.f, 1.f));
+
+		if (std::min(ThetaD + ThetaB, float(M_PI)) <= ThetaA)
+		{
+			return A;
+		}
+
+		if (std::min(ThetaD + ThetaA, float(M_PI)) <= ThetaB)
+		{
+			return B;
+		}
+
+		float ThetaO = (ThetaA + ThetaD + ThetaB) * 0.5f;
+
+		if (ThetaO >= float(M_PI))
+		{
+			return {A.Axis, -1.f};
+		}
+
+		/// Axis of A is rotated towards the axis of B, so that the new cone touches both
+		FVector3 RotationAxis = cross(A.Axis, B.Axis);
+
+		if (dot(RotationAxis, RotationAxis) == 0.f)
+		{
+			return {A.Axis, -1.f};
+		}
+
+		RotationAxis = normalize(RotationAxis);
+		float ThetaR = ThetaO - ThetaA;
+		FVector3 Axis = A.Axis * std::cos(ThetaR) + cross(RotationAxis, A.Axis) * std::sin(ThetaR);
+
+		return {normalize(Axis), std::cos(ThetaO)};
+	}
+
+	FVector3 GetCentroid(const FLightBounds& Bounds)
+	{
+		return (Bounds.BoundsMin + Bounds.BoundsMax) * 0.5f;
+	}
+
+	float GetSurfaceArea(const FLightBounds& Bounds)
+	{
+		FVector3 Diagonal = Bounds.BoundsMax - Bounds.BoundsMin;
+		return 2.f * (Diagonal.X * Diagonal.Y + Diagonal.Y * Diagonal.Z + Diagonal.Z * Diagonal.X);
+	}
+
+	/// Surface area orientation heuristic: power times the measure of the directions the lights emit to times the area of the bounds.
+	/// Thin nodes are penalized, so that splits along the longest axis are preferred
+	float EvaluateCost(const FLightBounds& Bounds, const FVector3& NodeDiagonal, uint32_t Axis)
+	{
+		/// Omnidirectional lights emit to the whole sphere, which saves the trigonometry for the usual case
+		float MOmega = 4.f * float(M_PI);
+
+		if (Bounds.CosThetaO > -1.f)
+		{
+			float ThetaO = std::acos(clamp(Bounds.CosThetaO, -1.f, 1.f));
+			float ThetaE = std::acos(clamp(Bounds.CosThetaE, -1.f, 1.f));
+			float ThetaW = std::min(ThetaO + ThetaE, float(M_PI));
+			float SinThetaO = std::sin(ThetaO);
+			MOmega = 2.f * float(M_PI) * (1.f - Bounds.CosThetaO) +
+				float(M_PI) / 2.f * (2.f * ThetaW * SinThetaO - std::cos(ThetaO - 2.f * ThetaW) - 2.f * ThetaO * SinThetaO + Bounds.CosThetaO);
+		}
+
+		float MaxExtent = std::max(NodeDiagonal.X, std::max(NodeDiagonal.Y, NodeDiagonal.Z));
+		float Kr = MaxExtent / NodeDiagonal[Axis];
+
+		return Bounds.Energy * MOmega * Kr * GetSurfaceArea(Bounds);
+	}
+
+	uint32_t CeilLog2(uint32_t Value)
+	{
+		uint32_t Result = 0;
+
+		while ((1ull << Result) < Value)
+		{
+			++Result;
+		}
+
+		return Result;
+	}
+
+	FLightBVHNode CreateNode(const FLightBounds& Bounds)
+	{
+		FLightBVHNode Node{};
+		Node.BoundsMin = Bounds.BoundsMin;
+		Node.Energy = Bounds.Energy;
+		Node.BoundsMax = Bounds.BoundsMax;
+		Node.CosThetaO = Bounds.CosThetaO;
+		Node.Axis = Bounds.Axis;
+		Node.CosThetaE = Bounds.CosThetaE;
+		Node.FirstChild = UINT32_MAX;
+		Node.SecondChild = UINT32_MAX;
+		return Node;
+	}
+
+	FLightBounds GetNodeBounds(const FLightBVHNode& Node)
+	{
+		FLightBounds Bounds;
+		Bounds.BoundsMin = Node.BoundsMin;
+		Bounds.BoundsMax = Node.BoundsMax;
+		Bounds.Energy = Node.Energy;
+		Bounds.Axis = Node.Axis;
+		Bounds.CosThetaO = Node.CosThetaO;
+		Bounds.CosThetaE = Node.CosThetaE;
+		return Bounds;
+	}
+
+	/// Lights are partitioned in place rather than through indices, so that every node reads its lights in a row
+	struct FLightRecord
+	{
+		FLightBounds Bounds;
+		FVector3 Centroid;
+		uint32_t LightIndex;
+	};
+
+	class FLightBVHBuilder
+	{
+	public:
+		explicit FLightBVHBuilder(const std::vector<FLightBounds>& LightsIn) : Nodes(std::max<size_t>(2 * LightsIn.size(), 2) - 1), NextNode(uint32_t(LightsIn.size()))
+		{
+			Records.resize(LightsIn.size());
+
+			for (uint32_t i = 0; i < Records.size(); ++i)
+			{
+				Records[i] = {LightsIn[i], GetCentroid(LightsIn[i]), i};
+			}
+		}
+
+		std::vector<FLightBVHNode> Build()
+		{
+			BuildNode(0, uint32_t(Records.size()), 0, 0);
+			return std::move(Nodes);
+		}
+
+	private:
+		uint32_t BuildNode(uint32_t Begin, uint32_t End, uint32_t Depth, uint32_t Trail)
+		{
+			if (End - Begin == 1)
+			{
+				uint32_t LightIndex = Records[Begin].LightIndex;
+				Nodes[LightIndex] = CreateNode(Records[Begin].Bounds);
+				Nodes[LightIndex].Trail = Trail;
+				return LightIndex;
+			}
+
+			/// Only the box matters for the split, cones and power of the node come from its children
+			FVector3 BoundsMin = Records[Begin].Bounds.BoundsMin;
+			FVector3 BoundsMax = Records[Begin].Bounds.BoundsMax;
+			FVector3 CentroidMin = Records[Begin].Centroid;
+			FVector3 CentroidMax = CentroidMin;
+
+			for (uint32_t i = Begin + 1; i < End; ++i)
+			{
+				auto& Light = Records[i].Bounds;
+				auto& Centroid = Records[i].Centroid;
+				BoundsMin = FVector3{std::min(BoundsMin.X, Light.BoundsMin.X), std::min(BoundsMin.Y, Light.BoundsMin.Y), std::min(BoundsMin.Z, Light.BoundsMin.Z)};
+				BoundsMax = FVector3{std::max(BoundsMax.X, Light.BoundsMax.X), std::max(BoundsMax.Y, Light.BoundsMax.Y), std::max(BoundsMax.Z, Light.BoundsMax.Z)};
+				CentroidMin = FVector3{std::min(CentroidMin.X, Centroid.X), std::min(CentroidMin.Y, Centroid.Y), std::min(CentroidMin.Z, Centroid.Z)};
+				CentroidMax = FVector3{std::max(CentroidMax.X, Centroid.X), std::max(CentroidMax.Y, Centroid.Y), std::max(CentroidMax.Z, Centroid.Z)};
+			}
+
+			uint32_t Middle = Begin;
+
+			/// Unbalanced splits could run out of bits of the trails, so once there're only enough of them for a balanced tree, lights are split in halves.
+			/// Two lights are always split in halves, there's nothing to choose from
+			if (End - Begin > 2 && Depth + 1 + CeilLog2(End - Begin - 1) <= LIGHT_BVH_MAX_DEPTH)
+			{
+				Middle = FindSplit(Begin, End, BoundsMax - BoundsMin, CentroidMin, CentroidMax);
+			}
+
+			if (Middle == Begin || Middle == End)
+			{
+				Middle = SplitInHalves(Begin, End, CentroidMin, CentroidMax);
+			}
+
+			/// Internal nodes are stored in the order they're visited from the root
+			uint32_t NodeIndex = NextNode++;
+			uint32_t FirstChild = BuildNode(Begin, Middle, Depth + 1, Trail);
+			uint32_t SecondChild = BuildNode(Middle, End, Depth + 1, Trail | (1u << Depth));
+
+			/// Unions of cones depend on the order, so the node bounds its children rather than its lights, which keeps every child inside of its parent
+			Nodes[NodeIndex] = CreateNode(Union(GetNodeBounds(Nodes[FirstChild]), GetNodeBounds(Nodes[SecondChild])));
+			Nodes[NodeIndex].FirstChild = FirstChild;
+			Nodes[NodeIndex].SecondChild = SecondChild;
+
+			return NodeIndex;
+		}
+
+		/// Partitions the lights by the cheapest bucket boundary, returns Begin if there's none
+		uint32_t FindSplit(uint32_t Begin, uint32_t End, const FVector3& NodeDiagonal, const FVector3& CentroidMin, const FVector3& CentroidMax)
+		{
+			float MinCost = INFINITY;
+			uint32_t MinCostAxis = 0;
+			uint32_t MinCostBucket = 0;
+			bool bAxisUsable[3];
+
+			for (uint32_t Axis = 0; Axis < 3; ++Axis)
+			{
+				bAxisUsable[Axis] = CentroidMax[Axis] > CentroidMin[Axis] && NodeDiagonal[Axis] > 0.f;
+			}
+
+			/// Buckets of all axes are filled in a single pass, lights are scattered in memory and reading them is the slow part
+			FLightBounds AxisBuckets[3][LIGHT_BVH_BUCKETS_COUNT];
+			bool bAxisBucketUsed[3][LIGHT_BVH_BUCKETS_COUNT] = {};
+
+			for (uint32_t i = Begin; i < End; ++i)
+			{
+				auto& Light = Records[i].Bounds;
+				auto& Centroid = Records[i].Centroid;
+
+				for (uint32_t Axis = 0; Axis < 3; ++Axis)
+				{
+					if (!bAxisUsable[Axis])
+					{
+						continue;
+					}
+
+					uint32_t Bucket = GetBucket(Centroid[Axis], CentroidMin[Axis], CentroidMax[Axis]);
+					AxisBuckets[Axis][Bucket] = bAxisBucketUsed[Axis][Bucket] ? Union(AxisBuckets[Axis][Bucket], Light) : Light;
+					bAxisBucketUsed[Axis][Bucket] = true;
+				}
+			}
+
+			for (uint32_t Axis = 0; Axis < 3; ++Axis)
+			{
+				if (!bAxisUsable[Axis])
+				{
+					continue;
+				}
+
+				auto& Buckets = AxisBuckets[Axis];
+				auto& bBucketUsed = bAxisBucketUsed[Axis];
+
+				/// Costs of everything below each boundary, then of everything above it.
+				/// A boundary followed by an empty bucket splits the lights like the next one, so it's skipped, which leaves few costs to compute for small nodes
+				float BelowCosts[LIGHT_BVH_BUCKETS_COUNT - 1];
+				FLightBounds Below = Buckets[0];
+				bool bBelowUsed = bBucketUsed[0];
+
+				for (uint32_t Boundary = 0; Boundary < LIGHT_BVH_BUCKETS_COUNT - 1; ++Boundary)
+				{
+					if (Boundary > 0 && bBucketUsed[Boundary])
+					{
+						Below = bBelowUsed ? Union(Below, Buckets[Boundary]) : Buckets[Boundary];
+						bBelowUsed = true;
+					}
+
+					BelowCosts[Boundary] = bBelowUsed && bBucketUsed[Boundary + 1] ? EvaluateCost(Below, NodeDiagonal, Axis) : INFINITY;
+				}
+
+				FLightBounds Above = Buckets[LIGHT_BVH_BUCKETS_COUNT - 1];
+				bool bAboveUsed = bBucketUsed[LIGHT_BVH_BUCKETS_COUNT - 1];
+
+				for (uint32_t Boundary = LIGHT_BVH_BUCKETS_COUNT - 1; Boundary-- > 0;)
+				{
+					if (Boundary < LIGHT_BVH_BUCKETS_COUNT - 2 && bBucketUsed[Boundary + 1])
+					{
+						Above = bAboveUsed ? Union(Above, Buckets[Boundary + 1]) : Buckets[Boundary + 1];
+						bAboveUsed = true;
+					}
+
+					if (!bBucketUsed[Boundary + 1])
+					{
+						continue;
+					}
+
+					float Cost = BelowCosts[Boundary] + EvaluateCost(Above, NodeDiagonal, Axis);
+
+					if (Cost < MinCost)
+					{
+						MinCost = Cost;
+						MinCostAxis = Axis;
+						MinCostBucket = Boundary;
+					}
+				}
+			}
+
+			if (MinCost == INFINITY)
+			{
+				return Begin;
+			}
+
+			auto Middle = std::partition(Records.begin() + Begin, Records.begin() + End, [&](const FLightRecord& Record)
+			{
+				return GetBucket(Record.Centroid[MinCostAxis], CentroidMin[MinCostAxis], CentroidMax[MinCostAxis]) <= MinCostBucket;
+			});
+
+			return uint32_t(Middle - Records.begin());
+		}
+
+		/// Splits the lights at the median of the centroids along the longest axis
+		uint32_t SplitInHalves(uint32_t Begin, uint32_t End, const FVector3& CentroidMin, const FVector3& CentroidMax)
+		{
+			FVector3 Extent = CentroidMax - CentroidMin;
+			uint32_t Axis = (Extent.X > Extent.Y && Extent.X > Extent.Z) ? 0 : (Extent.Y > Extent.Z ? 1 : 2);
+			uint32_t Middle = Begin + (End - Begin) / 2;
+
+			std::nth_element(Records.begin() + Begin, Records.begin() + Middle, Records.begin() + End, [&](const FLightRecord& A, const FLightRecord& B)
+			{
+				return A.Centroid[Axis] < B.Centroid[Axis];
+			});
+
+			return Middle;
+		}
+
+		static uint32_t GetBucket(float Centroid, float Min, float Max)
+		{
+			auto Bucket = uint32_t(float(LIGHT_BVH_BUCKETS_COUNT) * (Centroid - Min) / (Max - Min));
+			return std::min(Bucket, LIGHT_BVH_BUCKETS_COUNT - 1);
+		}
+
+		std::vector<FLightBVHNode> Nodes;
+		std::vector<FLightRecord> Records;
+		uint32_t NextNode = 0;
+	};
+}
+
+FLightBounds GetPointLightBounds(const FPointLight& PointLight)
+{
+	FLightBounds Bounds;
+	Bounds.BoundsMin = PointLight.Position;
+	Bounds.BoundsMax = PointLight.Position;
+	Bounds.Energy = PointLight.Power;
+	return Bounds;
+}
+
+FLightBounds Union(const FLightBounds& A, const FLightBounds& B)
+{
+	FLightBounds Result;
+	Result.BoundsMin = FVector3{std::min(A.BoundsMin.X, B.BoundsMin.X), std::min(A.BoundsMin.Y, B.BoundsMin.Y), std::min(A.BoundsMin.Z, B.BoundsMin.Z)};
+	Result.BoundsMax = FVector3{std::max(A.BoundsMax.X, B.BoundsMax.X), std::max(A.BoundsMax.Y, B.BoundsMax.Y), std::max(A.BoundsMax.Z, B.BoundsMax.Z)};
+	Result.Energy = A.Energy + B.Energy;
+
+	FCone Cone = UnionCones({A.Axis, A.CosThetaO}, {B.Axis, B.CosThetaO});
+	Result.Axis = Cone.Axis;
+	Result.CosThetaO = Cone.CosTheta;
+	Result.CosThetaE = std::min(A.CosThetaE, B.CosThetaE);
+
+	return Result;
+}
+
+std::vector<FLightBVHNode> BuildLightBVH(const std::vector<FLightBounds>& Lights)
+{
+	if (Lights.empty())
+	{
+		return {};
+	}
+
+	assert(Lights.size() < UINT32_MAX / 2 && "Too many lights for a light BVH");
+
+	return FLightBVHBuilder(Lights).Build();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "maths.h"
+#include "common_defines.h"
+#include "common_structures.h"
+
+#include <vector>
+
+/**
+ * What the light BVH knows about a light or a group of lights: where they are, how much they emit and where to
+ */
+struct FLightBounds
+{
+	FVector3 BoundsMin = {0.f, 0.f, 0.f};
+	FVector3 BoundsMax = {0.f, 0.f, 0.f};
+	float Energy = 0.f;
+	/// Cone bounding the normals of the lights. Omnidirectional lights have normals in every direction
+	FVector3 Axis = {0.f, 0.f, 1.f};
+	float CosThetaO = -1.f;
+	/// Angle the lights emit at beyond their normals, a half of the sphere for omnidirectional and area lights
+	float CosThetaE = 0.f;
+};
+
+FLightBounds GetPointLightBounds(const FPointLight& PointLight);
+/// Bounds of both, the cone of normals is the smallest one holding both cones
+FLightBounds Union(const FLightBounds& A, const FLightBounds& B);
+
+/// @brief Build a light BVH over the lights, splitting nodes by the surface area orientation heuristic of Conty Estevez and Kulla.
+/// The first Lights.size() nodes are the leaves in the order of the lights, internal nodes follow them starting from the root.
+/// Leaves are never deeper than LIGHT_BVH_MAX_DEPTH, so that their trails fit into 32 bits. Nothing is built for no lights
+std::vector<FLightBVHNode> BuildLightBVH(const std::vector<FLightBounds>& Lights);
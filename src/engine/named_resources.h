@@ -4,6 +4,7 @@ constexpr const char* THROUGHPUT_BUFFER = "ThroughputBuffer";
 constexpr const char* INITIAL_RAYS_BUFFER = "InitialRaysBuffer";
 constexpr const char* HITS_BUFFER = "HitsBuffer";
 constexpr const char* PIXEL_INDEX_BUFFER = "PixelIndexBuffer";
+constexpr const char* UNSORTED_PIXEL_INDEX_BUFFER = "UnsortedPixelIndexBuffer";
 constexpr const char* MATERIAL_INDEX_AOV_BUFFER = "MaterialIndicesAOVBuffer";
 constexpr const char* ACTIVE_RAY_COUNT_BUFFER = "ActiveRayCountBuffer";
 constexpr const char* CUMULATIVE_MATERIAL_COLOR_BUFFER = "CumulativeMaterialColorBuffer";
@@ -17,3 +18,10 @@ constexpr const char* DIRECTIONAL_LIGHTS_IMPORTANCE_BUFFER = "DirectionalLightsI
 constexpr const char* SPOT_LIGHTS_IMPORTANCE_BUFFER = "SpotLightsImportanceBuffer";
 constexpr const char* AREA_LIGHTS_IMPORTANCE_BUFFER = "AreaLightsImportanceBuffer";
 constexpr const char* MATERIAL_SYSTEM_DATA_BUFFER = "MaterialSystemDataBuffer";
+constexpr const char* LUMINANCE_MOMENTS_BUFFER = "LuminanceMomentsBuffer";
+constexpr const char* CONVERGENCE_MASK_BUFFER = "ConvergenceMaskBuffer";
+constexpr const char* CONVERGENCE_COUNTERS_BUFFER = "ConvergenceCountersBuffer";
+constexpr const char* CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER = "ConvergenceCountersSnapshotBuffer";
+
+/// Acceleration structures, named for the frame graph
+constexpr const char* TLAS_ACCELERATION_STRUCTURE = "TLAS";
@@ -124,6 +124,11 @@ FRender::FRender(uint32_t WidthIn, uint32_t HeightIn) : Width(WidthIn), Height(H
     TextureSignature.set(COORDINATOR().GetComponentType<ECS::COMPONENTS::FTextureComponent>());
     COORDINATOR().SetSystemSignature<ECS::SYSTEMS::FTextureSystem>(TextureSignature);
 
+    /// Systems that walk all of their entities do it in the order of the components they read
+    RenderableSystem->EnableSortingByComponentIndex<ECS::COMPONENTS::FDeviceRenderableComponent>();
+    MaterialSystem->EnableSortingByComponentIndex<ECS::COMPONENTS::FMaterialComponent>();
+    MeshSystem->EnableSortingByComponentIndex<ECS::COMPONENTS::FAccelerationStructureComponent>();
+
 	VK_CONTEXT()->InitManagerResources();
     CAMERA_SYSTEM()->Init(MaxFramesInFlight);
     RENDERABLE_SYSTEM()->Init(MaxFramesInFlight);
@@ -146,12 +151,6 @@ FRender::~FRender()
 {
 	Cleanup();
 
-	for (int i = 0; i < ImagesInFlight.size(); ++i)
-	{
-		vkDestroyFence(VK_CONTEXT()->LogicalDevice, ImagesInFlight[i], nullptr);
-		ImagesInFlight[i] = VK_NULL_HANDLE;
-	}
-
 	FreeIndependentResources();
 
 	ACCELERATION_STRUCTURE_SYSTEM()->Terminate();
@@ -205,19 +204,29 @@ int FRender::Init()
 	}
 
 	ImageAvailable.resize(MaxFramesInFlight);
+	VK_CONTEXT()->TimelineSchedule.SetFramesInFlight(MaxFramesInFlight);
 
-    for (int i = 0; i < MaxFramesInFlight; ++i)
-    {
-        ImagesInFlight.push_back(VK_CONTEXT()->CreateSignalledFence());
-    }
+	/// Presentation can't wait for timeline semaphores
+	if (!ExternalImageAvailable.empty())
+	{
+		for (int i = 0; i < MaxFramesInFlight; ++i)
+		{
+			RenderingFinished.push_back(VK_CONTEXT()->CreateSemaphore());
+			V::SetName(VK_CONTEXT()->LogicalDevice, RenderingFinished.back(), "Rendering finished", i);
+		}
+	}
 
 	AllocateDependentResources();
+	/// The master shader reads the point lights importance buffer the way the point light system fills it
+	POINT_LIGHT_SYSTEM()->SetSamplingMode(PointLightSamplingMode);
 
 	/// Create all required tasks
 	UpdateTLASTask 						= std::make_shared<FUpdateTLASTask>					(Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
 	ResetRenderIterations				= std::make_shared<FClearBufferTask>				(RENDER_ITERATION_BUFFER, 			Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
     ClearImageTask 						= std::make_shared<FClearImageTask>					("AccumulatorImage", 				Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
 	ClearCumulativeMaterialColorBuffer	= std::make_shared<FClearBufferTask>				(CUMULATIVE_MATERIAL_COLOR_BUFFER, 		Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice, 0x3F800000);
+	std::vector<std::string> ConvergenceBuffers{LUMINANCE_MOMENTS_BUFFER, CONVERGENCE_MASK_BUFFER, CONVERGENCE_COUNTERS_BUFFER};
+	ClearConvergenceTask				= std::make_shared<FClearBufferTask>				(ConvergenceBuffers, 				Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
 	ResetActiveRayCountTask 			= std::make_shared<FResetActiveRayCountTask>		(Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
 	std::vector<std::string> BuffersToCleanEachBounce{COUNTED_MATERIALS_PER_CHUNK_BUFFER};
 	ClearBuffersEachBounceTask 			= std::make_shared<FClearBufferTask>				(BuffersToCleanEachBounce , Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
@@ -229,9 +238,10 @@ int FRender::Init()
     ComputePrefixSumsDownSweepTask 		= std::make_shared<FComputePrefixSumsDownSweepTask>	(Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
     ComputeOffsetsPerMaterialTask 		= std::make_shared<FComputeOffsetsPerMaterialTask>	(Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
     SortMaterialsTask 					= std::make_shared<FSortMaterialsTask>				(Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
-	MasterShader 						= std::make_shared<FMasterShader>					(Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
+	MasterShader 						= std::make_shared<FMasterShader>					(Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice, MaterialPipelineMode, IBLSamplingMode, PointLightSamplingMode);
     MissTask 							= std::make_shared<FMissTask>						(Width, Height, RecursionDepth, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
     AccumulateTask 						= std::make_shared<FAccumulateTask>					(Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
+    ConvergenceTask 					= std::make_shared<FConvergenceTask>				(Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
     PassthroughTask 					= std::make_shared<FPassthroughTask>				(Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
 	AdvanceRenderCountTask 				= std::make_shared<FAdvanceRenderCount>				(Width, Height, 1, MaxFramesInFlight, VK_CONTEXT()->LogicalDevice);
 
@@ -241,8 +251,15 @@ int FRender::Init()
         PassthroughTask->RegisterOutput("PassthroughOutput" + std::to_string(i), TEXTURE_MANAGER()->GetFramebufferImage(FramebufferComponent.FramebufferName));
     }
 
+	FrameGraphs = {CreateFrameGraphSubmits(false), CreateFrameGraphSubmits(true)};
+
     RenderFrameIndex = 0;
 	Counter = 0;
+	ConvergedPixelCount = 0;
+	SkippedSampleCount = 0;
+	ConvergenceSnapshotFrames.assign(MaxFramesInFlight, 0);
+	ConvergenceSnapshotGenerations.assign(MaxFramesInFlight, 0);
+	++AccumulationGeneration;
     return 0;
 }
 
@@ -251,11 +268,13 @@ int FRender::Cleanup()
 	VK_CONTEXT()->WaitIdle();
 
 	FreeDependentResources();
+	FreeFrameGraphSubmits();
 
 	UpdateTLASTask 						= nullptr;
 	ResetRenderIterations				= nullptr;
     ClearImageTask 						= nullptr;
 	ClearCumulativeMaterialColorBuffer	= nullptr;
+	ClearConvergenceTask				= nullptr;
 	ResetActiveRayCountTask 			= nullptr;
 	ClearBuffersEachBounceTask			= nullptr;
 	ClearBuffersEachBounceTask			= nullptr;
@@ -270,13 +289,20 @@ int FRender::Cleanup()
 	MasterShader						= nullptr;
     MissTask 							= nullptr;
     AccumulateTask 						= nullptr;
+    ConvergenceTask 					= nullptr;
     PassthroughTask 					= nullptr;
 	AdvanceRenderCountTask				= nullptr;
 
 	ExternalTasks.clear();
 
     ImageAvailable.clear();
-    ImagesInFlight.clear();
+
+	for (auto& Semaphore : RenderingFinished)
+	{
+		vkDestroySemaphore(VK_CONTEXT()->LogicalDevice, Semaphore, nullptr);
+	}
+
+	RenderingFinished.clear();
 
     return 0;
 }
@@ -315,6 +341,56 @@ void FRender::SetAccumulateBounces(bool bAccumulateBounces)
 	bAnyUpdate = true;
 }
 
+void FRender::SetRussianRouletteStartDepth(uint32_t StartDepth)
+{
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(UTILITY_INFO_BUFFER, sizeof(uint32_t),  offsetof(FUtilityData, RussianRouletteStartDepth), &StartDepth);
+	bAnyUpdate = true;
+}
+
+void FRender::SetRussianRouletteMaxSurvivalProbability(float MaxSurvivalProbability)
+{
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(UTILITY_INFO_BUFFER, sizeof(float),  offsetof(FUtilityData, RussianRouletteMaxSurvivalProbability), &MaxSurvivalProbability);
+	bAnyUpdate = true;
+}
+
+void FRender::SetAdaptiveSamplingThreshold(float Threshold)
+{
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(UTILITY_INFO_BUFFER, sizeof(float),  offsetof(FUtilityData, AdaptiveSamplingThreshold), &Threshold);
+	bAnyUpdate = true;
+}
+
+void FRender::SetAdaptiveSamplingMinSamples(uint32_t MinSamples)
+{
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(UTILITY_INFO_BUFFER, sizeof(uint32_t),  offsetof(FUtilityData, AdaptiveSamplingMinSamples), &MinSamples);
+	bAnyUpdate = true;
+}
+
+void FRender::SetAdaptiveSamplingMaxSamples(uint32_t MaxSamples)
+{
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(UTILITY_INFO_BUFFER, sizeof(uint32_t),  offsetof(FUtilityData, AdaptiveSamplingMaxSamples), &MaxSamples);
+	bAnyUpdate = true;
+}
+
+void FRender::SetIBLCacheDirectory(const std::string& Directory)
+{
+	IMPORTANCE_MAP_CACHE()->SetDirectory(Directory);
+}
+
+bool FRender::IsConverged() const
+{
+	return ConvergedPixelCount >= Width * Height;
+}
+
+float FRender::GetSkippedSamplesFraction() const
+{
+	if (ConvergenceReadbackFrames == 0)
+	{
+		return 0.f;
+	}
+
+	return float(double(SkippedSampleCount) / (double(ConvergenceReadbackFrames) * Width * Height));
+}
+
 ECS::FEntity FRender::CreateCamera()
 {
     ECS::FEntity Camera = COORDINATOR().CreateEntity();
@@ -524,6 +600,7 @@ FSynchronizationPoint FRender::Render(uint32_t OutputImageIndex)
 	ComputePrefixSumsDownSweepTask->Reload();
 	ComputeOffsetsPerMaterialTask->Reload();
 	SortMaterialsTask->Reload();
+	ClearConvergenceTask->Reload();
 	FCompileDefinitions CompileDefinitions;
 	CompileDefinitions.Push("LAST_BOUNCE", std::to_string(RecursionDepth - 1));
 	CompileDefinitions.Push("LAST_DIFFUSE_BOUNCE", std::to_string(DiffuseRecursionDepth - 1));
@@ -532,6 +609,7 @@ FSynchronizationPoint FRender::Render(uint32_t OutputImageIndex)
 	MasterShader->Reload(&CompileDefinitions);
 	MissTask->Reload();
 	AccumulateTask->Reload();
+	ConvergenceTask->Reload();
 	PassthroughTask->Reload();
 	AdvanceRenderCountTask->Reload();
 
@@ -541,77 +619,87 @@ FSynchronizationPoint FRender::Render(uint32_t OutputImageIndex)
 	}
 
 
-	FSynchronizationPoint SynchronizationPoint = {{}, {ImagesInFlight[CurrentFrame]}, {}, {}};
+	FSynchronizationPoint SynchronizationPoint;
 
-	/// If we have no external semaphores
-	if (ExternalImageAvailable.empty())
+	/// Frames are chained on the GPU, so that a frame doesn't overwrite what the previous one still reads
+	if (RenderFrameIndex > 0)
 	{
-		/// We need to wait for the internal one, unless it's the first frame
-		if (RenderFrameIndex > 0)
-		{
-			SynchronizationPoint += ImageAvailable[(RenderFrameIndex - 1) % MaxFramesInFlight];
-		}
+		SynchronizationPoint += ImageAvailable[(RenderFrameIndex - 1) % MaxFramesInFlight];
 	}
-	else
+
+	if (!ExternalImageAvailable.empty())
 	{
 		SynchronizationPoint += ExternalImageAvailable[OutputImageIndex];
 	}
 
 	VkPipelineStageFlags PipelineStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 
-	SynchronizationPoint = UpdateTLASTask->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+	/// Submit data uploaded during the update. Frame tasks are submitted after them, so they will see the new data
+	RESOURCE_ALLOCATOR()->FlushUploads();
+	/// Finish readbacks started in previous frames, e.g. screenshots
+	RESOURCE_ALLOCATOR()->UpdateReadbacks();
 
-	if (bAnyUpdate || RenderFrameIndex == 0)
-	{
-		SynchronizationPoint = ResetRenderIterations->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+	/// Command buffers and per frame resources of the slot are reused once the frame that used the slot reaches its values, nothing else is waited for
+	std::vector<FTimelinePoint> FrameSlotReleased;
 
-		SynchronizationPoint = ClearImageTask->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+	for (auto& TimelineValue : VK_CONTEXT()->TimelineSchedule.BeginFrame(RenderFrameIndex))
+	{
+		FrameSlotReleased.push_back(VK_CONTEXT()->GetTimelinePoint(TimelineValue));
 	}
 
-	SynchronizationPoint = ClearCumulativeMaterialColorBuffer->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
-
-	//WaitIdle();
-	//auto BufferData = RESOURCE_ALLOCATOR()->DebugGetDataFromBuffer<float>("DebugBuffer");
-	//VK_CONTEXT()->SaveEXRWrapper(BufferData.data(), Width, Height, 4, false, "DebugBuffer.exr");
+	VK_CONTEXT()->WaitTimeline(FrameSlotReleased);
 
-	SynchronizationPoint = ResetActiveRayCountTask->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+	/// The frame that used the slot before is finished, so its copy of the adaptive sampling counters is complete and nothing writes it until this frame.
+	/// If the accumulation was reset since that frame, its counters are outdated, even if Counter already climbed past it again
+	uint32_t FramesAtSnapshot = ConvergenceSnapshotFrames[CurrentFrame];
 
-	for (uint32_t i = 0; i < RecursionDepth; ++i)
+	if (RenderFrameIndex % ConvergenceReadbackInterval == 0 && FramesAtSnapshot != 0 && ConvergenceSnapshotGenerations[CurrentFrame] == AccumulationGeneration)
 	{
-		SynchronizationPoint = ClearBuffersEachBounceTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = RayTraceTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = ClearTotalMaterialsCountTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = CountMaterialsPerChunkTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = ComputePrefixSumsUpSweepTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = ComputePrefixSumsZeroOutTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = ComputePrefixSumsDownSweepTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
+		uint32_t* Counters = ConvergenceCountersSnapshot + CurrentFrame * CONVERGENCE_COUNTERS_SIZE;
+		bool bWasConverged = IsConverged();
+		ConvergedPixelCount = Counters[CONVERGENCE_COUNTER_CONVERGED_PIXELS];
+		SkippedSampleCount = (uint64_t(Counters[CONVERGENCE_COUNTER_SKIPPED_SAMPLES_HIGH]) << 32) | Counters[CONVERGENCE_COUNTER_SKIPPED_SAMPLES_LOW];
+		ConvergenceReadbackFrames = FramesAtSnapshot;
 
-		SynchronizationPoint = ComputeOffsetsPerMaterialTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
-
-		SynchronizationPoint = SortMaterialsTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
+		if (!bWasConverged && IsConverged())
+		{
+			U::Log("Adaptive sampling converged after " + std::to_string(FramesAtSnapshot) + " frames, " + std::to_string(100.f * GetSkippedSamplesFraction()) + "% of the samples skipped");
+		}
+	}
 
-		SynchronizationPoint = MissTask->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
+	SubmitsPerFrame = 0;
+	/// If no external work to be done, then the last pass signals that the output can be presented
+	std::vector<VkSemaphore> SemaphoresToSignal;
 
-		SynchronizationPoint = MasterShader->Submit(PipelineStageFlags, SynchronizationPoint, i, CurrentFrame);
+	if (ExternalTasks.empty() && !RenderingFinished.empty())
+	{
+		SemaphoresToSignal.push_back(RenderingFinished[CurrentFrame]);
 	}
 
-	SynchronizationPoint = AccumulateTask->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
-
-	SynchronizationPoint = AdvanceRenderCountTask->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+	auto& FrameGraphSubmits = FrameGraphs[(bAnyUpdate || RenderFrameIndex == 0) ? 1 : 0];
+	/// The convergence task copies the counters of this frame into the snapshot slot of the frame
+	ConvergenceSnapshotFrames[CurrentFrame] = Counter + 1;
+	ConvergenceSnapshotGenerations[CurrentFrame] = AccumulationGeneration;
 
-	/// If no external work to be done, then use the internal fence in passthrough
-	if (ExternalTasks.empty())
+	if (bUseFrameGraph)
 	{
-		SynchronizationPoint.FencesToSignal.push_back(ImagesInFlight[CurrentFrame]);
+		SynchronizationPoint = SubmitFrameGraph(FrameGraphSubmits, SynchronizationPoint, CurrentFrame, SemaphoresToSignal);
 	}
+	else
+	{
+		for (uint32_t i = 0; i < FrameGraphSubmits.PassTasks.size(); ++i)
+		{
+			auto& [Task, X] = FrameGraphSubmits.PassTasks[i];
 
-	SynchronizationPoint = PassthroughTask->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+			if (i == FrameGraphSubmits.PassTasks.size() - 1)
+			{
+				SynchronizationPoint.SemaphoresToSignal = SemaphoresToSignal;
+			}
+
+			SynchronizationPoint = Task->Submit(PipelineStageFlags, SynchronizationPoint, X, CurrentFrame);
+			++SubmitsPerFrame;
+		}
+	}
 
 	//if (Counter == 256)
 	//{
@@ -635,13 +723,24 @@ FSynchronizationPoint FRender::Render(uint32_t OutputImageIndex)
 			SynchronizationPoint = ExternalTasks[i]->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
 		}
 
-		SynchronizationPoint.FencesToSignal.push_back(ImagesInFlight[CurrentFrame]);
+		if (!RenderingFinished.empty())
+		{
+			SynchronizationPoint.SemaphoresToSignal.push_back(RenderingFinished[CurrentFrame]);
+		}
+
 		SynchronizationPoint = ExternalTasks.back()->Submit(PipelineStageFlags, SynchronizationPoint, 0, CurrentFrame);
+
+		SubmitsPerFrame += ExternalTasks.size();
 	}
 
-	SynchronizationPoint.FencesToWait.push_back(ImagesInFlight[CurrentFrame]);
+	/// The next frame waits for the timeline value, the binary semaphore is left for the presentation
 	ImageAvailable[CurrentFrame] = SynchronizationPoint;
 
+	if (!RenderingFinished.empty())
+	{
+		SynchronizationPoint.SemaphoresToWait.push_back(RenderingFinished[CurrentFrame]);
+	}
+
     RenderFrameIndex++;
 	Counter++;
 
@@ -659,10 +758,30 @@ int FRender::Update()
 	bAnyUpdate |= SPOT_LIGHT_SYSTEM()->Update();
     bAnyUpdate |= AREA_LIGHT_SYSTEM()->Update();
 	bAnyUpdate |= ACCELERATION_STRUCTURE_SYSTEM()->Update();
-	bAnyUpdate |= MATERIAL_SYSTEM()->Update();
+	bool bMaterialsUpdated = MATERIAL_SYSTEM()->Update();
+	bAnyUpdate |= bMaterialsUpdated;
+
+	/// Constant material fields are folded into the shaders, so changing them requires new pipelines
+	if (bMaterialsUpdated && MasterShader != nullptr && MasterShader->AreMaterialsOutdated())
+	{
+		MasterShader->SetDirty(OUTDATED_PIPELINE | OUTDATED_COMMAND_BUFFER);
+		/// Old pipelines are destroyed on the next reload, so they must not be used by frames in flight
+		WaitIdle();
+	}
+
+	bAnyUpdate |= ReloadChangedShaders();
+	VK_CONTEXT()->FlushPipelineCache();
 
 	Counter = bAnyUpdate ? 0 : Counter;
 
+	if (bAnyUpdate)
+	{
+		++AccumulationGeneration;
+		ConvergedPixelCount = 0;
+		SkippedSampleCount = 0;
+		ConvergenceReadbackFrames = 0;
+	}
+
     if (bWasResized)
     {
         Init();
@@ -677,12 +796,66 @@ void FRender::WaitIdle()
 	VK_CONTEXT()->WaitIdle();
 }
 
+bool FRender::ReloadChangedShaders()
+{
+	if (ShaderFileWatcher == nullptr)
+	{
+		ShaderFileWatcher = std::make_unique<FShaderFileWatcher>(SHADER_DIRECTORY);
+		return false;
+	}
+
+	auto ChangedFiles = ShaderFileWatcher->PollChangedFiles();
+
+	if (ChangedFiles.empty())
+	{
+		return false;
+	}
+
+	/// Header changes affect every shader including it, directly or not
+	std::vector<std::string> AffectedShaders;
+
+	for (auto& ChangedFile : ChangedFiles)
+	{
+		SHADER_FILE_TABLE()->Invalidate(ChangedFile);
+		auto Shaders = SHADER_DEPENDENCY_GRAPH()->GetAffectedShaders(ChangedFile);
+		AffectedShaders.insert(AffectedShaders.end(), Shaders.begin(), Shaders.end());
+	}
+
+	std::vector<std::shared_ptr<FExecutableTask>> Tasks = {UpdateTLASTask, ResetRenderIterations, ClearImageTask, ClearCumulativeMaterialColorBuffer,
+		ResetActiveRayCountTask, ClearBuffersEachBounceTask, RayTraceTask, ClearTotalMaterialsCountTask, CountMaterialsPerChunkTask,
+		ComputePrefixSumsUpSweepTask, ComputePrefixSumsZeroOutTask, ComputePrefixSumsDownSweepTask, ComputeOffsetsPerMaterialTask,
+		SortMaterialsTask, MasterShader, MissTask, AccumulateTask, ConvergenceTask, PassthroughTask, AdvanceRenderCountTask};
+	Tasks.insert(Tasks.end(), ExternalTasks.begin(), ExternalTasks.end());
+
+	bool bAnyTaskOutdated = false;
+
+	for (auto& Task : Tasks)
+	{
+		if (Task != nullptr && Task->UsesAnyShader(AffectedShaders))
+		{
+			Task->SetDirty(OUTDATED_PIPELINE | OUTDATED_COMMAND_BUFFER);
+			bAnyTaskOutdated = true;
+		}
+	}
+
+	if (bAnyTaskOutdated)
+	{
+		/// Old pipelines are destroyed on the next reload, so they must not be used by frames in flight
+		WaitIdle();
+		U::Log("Shaders changed on the disk, rebuilding pipelines");
+	}
+
+	return bAnyTaskOutdated;
+}
+
 void FRender::Wait(FSynchronizationPoint& SynchronizationPoint)
 {
 	if(!SynchronizationPoint.FencesToWait.empty())
 	{
 		vkWaitForFences(VK_CONTEXT()->LogicalDevice, SynchronizationPoint.FencesToWait.size(), SynchronizationPoint.FencesToWait.data(), VK_TRUE, UINT64_MAX);
 	}
+
+	VK_CONTEXT()->WaitTimeline(SynchronizationPoint.TimelinePointsToWait);
 }
 
 ECS::FEntity FRender::CreateTexture(const std::string& FilePath)
@@ -1173,7 +1346,7 @@ void FRender::MaterialSetThinWalled(ECS::FEntity MaterialEntity, ECS::FEntity Te
 
 int FRender::SetIBL(const std::string& Path)
 {
-	auto IBLImage = VK_CONTEXT()->CreateEXRImageFromFile(Path, "V::IBL_Image");
+	auto IBLImage = VK_CONTEXT()->CreateEXRImageFromFile(Path, "V::IBL_Image", IBLSamplingMode);
 
     IBLImage->Transition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	TEXTURE_MANAGER()->RegisterIBL(IBLImage);
@@ -1375,13 +1548,22 @@ void FRender::AllocateDependentResources()
 		{INITIAL_RAYS_BUFFER, 				sizeof(FRayData) * Width * Height, 0},
 		{HITS_BUFFER, 						sizeof(FHit) * Width * Height, 	0},
 		{PIXEL_INDEX_BUFFER, 					sizeof(uint32_t) * Width * Height, 0},
+		{UNSORTED_PIXEL_INDEX_BUFFER, 		sizeof(uint32_t) * Width * Height, 0},
 		{MATERIAL_INDEX_AOV_BUFFER,			sizeof(uint32_t) * Width * Height, 0},
 		{COUNTED_MATERIALS_PER_CHUNK_BUFFER,	sizeof(uint32_t) * TOTAL_MATERIALS * CalculateMaxGroupCount(Width * Height, BASIC_CHUNK_SIZE),	VK_BUFFER_USAGE_TRANSFER_DST_BIT},
 		{CUMULATIVE_MATERIAL_COLOR_BUFFER, 	sizeof(FVector4) * Width * Height, VK_BUFFER_USAGE_TRANSFER_DST_BIT},
+		{LUMINANCE_MOMENTS_BUFFER, 			sizeof(FVector4) * Width * Height, VK_BUFFER_USAGE_TRANSFER_DST_BIT},
+		{CONVERGENCE_MASK_BUFFER, 			sizeof(uint32_t) * Width * Height, VK_BUFFER_USAGE_TRANSFER_DST_BIT},
 	};
 
 	CreateAndRegisterBufferShortcut(BufferDescriptions);
 
+	/// One copy of the adaptive sampling counters per frame in flight, read by the host once the frame that copied them is finished
+	auto ConvergenceCountersSnapshotBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(sizeof(uint32_t) * CONVERGENCE_COUNTERS_SIZE * MaxFramesInFlight,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER);
+	RESOURCE_ALLOCATOR()->RegisterBuffer(ConvergenceCountersSnapshotBuffer, CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER);
+	ConvergenceCountersSnapshot = static_cast<uint32_t*>(RESOURCE_ALLOCATOR()->Map(ConvergenceCountersSnapshotBuffer));
+
 	/// Create internal images
 	std::vector<FImageDescription> ImageDescriptions = {
 		{"ColorImage", 		Width, Height, VK_FORMAT_R32G32B32A32_SFLOAT},
@@ -1405,22 +1587,30 @@ void FRender::AllocateIndependentResources()
 	std::vector<FBufferDescription> BufferDescriptions = {
 		{RENDER_ITERATION_BUFFER,				sizeof(uint32_t),							VK_BUFFER_USAGE_TRANSFER_DST_BIT},
 		{TOTAL_COUNTED_MATERIALS_BUFFER,		sizeof(uint32_t) * TOTAL_MATERIALS * 3,	VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT},
-		{ACTIVE_RAY_COUNT_BUFFER, 				sizeof(uint32_t) * 3,						VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT},
+		{ACTIVE_RAY_COUNT_BUFFER, 				sizeof(uint32_t) * ACTIVE_RAY_COUNT_ARGUMENTS_SIZE,						VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT},
 		{MATERIALS_OFFSETS_PER_MATERIAL_BUFFER,	sizeof(uint32_t) * TOTAL_MATERIALS,	0},
-		{POINT_LIGHTS_IMPORTANCE_BUFFER, 		sizeof(FAliasTableEntry) * POINT_LIGHT_SYSTEM()->MAX_POINT_LIGHTS, 0},
+		{POINT_LIGHTS_IMPORTANCE_BUFFER, 		std::max(sizeof(FAliasTableEntry) * POINT_LIGHT_SYSTEM()->MAX_POINT_LIGHTS, sizeof(FLightBVHNode) * (2 * POINT_LIGHT_SYSTEM()->MAX_POINT_LIGHTS - 1)), 0},
 		{DIRECTIONAL_LIGHTS_IMPORTANCE_BUFFER,	sizeof(FAliasTableEntry) * DIRECTIONAL_LIGHT_SYSTEM()->MAX_DIRECTIONAL_LIGHTS, 0},
 		{SPOT_LIGHTS_IMPORTANCE_BUFFER,			sizeof(FAliasTableEntry) * SPOT_LIGHT_SYSTEM()->MAX_SPOT_LIGHTS, 0},
         {AREA_LIGHTS_IMPORTANCE_BUFFER, 		sizeof(uint64_t) * AREA_LIGHT_SYSTEM()->MAX_AREA_LIGHTS, 0},
+		{CONVERGENCE_COUNTERS_BUFFER,			sizeof(uint32_t) * CONVERGENCE_COUNTERS_SIZE,	VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT},
 	};
 
 	CreateAndRegisterBufferShortcut(BufferDescriptions);
 
+	/// Fields added to FUtilityData should either fill its padding or pad it to the next 16 bytes
+	static_assert(sizeof(FUtilityData) % 16 == 0, "Uniform buffer size should be a multiple of 16");
 	auto UtilityInfo = RESOURCE_ALLOCATOR()->CreateBuffer(sizeof(FUtilityData),
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, UTILITY_INFO_BUFFER);
 	RESOURCE_ALLOCATOR()->RegisterBuffer(UtilityInfo, UTILITY_INFO_BUFFER);
 
 	FUtilityData UtilityData{};
 	UtilityData.AccumulateFrames = true;
+	UtilityData.RussianRouletteStartDepth = 2;
+	UtilityData.RussianRouletteMaxSurvivalProbability = 0.95f;
+	UtilityData.AdaptiveSamplingMinSamples = 32;
+	UtilityData.AdaptiveSamplingMaxSamples = 4096;
+	UtilityData.AdaptiveSamplingThreshold = 0.01f;
 	RESOURCE_ALLOCATOR()->LoadDataToBuffer(UTILITY_INFO_BUFFER, sizeof(FUtilityData), 0, &UtilityData);
 }
 
@@ -1431,9 +1621,17 @@ void FRender::FreeDependentResources()
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(INITIAL_RAYS_BUFFER);
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(HITS_BUFFER);
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(PIXEL_INDEX_BUFFER);
+	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(UNSORTED_PIXEL_INDEX_BUFFER);
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(MATERIAL_INDEX_AOV_BUFFER);
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(CUMULATIVE_MATERIAL_COLOR_BUFFER);
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(COUNTED_MATERIALS_PER_CHUNK_BUFFER);
+	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(LUMINANCE_MOMENTS_BUFFER);
+	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(CONVERGENCE_MASK_BUFFER);
+
+	auto ConvergenceCountersSnapshotBuffer = RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER);
+	RESOURCE_ALLOCATOR()->Unmap(ConvergenceCountersSnapshotBuffer);
+	ConvergenceCountersSnapshot = nullptr;
+	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER);
 
 	/// Free images
 	TEXTURE_MANAGER()->UnregisterAndFreeFramebuffer("ColorImage");
@@ -1452,6 +1650,181 @@ void FRender::FreeIndependentResources()
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(DIRECTIONAL_LIGHTS_IMPORTANCE_BUFFER);
 	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(SPOT_LIGHTS_IMPORTANCE_BUFFER);
     RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(AREA_LIGHTS_IMPORTANCE_BUFFER);
+	RESOURCE_ALLOCATOR()->UnregisterAndDestroyBuffer(CONVERGENCE_COUNTERS_BUFFER);
+}
+
+static VkPipelineStageFlags ToVkPipelineStageFlags(uint32_t Stages)
+{
+	VkPipelineStageFlags PipelineStageFlags = 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_DRAW_INDIRECT) ? VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT : 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_COMPUTE_SHADER) ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_RAY_TRACING_SHADER) ? VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR : 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_FRAGMENT_SHADER) ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_COLOR_ATTACHMENT_OUTPUT) ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_TRANSFER) ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0;
+	PipelineStageFlags |= (Stages & FRAME_GRAPH_STAGE_ACCELERATION_STRUCTURE_BUILD) ? VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR : 0;
+	return PipelineStageFlags;
+}
+
+static VkAccessFlags ToVkAccessFlags(uint32_t Access)
+{
+	VkAccessFlags AccessFlags = 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ) ? VK_ACCESS_INDIRECT_COMMAND_READ_BIT : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_SHADER_READ) ? VK_ACCESS_SHADER_READ_BIT : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_SHADER_WRITE) ? VK_ACCESS_SHADER_WRITE_BIT : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE) ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_TRANSFER_READ) ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_TRANSFER_WRITE) ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_READ) ? VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR : 0;
+	AccessFlags |= (Access & FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_WRITE) ? VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR : 0;
+	return AccessFlags;
+}
+
+FRender::FFrameGraphSubmits FRender::CreateFrameGraphSubmits(bool bResetAccumulation)
+{
+	FFrameGraphSubmits FrameGraphSubmits;
+	FFrameGraph FrameGraph;
+
+	auto AddPass = [&](const std::shared_ptr<FExecutableTask>& Task, uint32_t X)
+	{
+		FrameGraph.AddPass({Task->Name, uint32_t(Task->QueueFlagsBits), Task->GetResourceAccesses()});
+		FrameGraphSubmits.PassTasks.emplace_back(Task, X);
+	};
+
+	/// Passes are added in the order they would be submitted one by one
+	AddPass(UpdateTLASTask, 0);
+
+	if (bResetAccumulation)
+	{
+		AddPass(ResetRenderIterations, 0);
+		AddPass(ClearImageTask, 0);
+		AddPass(ClearConvergenceTask, 0);
+	}
+
+	AddPass(ClearCumulativeMaterialColorBuffer, 0);
+	AddPass(ResetActiveRayCountTask, 0);
+
+	for (uint32_t i = 0; i < RecursionDepth; ++i)
+	{
+		AddPass(ClearBuffersEachBounceTask, i);
+		AddPass(RayTraceTask, i);
+		AddPass(ClearTotalMaterialsCountTask, i);
+		AddPass(CountMaterialsPerChunkTask, i);
+		AddPass(ComputePrefixSumsUpSweepTask, i);
+		AddPass(ComputePrefixSumsZeroOutTask, i);
+		AddPass(ComputePrefixSumsDownSweepTask, i);
+		AddPass(ComputeOffsetsPerMaterialTask, i);
+		AddPass(SortMaterialsTask, i);
+		AddPass(MissTask, i);
+		AddPass(MasterShader, i);
+	}
+
+	AddPass(AccumulateTask, 0);
+	AddPass(ConvergenceTask, 0);
+	AddPass(AdvanceRenderCountTask, 0);
+	AddPass(PassthroughTask, 0);
+
+	FrameGraphSubmits.CompiledFrameGraph = FrameGraph.Compile();
+	auto& Batches = FrameGraphSubmits.CompiledFrameGraph.Batches;
+
+	FrameGraphSubmits.BarrierCommandBuffers.resize(MaxFramesInFlight);
+
+	for (uint32_t i = 0; i < MaxFramesInFlight; ++i)
+	{
+		for (auto& Batch : Batches)
+		{
+			std::vector<VkCommandBuffer> StepsCommandBuffers;
+
+			for (auto& Step : Batch.Steps)
+			{
+				if (Step.Barrier.IsEmpty())
+				{
+					StepsCommandBuffers.push_back(VK_NULL_HANDLE);
+					continue;
+				}
+
+				StepsCommandBuffers.push_back(COMMAND_BUFFER_MANAGER()->RecordCommand([&](VkCommandBuffer CommandBuffer)
+				{
+					/// Tasks keep the layouts of their images, so a global memory barrier is enough
+					VkMemoryBarrier MemoryBarrier{};
+					MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+					MemoryBarrier.srcAccessMask = ToVkAccessFlags(Step.Barrier.SrcAccess);
+					MemoryBarrier.dstAccessMask = ToVkAccessFlags(Step.Barrier.DstAccess);
+					vkCmdPipelineBarrier(CommandBuffer, ToVkPipelineStageFlags(Step.Barrier.SrcStages), ToVkPipelineStageFlags(Step.Barrier.DstStages), 0,
+						1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+				}, VkQueueFlagBits(Batch.Queue)));
+
+				V::SetName(VK_CONTEXT()->LogicalDevice, StepsCommandBuffers.back(), "Frame graph barrier", i);
+			}
+
+			FrameGraphSubmits.BarrierCommandBuffers[i].push_back(StepsCommandBuffers);
+		}
+	}
+
+	return FrameGraphSubmits;
+}
+
+void FRender::FreeFrameGraphSubmits()
+{
+	for (auto& FrameGraphSubmits : FrameGraphs)
+	{
+		auto& Batches = FrameGraphSubmits.CompiledFrameGraph.Batches;
+
+		for (auto& BatchesCommandBuffers : FrameGraphSubmits.BarrierCommandBuffers)
+		{
+			for (uint32_t i = 0; i < Batches.size(); ++i)
+			{
+				for (auto& CommandBuffer : BatchesCommandBuffers[i])
+				{
+					if (CommandBuffer != VK_NULL_HANDLE)
+					{
+						COMMAND_BUFFER_MANAGER()->FreeCommandBuffer(CommandBuffer, VkQueueFlagBits(Batches[i].Queue));
+					}
+				}
+			}
+		}
+	}
+
+	FrameGraphs.clear();
+}
+
+FSynchronizationPoint FRender::SubmitFrameGraph(FFrameGraphSubmits& FrameGraphSubmits, FSynchronizationPoint SynchronizationPoint, uint32_t CurrentFrame, const std::vector<VkSemaphore>& SemaphoresToSignal)
+{
+	auto& Batches = FrameGraphSubmits.CompiledFrameGraph.Batches;
+
+	for (uint32_t i = 0; i < Batches.size(); ++i)
+	{
+		std::vector<VkCommandBuffer> CommandBuffers;
+
+		for (uint32_t j = 0; j < Batches[i].Steps.size(); ++j)
+		{
+			auto BarrierCommandBuffer = FrameGraphSubmits.BarrierCommandBuffers[CurrentFrame][i][j];
+
+			if (BarrierCommandBuffer != VK_NULL_HANDLE)
+			{
+				CommandBuffers.push_back(BarrierCommandBuffer);
+			}
+
+			for (auto Pass : Batches[i].Steps[j].Passes)
+			{
+				auto& [Task, X] = FrameGraphSubmits.PassTasks[Pass];
+				CommandBuffers.push_back(Task->GetCommandBuffer(X, CurrentFrame));
+				Task->TaskStates[CurrentFrame] = SUBMITTED;
+			}
+		}
+
+		/// The last batch signals what the caller asked for, every batch signals the next value of its queue's timeline
+		if (i == Batches.size() - 1)
+		{
+			SynchronizationPoint.SemaphoresToSignal = SemaphoresToSignal;
+		}
+
+		/// Nothing in the batch runs before the semaphores are signalled, barriers inside the batch take care of the rest
+		SynchronizationPoint = VK_CONTEXT()->Submit(VkQueueFlagBits(Batches[i].Queue), CommandBuffers, SynchronizationPoint, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		++SubmitsPerFrame;
+	}
+
+	return SynchronizationPoint;
 }
 
 void FRender::CreateAndRegisterBufferShortcut(const std::vector<FBufferDescription>& BufferDescriptions)
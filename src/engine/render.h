@@ -22,13 +22,18 @@
 #include "tasks/task_master_shader.h"
 #include "tasks/task_miss.h"
 #include "tasks/task_accumulate.h"
+#include "tasks/task_convergence.h"
 #include "tasks/task_passthrough.h"
 #include "tasks/task_advance_render_count.h"
 
 #include "components/material_component.h"
 
+#include "frame_graph.h"
 #include "renderer_options.h"
 
+#include "common_defines.h"
+
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -46,6 +51,22 @@ public:
 	void SetRenderTarget(EOutputType OutputType);
 	void SetAccumulateFrames(bool bAccumulateFrames);
 	void SetAccumulateBounces(bool bAccumulateBounces);
+	/// Bounces every path goes through before Russian roulette can terminate it, set it to the recursion depth to disable the roulette
+	void SetRussianRouletteStartDepth(uint32_t StartDepth);
+	/// Upper bound of the survival probability, lower values terminate more paths, 1 lets paths with full throughput always go on
+	void SetRussianRouletteMaxSurvivalProbability(float MaxSurvivalProbability);
+	/// Relative error of the pixel luminance under which pixels stop being sampled, 0 disables adaptive sampling
+	void SetAdaptiveSamplingThreshold(float Threshold);
+	/// Samples every pixel gets before its error is trusted
+	void SetAdaptiveSamplingMinSamples(uint32_t MinSamples);
+	/// Samples after which pixels stop being sampled whatever their error is
+	void SetAdaptiveSamplingMaxSamples(uint32_t MaxSamples);
+	/// Where importance tables of environment maps are kept between runs, empty string disables the cache. Takes effect on the next SetIBL
+	void SetIBLCacheDirectory(const std::string& Directory);
+	/// Every pixel converged, so further frames don't change the image. Offline renders can stop here. Lags up to ConvergenceReadbackInterval plus the frames in flight behind the submitted frames
+	bool IsConverged() const;
+	/// Part of the samples since the accumulation was reset that adaptive sampling skipped
+	float GetSkippedSamplesFraction() const;
 
     ECS::FEntity CreateCamera();
     void SetActiveCamera(ECS::FEntity Camera);
@@ -70,6 +91,8 @@ public:
     FSynchronizationPoint Render(uint32_t OutputImageIndex);
     int Update();
 	void WaitIdle();
+	/// Rebuild pipelines of the tasks that use shaders changed on the disk since the last call. Returns true if any pipeline is going to be rebuilt
+	bool ReloadChangedShaders();
 	void Wait(FSynchronizationPoint& SynchronizationPoint);
 
 	/// Materials creation
@@ -203,8 +226,25 @@ public:
     bool bWasResized = false;
 
     uint32_t MaxFramesInFlight = 2;
+	/// Submit the passes of a frame batched by the frame graph, with barriers between them, instead of submitting every pass on its own
+	bool bUseFrameGraph = true;
+	/// Number of vkQueueSubmit calls made by the last Render call
+	uint32_t SubmitsPerFrame = 0;
+	/// Read by Init, so it must be set before it
+	EMaterialPipelineMode MaterialPipelineMode = EMaterialPipelineMode::PerMaterial;
+	/// Read by Init and SetIBL, so it must be set before them
+	EIBLSamplingMode IBLSamplingMode = EIBLSamplingMode::AliasTable;
+	/// Read by Init, so it must be set before it. The light BVH pays off with many point lights, the alias table ignores where they are
+	ELightSamplingMode PointLightSamplingMode = ELightSamplingMode::AliasTable;
     uint32_t RenderFrameIndex = 0;
 	uint32_t Counter = 0;
+	/// Adaptive sampling counters are read every this many frames
+	uint32_t ConvergenceReadbackInterval = 16;
+	/// Values of the adaptive sampling counters at the last readback
+	uint32_t ConvergedPixelCount = 0;
+	uint64_t SkippedSampleCount = 0;
+	/// Frames accumulated when the counters were read back
+	uint32_t ConvergenceReadbackFrames = 0;
 
     ECS::FEntity ActiveCamera;
 
@@ -212,6 +252,7 @@ public:
 	std::shared_ptr<FClearBufferTask> ResetRenderIterations = nullptr;
     std::shared_ptr<FClearImageTask> ClearImageTask = nullptr;
 	std::shared_ptr<FClearBufferTask> ClearCumulativeMaterialColorBuffer = nullptr;
+	std::shared_ptr<FClearBufferTask> ClearConvergenceTask = nullptr;
 	std::shared_ptr<FResetActiveRayCountTask> ResetActiveRayCountTask = nullptr;
 	std::shared_ptr<FClearBufferTask> ClearBuffersEachBounceTask = nullptr;
     std::shared_ptr<FRaytraceTask> RayTraceTask = nullptr;
@@ -225,12 +266,15 @@ public:
 	std::shared_ptr<FMasterShader> MasterShader = nullptr;
     std::shared_ptr<FMissTask> MissTask = nullptr;
     std::shared_ptr<FAccumulateTask> AccumulateTask = nullptr;
+    std::shared_ptr<FConvergenceTask> ConvergenceTask = nullptr;
     std::shared_ptr<FPassthroughTask> PassthroughTask = nullptr;
 	std::shared_ptr<FAdvanceRenderCount> AdvanceRenderCountTask = nullptr;
 	std::vector<std::shared_ptr<FExecutableTask>> ExternalTasks;
 
+    /// Timeline values reached by the frames
     std::vector<FSynchronizationPoint> ImageAvailable;
-    std::vector<VkFence> ImagesInFlight;
+    /// Binary semaphores signalled by the frames, for the presentation of the external outputs
+    std::vector<VkSemaphore> RenderingFinished;
 
 	std::vector<FSynchronizationPoint> ExternalImageAvailable;
     std::vector<ECS::FEntity> OutputFramebuffers;
@@ -257,6 +301,23 @@ private:
 		VkFormat Format;
 	};
 
+	/**
+	 * Passes of a frame, compiled into submits, and what's needed to submit them
+	 */
+	struct FFrameGraphSubmits
+	{
+		/// Task and bounce of every pass in the graph
+		std::vector<std::pair<std::shared_ptr<FExecutableTask>, uint32_t>> PassTasks;
+		FCompiledFrameGraph CompiledFrameGraph;
+		/// Command buffers with the barriers in front of the steps, per frame in flight, batch and step. VK_NULL_HANDLE for steps without a barrier
+		std::vector<std::vector<std::vector<VkCommandBuffer>>> BarrierCommandBuffers;
+	};
+
+	FFrameGraphSubmits CreateFrameGraphSubmits(bool bResetAccumulation);
+	void FreeFrameGraphSubmits();
+	/// Batches are chained with the timeline semaphores of their queues, the last one also signals SemaphoresToSignal
+	FSynchronizationPoint SubmitFrameGraph(FFrameGraphSubmits& FrameGraphSubmits, FSynchronizationPoint SynchronizationPoint, uint32_t CurrentFrame, const std::vector<VkSemaphore>& SemaphoresToSignal);
+
 	void CreateAndRegisterBufferShortcut(const std::vector<FBufferDescription>& BufferDescriptions);
 	void CreateRegisterAndTransitionImageShortcut(const std::vector<FImageDescription>& ImageDescriptions);
 
@@ -267,6 +328,18 @@ private:
 	uint32_t ReflectionRecursionDepth = 4;
 	uint32_t RefractionRecursionDepth = 7;
 	bool bAnyUpdate = false;
+	/// Mapped CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER, CONVERGENCE_COUNTERS_SIZE counters per frame in flight
+	uint32_t* ConvergenceCountersSnapshot = nullptr;
+	/// Frames accumulated by the last frame of every frame in flight slot, 0 if the slot has no counters yet
+	std::vector<uint32_t> ConvergenceSnapshotFrames;
+	/// Incremented every time the accumulation is reset, a snapshot is only valid while it matches
+	uint32_t AccumulationGeneration = 0;
+	/// AccumulationGeneration of the last frame of every frame in flight slot
+	std::vector<uint32_t> ConvergenceSnapshotGenerations;
+	/// Frame graphs of the frames that keep and that reset the accumulation
+	std::vector<FFrameGraphSubmits> FrameGraphs;
+	/// Watches the shader directory, so that edited shaders and headers are picked up without restarting
+	std::unique_ptr<FShaderFileWatcher> ShaderFileWatcher = nullptr;
 	std::chrono::time_point<std::chrono::steady_clock> Time;
 	std::chrono::time_point<std::chrono::steady_clock> PreviousTime;
 };
\ No newline at end of file
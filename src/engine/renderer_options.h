@@ -66,6 +66,20 @@ enum class EOutputType {
 	DebugLayer7							= AOV_DEBUG_LAYER_7,
 	Max 								= AOV_MAX};
 
+/// How the master shader handles different materials
+enum class EMaterialPipelineMode {
+	/// Every material gets its own ray tracing pipeline with the material baked in, rays are traced once per material
+	PerMaterial,
+	/// Single pipeline reads materials from the material buffer at runtime, rays of all materials are traced at once
+	Uber};
+
+/// How point lights are importance sampled
+enum class ELightSamplingMode {
+	/// Alias table over the power of the lights, the same for every point of the scene
+	AliasTable,
+	/// Light BVH, lights are picked by their power, distance and orientation relative to the shading point, see light_bvh.h in shaders
+	BVH};
+
 struct FRenderState
 {
 	EOutputType RenderTarget = EOutputType::Color;
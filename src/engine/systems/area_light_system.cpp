@@ -24,7 +24,8 @@ namespace ECS
 
 			if (bAreaLightAddressTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FAreaLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FAreaLightComponent>(),
+				auto AreaLights = COORDINATOR().GatherData<ECS::COMPONENTS::FAreaLightComponent>();
+				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FAreaLightComponent>(AreaLights.data(),
 					CurrentAreaLightsCount, 1, [](ECS::COMPONENTS::FAreaLightComponent Component){return double(Component.Area);});
 
 				RESOURCE_ALLOCATOR()->LoadDataToBuffer(AREA_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
@@ -61,7 +62,8 @@ namespace ECS
 
 			if (bAreaLightAddressTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FAreaLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FAreaLightComponent>(),
+				auto AreaLights = COORDINATOR().GatherData<ECS::COMPONENTS::FAreaLightComponent>();
+				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FAreaLightComponent>(AreaLights.data(),
 					CurrentAreaLightsCount, 1, [](ECS::COMPONENTS::FAreaLightComponent Component){return double(Component.Area);});
 
 				RESOURCE_ALLOCATOR()->LoadDataToBuffer(AREA_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
@@ -22,7 +22,8 @@ namespace ECS
 
 			if (bAliasTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FDirectionalLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FDirectionalLightComponent>(),
+				auto DirectionalLights = COORDINATOR().GatherData<ECS::COMPONENTS::FDirectionalLightComponent>();
+				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FDirectionalLightComponent>(DirectionalLights.data(),
 					CurrentDirectionalLightsCount, 1, [](ECS::COMPONENTS::FDirectionalLightComponent Component){return double(Component.Power);});
 
 				RESOURCE_ALLOCATOR()->LoadDataToBuffer(DIRECTIONAL_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
@@ -59,7 +60,8 @@ namespace ECS
 
 			if (bAliasTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FDirectionalLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FDirectionalLightComponent>(),
+				auto DirectionalLights = COORDINATOR().GatherData<ECS::COMPONENTS::FDirectionalLightComponent>();
+				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FDirectionalLightComponent>(DirectionalLights.data(),
 					CurrentDirectionalLightsCount, 1, [](ECS::COMPONENTS::FDirectionalLightComponent Component){return double(Component.Power);});
 
 				RESOURCE_ALLOCATOR()->LoadDataToBuffer(DIRECTIONAL_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
@@ -46,7 +46,10 @@ namespace ECS
 
                     for (auto Entity : EntitiesToUpdate[Index])
                     {
-                        if (Offsets.size() > 0 && ((COORDINATOR().GetOffset<T>(Entity) + DeviceBufferBaseOffset) == Offsets.back() + Sizes.back()))
+                        /// Components are merged into a single region only if they are adjacent both in the device buffer and in the host memory,
+                        /// since component arrays are paged and two neighbouring components might be stored in different pages
+                        if (Offsets.size() > 0 && ((COORDINATOR().GetOffset<T>(Entity) + DeviceBufferBaseOffset) == Offsets.back() + Sizes.back())
+                            && COORDINATOR().Data<T>(Entity) == static_cast<char*>(Data.back()) + Sizes.back())
                         {
                             Sizes.back() += sizeof(T);
                         }
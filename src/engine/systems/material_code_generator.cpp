@@ -0,0 +1,253 @@
+#include "material_code_generator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <optional>
+#include <sstream>
+
+namespace
+{
+	std::string SampleFunctionName(EMaterialFieldType Type)
+	{
+		switch (Type)
+		{
+			case EMaterialFieldType::Float: return "SampleFloat";
+			case EMaterialFieldType::Vec3: return "SampleVec3";
+		}
+
+		assert(false && "Unknown material field type");
+		return "";
+	}
+
+	/// Offsets in the generated code are in floats, not in bytes
+	uint32_t ToFloatOffset(uint32_t Offset)
+	{
+		assert((Offset % sizeof(float)) == 0);
+		return Offset / sizeof(float);
+	}
+
+	/// Either reads the constant value of the field, or samples the texture
+	std::string GenerateFieldRead(const FMaterialFieldDescription& Field, const std::string& MaterialIndex, bool bTextured)
+	{
+		if (!bTextured)
+		{
+			return SampleFunctionName(Field.Type) + "(" + MaterialIndex + ", " + std::to_string(ToFloatOffset(Field.DataOffset)) + ")";
+		}
+
+		std::string Result = SampleFunctionName(Field.Type) + "(" + MaterialIndex + ", " + std::to_string(ToFloatOffset(Field.TextureOffset)) + ", TextureCoords)";
+
+		/// If we sample a texture, in some cases it might be in sRGB format, and we need to translate it to linear color space
+		if (Field.bConvertToLinear)
+		{
+			Result = "SRGBToLinear(" + Result + ")";
+		}
+
+		return Result;
+	}
+
+	template <typename T>
+	T ReadField(const FDeviceMaterial& Material, uint32_t Offset)
+	{
+		T Value;
+		std::memcpy(&Value, reinterpret_cast<const char*>(&Material) + Offset, sizeof(T));
+		return Value;
+	}
+
+	bool IsTextured(const FDeviceMaterial& Material, const FMaterialFieldDescription& Field)
+	{
+		return UINT32_MAX != ReadField<uint32_t>(Material, Field.TextureOffset);
+	}
+
+	/// Enough digits to get exactly the same float back
+	std::string FloatToLiteral(float Value)
+	{
+		std::ostringstream Stream;
+		Stream << std::setprecision(std::numeric_limits<float>::max_digits10) << Value;
+		std::string Result = Stream.str();
+
+		/// "1" would be an int in GLSL
+		if (Result.find_first_of(".e") == std::string::npos)
+		{
+			Result += ".0";
+		}
+
+		return Result;
+	}
+
+	/// Returns nothing if the value can't be written in GLSL, like NaN or infinity
+	std::optional<std::string> GenerateFieldLiteral(const FDeviceMaterial& Material, const FMaterialFieldDescription& Field)
+	{
+		switch (Field.Type)
+		{
+			case EMaterialFieldType::Float:
+			{
+				float Value = ReadField<float>(Material, Field.DataOffset);
+
+				if (!std::isfinite(Value))
+				{
+					return std::nullopt;
+				}
+
+				return FloatToLiteral(Value);
+			}
+			case EMaterialFieldType::Vec3:
+			{
+				FVector3 Value = ReadField<FVector3>(Material, Field.DataOffset);
+
+				if (!std::isfinite(Value.X) || !std::isfinite(Value.Y) || !std::isfinite(Value.Z))
+				{
+					return std::nullopt;
+				}
+
+				return "vec3(" + FloatToLiteral(Value.X) + ", " + FloatToLiteral(Value.Y) + ", " + FloatToLiteral(Value.Z) + ")";
+			}
+		}
+
+		assert(false && "Unknown material field type");
+		return std::nullopt;
+	}
+}
+
+const std::vector<FMaterialFieldDescription>& GetMaterialFieldDescriptions()
+{
+	static const std::vector<FMaterialFieldDescription> MaterialFieldDescriptions = {
+		{"BaseWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, BaseWeight), offsetof(FDeviceMaterial, BaseWeightTexture)},
+		{"BaseColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, BaseColor), offsetof(FDeviceMaterial, BaseColorTexture), true},
+		{"DiffuseRoughness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, DiffuseRoughness), offsetof(FDeviceMaterial, DiffuseRoughnessTexture)},
+		{"Metalness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, Metalness), offsetof(FDeviceMaterial, MetalnessTexture)},
+		{"Normal", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, Normal), offsetof(FDeviceMaterial, NormalTexture)},
+		{"SpecularWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SpecularWeight), offsetof(FDeviceMaterial, SpecularWeightTexture)},
+		{"SpecularColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, SpecularColor), offsetof(FDeviceMaterial, SpecularColorTexture), true},
+		{"SpecularRoughness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SpecularRoughness), offsetof(FDeviceMaterial, SpecularRoughnessTexture)},
+		{"SpecularIOR", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SpecularIOR), offsetof(FDeviceMaterial, SpecularIORTexture)},
+		{"SpecularAnisotropy", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SpecularAnisotropy), offsetof(FDeviceMaterial, SpecularAnisotropyTexture)},
+		{"SpecularRotation", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SpecularRotation), offsetof(FDeviceMaterial, SpecularRotationTexture)},
+		{"TransmissionWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, TransmissionWeight), offsetof(FDeviceMaterial, TransmissionWeightTexture)},
+		{"TransmissionColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, TransmissionColor), offsetof(FDeviceMaterial, TransmissionColorTexture), true},
+		{"TransmissionDepth", EMaterialFieldType::Float, offsetof(FDeviceMaterial, TransmissionDepth), offsetof(FDeviceMaterial, TransmissionDepthTexture)},
+		{"TransmissionScatter", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, TransmissionScatter), offsetof(FDeviceMaterial, TransmissionScatterTexture)},
+		{"TransmissionAnisotropy", EMaterialFieldType::Float, offsetof(FDeviceMaterial, TransmissionAnisotropy), offsetof(FDeviceMaterial, TransmissionAnisotropyTexture)},
+		{"TransmissionDispersion", EMaterialFieldType::Float, offsetof(FDeviceMaterial, TransmissionDispersion), offsetof(FDeviceMaterial, TransmissionDispersionTexture)},
+		{"TransmissionRoughness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, TransmissionRoughness), offsetof(FDeviceMaterial, TransmissionRoughnessTexture)},
+		{"SubsurfaceWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SubsurfaceWeight), offsetof(FDeviceMaterial, SubsurfaceWeightTexture)},
+		{"SubsurfaceColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, SubsurfaceColor), offsetof(FDeviceMaterial, SubsurfaceColorTexture), true},
+		{"SubsurfaceRadius", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, SubsurfaceRadius), offsetof(FDeviceMaterial, SubsurfaceRadiusTexture)},
+		{"SubsurfaceScale", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SubsurfaceScale), offsetof(FDeviceMaterial, SubsurfaceScaleTexture)},
+		{"SubsurfaceAnisotropy", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SubsurfaceAnisotropy), offsetof(FDeviceMaterial, SubsurfaceAnisotropyTexture)},
+		{"SheenWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SheenWeight), offsetof(FDeviceMaterial, SheenWeightTexture)},
+		{"SheenColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, SheenColor), offsetof(FDeviceMaterial, SheenColorTexture), true},
+		{"SheenRoughness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, SheenRoughness), offsetof(FDeviceMaterial, SheenRoughnessTexture)},
+		{"CoatWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatWeight), offsetof(FDeviceMaterial, CoatWeightTexture)},
+		{"CoatColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, CoatColor), offsetof(FDeviceMaterial, CoatColorTexture), true},
+		{"CoatRoughness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatRoughness), offsetof(FDeviceMaterial, CoatRoughnessTexture)},
+		{"CoatAnisotropy", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatAnisotropy), offsetof(FDeviceMaterial, CoatAnisotropyTexture)},
+		{"CoatRotation", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatRotation), offsetof(FDeviceMaterial, CoatRotationTexture)},
+		{"CoatIOR", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatIOR), offsetof(FDeviceMaterial, CoatIORTexture)},
+		{"CoatNormal", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, CoatNormal), offsetof(FDeviceMaterial, CoatNormalTexture)},
+		{"CoatAffectColor", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatAffectColor), offsetof(FDeviceMaterial, CoatAffectColorTexture)},
+		{"CoatAffectRoughness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, CoatAffectRoughness), offsetof(FDeviceMaterial, CoatAffectRoughnessTexture)},
+		{"ThinFilmThickness", EMaterialFieldType::Float, offsetof(FDeviceMaterial, ThinFilmThickness), offsetof(FDeviceMaterial, ThinFilmThicknessTexture)},
+		{"ThinFilmIOR", EMaterialFieldType::Float, offsetof(FDeviceMaterial, ThinFilmIOR), offsetof(FDeviceMaterial, ThinFilmIORTexture)},
+		{"EmissionWeight", EMaterialFieldType::Float, offsetof(FDeviceMaterial, EmissionWeight), offsetof(FDeviceMaterial, EmissionWeightTexture)},
+		{"EmissionColor", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, EmissionColor), offsetof(FDeviceMaterial, EmissionColorTexture), true},
+		{"Opacity", EMaterialFieldType::Vec3, offsetof(FDeviceMaterial, Opacity), offsetof(FDeviceMaterial, OpacityTexture)},
+	};
+
+	return MaterialFieldDescriptions;
+}
+
+std::string GenerateMaterialCode(const FDeviceMaterial& Material, uint32_t MaterialIndex, const std::set<std::string>& AnimatableFields, bool bFoldConstants)
+{
+	std::string Result;
+
+	Result += "FDeviceMaterial GetMaterial(vec2 TextureCoords)\r\n";
+	Result += "{\r\n";
+	Result += "    FDeviceMaterial Material;\r\n";
+
+	for (auto& Field : GetMaterialFieldDescriptions())
+	{
+		bool bTextured = IsTextured(Material, Field);
+		std::optional<std::string> Literal;
+
+		if (bFoldConstants && !bTextured && AnimatableFields.count(Field.Name) == 0)
+		{
+			Literal = GenerateFieldLiteral(Material, Field);
+		}
+
+		Result += "    Material." + Field.Name + " = " + (Literal ? *Literal : GenerateFieldRead(Field, std::to_string(MaterialIndex), bTextured)) + ";\r\n";
+	}
+
+	//TODO: Add uint textures
+	if (AnimatableFields.count("ThinWalled") != 0)
+	{
+		Result += "    Material.ThinWalled = SampleUint(" + std::to_string(MaterialIndex) + ", " + std::to_string(ToFloatOffset(offsetof(FDeviceMaterial, ThinWalled))) + ");\r\n";
+	}
+	else
+	{
+		Result += "    Material.ThinWalled = " + std::to_string(Material.ThinWalled) + ";\r\n";
+	}
+
+	Result += "    return Material;\r\n";
+	Result += "};\r\n";
+
+	return Result;
+}
+
+std::vector<std::string> GetDisabledMaterialLayers(const FDeviceMaterial& Material, const std::set<std::string>& AnimatableFields)
+{
+	/// Emission is what's left when every other layer is skipped, so it's never disabled
+	static const std::vector<std::pair<std::string, std::string>> LayerWeights = {
+		{"BaseWeight", "DISABLE_DIFFUSE_LAYER"},
+		{"SpecularWeight", "DISABLE_SPECULAR_LAYER"},
+		{"TransmissionWeight", "DISABLE_TRANSMISSION_LAYER"},
+		{"SubsurfaceWeight", "DISABLE_SUBSURFACE_LAYER"},
+		{"SheenWeight", "DISABLE_SHEEN_LAYER"},
+		{"CoatWeight", "DISABLE_COAT_LAYER"},
+	};
+
+	std::vector<std::string> Result;
+
+	for (auto& [WeightName, Define] : LayerWeights)
+	{
+		auto& Fields = GetMaterialFieldDescriptions();
+		auto Field = std::find_if(Fields.begin(), Fields.end(), [&WeightName = WeightName](const FMaterialFieldDescription& Description){return Description.Name == WeightName;});
+		assert(Field != Fields.end() && "Unknown material layer weight");
+
+		if (!IsTextured(Material, *Field) && AnimatableFields.count(WeightName) == 0 && ReadField<float>(Material, Field->DataOffset) == 0.f)
+		{
+			Result.push_back(Define);
+		}
+	}
+
+	return Result;
+}
+
+std::string GenerateRuntimeMaterialCode()
+{
+	std::string Result;
+
+	Result += "FDeviceMaterial GetMaterial(vec2 TextureCoords, uint MaterialIndex)\r\n";
+	Result += "{\r\n";
+	Result += "    FDeviceMaterial Material;\r\n";
+
+	for (auto& Field : GetMaterialFieldDescriptions())
+	{
+		/// Only the selected branch is executed, so untextured fields don't touch the textures
+		std::string TextureIndex = "SampleUint(MaterialIndex, " + std::to_string(ToFloatOffset(Field.TextureOffset)) + ")";
+		Result += "    Material." + Field.Name + " = (" + TextureIndex + " == 0xFFFFFFFFu) ? " + GenerateFieldRead(Field, "MaterialIndex", false) + " : " +
+			GenerateFieldRead(Field, "MaterialIndex", true) + ";\r\n";
+	}
+
+	//TODO: Add uint textures
+	Result += "    Material.ThinWalled = SampleUint(MaterialIndex, " + std::to_string(ToFloatOffset(offsetof(FDeviceMaterial, ThinWalled))) + ");\r\n";
+
+	Result += "    return Material;\r\n";
+	Result += "};\r\n";
+
+	return Result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "maths.h"
+#include "common_structures.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+enum class EMaterialFieldType
+{
+	Float,
+	Vec3
+};
+
+/**
+ * Field of FDeviceMaterial, which can be either a constant or sampled from a texture
+ */
+struct FMaterialFieldDescription
+{
+	std::string Name;
+	EMaterialFieldType Type;
+	/// Offsets in bytes from the beginning of FDeviceMaterial
+	uint32_t DataOffset;
+	uint32_t TextureOffset;
+	/// Colors stored in textures are in sRGB
+	bool bConvertToLinear = false;
+};
+
+/// Every field of FDeviceMaterial, except ThinWalled, in the order they are read by the generated code
+const std::vector<FMaterialFieldDescription>& GetMaterialFieldDescriptions();
+
+/**
+ * Code of "FDeviceMaterial GetMaterial(vec2 TextureCoords)" for a single material.
+ * Whether a field is sampled from a texture and the material index are baked into the code, so every material needs its own shader.
+ * With bFoldConstants, fields that are neither textured nor animatable are written as literals, so the shader has to be rebuilt when they change.
+ * AnimatableFields holds names of the fields, "ThinWalled" included, that are always read from the material buffer
+ */
+std::string GenerateMaterialCode(const FDeviceMaterial& Material, uint32_t MaterialIndex, const std::set<std::string>& AnimatableFields = {}, bool bFoldConstants = true);
+/// Defines, like DISABLE_COAT_LAYER, for the layers of process_material_interaction.h the material can never select, as their weight is a constant zero
+std::vector<std::string> GetDisabledMaterialLayers(const FDeviceMaterial& Material, const std::set<std::string>& AnimatableFields = {});
+/**
+ * Code of "FDeviceMaterial GetMaterial(vec2 TextureCoords, uint MaterialIndex)" shared by all materials.
+ * Everything is read from the material buffer at runtime, so a single shader handles every material
+ */
+std::string GenerateRuntimeMaterialCode();
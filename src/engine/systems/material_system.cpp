@@ -1,3 +1,4 @@
+#include "material_code_generator.h"
 #include "material_component.h"
 #include "material_system.h"
 #include "named_resources.h"
@@ -5,6 +6,7 @@
 
 #include "texture_manager.h"
 
+#include <algorithm>
 #include <typeindex>
 #include <type_traits>
 
@@ -865,64 +867,35 @@ namespace ECS
     		return Result;
     	}
 
-        std::string FMaterialSystem::GenerateMaterialCode(FEntity MaterialEntity)
+        FMaterialSystem& FMaterialSystem::SetAnimatable(FEntity MaterialEntity, const std::string& FieldName, bool bAnimatable)
         {
-            std::string Result;
+            auto& Fields = GetMaterialFieldDescriptions();
+            bool bKnownField = FieldName == "ThinWalled" ||
+                std::find_if(Fields.begin(), Fields.end(), [&FieldName](const FMaterialFieldDescription& Field){return Field.Name == FieldName;}) != Fields.end();
+            assert(bKnownField && "Unknown material field");
+
+            if (bAnimatable)
+            {
+                AnimatableFields[MaterialEntity].insert(FieldName);
+            }
+            else
+            {
+                AnimatableFields[MaterialEntity].erase(FieldName);
+            }
+
+            return *this;
+        }
+
+        std::string FMaterialSystem::GenerateMaterialCode(FEntity MaterialEntity, bool bFoldConstants)
+        {
+            auto& MaterialComponent = GetComponent<COMPONENTS::FMaterialComponent>(MaterialEntity);
+            return ::GenerateMaterialCode(MaterialComponent, MaterialToIndexMap[MaterialEntity], AnimatableFields[MaterialEntity], bFoldConstants);
+        }
 
+        std::vector<std::string> FMaterialSystem::GetDisabledLayers(FEntity MaterialEntity)
+        {
             auto& MaterialComponent = GetComponent<COMPONENTS::FMaterialComponent>(MaterialEntity);
-    		uint32_t MaterialIndex = MaterialToIndexMap[MaterialEntity];
-
-            Result += "FDeviceMaterial GetMaterial(vec2 TextureCoords)\r\n";
-            Result += "{\r\n";
-            Result += "    FDeviceMaterial Material;\r\n";
-
-            Result += GenerateGetFunction<float>(	"Material.BaseWeight",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, BaseWeight),				offsetof(COMPONENTS::FMaterialComponent, BaseWeightTexture),				MaterialComponent.BaseWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.BaseColor",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, BaseColor),				offsetof(COMPONENTS::FMaterialComponent, BaseColorTexture),					MaterialComponent.BaseColorTexture, true);
-            Result += GenerateGetFunction<float>(	"Material.DiffuseRoughness",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, DiffuseRoughness),			offsetof(COMPONENTS::FMaterialComponent, DiffuseRoughnessTexture),			MaterialComponent.DiffuseRoughnessTexture);
-            Result += GenerateGetFunction<float>(	"Material.Metalness",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, Metalness),				offsetof(COMPONENTS::FMaterialComponent, MetalnessTexture),					MaterialComponent.MetalnessTexture);
-            Result += GenerateGetFunction<FVector3>("Material.Normal",					MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, Normal),					offsetof(COMPONENTS::FMaterialComponent, NormalTexture),					MaterialComponent.NormalTexture);
-            Result += GenerateGetFunction<float>(	"Material.SpecularWeight",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SpecularWeight),			offsetof(COMPONENTS::FMaterialComponent, SpecularWeightTexture),			MaterialComponent.SpecularWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.SpecularColor",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SpecularColor),			offsetof(COMPONENTS::FMaterialComponent, SpecularColorTexture),				MaterialComponent.SpecularColorTexture, true);
-            Result += GenerateGetFunction<float>(	"Material.SpecularRoughness",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SpecularRoughness),		offsetof(COMPONENTS::FMaterialComponent, SpecularRoughnessTexture),			MaterialComponent.SpecularRoughnessTexture);
-            Result += GenerateGetFunction<float>(	"Material.SpecularIOR",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SpecularIOR),				offsetof(COMPONENTS::FMaterialComponent, SpecularIORTexture),				MaterialComponent.SpecularIORTexture);
-            Result += GenerateGetFunction<float>(	"Material.SpecularAnisotropy",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SpecularAnisotropy),		offsetof(COMPONENTS::FMaterialComponent, SpecularAnisotropyTexture),		MaterialComponent.SpecularAnisotropyTexture);
-            Result += GenerateGetFunction<float>(	"Material.SpecularRotation",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SpecularRotation),			offsetof(COMPONENTS::FMaterialComponent, SpecularRotationTexture),			MaterialComponent.SpecularRotationTexture);
-            Result += GenerateGetFunction<float>(	"Material.TransmissionWeight",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionWeight),		offsetof(COMPONENTS::FMaterialComponent, TransmissionWeightTexture),		MaterialComponent.TransmissionWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.TransmissionColor",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionColor),		offsetof(COMPONENTS::FMaterialComponent, TransmissionColorTexture),			MaterialComponent.TransmissionColorTexture, true);
-            Result += GenerateGetFunction<float>(	"Material.TransmissionDepth",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionDepth),		offsetof(COMPONENTS::FMaterialComponent, TransmissionDepthTexture),			MaterialComponent.TransmissionDepthTexture);
-            Result += GenerateGetFunction<FVector3>("Material.TransmissionScatter",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionScatter),		offsetof(COMPONENTS::FMaterialComponent, TransmissionScatterTexture),		MaterialComponent.TransmissionScatterTexture);
-            Result += GenerateGetFunction<float>(	"Material.TransmissionAnisotropy",	MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionAnisotropy),	offsetof(COMPONENTS::FMaterialComponent, TransmissionAnisotropyTexture),	MaterialComponent.TransmissionAnisotropyTexture);
-            Result += GenerateGetFunction<float>(	"Material.TransmissionDispersion",	MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionDispersion),	offsetof(COMPONENTS::FMaterialComponent, TransmissionDispersionTexture),	MaterialComponent.TransmissionDispersionTexture);
-            Result += GenerateGetFunction<float>(	"Material.TransmissionRoughness",	MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, TransmissionRoughness),	offsetof(COMPONENTS::FMaterialComponent, TransmissionRoughnessTexture),		MaterialComponent.TransmissionRoughnessTexture);
-            Result += GenerateGetFunction<float>(	"Material.SubsurfaceWeight",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SubsurfaceWeight),			offsetof(COMPONENTS::FMaterialComponent, SubsurfaceWeightTexture),			MaterialComponent.SubsurfaceWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.SubsurfaceColor",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SubsurfaceColor),			offsetof(COMPONENTS::FMaterialComponent, SubsurfaceColorTexture),			MaterialComponent.SubsurfaceColorTexture, true);
-            Result += GenerateGetFunction<FVector3>("Material.SubsurfaceRadius",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SubsurfaceRadius),			offsetof(COMPONENTS::FMaterialComponent, SubsurfaceRadiusTexture),			MaterialComponent.SubsurfaceRadiusTexture);
-            Result += GenerateGetFunction<float>(	"Material.SubsurfaceScale",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SubsurfaceScale),			offsetof(COMPONENTS::FMaterialComponent, SubsurfaceScaleTexture),			MaterialComponent.SubsurfaceScaleTexture);
-            Result += GenerateGetFunction<float>(	"Material.SubsurfaceAnisotropy",	MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SubsurfaceAnisotropy),		offsetof(COMPONENTS::FMaterialComponent, SubsurfaceAnisotropyTexture),		MaterialComponent.SubsurfaceAnisotropyTexture);
-            Result += GenerateGetFunction<float>(	"Material.SheenWeight",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SheenWeight),				offsetof(COMPONENTS::FMaterialComponent, SheenWeightTexture),				MaterialComponent.SheenWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.SheenColor",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SheenColor),				offsetof(COMPONENTS::FMaterialComponent, SheenColorTexture),				MaterialComponent.SheenColorTexture, true);
-            Result += GenerateGetFunction<float>(	"Material.SheenRoughness",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, SheenRoughness),			offsetof(COMPONENTS::FMaterialComponent, SheenRoughnessTexture),			MaterialComponent.SheenRoughnessTexture);
-            Result += GenerateGetFunction<float>(	"Material.CoatWeight",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatWeight),				offsetof(COMPONENTS::FMaterialComponent, CoatWeightTexture),				MaterialComponent.CoatWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.CoatColor",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatColor),				offsetof(COMPONENTS::FMaterialComponent, CoatColorTexture),					MaterialComponent.CoatColorTexture, true);
-            Result += GenerateGetFunction<float>(	"Material.CoatRoughness",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatRoughness),			offsetof(COMPONENTS::FMaterialComponent, CoatRoughnessTexture),				MaterialComponent.CoatRoughnessTexture);
-            Result += GenerateGetFunction<float>(	"Material.CoatAnisotropy",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatAnisotropy),			offsetof(COMPONENTS::FMaterialComponent, CoatAnisotropyTexture),			MaterialComponent.CoatAnisotropyTexture);
-            Result += GenerateGetFunction<float>(	"Material.CoatRotation",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatRotation),				offsetof(COMPONENTS::FMaterialComponent, CoatRotationTexture),				MaterialComponent.CoatRotationTexture);
-            Result += GenerateGetFunction<float>(	"Material.CoatIOR",					MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatIOR),					offsetof(COMPONENTS::FMaterialComponent, CoatIORTexture),					MaterialComponent.CoatIORTexture);
-            Result += GenerateGetFunction<FVector3>("Material.CoatNormal",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatNormal),				offsetof(COMPONENTS::FMaterialComponent, CoatNormalTexture),				MaterialComponent.CoatNormalTexture);
-            Result += GenerateGetFunction<float>(	"Material.CoatAffectColor",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatAffectColor),			offsetof(COMPONENTS::FMaterialComponent, CoatAffectColorTexture),			MaterialComponent.CoatAffectColorTexture);
-            Result += GenerateGetFunction<float>(	"Material.CoatAffectRoughness",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, CoatAffectRoughness),		offsetof(COMPONENTS::FMaterialComponent, CoatAffectRoughnessTexture),		MaterialComponent.CoatAffectRoughnessTexture);
-            Result += GenerateGetFunction<float>(	"Material.ThinFilmThickness",		MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, ThinFilmThickness),		offsetof(COMPONENTS::FMaterialComponent, ThinFilmThicknessTexture),			MaterialComponent.ThinFilmThicknessTexture);
-            Result += GenerateGetFunction<float>(	"Material.ThinFilmIOR",				MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, ThinFilmIOR),				offsetof(COMPONENTS::FMaterialComponent, ThinFilmIORTexture),				MaterialComponent.ThinFilmIORTexture);
-            Result += GenerateGetFunction<float>(	"Material.EmissionWeight",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, EmissionWeight),			offsetof(COMPONENTS::FMaterialComponent, EmissionWeightTexture),			MaterialComponent.EmissionWeightTexture);
-            Result += GenerateGetFunction<FVector3>("Material.EmissionColor",			MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, EmissionColor),			offsetof(COMPONENTS::FMaterialComponent, EmissionColorTexture),				MaterialComponent.EmissionColorTexture, true);
-            Result += GenerateGetFunction<FVector3>("Material.Opacity",					MaterialIndex, offsetof(COMPONENTS::FMaterialComponent, Opacity),					offsetof(COMPONENTS::FMaterialComponent, OpacityTexture),					MaterialComponent.OpacityTexture);
-            //TODO: Add uint textures
-            Result += "    Material.ThinWalled = " + std::to_string(MaterialComponent.ThinWalled) + ";\r\n";
-
-            Result += "    return Material;\r\n";
-            Result += "};\r\n";
-
-            return Result;
+            return GetDisabledMaterialLayers(MaterialComponent, AnimatableFields[MaterialEntity]);
         }
 
 		std::string FMaterialSystem::GenerateEmissiveMaterialsCode(const std::unordered_map<uint32_t , uint32_t>& EmissiveMaterials)
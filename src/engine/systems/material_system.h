@@ -119,7 +119,12 @@ namespace ECS
 			FMaterialSystem& SetThinWalled(FEntity MaterialEntity, bool ThinWalled);
 			FMaterialSystem& SetThinWalled(FEntity MaterialEntity, FEntity TextureEntity);
 
-			std::string GenerateMaterialCode(FEntity MaterialEntity);
+			/// Animatable fields are never folded into the shader code, so changing them doesn't require rebuilding it
+			FMaterialSystem& SetAnimatable(FEntity MaterialEntity, const std::string& FieldName, bool bAnimatable = true);
+
+			std::string GenerateMaterialCode(FEntity MaterialEntity, bool bFoldConstants = true);
+			/// Defines that compile out the layers the material never uses
+			std::vector<std::string> GetDisabledLayers(FEntity MaterialEntity);
 			std::string GenerateEmissiveMaterialsCode(const std::unordered_map<uint32_t , uint32_t>& EmissiveMaterials);
 
             const uint32_t MAX_MATERIALS = IBL_MATERIAL_INDEX;
@@ -128,6 +133,7 @@ namespace ECS
         	std::queue<uint32_t> FreeIndices;
         	std::set<FEntity> ChangedMaterials;
         	std::unordered_map<FEntity, std::string> MaterialToName;
+        	std::unordered_map<FEntity, std::set<std::string>> AnimatableFields;
         };
     }
 }
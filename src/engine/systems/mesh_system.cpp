@@ -44,15 +44,13 @@ namespace ECS
             uint32_t VertexBufferRequiredSize = MeshComponent.Vertices.size() * sizeof(FVertex);
             uint32_t IndexBufferRequiredSize = MeshComponent.Indices.size() * sizeof(uint32_t);
 
-            FMemoryPtr VertexBufferChunk = VertexBuffer.CheckAvailableMemory(VertexBufferRequiredSize);
-            VertexBuffer.ReserveMemory(VertexBufferChunk);
+            FMemoryPtr VertexBufferChunk = VertexBuffer.Allocate(VertexBufferRequiredSize);
 
             FMemoryPtr IndexBufferChunk{};
 
             if (MeshComponent.Indexed)
             {
-                IndexBufferChunk = IndexBuffer.CheckAvailableMemory(IndexBufferRequiredSize);
-                IndexBuffer.ReserveMemory(IndexBufferChunk);
+                IndexBufferChunk = IndexBuffer.Allocate(IndexBufferRequiredSize);
             }
 
             DeviceMeshComponent.VertexPtr = VertexBufferChunk;
@@ -68,7 +66,7 @@ namespace ECS
 
         void FMeshSystem::Terminate()
         {
-            for (auto Entity : Entities)
+            for (auto Entity : *this)
             {
                 DeleteBLAS(Entity);
             }
@@ -96,7 +94,7 @@ namespace ECS
 
         uint32_t FMeshSystem::Size()
         {
-            return Entities.size();
+            return size();
         }
 
         void FMeshSystem::LoadMesh(FEntity Entity, const std::string &Path)
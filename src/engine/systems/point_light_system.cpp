@@ -1,6 +1,7 @@
 #include "named_resources.h"
 #include "light_component.h"
 #include "point_light_system.h"
+#include "light_bvh_builder.h"
 
 namespace ECS
 {
@@ -21,11 +22,7 @@ namespace ECS
 
 			if (bAliasTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FPointLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FPointLightComponent>(),
-					CurrentPointLightsCount, 1, [](ECS::COMPONENTS::FPointLightComponent Component){return double(Component.Power);});
-
-				RESOURCE_ALLOCATOR()->LoadDataToBuffer(POINT_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
-
+				UpdateImportanceBuffer();
 				bAliasTableShouldBeUpdated = false;
 			}
 
@@ -58,11 +55,7 @@ namespace ECS
 
 			if (bAliasTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FPointLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FPointLightComponent>(),
-					CurrentPointLightsCount, 1, [](ECS::COMPONENTS::FPointLightComponent Component){return double(Component.Power);});
-
-				RESOURCE_ALLOCATOR()->LoadDataToBuffer(POINT_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
-
+				UpdateImportanceBuffer();
 				bAliasTableShouldBeUpdated = false;
 			}
 
@@ -94,6 +87,7 @@ namespace ECS
             auto& LightComponent = COORDINATOR().GetComponent<COMPONENTS::FPointLightComponent>(LightEntity);
             LightComponent.Position = FVector3(X, Y, Z);
             MarkDirty(LightEntity);
+			bAliasTableShouldBeUpdated |= SamplingMode == ELightSamplingMode::BVH;
 
             return *this;
         }
@@ -103,6 +97,7 @@ namespace ECS
             auto& LightComponent = COORDINATOR().GetComponent<COMPONENTS::FPointLightComponent>(LightEntity);
             LightComponent.Position = Position;
             MarkDirty(LightEntity);
+			bAliasTableShouldBeUpdated |= SamplingMode == ELightSamplingMode::BVH;
 
             return *this;
         }
@@ -125,6 +120,14 @@ namespace ECS
             return *this;
         }
 
+		FPointLightSystem& FPointLightSystem::SetSamplingMode(ELightSamplingMode SamplingModeIn)
+		{
+			bAliasTableShouldBeUpdated |= SamplingMode != SamplingModeIn;
+			SamplingMode = SamplingModeIn;
+
+			return *this;
+		}
+
         FEntity FPointLightSystem::CreatePointLight(const FVector3& Position, const FVector3& Color, float Intensity)
         {
             auto Light = COORDINATOR().CreateEntity();
@@ -143,5 +146,34 @@ namespace ECS
 
             return Light;
         }
+
+		void FPointLightSystem::UpdateImportanceBuffer()
+		{
+			auto PointLights = COORDINATOR().GatherData<ECS::COMPONENTS::FPointLightComponent>();
+
+			if (SamplingMode == ELightSamplingMode::BVH)
+			{
+				std::vector<FLightBounds> Lights(CurrentPointLightsCount);
+
+				for (uint32_t i = 0; i < CurrentPointLightsCount; ++i)
+				{
+					Lights[i] = GetPointLightBounds(PointLights[i]);
+				}
+
+				auto Nodes = BuildLightBVH(Lights);
+
+				if (!Nodes.empty())
+				{
+					RESOURCE_ALLOCATOR()->LoadDataToBuffer(POINT_LIGHTS_IMPORTANCE_BUFFER, Nodes.size() * sizeof(FLightBVHNode), 0, Nodes.data());
+				}
+
+				return;
+			}
+
+			auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FPointLightComponent>(PointLights.data(),
+				CurrentPointLightsCount, 1, [](ECS::COMPONENTS::FPointLightComponent Component){return double(Component.Power);});
+
+			RESOURCE_ALLOCATOR()->LoadDataToBuffer(POINT_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
+		}
     }
 }
@@ -8,6 +8,7 @@
 #include "maths.h"
 
 #include "common_structures.h"
+#include "renderer_options.h"
 
 namespace ECS
 {
@@ -24,15 +25,23 @@ namespace ECS
             FPointLightSystem& SetLightPosition(FEntity LightEntity, float X, float Y, float Z);
             FPointLightSystem& SetLightColor(FEntity LightEntity, const FVector3& Color);
             FPointLightSystem& SetLightIntensity(FEntity LightEntity, float Intensity);
+            FPointLightSystem& SetSamplingMode(ELightSamplingMode SamplingModeIn);
 
             FEntity CreatePointLight(const FVector3& Position, const FVector3& Color, float Intensity);
 
-            static const uint32_t MAX_POINT_LIGHTS = 512;
+            /// The light BVH is meant for scenes with thousands of point lights
+            static const uint32_t MAX_POINT_LIGHTS = 1 << 16;
 			uint32_t LoadedPointLightsCount = 0;
 			float LoadedPointLightPower = 0.f;
 			uint32_t CurrentPointLightsCount = 0;
 			float CurrentPointLightPower = 0.f;
 			bool bAliasTableShouldBeUpdated = false;
+			/// The light BVH depends on where the lights are, so it's rebuilt when they move, unlike the alias table
+			ELightSamplingMode SamplingMode = ELightSamplingMode::AliasTable;
+
+        private:
+            /// Loads the alias table or the light BVH of the current lights into the point lights importance buffer
+            void UpdateImportanceBuffer();
         };
     }
 }
@@ -59,7 +59,7 @@ namespace ECS
 
         void FRenderableSystem::SetSelected(FEntity Entity)
         {
-            for (auto E : Entities)
+            for (auto E : *this)
             {
                 auto& RenderableComponent = GetComponent<ECS::COMPONENTS::FDeviceRenderableComponent>(E);
                 if (Entity == E)
@@ -78,7 +78,7 @@ namespace ECS
         void FRenderableSystem::SetSelectedByIndex(uint32_t Index)
         {
             FEntity Entity;
-            for (auto EntityEntry : Entities)
+            for (auto EntityEntry : *this)
             {
                 auto& RenderableComponent = GetComponent<ECS::COMPONENTS::FDeviceRenderableComponent>(EntityEntry);
                 if (RenderableComponent.RenderableIndex == Index)
@@ -21,7 +21,8 @@ namespace ECS
 
 			if (bAliasTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FSpotLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FSpotLightComponent>(),
+				auto SpotLights = COORDINATOR().GatherData<ECS::COMPONENTS::FSpotLightComponent>();
+				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FSpotLightComponent>(SpotLights.data(),
 					CurrentSpotLightsCount, 1, [](ECS::COMPONENTS::FSpotLightComponent Component){return double(Component.Power);});
 
 				RESOURCE_ALLOCATOR()->LoadDataToBuffer(SPOT_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
@@ -56,7 +57,8 @@ namespace ECS
 
 			if (bAliasTableShouldBeUpdated)
 			{
-				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FSpotLightComponent>(COORDINATOR().Data<ECS::COMPONENTS::FSpotLightComponent>(),
+				auto SpotLights = COORDINATOR().GatherData<ECS::COMPONENTS::FSpotLightComponent>();
+				auto [UpdatedAliasTable, _] = GenerateImportanceMapFast<ECS::COMPONENTS::FSpotLightComponent>(SpotLights.data(),
 					CurrentSpotLightsCount, 1, [](ECS::COMPONENTS::FSpotLightComponent Component){return double(Component.Power);});
 
 				RESOURCE_ALLOCATOR()->LoadDataToBuffer(SPOT_LIGHTS_IMPORTANCE_BUFFER, UpdatedAliasTable.size() * sizeof(FAliasTableEntry), 0, UpdatedAliasTable.data());
@@ -1,6 +1,9 @@
 #include "executable_task.h"
 
+#include <algorithm>
+#include <cassert>
 #include <utility>
+#include "logging.h"
 #include "vk_context.h"
 #include "vk_debug.h"
 
@@ -25,7 +28,6 @@ FExecutableTask::FExecutableTask(uint32_t WidthIn, uint32_t HeightIn, uint32_t S
         SubmitX(SubmitXIn), SubmitY(SubmitYIn), LogicalDevice(LogicalDevice), TaskStates(SubmitYIn, UNDEFINED)
 {
 	TotalSize = SubmitX * SubmitY;
-    CreateSyncObjects();
 	DitryFlags |= UNINITIALIZED | OUTDATED_DESCRIPTOR_SET | OUTDATED_COMMAND_BUFFER;
 	QueryPool = VK_CONTEXT()->CreateQueryPool( SubmitXIn * SubmitYIn * 2, VK_QUERY_TYPE_TIMESTAMP);
 }
@@ -42,43 +44,13 @@ FExecutableTask::~FExecutableTask()
 
     VK_CONTEXT()->DescriptorSetManager->DestroyPipelineLayout(Name);
 
-    if (Pipeline != VK_NULL_HANDLE)
-    {
-        vkDestroyPipeline(LogicalDevice, Pipeline, nullptr);
-    }
+    FExecutableTask::DestroyPipeline();
 
     VK_CONTEXT()->DescriptorSetManager->Reset(Name);
 
-    FreeSyncObjects();
-
 	vkDestroyQueryPool(LogicalDevice, QueryPool, nullptr);
 }
 
-void FExecutableTask::CreateSyncObjects()
-{
-	SignalSemaphores.reserve(TotalSize);
-
-    for (int i = 0; i < TotalSize; ++i)
-    {
-        SignalSemaphores.push_back(VK_CONTEXT()->CreateSemaphore());
-        V::SetName(LogicalDevice, SignalSemaphores.back(), Name);
-    }
-}
-
-void FExecutableTask::FreeSyncObjects()
-{
-    for (int i = 0; i < TotalSize; ++i)
-    {
-        if (SignalSemaphores[i] != VK_NULL_HANDLE)
-        {
-            vkDestroySemaphore(LogicalDevice, SignalSemaphores[i], nullptr);
-            SignalSemaphores[i] = VK_NULL_HANDLE;
-        }
-    }
-
-    SignalSemaphores.clear();
-}
-
 void FExecutableTask::RegisterInput(const std::string& InputName, ImagePtr Image)
 {
     if (Inputs.find(InputName) != Inputs.end())
@@ -105,6 +77,18 @@ void FExecutableTask::Reload(FCompileDefinitions* CompileDefinitions)
 	{
 		Init(CompileDefinitions);
 	}
+	else if (CheckFlag(DitryFlags, DirtyType::OUTDATED_PIPELINE))
+	{
+		try
+		{
+			BuildPipeline(CompileDefinitions);
+		}
+		catch (const std::runtime_error& Error)
+		{
+			/// Shader broken while editing it shouldn't stop the application, the old pipeline works until the shader is fixed
+			U::Log(Error.what());
+		}
+	}
 
 	if (CheckFlag(DitryFlags, DirtyType::OUTDATED_DESCRIPTOR_SET))
 	{
@@ -119,51 +103,98 @@ void FExecutableTask::Reload(FCompileDefinitions* CompileDefinitions)
 	DitryFlags = 0u;
 }
 
-FSynchronizationPoint FExecutableTask::Submit(VkPipelineStageFlags& PipelineStageFlagsIn, FSynchronizationPoint SynchronizationPoint, uint32_t X, uint32_t Y)
+std::vector<FShaderCompilationJob> FExecutableTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
 {
-	uint32_t SubmitIndex = Y * SubmitX + X;
+	return {};
+}
 
-    VkPipelineStageFlags WaitStages[] = {PipelineStageFlagsIn};
-    VkSubmitInfo SubmitInfo{};
-    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    SubmitInfo.waitSemaphoreCount = SynchronizationPoint.SemaphoresToWait.size();
-    SubmitInfo.pWaitSemaphores = SynchronizationPoint.SemaphoresToWait.empty() ? nullptr : SynchronizationPoint.SemaphoresToWait.data();
-    SubmitInfo.pWaitDstStageMask = WaitStages;
-    SubmitInfo.commandBufferCount = 1;
-    SubmitInfo.pCommandBuffers = &CommandBuffers[SubmitIndex];
+void FExecutableTask::CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData)
+{
+	assert(SPIRVData.size() == 1 && "Default pipeline is a single compute shader");
 
-	/// We push the task's semaphore to the list of signal semaphores
-	SynchronizationPoint.SemaphoresToSignal.push_back(SignalSemaphores[SubmitIndex]);
-    SubmitInfo.signalSemaphoreCount = SynchronizationPoint.SemaphoresToSignal.size();
-    SubmitInfo.pSignalSemaphores = SynchronizationPoint.SemaphoresToSignal.data();
+	auto ComputeShader = FShader(SPIRVData[0]);
+	Pipeline = VK_CONTEXT()->CreateComputePipeline(ComputeShader(), PipelineLayout);
+}
 
-    if(!SynchronizationPoint.FencesToWait.empty())
-    {
-		vkWaitForFences(LogicalDevice, SynchronizationPoint.FencesToWait.size(), SynchronizationPoint.FencesToWait.data(), VK_TRUE, UINT64_MAX);
-    }
+void FExecutableTask::ReplacePipeline(const std::vector<std::shared_future<std::vector<uint32_t>>>& SPIRVData)
+{
+	/// Throws before anything is destroyed
+	auto ReadySPIRVData = FShaderCompilationPool::WaitForBatch(SPIRVData);
 
-	VkFence FenceToSignal = VK_NULL_HANDLE;
+	DestroyPipeline();
+	CreatePipeline(ReadySPIRVData);
+}
 
-    if (!SynchronizationPoint.FencesToSignal.empty())
-    {
-#ifndef NDEBUG
-		if (SynchronizationPoint.FencesToSignal.size() > 1)
-			U::Log("There are more that one fence to signal. This might be an error");
-#endif
-        vkResetFences(LogicalDevice, SynchronizationPoint.FencesToSignal.size(), SynchronizationPoint.FencesToSignal.data());
-		FenceToSignal = SynchronizationPoint.FencesToSignal[0];
-    }
+void FExecutableTask::DestroyPipeline()
+{
+	if (Pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(LogicalDevice, Pipeline, nullptr);
+		Pipeline = VK_NULL_HANDLE;
+	}
+}
 
-    /// Submit computing. When computing finished, appropriate fence will be signalled
-    if (vkQueueSubmit(VK_CONTEXT()->GetQueue(QueueFlagsBits), 1, &SubmitInfo, FenceToSignal) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to submit draw command buffer!");
-    }
+void FExecutableTask::BuildPipeline(FCompileDefinitions* CompileDefinitions)
+{
+	auto Jobs = GetShaderCompilationJobs(CompileDefinitions);
+
+	if (Jobs.empty())
+	{
+		return;
+	}
+
+	std::vector<std::shared_future<std::vector<uint32_t>>> SPIRVData;
+	SPIRVData.reserve(Jobs.size());
+
+	for (auto& Job : Jobs)
+	{
+		SPIRVData.push_back(SHADER_COMPILATION_POOL()->Compile(Job));
+	}
+
+	/// Tasks with many shaders, like the master shader, start creating pipelines while the rest is still being compiled
+	ReplacePipeline(SPIRVData);
+
+	ShaderPaths.clear();
+
+	for (auto& Job : Jobs)
+	{
+		auto ShaderPath = NormalizeShaderPath(Job.Path);
+
+		if (std::find(ShaderPaths.begin(), ShaderPaths.end(), ShaderPath) == ShaderPaths.end())
+		{
+			ShaderPaths.push_back(ShaderPath);
+		}
+	}
+}
+
+bool FExecutableTask::UsesAnyShader(const std::vector<std::string>& Shaders) const
+{
+	return std::any_of(Shaders.begin(), Shaders.end(), [this](const std::string& Shader)
+	{
+		return std::find(ShaderPaths.begin(), ShaderPaths.end(), Shader) != ShaderPaths.end();
+	});
+}
+
+FSynchronizationPoint FExecutableTask::Submit(VkPipelineStageFlags& PipelineStageFlagsIn, FSynchronizationPoint SynchronizationPoint, uint32_t X, uint32_t Y)
+{
+	/// The submit signals the next value of the queue's timeline, the next task waits for it
+	SynchronizationPoint = VK_CONTEXT()->Submit(QueueFlagsBits, {CommandBuffers[Y * SubmitX + X]}, SynchronizationPoint, PipelineStageFlagsIn);
 
 	PipelineStageFlagsIn = PipelineStageFlags;
 	TaskStates[Y] = SUBMITTED;
 
-	return {{SignalSemaphores[SubmitIndex]}, {}, {}, {}};
+	return SynchronizationPoint;
+}
+
+std::vector<FFrameGraphResourceAccess> FExecutableTask::GetResourceAccesses() const
+{
+	assert(false && "Tasks in the frame graph must declare the resources they access");
+	return {};
+}
+
+VkCommandBuffer FExecutableTask::GetCommandBuffer(uint32_t X, uint32_t Y) const
+{
+	return CommandBuffers[Y * SubmitX + X];
 }
 
 void FExecutableTask::UpdateDescriptorSet(uint32_t LayoutSetIndex, uint32_t LayoutIndex, int FrameIndex, const FBuffer& Buffer)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "frame_graph.h"
 #include "image.h"
 #include "vk_pipeline.h"
 #include "vk_shader_compiler.h"
@@ -8,7 +9,8 @@
 
 enum DirtyType {UNINITIALIZED 			= 1u,
 				OUTDATED_DESCRIPTOR_SET = 1u << 1,
-				OUTDATED_COMMAND_BUFFER = 1u << 2};
+				OUTDATED_COMMAND_BUFFER = 1u << 2,
+				OUTDATED_PIPELINE 		= 1u << 3};
 
 class FVulkanContext;
 
@@ -45,10 +47,30 @@ public:
     virtual void UpdateDescriptorSets() = 0;
     virtual void RecordCommands() = 0;
 	virtual void Reload(FCompileDefinitions* CompileDefinitions = nullptr);
-	/// SynchronizationPoint will be updated after this
+	/// Shaders the pipeline is built from. The compilation might still fail, so nothing the current pipeline depends on may change here
+	virtual std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions);
+	/// Create the pipeline out of the shaders compiled in the order of the jobs. Most tasks are a single compute shader, so that's the default
+	virtual void CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData);
+	/// Replace the pipeline by the one built from the shaders being compiled, in the order of the jobs.
+	/// Throws std::runtime_error if some shader fails to compile, leaving the old pipeline as it was.
+	/// By default waits for all shaders, then destroys the old pipeline and calls CreatePipeline
+	virtual void ReplacePipeline(const std::vector<std::shared_future<std::vector<uint32_t>>>& SPIRVData);
+	/// Destroy everything CreatePipeline created
+	virtual void DestroyPipeline();
+	/// Compile the shaders in parallel, then replace the pipeline.
+	/// Throws std::runtime_error if some shader fails to compile, in which case the old pipeline is kept
+	void BuildPipeline(FCompileDefinitions* CompileDefinitions);
+	/// Whether any of the shaders, given by normalized paths, is used by the pipeline
+	bool UsesAnyShader(const std::vector<std::string>& Shaders) const;
+	/// SynchronizationPoint will be updated after this. Tasks don't own semaphores, the submit signals the next value of the queue's timeline semaphore
 	/// X - for bounce
 	/// Y - for frame
     virtual FSynchronizationPoint Submit(VkPipelineStageFlags& PipelineStageFlagsIn, FSynchronizationPoint SynchronizationPoint, uint32_t X, uint32_t Y);
+	/// Buffers and images the recorded commands access, so that the frame graph can place barriers between the tasks submitted together.
+	/// Every task put into the frame graph must override it
+	virtual std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const;
+	/// Command buffer Submit would submit
+	VkCommandBuffer GetCommandBuffer(uint32_t X, uint32_t Y) const;
 
     void RegisterInput(const std::string& InputName, ImagePtr Image);
     void RegisterOutput(const std::string& InputName, ImagePtr Image);
@@ -69,8 +91,6 @@ public:
 
     std::vector<VkCommandBuffer> CommandBuffers;
 
-    std::vector<VkSemaphore> SignalSemaphores;
-
     std::string Name;
 
     uint32_t Width = 0;
@@ -86,8 +106,6 @@ public:
     VkQueueFlagBits QueueFlagsBits;
 	VkQueryPool QueryPool = VK_NULL_HANDLE;
 	uint32_t DitryFlags = true;
-
-protected:
-    void CreateSyncObjects();
-    void FreeSyncObjects();
+	/// Normalized paths of the shaders the pipeline was built from
+	std::vector<std::string> ShaderPaths;
 };
\ No newline at end of file
@@ -28,6 +28,10 @@ FAccumulateTask::FAccumulateTask(uint32_t WidthIn, uint32_t HeightIn, uint32_t S
     	{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,  VK_SHADER_STAGE_COMPUTE_BIT});
 	DescriptorSetManager->AddDescriptorLayout(Name, ACCUMULATE_PER_FRAME_LAYOUT_INDEX, UTILITY_BUFFER_INDEX,
 		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
+	DescriptorSetManager->AddDescriptorLayout(Name, ACCUMULATE_PER_FRAME_LAYOUT_INDEX, ACCUMULATE_LUMINANCE_MOMENTS_BUFFER_INDEX,
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
+	DescriptorSetManager->AddDescriptorLayout(Name, ACCUMULATE_PER_FRAME_LAYOUT_INDEX, ACCUMULATE_CONVERGENCE_MASK_BUFFER_INDEX,
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
 
 	VkPushConstantRange PushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FPushConstants)};
 	DescriptorSetManager->CreateDescriptorSetLayout({PushConstantRange}, Name);
@@ -40,11 +44,9 @@ void FAccumulateTask::Init(FCompileDefinitions* CompileDefinitions)
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto AccumulateShader = FShader("../src/shaders/accumulate.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
 
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(AccumulateShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, ACCUMULATE_PER_FRAME_LAYOUT_INDEX, TotalSize);
@@ -54,6 +56,11 @@ void FAccumulateTask::Init(FCompileDefinitions* CompileDefinitions)
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FAccumulateTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/accumulate.comp"}};
+}
+
 void FAccumulateTask::UpdateDescriptorSets()
 {
     for (uint32_t i = 0; i < TotalSize; ++i)
@@ -74,6 +81,8 @@ void FAccumulateTask::UpdateDescriptorSets()
         UpdateDescriptorSet(ACCUMULATE_PER_FRAME_LAYOUT_INDEX, ACCUMULATE_IMAGE_INDEX, i, TEXTURE_MANAGER()->GetFramebufferImage("AccumulatorImage"));
         UpdateDescriptorSet(ACCUMULATE_PER_FRAME_LAYOUT_INDEX, ESTIMATED_IMAGE_INDEX, i, TEXTURE_MANAGER()->GetFramebufferImage("EstimatedImage"));
     	UpdateDescriptorSet(ACCUMULATE_PER_FRAME_LAYOUT_INDEX, UTILITY_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(UTILITY_INFO_BUFFER));
+    	UpdateDescriptorSet(ACCUMULATE_PER_FRAME_LAYOUT_INDEX, ACCUMULATE_LUMINANCE_MOMENTS_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(LUMINANCE_MOMENTS_BUFFER));
+    	UpdateDescriptorSet(ACCUMULATE_PER_FRAME_LAYOUT_INDEX, ACCUMULATE_CONVERGENCE_MASK_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_MASK_BUFFER));
     }
 };
 
@@ -103,3 +112,15 @@ void FAccumulateTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FAccumulateTask::GetResourceAccesses() const
+{
+	/// Only one of the color and AOV images is read, depending on the render target
+	return {
+		{"ColorImage", FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{"AOVImage", FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{"AccumulatorImage", FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{"EstimatedImage", FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE},
+		{LUMINANCE_MOMENTS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{CONVERGENCE_MASK_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ}};
+}
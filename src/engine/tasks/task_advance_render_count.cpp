@@ -28,10 +28,8 @@ void FAdvanceRenderCount::Init(FCompileDefinitions* CompileDefinitions)
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto RayGenerationShader = FShader("../src/shaders/advance_render_iteration.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(RayGenerationShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, ADVANCE_RENDER_COUNT_LAYOUT_INDEX, TotalSize);
@@ -41,6 +39,11 @@ void FAdvanceRenderCount::Init(FCompileDefinitions* CompileDefinitions)
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FAdvanceRenderCount::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/advance_render_iteration.comp"}};
+}
+
 void FAdvanceRenderCount::UpdateDescriptorSets()
 {
     for (uint32_t i = 0; i < TotalSize; ++i)
@@ -71,3 +74,8 @@ void FAdvanceRenderCount::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FAdvanceRenderCount::GetResourceAccesses() const
+{
+	return {{RENDER_ITERATION_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE}};
+}
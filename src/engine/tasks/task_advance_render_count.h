@@ -8,6 +8,8 @@ public:
 	FAdvanceRenderCount(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice);
 
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
+    std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions) override;
     void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
 };
\ No newline at end of file
@@ -65,3 +65,15 @@ void FClearBufferTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FClearBufferTask::GetResourceAccesses() const
+{
+	std::vector<FFrameGraphResourceAccess> ResourceAccesses;
+
+	for (auto& BufferName : BufferNames)
+	{
+		ResourceAccesses.push_back({BufferName, FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_TRANSFER_WRITE});
+	}
+
+	return ResourceAccesses;
+}
@@ -56,7 +56,8 @@ void FClearImageTask::RecordCommands()
 			ImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
 
-			vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			/// Transfer stages on both sides chain the layout transitions with the frame graph barriers around the clear
+			vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
 				0, nullptr, 0, nullptr, 1, &ImageMemoryBarrier);
 
 			VkImageSubresourceRange Range{};
@@ -73,10 +74,15 @@ void FClearImageTask::RecordCommands()
 			ImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 			ImageMemoryBarrier.dstAccessMask = 0;
 
-			vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
 				0, nullptr, 0, nullptr, 1, &ImageMemoryBarrier);
         }, QueueFlagsBits);
 
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FClearImageTask::GetResourceAccesses() const
+{
+	return {{ImageName, FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_TRANSFER_WRITE}};
+}
@@ -10,6 +10,7 @@ public:
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
     void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
 
 	std::string ImageName;
 };
@@ -0,0 +1,116 @@
+#include "vk_context.h"
+#include "vk_debug.h"
+#include "vk_functions.h"
+#include "common_defines.h"
+#include "common_structures.h"
+
+#include "vk_shader_compiler.h"
+
+#include "task_convergence.h"
+
+#include "utils.h"
+
+FConvergenceTask::FConvergenceTask(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice) :
+        FExecutableTask(WidthIn, HeightIn, SubmitXIn, SubmitYIn, LogicalDevice)
+{
+    Name = "Task Convergence";
+
+    auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
+
+    DescriptorSetManager->AddDescriptorLayout(Name, CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_LUMINANCE_MOMENTS_BUFFER_INDEX,
+    	{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
+    DescriptorSetManager->AddDescriptorLayout(Name, CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_MASK_BUFFER_INDEX,
+    	{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
+    DescriptorSetManager->AddDescriptorLayout(Name, CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_COUNTERS_BUFFER_INDEX,
+    	{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
+	DescriptorSetManager->AddDescriptorLayout(Name, CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_UTILITY_BUFFER_INDEX,
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
+
+	VkPushConstantRange PushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FPushConstants)};
+	DescriptorSetManager->CreateDescriptorSetLayout({PushConstantRange}, Name);
+
+    PipelineStageFlags = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    QueueFlagsBits = VK_QUEUE_COMPUTE_BIT;
+}
+
+void FConvergenceTask::Init(FCompileDefinitions* CompileDefinitions)
+{
+    auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
+
+    PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
+
+    BuildPipeline(CompileDefinitions);
+
+    DescriptorSetManager->ReserveDescriptorSet(Name, CONVERGENCE_LAYOUT_INDEX, TotalSize);
+
+    DescriptorSetManager->ReserveDescriptorPool(Name);
+
+    DescriptorSetManager->AllocateAllDescriptorSets(Name);
+};
+
+std::vector<FShaderCompilationJob> FConvergenceTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/convergence.comp"}};
+}
+
+void FConvergenceTask::UpdateDescriptorSets()
+{
+    for (uint32_t i = 0; i < TotalSize; ++i)
+    {
+        UpdateDescriptorSet(CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_LUMINANCE_MOMENTS_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(LUMINANCE_MOMENTS_BUFFER));
+        UpdateDescriptorSet(CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_MASK_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_MASK_BUFFER));
+        UpdateDescriptorSet(CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_COUNTERS_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_COUNTERS_BUFFER));
+    	UpdateDescriptorSet(CONVERGENCE_LAYOUT_INDEX, CONVERGENCE_UTILITY_BUFFER_INDEX, i, RESOURCE_ALLOCATOR()->GetBuffer(UTILITY_INFO_BUFFER));
+    }
+};
+
+void FConvergenceTask::RecordCommands()
+{
+    CommandBuffers.resize(TotalSize);
+
+    for (uint32_t i = 0; i < TotalSize; ++i)
+    {
+        CommandBuffers[i] = COMMAND_BUFFER_MANAGER()->RecordCommand([&, this](VkCommandBuffer CommandBuffer)
+        {
+			ResetQueryPool(CommandBuffer, i);
+			GPU_TIMER();
+
+            vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline);
+            auto ComputeDescriptorSet = VK_CONTEXT()->DescriptorSetManager->GetSet(Name, CONVERGENCE_LAYOUT_INDEX, i);
+            vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, VK_CONTEXT()->DescriptorSetManager->GetPipelineLayout(Name),
+                                    0, 1, &ComputeDescriptorSet, 0, nullptr);
+
+            uint32_t GroupCount = CalculateGroupCount(Width * Height, BASIC_CHUNK_SIZE);
+			FPushConstants PushConstants = {Width, Height, 1.f / float(Width), 1.f / float(Height), Width * Height, 0, 0};
+			vkCmdPushConstants(CommandBuffer, VK_CONTEXT()->DescriptorSetManager->GetPipelineLayout(Name), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FPushConstants), &PushConstants);
+            vkCmdDispatch(CommandBuffer, GroupCount, 1, 1);
+
+            /// Every frame in flight copies the counters into its own slot, so the host can read them once the frame is finished without racing later frames
+            VkMemoryBarrier MemoryBarrier{};
+            MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            MemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            MemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+
+            auto CountersBuffer = RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_COUNTERS_BUFFER);
+            auto SnapshotBuffer = RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER);
+            VkBufferCopy BufferCopy{0, i * sizeof(uint32_t) * CONVERGENCE_COUNTERS_SIZE, sizeof(uint32_t) * CONVERGENCE_COUNTERS_SIZE};
+            vkCmdCopyBuffer(CommandBuffer, CountersBuffer.Buffer, SnapshotBuffer.Buffer, 1, &BufferCopy);
+
+            MemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            MemoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+        }, QueueFlagsBits);
+
+        V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
+    }
+};
+
+std::vector<FFrameGraphResourceAccess> FConvergenceTask::GetResourceAccesses() const
+{
+	return {
+		{LUMINANCE_MOMENTS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{CONVERGENCE_MASK_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{CONVERGENCE_COUNTERS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER | FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE | FRAME_GRAPH_ACCESS_TRANSFER_READ},
+		{CONVERGENCE_COUNTERS_SNAPSHOT_BUFFER, FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_TRANSFER_WRITE}};
+}
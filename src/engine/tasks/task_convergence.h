@@ -0,0 +1,15 @@
+#pragma once
+
+#include "executable_task.h"
+
+class FConvergenceTask : public FExecutableTask
+{
+public:
+    FConvergenceTask(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice);
+
+    void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
+    std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions) override;
+    void UpdateDescriptorSets() override;
+    void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
+};
@@ -44,3 +44,10 @@ void FCopyBufferTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FCopyBufferTask::GetResourceAccesses() const
+{
+	return {
+		{SrcBufferName, FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_TRANSFER_READ},
+		{DstBufferName, FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_TRANSFER_WRITE}};
+}
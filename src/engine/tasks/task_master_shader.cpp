@@ -3,6 +3,7 @@
 #include "vk_functions.h"
 
 #include "area_light_system.h"
+#include "material_code_generator.h"
 #include "material_component.h"
 #include "material_system.h"
 #include "renderable_system.h"
@@ -16,8 +17,12 @@
 #include "task_master_shader.h"
 #include "texture_manager.h"
 
-FMasterShader::FMasterShader(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice) :
-        FExecutableTask(WidthIn, HeightIn, SubmitXIn, SubmitYIn, LogicalDevice)
+#include <algorithm>
+
+FMasterShader::FMasterShader(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice, EMaterialPipelineMode MaterialPipelineModeIn, EIBLSamplingMode IBLSamplingModeIn,
+							 ELightSamplingMode PointLightSamplingModeIn) :
+        FExecutableTask(WidthIn, HeightIn, SubmitXIn, SubmitYIn, LogicalDevice), MaterialPipelineMode(MaterialPipelineModeIn), IBLSamplingMode(IBLSamplingModeIn),
+		PointLightSamplingMode(PointLightSamplingModeIn)
 {
     Name = "Master shader pipeline";
 	MaterialPipelines.resize(MATERIAL_SYSTEM()->MAX_MATERIALS, VK_NULL_HANDLE);
@@ -93,13 +98,7 @@ FMasterShader::FMasterShader(uint32_t WidthIn, uint32_t HeightIn, uint32_t Submi
 
 FMasterShader::~FMasterShader()
 {
-	for (auto& Buffer : SBTBuffers)
-	{
-		if (Buffer.Buffer != VK_NULL_HANDLE)
-		{
-			GetResourceAllocator()->DestroyBuffer(Buffer);
-		}
-	}
+	FMasterShader::DestroyPipeline();
 
 	vkDestroySampler(LogicalDevice, IBLSampler, nullptr);
 	vkDestroySampler(LogicalDevice, MaterialTextureSampler, nullptr);
@@ -111,39 +110,262 @@ void FMasterShader::Init(FCompileDefinitions* CompileDefinitions)
 
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
 
-	auto RayClosestHitShader = FShader("../src/shaders/master_shader.rchit");
-	auto RayMissShader = FShader("../src/shaders/master_shader.rmiss");
-	RGenRegions.resize(MATERIAL_SYSTEM()->Entities.size());
-	SBTBuffers.resize(RGenRegions.size());
+	BuildPipeline(CompileDefinitions);
+
+	MaterialTextureSampler = VK_CONTEXT()->CreateTextureSampler(VK_SAMPLE_COUNT_1_BIT, VK_FILTER_NEAREST);
+	IBLSampler = VK_CONTEXT()->CreateTextureSampler(VK_SAMPLE_COUNT_1_BIT, VK_FILTER_LINEAR);
+    /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
+    DescriptorSetManager->ReserveDescriptorSet(Name, MASTER_SHADER_LAYOUT_STATIC_INDEX, 1);
+	DescriptorSetManager->ReserveDescriptorSet(Name, MASTER_SHADER_LAYOUT_INDEX_PER_FRAME, SubmitY);
+
+    DescriptorSetManager->ReserveDescriptorPool(Name);
+
+    DescriptorSetManager->AllocateAllDescriptorSets(Name);
+};
 
-    const auto EmissiveMaterials = AREA_LIGHT_SYSTEM()->GetEmissiveMaterials();
-    auto EmissiveMaterialCode = MATERIAL_SYSTEM()->GenerateEmissiveMaterialsCode(EmissiveMaterials);
-    FCompileDefinitions MasterShaderCompileDefinitions(*CompileDefinitions);
-    MasterShaderCompileDefinitions.Push("FDeviceMaterial GetEmissiveMaterial(vec2 TextureCoords, uint MaterialIndex);", EmissiveMaterialCode);
+std::vector<FShaderCompilationJob> FMasterShader::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+	const auto EmissiveMaterials = AREA_LIGHT_SYSTEM()->GetEmissiveMaterials();
+	auto EmissiveMaterialCode = MATERIAL_SYSTEM()->GenerateEmissiveMaterialsCode(EmissiveMaterials);
+	FCompileDefinitions MasterShaderCompileDefinitions = CompileDefinitions ? *CompileDefinitions : FCompileDefinitions();
+	MasterShaderCompileDefinitions.Push("FDeviceMaterial GetEmissiveMaterial(vec2 TextureCoords, uint MaterialIndex);", EmissiveMaterialCode);
 	assert((sizeof(FDeviceMaterial) % sizeof(float)) == 0);
 	MasterShaderCompileDefinitions.Push("SIZE_OF_DEVICE_MATERIAL_STRUCT", std::to_string(sizeof(FDeviceMaterial) / sizeof(float)));
 
+	if (IBLSamplingMode == EIBLSamplingMode::Hierarchical)
+	{
+		MasterShaderCompileDefinitions.Push("IBL_HIERARCHICAL_SAMPLING", "1");
+	}
+
+	if (PointLightSamplingMode == ELightSamplingMode::BVH)
+	{
+		MasterShaderCompileDefinitions.Push("LIGHT_BVH", "1");
+	}
+
+	/// Shaders of all materials are compiled in parallel, closest hit and miss shaders go first and are shared by every material pipeline
+	std::vector<FShaderCompilationJob> Jobs = {{"../src/shaders/master_shader.rchit"}, {"../src/shaders/master_shader.rmiss"}};
+	PendingPipelineMaterialIndices.clear();
+
+	if (MaterialPipelineMode == EMaterialPipelineMode::Uber)
+	{
+		/// Doesn't depend on the materials, so adding or changing materials doesn't require recompilation
+		MasterShaderCompileDefinitions.Push("UBER_SHADER", "1");
+		MasterShaderCompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords, uint MaterialIndex);", GenerateRuntimeMaterialCode());
+		Jobs.push_back({"../src/shaders/master_shader.rgen", MasterShaderCompileDefinitions});
+		return Jobs;
+	}
+
 	for (auto& Material : *MATERIAL_SYSTEM())
 	{
-		auto MaterialCode = MATERIAL_SYSTEM()->GenerateMaterialCode(Material);
+		auto MaterialCode = MATERIAL_SYSTEM()->GenerateMaterialCode(Material, bSpecializeMaterials);
 		FCompileDefinitions CombinedCompileDefinitions(MasterShaderCompileDefinitions);
 		CombinedCompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords);", MaterialCode);
-		auto RayGenerationShader = FShader("../src/shaders/master_shader.rgen", &CombinedCompileDefinitions);
-		uint32_t MaterialIndex = COORDINATOR().GetIndex<ECS::COMPONENTS::FMaterialComponent>(Material);
-		MaterialPipelines[MaterialIndex] = VK_CONTEXT()->CreateRayTracingPipeline(RayGenerationShader(), RayMissShader(), RayClosestHitShader(), PipelineLayout);
-		SBTBuffers[MaterialIndex] = VK_CONTEXT()->GenerateSBT(MaterialPipelines[MaterialIndex], RMissRegion, RHitRegion, RGenRegions[MaterialIndex]);
+
+		if (bSpecializeMaterials)
+		{
+			for (auto& Define : MATERIAL_SYSTEM()->GetDisabledLayers(Material))
+			{
+				CombinedCompileDefinitions.Push(Define, "1");
+			}
+		}
+
+		PendingPipelineMaterialIndices.push_back(COORDINATOR().GetIndex<ECS::COMPONENTS::FMaterialComponent>(Material));
+		Jobs.push_back({"../src/shaders/master_shader.rgen", CombinedCompileDefinitions});
 	}
 
-	MaterialTextureSampler = VK_CONTEXT()->CreateTextureSampler(VK_SAMPLE_COUNT_1_BIT, VK_FILTER_NEAREST);
-	IBLSampler = VK_CONTEXT()->CreateTextureSampler(VK_SAMPLE_COUNT_1_BIT, VK_FILTER_LINEAR);
-    /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
-    DescriptorSetManager->ReserveDescriptorSet(Name, MASTER_SHADER_LAYOUT_STATIC_INDEX, 1);
-	DescriptorSetManager->ReserveDescriptorSet(Name, MASTER_SHADER_LAYOUT_INDEX_PER_FRAME, SubmitY);
+	PendingMaterialsSignature = GetMaterialsSignature();
 
-    DescriptorSetManager->ReserveDescriptorPool(Name);
+	return Jobs;
+}
 
-    DescriptorSetManager->AllocateAllDescriptorSets(Name);
-};
+bool FMasterShader::AreMaterialsOutdated() const
+{
+	if (MaterialPipelineMode == EMaterialPipelineMode::Uber)
+	{
+		return false;
+	}
+
+	return GetMaterialsSignature() != CompiledMaterialsSignature;
+}
+
+std::string FMasterShader::GetMaterialsSignature() const
+{
+	std::string Signature;
+
+	for (auto& Material : *MATERIAL_SYSTEM())
+	{
+		Signature += MATERIAL_SYSTEM()->GenerateMaterialCode(Material, bSpecializeMaterials);
+
+		if (bSpecializeMaterials)
+		{
+			for (auto& Define : MATERIAL_SYSTEM()->GetDisabledLayers(Material))
+			{
+				Signature += Define + "\n";
+			}
+		}
+	}
+
+	return Signature;
+}
+
+void FMasterShader::CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData)
+{
+	std::vector<std::shared_future<std::vector<uint32_t>>> ReadySPIRVData;
+
+	for (auto& Data : SPIRVData)
+	{
+		std::promise<std::vector<uint32_t>> Promise;
+		Promise.set_value(Data);
+		ReadySPIRVData.push_back(Promise.get_future().share());
+	}
+
+	ReplacePipeline(ReadySPIRVData);
+}
+
+void FMasterShader::ReplacePipeline(const std::vector<std::shared_future<std::vector<uint32_t>>>& SPIRVData)
+{
+	assert(SPIRVData.size() == (MaterialPipelineMode == EMaterialPipelineMode::Uber ? 3 : PendingPipelineMaterialIndices.size() + 2) &&
+		"Every material should have its own ray generation shader, or there should be a single uber shader");
+
+	/// Errors are collected in the order of the jobs, like FShaderCompilationPool::CompileBatch does
+	std::string ErrorMessage;
+
+	auto GetShaderData = [&](size_t JobIndex) -> const std::vector<uint32_t>*
+	{
+		try
+		{
+			return &SPIRVData[JobIndex].get();
+		}
+		catch (const std::runtime_error& Error)
+		{
+			ErrorMessage += FShaderCompilationPool::GetJobErrorMessage(JobIndex, Error);
+			return nullptr;
+		}
+	};
+
+	/// Closest hit and miss shaders go first and are shared by every pipeline
+	auto RayClosestHitShaderData = GetShaderData(0);
+	auto RayMissShaderData = GetShaderData(1);
+	std::unique_ptr<FShader> RayClosestHitShader;
+	std::unique_ptr<FShader> RayMissShader;
+
+	if (ErrorMessage.empty())
+	{
+		RayClosestHitShader = std::make_unique<FShader>(*RayClosestHitShaderData);
+		RayMissShader = std::make_unique<FShader>(*RayMissShaderData);
+	}
+
+	/// New pipelines are created next to the old ones, which are replaced only once every shader compiled.
+	/// After the first error the rest of the shaders are only waited for, so that all errors are reported
+	std::vector<VkPipeline> NewPipelines(SPIRVData.size() - 2, VK_NULL_HANDLE);
+	std::vector<FBuffer> NewSBTBuffers(NewPipelines.size());
+	std::vector<VkStridedDeviceAddressRegionKHR> NewRGenRegions(NewPipelines.size());
+	VkStridedDeviceAddressRegionKHR NewRMissRegion{};
+	VkStridedDeviceAddressRegionKHR NewRHitRegion{};
+
+	for (size_t i = 0; i < NewPipelines.size(); ++i)
+	{
+		auto RayGenerationShaderData = GetShaderData(i + 2);
+
+		if (!ErrorMessage.empty())
+		{
+			continue;
+		}
+
+		auto RayGenerationShader = FShader(*RayGenerationShaderData);
+		NewPipelines[i] = VK_CONTEXT()->CreateRayTracingPipeline(RayGenerationShader(), (*RayMissShader)(), (*RayClosestHitShader)(), PipelineLayout);
+		NewSBTBuffers[i] = VK_CONTEXT()->GenerateSBT(NewPipelines[i], NewRMissRegion, NewRHitRegion, NewRGenRegions[i]);
+	}
+
+	if (!ErrorMessage.empty())
+	{
+		for (size_t i = 0; i < NewPipelines.size(); ++i)
+		{
+			if (NewPipelines[i] != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(LogicalDevice, NewPipelines[i], nullptr);
+			}
+
+			if (NewSBTBuffers[i].Buffer != VK_NULL_HANDLE)
+			{
+				GetResourceAllocator()->DestroyBuffer(NewSBTBuffers[i]);
+			}
+		}
+
+		throw std::runtime_error(ErrorMessage);
+	}
+
+	DestroyPipeline();
+	RMissRegion = NewRMissRegion;
+	RHitRegion = NewRHitRegion;
+
+	if (MaterialPipelineMode == EMaterialPipelineMode::Uber)
+	{
+		UberPipeline = NewPipelines[0];
+		UberSBTBuffer = NewSBTBuffers[0];
+		UberRGenRegion = NewRGenRegions[0];
+		return;
+	}
+
+	RGenRegions.resize(MATERIAL_SYSTEM()->MAX_MATERIALS);
+	SBTBuffers.resize(RGenRegions.size());
+
+	for (size_t i = 0; i < NewPipelines.size(); ++i)
+	{
+		uint32_t MaterialIndex = PendingPipelineMaterialIndices[i];
+		MaterialPipelines[MaterialIndex] = NewPipelines[i];
+		SBTBuffers[MaterialIndex] = NewSBTBuffers[i];
+		RGenRegions[MaterialIndex] = NewRGenRegions[i];
+	}
+
+	PipelineMaterialIndices = PendingPipelineMaterialIndices;
+	CompiledMaterialsSignature = PendingMaterialsSignature;
+}
+
+void FMasterShader::DestroyPipeline()
+{
+	for (auto& MaterialPipeline : MaterialPipelines)
+	{
+		if (MaterialPipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(LogicalDevice, MaterialPipeline, nullptr);
+			MaterialPipeline = VK_NULL_HANDLE;
+		}
+	}
+
+	for (auto& Buffer : SBTBuffers)
+	{
+		if (Buffer.Buffer != VK_NULL_HANDLE)
+		{
+			GetResourceAllocator()->DestroyBuffer(Buffer);
+		}
+	}
+
+	if (UberPipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(LogicalDevice, UberPipeline, nullptr);
+		UberPipeline = VK_NULL_HANDLE;
+	}
+
+	if (UberSBTBuffer.Buffer != VK_NULL_HANDLE)
+	{
+		GetResourceAllocator()->DestroyBuffer(UberSBTBuffer);
+	}
+
+	FExecutableTask::DestroyPipeline();
+}
+
+uint32_t FMasterShader::GetPipelineCount() const
+{
+	uint32_t PipelineCount = (UberPipeline != VK_NULL_HANDLE) ? 1 : 0;
+
+	for (auto& MaterialPipeline : MaterialPipelines)
+	{
+		PipelineCount += (MaterialPipeline != VK_NULL_HANDLE) ? 1 : 0;
+	}
+
+	return PipelineCount;
+}
 
 void FMasterShader::UpdateDescriptorSets()
 {
@@ -191,6 +413,7 @@ void FMasterShader::RecordCommands()
 {
     CommandBuffers.resize(TotalSize);
 	auto TotalCountedMaterialsBuffer = VK_CONTEXT()->GetBufferDeviceAddressInfo(RESOURCE_ALLOCATOR()->GetBuffer(TOTAL_COUNTED_MATERIALS_BUFFER));
+	auto ActiveRayCountBuffer = VK_CONTEXT()->GetBufferDeviceAddressInfo(RESOURCE_ALLOCATOR()->GetBuffer(ACTIVE_RAY_COUNT_BUFFER)) + ACTIVE_RAY_COUNT_TRACE_RAYS_ARGUMENTS * sizeof(uint32_t);
 
     for (uint32_t i = 0; i < TotalSize; ++i)
     {
@@ -198,12 +421,11 @@ void FMasterShader::RecordCommands()
         {
 			ResetQueryPool(CommandBuffer, i);
 			GPU_TIMER();
+			uint32_t RecordedCommands = 0;
 
-			for (auto& Material : *MATERIAL_SYSTEM())
+			auto TraceRays = [&](VkPipeline Pipeline, uint32_t MaterialIndex, VkStridedDeviceAddressRegionKHR* RGenRegion, VkDeviceAddress IndirectDeviceAddress)
 			{
-				uint32_t MaterialIndex = COORDINATOR().GetIndex<ECS::COMPONENTS::FMaterialComponent>(Material);
-
-				vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, MaterialPipelines[MaterialIndex]);
+				vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, Pipeline);
 				std::vector<VkDescriptorSet> RayTracingDescriptorSets = {
 					VK_CONTEXT()->DescriptorSetManager->GetSet(Name, MASTER_SHADER_LAYOUT_STATIC_INDEX, 0),
 					VK_CONTEXT()->DescriptorSetManager->GetSet(Name, MASTER_SHADER_LAYOUT_INDEX_PER_FRAME, i / SubmitX)};
@@ -213,10 +435,52 @@ void FMasterShader::RecordCommands()
 				FPushConstants PushConstants = { Width, Height, 1.f / float(Width), 1.f / float(Height), Width * Height, MaterialIndex, i % SubmitX };
 				vkCmdPushConstants(CommandBuffer, VK_CONTEXT()->DescriptorSetManager->GetPipelineLayout(Name), VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, sizeof(FPushConstants), &PushConstants);
 
-				V::vkCmdTraceRaysIndirectKHR(CommandBuffer, &RGenRegions[MaterialIndex], &RMissRegion, &RHitRegion, &RCallRegion, TotalCountedMaterialsBuffer + (MaterialIndex * 3 * sizeof(uint32_t)));
+				V::vkCmdTraceRaysIndirectKHR(CommandBuffer, RGenRegion, &RMissRegion, &RHitRegion, &RCallRegion, IndirectDeviceAddress);
+				RecordedCommands += 4;
+			};
+
+			if (MaterialPipelineMode == EMaterialPipelineMode::Uber)
+			{
+				/// Sorted rays of all materials start at the offset of the first material, and the number of rays which hit anything is already counted for the next bounce
+				TraceRays(UberPipeline, 0, &UberRGenRegion, ActiveRayCountBuffer);
+			}
+			else
+			{
+				for (auto& Material : *MATERIAL_SYSTEM())
+				{
+					uint32_t MaterialIndex = COORDINATOR().GetIndex<ECS::COMPONENTS::FMaterialComponent>(Material);
+
+					/// Materials added after the last successful build have no pipeline until the shaders compile, their rays are skipped meanwhile
+					if (std::find(PipelineMaterialIndices.begin(), PipelineMaterialIndices.end(), MaterialIndex) == PipelineMaterialIndices.end())
+					{
+						continue;
+					}
+
+					TraceRays(MaterialPipelines[MaterialIndex], MaterialIndex, &RGenRegions[MaterialIndex], TotalCountedMaterialsBuffer + (MaterialIndex * 3 * sizeof(uint32_t)));
+				}
 			}
+
+			CommandsPerBounce = RecordedCommands;
         }, QueueFlagsBits);
 
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FMasterShader::GetResourceAccesses() const
+{
+	/// Rays are traced indirectly, per material or all at once in the uber mode
+	return {
+		{TLAS_ACCELERATION_STRUCTURE, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_READ},
+		{TOTAL_COUNTED_MATERIALS_BUFFER, FRAME_GRAPH_STAGE_DRAW_INDIRECT, FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ},
+		{ACTIVE_RAY_COUNT_BUFFER, FRAME_GRAPH_STAGE_DRAW_INDIRECT, FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ},
+		{INITIAL_RAYS_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{HITS_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{MATERIALS_OFFSETS_PER_MATERIAL_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{PIXEL_INDEX_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{CUMULATIVE_MATERIAL_COLOR_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{THROUGHPUT_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{RENDER_ITERATION_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{"ColorImage", FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{"AOVImage", FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE}};
+}
@@ -1,26 +1,67 @@
 #pragma once
 
 #include "executable_task.h"
+#include "renderer_options.h"
 #include "vk_acceleration_structure.h"
 
 class FMasterShader : public FExecutableTask
 {
 public:
-	FMasterShader(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice);
+	FMasterShader(uint32_t WidthIn, uint32_t HeightIn, uint32_t SubmitXIn, uint32_t SubmitYIn, VkDevice LogicalDevice,
+				  EMaterialPipelineMode MaterialPipelineModeIn = EMaterialPipelineMode::PerMaterial, EIBLSamplingMode IBLSamplingModeIn = EIBLSamplingMode::AliasTable,
+				  ELightSamplingMode PointLightSamplingModeIn = ELightSamplingMode::AliasTable);
     ~FMasterShader() override;
 
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
+    std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions) override;
+    void CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData) override;
+    /// Every material pipeline is created as soon as its own ray generation shader is ready
+    void ReplacePipeline(const std::vector<std::shared_future<std::vector<uint32_t>>>& SPIRVData) override;
+    void DestroyPipeline() override;
     void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
+
+    /// Number of ray tracing pipelines currently created
+    uint32_t GetPipelineCount() const;
+    /// True if the materials changed in a way that requires recompiling the per material shaders
+    bool AreMaterialsOutdated() const;
+
+    const EMaterialPipelineMode MaterialPipelineMode;
+    /// Has to match the IBL tables CreateEXRImageFromFile built
+    const EIBLSamplingMode IBLSamplingMode;
+    /// Has to match what the point light system loads into the point lights importance buffer
+    const ELightSamplingMode PointLightSamplingMode;
+    /// Commands recorded to shade a single bounce, updated every time the command buffers are recorded
+    uint32_t CommandsPerBounce = 0;
+    /// Fold constant material fields into the per material shaders and compile out the layers they don't use
+    bool bSpecializeMaterials = true;
 
 	VkSampler MaterialTextureSampler = VK_NULL_HANDLE;
 	std::vector<VkPipeline> MaterialPipelines;
 	VkSampler IBLSampler = VK_NULL_HANDLE;
 
     std::vector<FBuffer> SBTBuffers;
+    /// Material index of every ray generation shader, in the order they were compiled
+    std::vector<uint32_t> PipelineMaterialIndices;
 
     std::vector<VkStridedDeviceAddressRegionKHR> RGenRegions;
     VkStridedDeviceAddressRegionKHR RMissRegion{};
     VkStridedDeviceAddressRegionKHR RHitRegion{};
     VkStridedDeviceAddressRegionKHR RCallRegion{};
+
+    /// Used instead of the per material pipelines in EMaterialPipelineMode::Uber
+    VkPipeline UberPipeline = VK_NULL_HANDLE;
+    FBuffer UberSBTBuffer;
+    VkStridedDeviceAddressRegionKHR UberRGenRegion{};
+
+private:
+    /// Everything about the materials that ends up in the per material shaders
+    std::string GetMaterialsSignature() const;
+
+    /// Signature of the materials the current shaders were compiled for
+    std::string CompiledMaterialsSignature;
+    /// What PipelineMaterialIndices and CompiledMaterialsSignature become once the shaders of the last GetShaderCompilationJobs call make it into pipelines
+    std::vector<uint32_t> PendingPipelineMaterialIndices;
+    std::string PendingMaterialsSignature;
 };
@@ -32,10 +32,8 @@ void FClearTotalMaterialsCountTask::Init(FCompileDefinitions* CompileDefinitions
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto MaterialCountShader = FShader("../src/shaders/material_sort_clear_total_material_count.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(MaterialCountShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, MATERIAL_SORT_CLEAR_TOTAL_MATERIALS_COUNT_LAYOUT_INDEX, TotalSize);
@@ -45,6 +43,11 @@ void FClearTotalMaterialsCountTask::Init(FCompileDefinitions* CompileDefinitions
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FClearTotalMaterialsCountTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/material_sort_clear_total_material_count.comp"}};
+}
+
 void FClearTotalMaterialsCountTask::UpdateDescriptorSets()
 {
     for (uint32_t i = 0; i < TotalSize; ++i)
@@ -75,3 +78,8 @@ void FClearTotalMaterialsCountTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FClearTotalMaterialsCountTask::GetResourceAccesses() const
+{
+	return {{TOTAL_COUNTED_MATERIALS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE}};
+}
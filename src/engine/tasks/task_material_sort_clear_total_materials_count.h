@@ -9,6 +9,8 @@ public:
     ~FClearTotalMaterialsCountTask() override;
 
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
+    std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions) override;
     void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
 };
@@ -21,7 +21,8 @@ FComputeOffsetsPerMaterialTask::FComputeOffsetsPerMaterialTask(uint32_t WidthIn,
 	DescriptorSetManager->AddDescriptorLayout(Name, MATERIAL_SORT_COMPUTE_OFFSETS_PER_MATERIAL_LAYOUT_INDEX, MATERIAL_SORT_ACTIVE_RAY_COUNT_BUFFER,
 											  {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  VK_SHADER_STAGE_COMPUTE_BIT});
 
-    DescriptorSetManager->CreateDescriptorSetLayout({}, Name);
+    VkPushConstantRange PushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t)};
+    DescriptorSetManager->CreateDescriptorSetLayout({PushConstantRange}, Name);
 
     PipelineStageFlags = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     QueueFlagsBits = VK_QUEUE_COMPUTE_BIT;
@@ -35,10 +36,8 @@ void FComputeOffsetsPerMaterialTask::Init(FCompileDefinitions* CompileDefinition
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto MaterialCountShader = FShader("../src/shaders/material_sort_compute_offsets_per_material.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(MaterialCountShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, MATERIAL_SORT_COMPUTE_OFFSETS_PER_MATERIAL_LAYOUT_INDEX, TotalSize);
@@ -48,6 +47,11 @@ void FComputeOffsetsPerMaterialTask::Init(FCompileDefinitions* CompileDefinition
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FComputeOffsetsPerMaterialTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/material_sort_compute_offsets_per_material.comp"}};
+}
+
 void FComputeOffsetsPerMaterialTask::UpdateDescriptorSets()
 {
     for (uint32_t i = 0; i < TotalSize; ++i)
@@ -74,9 +78,21 @@ void FComputeOffsetsPerMaterialTask::RecordCommands()
             vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, VK_CONTEXT()->DescriptorSetManager->GetPipelineLayout(Name),
                                     0, 1, &ComputeDescriptorSet, 0, nullptr);
 
+            /// Picks the compaction arguments to write for the next bounce
+            uint32_t BounceIndex = i % SubmitX;
+            vkCmdPushConstants(CommandBuffer, VK_CONTEXT()->DescriptorSetManager->GetPipelineLayout(Name), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &BounceIndex);
+
             vkCmdDispatch(CommandBuffer, 1, 1, 1);
         }, QueueFlagsBits);
 
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FComputeOffsetsPerMaterialTask::GetResourceAccesses() const
+{
+	return {
+		{TOTAL_COUNTED_MATERIALS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{MATERIALS_OFFSETS_PER_MATERIAL_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{ACTIVE_RAY_COUNT_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE}};
+}
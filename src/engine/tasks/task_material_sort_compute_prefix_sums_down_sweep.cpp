@@ -32,10 +32,8 @@ void FComputePrefixSumsDownSweepTask::Init(FCompileDefinitions* CompileDefinitio
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto MaterialCountShader = FShader("../src/shaders/material_sort_compute_prefix_sums_down_sweep.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(MaterialCountShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, MATERIAL_SORT_COMPUTE_PREFIX_SUMS_DOWN_SWEEP_LAYOUT_INDEX, TotalSize);
@@ -45,6 +43,11 @@ void FComputePrefixSumsDownSweepTask::Init(FCompileDefinitions* CompileDefinitio
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FComputePrefixSumsDownSweepTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/material_sort_compute_prefix_sums_down_sweep.comp"}};
+}
+
 void FComputePrefixSumsDownSweepTask::UpdateDescriptorSets()
 {
     for (uint32_t i = 0; i < TotalSize; ++i)
@@ -95,3 +98,8 @@ void FComputePrefixSumsDownSweepTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FComputePrefixSumsDownSweepTask::GetResourceAccesses() const
+{
+	return {{COUNTED_MATERIALS_PER_CHUNK_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE}};
+}
@@ -32,10 +32,8 @@ void FComputePrefixSumsUpSweepTask::Init(FCompileDefinitions* CompileDefinitions
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto MaterialCountShader = FShader("../src/shaders/material_sort_compute_prefix_sums_up_sweep.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(MaterialCountShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, MATERIAL_SORT_COMPUTE_PREFIX_SUMS_UP_SWEEP_LAYOUT_INDEX, TotalSize);
@@ -45,6 +43,11 @@ void FComputePrefixSumsUpSweepTask::Init(FCompileDefinitions* CompileDefinitions
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FComputePrefixSumsUpSweepTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/material_sort_compute_prefix_sums_up_sweep.comp"}};
+}
+
 void FComputePrefixSumsUpSweepTask::UpdateDescriptorSets()
 {
     for (uint32_t i = 0; i < TotalSize; ++i)
@@ -94,3 +97,8 @@ void FComputePrefixSumsUpSweepTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FComputePrefixSumsUpSweepTask::GetResourceAccesses() const
+{
+	return {{COUNTED_MATERIALS_PER_CHUNK_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE}};
+}
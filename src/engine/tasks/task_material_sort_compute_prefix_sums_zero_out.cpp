@@ -34,10 +34,8 @@ void FComputePrefixSumsZeroOutTask::Init(FCompileDefinitions* CompileDefinitions
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto MaterialCountShader = FShader("../src/shaders/material_sort_prefix_sums_zero_out.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(MaterialCountShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, MATERIAL_SORT_COMPUTE_PREFIX_SUMS_ZERO_OUT_LAYOUT_INDEX, TotalSize);
@@ -47,6 +45,11 @@ void FComputePrefixSumsZeroOutTask::Init(FCompileDefinitions* CompileDefinitions
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FComputePrefixSumsZeroOutTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/material_sort_prefix_sums_zero_out.comp"}};
+}
+
 void FComputePrefixSumsZeroOutTask::UpdateDescriptorSets()
 {
     for (size_t i = 0; i < TotalSize; ++i)
@@ -84,3 +87,10 @@ void FComputePrefixSumsZeroOutTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FComputePrefixSumsZeroOutTask::GetResourceAccesses() const
+{
+	return {
+		{COUNTED_MATERIALS_PER_CHUNK_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{TOTAL_COUNTED_MATERIALS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE}};
+}
@@ -53,11 +53,9 @@ void FMissTask::Init(FCompileDefinitions* CompileDefinitions)
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto ShadeShader = FShader("../src/shaders/miss.comp");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
 
-    Pipeline = VK_CONTEXT()->CreateComputePipeline(ShadeShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
 	IBLImageSamplerLinear = VK_CONTEXT()->CreateTextureSampler(VK_SAMPLE_COUNT_1_BIT, VK_FILTER_LINEAR);
 
@@ -69,6 +67,11 @@ void FMissTask::Init(FCompileDefinitions* CompileDefinitions)
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FMissTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/miss.comp"}};
+}
+
 void FMissTask::UpdateDescriptorSets()
 {
     for (int i = 0; i < TotalSize; ++i)
@@ -89,7 +92,8 @@ void FMissTask::UpdateDescriptorSets()
 void FMissTask::RecordCommands()
 {
     CommandBuffers.resize(TotalSize);
-	auto DispatchBuffer = RESOURCE_ALLOCATOR()->GetBuffer(TOTAL_COUNTED_MATERIALS_BUFFER);
+	/// Sized by the missed rays of the bounce, the compute offsets pass writes the arguments
+	auto DispatchBuffer = RESOURCE_ALLOCATOR()->GetBuffer(ACTIVE_RAY_COUNT_BUFFER);
 
     for (uint32_t i = 0; i < TotalSize; ++i)
     {
@@ -108,9 +112,23 @@ void FMissTask::RecordCommands()
             vkCmdPushConstants(CommandBuffer, VK_CONTEXT()->DescriptorSetManager->GetPipelineLayout(Name),
                                VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FPushConstants), &PushConstants);
 
-            vkCmdDispatchIndirect(CommandBuffer, DispatchBuffer.Buffer, MaterialIndex * 3 * sizeof(uint32_t));
+            vkCmdDispatchIndirect(CommandBuffer, DispatchBuffer.Buffer, ACTIVE_RAY_COUNT_MISS_DISPATCH_ARGUMENTS * sizeof(uint32_t));
         }, QueueFlagsBits);
 
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FMissTask::GetResourceAccesses() const
+{
+	return {
+		{ACTIVE_RAY_COUNT_BUFFER, FRAME_GRAPH_STAGE_DRAW_INDIRECT, FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ},
+		{INITIAL_RAYS_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{PIXEL_INDEX_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{MATERIAL_INDEX_AOV_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{MATERIALS_OFFSETS_PER_MATERIAL_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{CUMULATIVE_MATERIAL_COLOR_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{THROUGHPUT_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{"ColorImage", FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE},
+		{"AOVImage", FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE}};
+}
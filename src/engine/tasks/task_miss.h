@@ -9,8 +9,10 @@ public:
     ~FMissTask() override;
 
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
+    std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions) override;
     void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
 
     VkSampler IBLImageSamplerLinear = VK_NULL_HANDLE;
 };
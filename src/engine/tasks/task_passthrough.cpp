@@ -32,7 +32,7 @@ FPassthroughTask::~FPassthroughTask()
     }
 
     vkDestroySampler(LogicalDevice, Sampler, nullptr);
-    vkDestroyRenderPass(LogicalDevice, RenderPass, nullptr);
+    FPassthroughTask::DestroyPipeline();
 }
 
 void FPassthroughTask::Init(FCompileDefinitions* CompileDefinitions)
@@ -41,14 +41,10 @@ void FPassthroughTask::Init(FCompileDefinitions* CompileDefinitions)
 
     Sampler = VK_CONTEXT()->CreateTextureSampler(VK_CONTEXT()->MipLevels, VK_FILTER_LINEAR);
 
-    auto VertexShader = FShader("../src/shaders/passthrough.vert");
-    auto FragmentShader = FShader("../src/shaders/passthrough.frag");
-
     GraphicsPipelineOptions.RegisterColorAttachment(0, Outputs["PassthroughOutput" + std::to_string(0)], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ATTACHMENT_LOAD_OP_CLEAR);
     GraphicsPipelineOptions.SetPipelineLayout(DescriptorSetManager->GetPipelineLayout(Name));
 
-    Pipeline = VK_CONTEXT()->CreateGraphicsPipeline(VertexShader(), FragmentShader(), Width, Height, GraphicsPipelineOptions);
-    RenderPass = GraphicsPipelineOptions.RenderPass;
+    BuildPipeline(CompileDefinitions);
 
     PassthroughFramebuffers.resize(TotalSize);
 
@@ -65,6 +61,32 @@ void FPassthroughTask::Init(FCompileDefinitions* CompileDefinitions)
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
 }
 
+std::vector<FShaderCompilationJob> FPassthroughTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/passthrough.vert"}, {"../src/shaders/passthrough.frag"}};
+}
+
+void FPassthroughTask::CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData)
+{
+    auto VertexShader = FShader(SPIRVData[0]);
+    auto FragmentShader = FShader(SPIRVData[1]);
+
+    /// Render pass is created together with the pipeline. A new one is compatible with the old one, so framebuffers stay valid
+    Pipeline = VK_CONTEXT()->CreateGraphicsPipeline(VertexShader(), FragmentShader(), Width, Height, GraphicsPipelineOptions);
+    RenderPass = GraphicsPipelineOptions.RenderPass;
+}
+
+void FPassthroughTask::DestroyPipeline()
+{
+    if (RenderPass != VK_NULL_HANDLE)
+    {
+        vkDestroyRenderPass(LogicalDevice, RenderPass, nullptr);
+        RenderPass = VK_NULL_HANDLE;
+    }
+
+    FExecutableTask::DestroyPipeline();
+}
+
 void FPassthroughTask::UpdateDescriptorSets()
 {
     for (int i = 0; i < TotalSize; ++i)
@@ -114,3 +136,10 @@ void FPassthroughTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 }
+
+std::vector<FFrameGraphResourceAccess> FPassthroughTask::GetResourceAccesses() const
+{
+	return {
+		{"EstimatedImage", FRAME_GRAPH_STAGE_FRAGMENT_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{"PassthroughOutput", FRAME_GRAPH_STAGE_COLOR_ATTACHMENT_OUTPUT, FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE}};
+}
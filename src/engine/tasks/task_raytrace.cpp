@@ -38,6 +38,8 @@ FRaytraceTask::FRaytraceTask(uint32_t WidthIn, uint32_t HeightIn, uint32_t Submi
 		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR});
 	DescriptorSetManager->AddDescriptorLayout(Name, RAYTRACE_LAYOUT_INDEX, RAYTRACE_THROUGHPUT_BUFFER,
 		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR});
+	DescriptorSetManager->AddDescriptorLayout(Name, RAYTRACE_LAYOUT_INDEX, RAYTRACE_CONVERGENCE_MASK_BUFFER,
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR});
 
 	VkPushConstantRange PushConstantRange{VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, sizeof(FPushConstants)};
 	DescriptorSetManager->CreateDescriptorSetLayout({PushConstantRange}, Name);
@@ -48,20 +50,16 @@ FRaytraceTask::FRaytraceTask(uint32_t WidthIn, uint32_t HeightIn, uint32_t Submi
 
 FRaytraceTask::~FRaytraceTask()
 {
-    GetResourceAllocator()->DestroyBuffer(SBTBuffer);
+    FRaytraceTask::DestroyPipeline();
 };
 
 void FRaytraceTask::Init(FCompileDefinitions* CompileDefinitions)
 {
     auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-    auto RayGenerationShader = FShader("../src/shaders/raytrace.rgen");
-    auto RayClosestHitShader = FShader("../src/shaders/raytrace.rchit");
-    auto RayMissShader = FShader("../src/shaders/raytrace.rmiss");
-
     PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
 
-    Pipeline = VK_CONTEXT()->CreateRayTracingPipeline(RayGenerationShader(), RayMissShader(), RayClosestHitShader(), PipelineLayout);
+    BuildPipeline(CompileDefinitions);
 
     /// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
     DescriptorSetManager->ReserveDescriptorSet(Name, RAYTRACE_LAYOUT_INDEX, TotalSize);
@@ -69,9 +67,32 @@ void FRaytraceTask::Init(FCompileDefinitions* CompileDefinitions)
     DescriptorSetManager->ReserveDescriptorPool(Name);
 
     DescriptorSetManager->AllocateAllDescriptorSets(Name);
+};
 
+std::vector<FShaderCompilationJob> FRaytraceTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+    return {{"../src/shaders/raytrace.rgen"}, {"../src/shaders/raytrace.rchit"}, {"../src/shaders/raytrace.rmiss"}};
+}
+
+void FRaytraceTask::CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData)
+{
+    auto RayGenerationShader = FShader(SPIRVData[0]);
+    auto RayClosestHitShader = FShader(SPIRVData[1]);
+    auto RayMissShader = FShader(SPIRVData[2]);
+
+    Pipeline = VK_CONTEXT()->CreateRayTracingPipeline(RayGenerationShader(), RayMissShader(), RayClosestHitShader(), PipelineLayout);
     SBTBuffer = VK_CONTEXT()->GenerateSBT(Pipeline, RMissRegion, RHitRegion, RGenRegion);
-};
+}
+
+void FRaytraceTask::DestroyPipeline()
+{
+    if (SBTBuffer.Buffer != VK_NULL_HANDLE)
+    {
+        GetResourceAllocator()->DestroyBuffer(SBTBuffer);
+    }
+
+    FExecutableTask::DestroyPipeline();
+}
 
 void FRaytraceTask::UpdateDescriptorSets()
 {
@@ -86,13 +107,14 @@ void FRaytraceTask::UpdateDescriptorSets()
 		UpdateDescriptorSet(RAYTRACE_LAYOUT_INDEX, RAYTRACE_CAMERA_POSITION_BUFFER, i, CAMERA_SYSTEM()->DeviceBuffer);
 		UpdateDescriptorSet(RAYTRACE_LAYOUT_INDEX, RAYTRACE_RENDER_ITERATION_BUFFER, i, RESOURCE_ALLOCATOR()->GetBuffer(RENDER_ITERATION_BUFFER));
 		UpdateDescriptorSet(RAYTRACE_LAYOUT_INDEX, RAYTRACE_THROUGHPUT_BUFFER, i, RESOURCE_ALLOCATOR()->GetBuffer(THROUGHPUT_BUFFER));
+		UpdateDescriptorSet(RAYTRACE_LAYOUT_INDEX, RAYTRACE_CONVERGENCE_MASK_BUFFER, i, RESOURCE_ALLOCATOR()->GetBuffer(CONVERGENCE_MASK_BUFFER));
     }
 };
 
 void FRaytraceTask::RecordCommands()
 {
     CommandBuffers.resize(TotalSize);
-	auto ActiveRayCountBufferDeviceAddress = VK_CONTEXT()->GetBufferDeviceAddressInfo(RESOURCE_ALLOCATOR()->GetBuffer(ACTIVE_RAY_COUNT_BUFFER));
+	auto ActiveRayCountBufferDeviceAddress = VK_CONTEXT()->GetBufferDeviceAddressInfo(RESOURCE_ALLOCATOR()->GetBuffer(ACTIVE_RAY_COUNT_BUFFER)) + ACTIVE_RAY_COUNT_TRACE_RAYS_ARGUMENTS * sizeof(uint32_t);
 
     for (uint32_t i = 0; i < TotalSize; ++i)
     {
@@ -115,3 +137,17 @@ void FRaytraceTask::RecordCommands()
         V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FRaytraceTask::GetResourceAccesses() const
+{
+	return {
+		{TLAS_ACCELERATION_STRUCTURE, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_READ},
+		{ACTIVE_RAY_COUNT_BUFFER, FRAME_GRAPH_STAGE_DRAW_INDIRECT, FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ},
+		{INITIAL_RAYS_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{PIXEL_INDEX_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{THROUGHPUT_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE},
+		{HITS_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE},
+		{MATERIAL_INDEX_AOV_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE},
+		{RENDER_ITERATION_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ},
+		{CONVERGENCE_MASK_BUFFER, FRAME_GRAPH_STAGE_RAY_TRACING_SHADER, FRAME_GRAPH_ACCESS_SHADER_READ}};
+}
@@ -10,8 +10,12 @@ public:
     ~FRaytraceTask() override;
 
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
+    std::vector<FShaderCompilationJob> GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions) override;
+    void CreatePipeline(const std::vector<std::vector<uint32_t>>& SPIRVData) override;
+    void DestroyPipeline() override;
     void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
 
     FBuffer SBTBuffer;
 
@@ -34,11 +34,9 @@ void FResetActiveRayCountTask::Init(FCompileDefinitions* CompileDefinitions)
 {
 	auto& DescriptorSetManager = VK_CONTEXT()->DescriptorSetManager;
 
-	auto ShadeShader = FShader("../src/shaders/reset_active_ray_count.comp");
-
 	PipelineLayout = DescriptorSetManager->GetPipelineLayout(Name);
 
-	Pipeline = VK_CONTEXT()->CreateComputePipeline(ShadeShader(), PipelineLayout);
+	BuildPipeline(CompileDefinitions);
 
 	/// Reserve descriptor sets that will be bound once per frame and once for each renderable objects
 	DescriptorSetManager->ReserveDescriptorSet(Name, RESET_ACTIVE_RAY_COUNT_LAYOUT_INDEX, TotalSize);
@@ -48,6 +46,11 @@ void FResetActiveRayCountTask::Init(FCompileDefinitions* CompileDefinitions)
 	DescriptorSetManager->AllocateAllDescriptorSets(Name);
 };
 
+std::vector<FShaderCompilationJob> FResetActiveRayCountTask::GetShaderCompilationJobs(FCompileDefinitions* CompileDefinitions)
+{
+	return {{"../src/shaders/reset_active_ray_count.comp"}};
+}
+
 void FResetActiveRayCountTask::UpdateDescriptorSets()
 {
 	for (size_t i = 0; i < TotalSize; ++i)
@@ -82,3 +85,8 @@ void FResetActiveRayCountTask::RecordCommands()
 		V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
 	}
 };
+
+std::vector<FFrameGraphResourceAccess> FResetActiveRayCountTask::GetResourceAccesses() const
+{
+	return {{ACTIVE_RAY_COUNT_BUFFER, FRAME_GRAPH_STAGE_COMPUTE_SHADER, FRAME_GRAPH_ACCESS_SHADER_WRITE}};
+}
@@ -72,3 +72,8 @@ void FUpdateTLASTask::RecordCommands()
 		V::SetName(LogicalDevice, CommandBuffers[i], Name, i);
     }
 };
+
+std::vector<FFrameGraphResourceAccess> FUpdateTLASTask::GetResourceAccesses() const
+{
+	return {{TLAS_ACCELERATION_STRUCTURE, FRAME_GRAPH_STAGE_ACCELERATION_STRUCTURE_BUILD, FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_WRITE}};
+}
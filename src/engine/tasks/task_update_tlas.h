@@ -11,6 +11,7 @@ public:
     void Init(FCompileDefinitions* CompileDefinitions = nullptr) override;
 	void UpdateDescriptorSets() override;
     void RecordCommands() override;
+    std::vector<FFrameGraphResourceAccess> GetResourceAccesses() const override;
 
 	FBuffer ScratchBuffer;
 };
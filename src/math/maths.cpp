@@ -225,6 +225,18 @@ float FVector3::Length2()
     return X * X + Y * Y + Z * Z;
 }
 
+float& FVector3::operator[](uint32_t Index)
+{
+    assert(Index < 3 && "FVector3 index out of range.");
+    return Index == 0 ? X : (Index == 1 ? Y : Z);
+}
+
+float FVector3::operator[](uint32_t Index) const
+{
+    assert(Index < 3 && "FVector3 index out of range.");
+    return Index == 0 ? X : (Index == 1 ? Y : Z);
+}
+
 std::string FVector3::ToString()
 {
     std::string Result = "FVector3(";
@@ -801,6 +813,16 @@ float max(float A, float B)
 	return (A > B) ? A : B;
 }
 
+float min(float A, float B)
+{
+	return (A < B) ? A : B;
+}
+
+float length(const FVector3& Vec)
+{
+	return std::sqrt(dot(Vec, Vec));
+}
+
 FQuaternion QuatFromVectors(const FVector3& Right, const FVector3& Up, const FVector3& Front)
 {
 	FQuaternion Result;
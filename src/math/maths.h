@@ -114,6 +114,8 @@ struct FVector3
     float Length();
     float Length2();
     std::string ToString();
+    float& operator[](uint32_t Index);
+    float operator[](uint32_t Index) const;
 
     /// Data
 	union
@@ -238,6 +240,8 @@ float dot(const FVector3& L, const FVector3& R);
 FVector3 cross(FVector3 A, FVector3 B);
 float clamp(float Val, float Min, float Max);
 float max(float A, float B);
+float min(float A, float B);
+float length(const FVector3& Vec);
 
 FQuaternion QuatFromVectors(const FVector3& Right, const FVector3& Up, const FVector3& Front);
 
@@ -0,0 +1,58 @@
+#ifndef ADAPTIVE_SAMPLING_H
+#define ADAPTIVE_SAMPLING_H
+
+#ifndef __cplusplus
+#define FVector4 vec4
+#define FVector3 vec3
+#define uint32_t uint
+#else
+#include "maths.h"
+#endif
+
+/// Darker pixels are measured against this luminance, so that noise no one can see doesn't keep them sampled forever
+#define ADAPTIVE_SAMPLING_MIN_LUMINANCE 0.01f
+/// Relative error of pixels that don't have enough samples to estimate it
+#define ADAPTIVE_SAMPLING_UNKNOWN_ERROR 1e30f
+
+/// Luminance of the tone mapped color, the same value the accumulator averages
+float AdaptiveSamplingLuminance(FVector3 Color)
+{
+	return dot(Color, FVector3(0.2126f, 0.7152f, 0.0722f));
+}
+
+/// Welford update of the luminance moments of a pixel: x is the sample count, y the running mean and z the sum of squared differences from it
+FVector4 UpdateLuminanceMoments(FVector4 Moments, float Luminance)
+{
+	float Count = Moments.x + 1.f;
+	float Delta = Luminance - Moments.y;
+	float Mean = Moments.y + Delta / Count;
+	float M2 = Moments.z + Delta * (Luminance - Mean);
+	return FVector4(Count, Mean, M2, 0.f);
+}
+
+/// Standard error of the mean relative to the mean
+float EstimateRelativeError(FVector4 Moments)
+{
+	if (Moments.x < 2.f)
+	{
+		return ADAPTIVE_SAMPLING_UNKNOWN_ERROR;
+	}
+
+	float Variance = max(Moments.z, 0.f) / (Moments.x - 1.f);
+	float StandardError = sqrt(Variance / Moments.x);
+	return StandardError / max(Moments.y, ADAPTIVE_SAMPLING_MIN_LUMINANCE);
+}
+
+/// Pixel stops being sampled once its relative error falls under the threshold, or it reached the maximum sample count.
+/// Noisy pixels can look converged after a few samples, so the minimum count is always taken. Threshold of 0 disables adaptive sampling
+bool IsPixelConverged(FVector4 Moments, uint32_t MinSamples, uint32_t MaxSamples, float Threshold)
+{
+	if (Threshold <= 0.f || Moments.x < float(MinSamples))
+	{
+		return false;
+	}
+
+	return Moments.x >= float(MaxSamples) || EstimateRelativeError(Moments) < Threshold;
+}
+
+#endif // ADAPTIVE_SAMPLING_H
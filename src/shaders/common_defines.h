@@ -30,6 +30,20 @@
 #define IBL_MATERIAL_INDEX														TOTAL_MATERIALS - 2
 #define INACTIVE_MATERIAL_INDEX													TOTAL_MATERIALS - 1
 #define BASIC_CHUNK_SIZE 														256
+/// Leaves of the light BVH keep the way from the root in 32 bits, one per level
+#define LIGHT_BVH_MAX_DEPTH														32u
+
+/// Indirect arguments in the active ray count buffer: VkTraceRaysIndirectCommandKHR for the rays which hit a material,
+/// then VkDispatchIndirectCommand of the miss pass, in BASIC_CHUNK_SIZE groups,
+/// then two sets of compaction arguments, a VkDispatchIndirectCommand over the traced rays followed by their count.
+/// A bounce compacts with one set while writing the other one for the next bounce
+#define ACTIVE_RAY_COUNT_TRACE_RAYS_ARGUMENTS									0u
+#define ACTIVE_RAY_COUNT_MISS_DISPATCH_ARGUMENTS								3u
+#define ACTIVE_RAY_COUNT_COMPACTION_ARGUMENTS									6u
+#define ACTIVE_RAY_COUNT_COMPACTION_ARGUMENTS_STRIDE							4u
+#define ACTIVE_RAY_COUNT_COMPACTION_RAY_COUNT									3u
+#define ACTIVE_RAY_COUNT_ARGUMENTS_SIZE											14u
+#define ACTIVE_RAY_COUNT_COMPACTION_ARGUMENTS_OFFSET(BounceIndex)				(ACTIVE_RAY_COUNT_COMPACTION_ARGUMENTS + ((BounceIndex) % 2u) * ACTIVE_RAY_COUNT_COMPACTION_ARGUMENTS_STRIDE)
 
 #define FLOAT_EPSILON															0.0001f
 
@@ -116,6 +130,22 @@
 #define ACCUMULATE_IMAGE_INDEX 													1u
 #define ESTIMATED_IMAGE_INDEX 													2u
 #define UTILITY_BUFFER_INDEX													3u
+#define ACCUMULATE_LUMINANCE_MOMENTS_BUFFER_INDEX								4u
+#define ACCUMULATE_CONVERGENCE_MASK_BUFFER_INDEX								5u
+
+/// Task convergence descriptor set layout defines
+#define CONVERGENCE_LAYOUT_INDEX 												0u
+
+#define CONVERGENCE_LUMINANCE_MOMENTS_BUFFER_INDEX								0u
+#define CONVERGENCE_MASK_BUFFER_INDEX											1u
+#define CONVERGENCE_COUNTERS_BUFFER_INDEX										2u
+#define CONVERGENCE_UTILITY_BUFFER_INDEX										3u
+
+/// Counters of the adaptive sampling: pixels that converged, then the samples skipped for them as a 64 bit value split into low and high words
+#define CONVERGENCE_COUNTER_CONVERGED_PIXELS									0u
+#define CONVERGENCE_COUNTER_SKIPPED_SAMPLES_LOW									1u
+#define CONVERGENCE_COUNTER_SKIPPED_SAMPLES_HIGH								2u
+#define CONVERGENCE_COUNTERS_SIZE												3u
 
 /// Task passthrough descriptor set layout defines
 #define PASSTHROUGH_PER_FRAME_LAYOUT_INDEX 										0u
@@ -134,6 +164,7 @@
 #define RAYTRACE_CAMERA_POSITION_BUFFER 										6u
 #define RAYTRACE_RENDER_ITERATION_BUFFER 										7u
 #define RAYTRACE_THROUGHPUT_BUFFER 												8u
+#define RAYTRACE_CONVERGENCE_MASK_BUFFER 										9u
 
 /// Task reset active ray count descriptor set layout defines
 #define RESET_ACTIVE_RAY_COUNT_LAYOUT_INDEX 									0u
@@ -203,6 +234,9 @@
 
 #define MATERIAL_SORT_COUNT_MATERIALS_MATERIAL_INDICES_AOV_BUFFER 				0u
 #define MATERIAL_SORT_COUNT_MATERIALS_MATERIAL_COUNT_BUFFER 					1u
+#define MATERIAL_SORT_COUNT_MATERIALS_PIXEL_INDEX_BUFFER 						2u
+#define MATERIAL_SORT_COUNT_MATERIALS_UNSORTED_PIXEL_INDEX_BUFFER 				3u
+#define MATERIAL_SORT_COUNT_MATERIALS_ACTIVE_RAY_COUNT_BUFFER 					4u
 
 /// Task material sort clear total materials count set layout defines
 #define MATERIAL_SORT_CLEAR_TOTAL_MATERIALS_COUNT_LAYOUT_INDEX 					0u
@@ -223,6 +257,8 @@
 #define MATERIAL_SORT_SORT_MATERIALS_MATERIAL_OFFSETS_PER_MATERIAL_BUFFER 		1u
 #define MATERIAL_SORT_SORT_MATERIALS_UNSORTED_MATERIALS_BUFFER 					2u
 #define MATERIAL_SORT_SORT_MATERIALS_SORTED_MATERIALS_INDEX_MAP_BUFFER 			3u
+#define MATERIAL_SORT_SORT_MATERIALS_UNSORTED_PIXEL_INDEX_BUFFER 				4u
+#define MATERIAL_SORT_SORT_MATERIALS_ACTIVE_RAY_COUNT_BUFFER 					5u
 
 /// Task material sort compute prefix sums us sweep set layout defines
 #define MATERIAL_SORT_COMPUTE_PREFIX_SUMS_UP_SWEEP_LAYOUT_INDEX 				0u
@@ -126,7 +126,13 @@ struct FUtilityData
 	uint32_t AOVIndex;
 	uint32_t AccumulateFrames;
 	uint32_t AccumulateBounces;
-	uint32_t Dummy;
+	/// Bounces every path goes through before Russian roulette can terminate it
+	uint32_t RussianRouletteStartDepth;
+	float RussianRouletteMaxSurvivalProbability;
+	/// Adaptive sampling stops pixels whose relative error fell under the threshold, after at least the minimum and at most the maximum samples
+	uint32_t AdaptiveSamplingMinSamples;
+	uint32_t AdaptiveSamplingMaxSamples;
+	float AdaptiveSamplingThreshold;
 };
 
 /// Should be aligned with FAliasTableEntry
@@ -136,6 +142,30 @@ struct FDeviceAliasTableEntry
 	uint32_t Alias;
 };
 
+/// Node of the light BVH, see light_bvh.h. The first LightsCount nodes are the leaves, one per light in the order of the lights, the root follows them
+struct FLightBVHNode
+{
+	FVector3 BoundsMin;
+	/// Power of all lights below the node
+	float Energy;
+
+	FVector3 BoundsMax;
+	/// Cosine of the half angle of the cone bounding the normals of the lights
+	float CosThetaO;
+
+	/// Axis of the cone of normals
+	FVector3 Axis;
+	/// Cosine of the angle the lights emit at beyond their normals
+	float CosThetaE;
+
+	/// Internal nodes only
+	uint32_t FirstChild;
+	uint32_t SecondChild;
+	/// Leaves only, the way from the root to the leaf: bit i is set if the second child was taken at depth i
+	uint32_t Trail;
+	uint32_t Padding;
+};
+
 struct FDeviceMaterial
 {
     FVector3 BaseColor;
@@ -325,6 +355,8 @@ struct FPushConstantsCountMaterialsPerChunk
     uint32_t TotalSize;
     uint32_t GroupSize;
     uint32_t MaxGroupSize;
+    /// Picks the compaction arguments of the bounce
+    uint32_t BounceIndex;
 };
 
 struct FPushConstantsOffsets
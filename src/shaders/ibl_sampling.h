@@ -0,0 +1,80 @@
+#ifndef IBL_SAMPLING_H
+#define IBL_SAMPLING_H
+
+#ifndef __cplusplus
+#define FVector2 vec2
+#define uint32_t uint
+#else
+#include "maths.h"
+#endif
+
+/// Hierarchical importance sampling of the IBL: a row is picked by the marginal CDF of the rows, then a column by the conditional CDF of that row.
+/// IBLImportanceBuffer holds Height inclusive CDF values of the rows, followed by Width inclusive CDF values of every row, see GenerateHierarchicalImportanceMap.
+/// Whoever includes this header declares IBLImportanceBuffer
+
+struct FIBLSample
+{
+	FVector2 UV;
+	uint32_t TexelIndex;
+};
+
+/// First entry of the CDF starting at Begin which is greater than Value
+uint32_t FindCDFInterval(uint32_t Begin, uint32_t Count, float Value)
+{
+	uint32_t Low = 0;
+	uint32_t High = Count - 1;
+
+	while (Low < High)
+	{
+		uint32_t Middle = (Low + High) / 2;
+
+		if (IBLImportanceBuffer[Begin + Middle] > Value)
+		{
+			High = Middle;
+		}
+		else
+		{
+			Low = Middle + 1;
+		}
+	}
+
+	return Low;
+}
+
+float GetCDFIntervalStart(uint32_t Begin, uint32_t Index)
+{
+	return Index > 0 ? IBLImportanceBuffer[Begin + Index - 1] : 0.f;
+}
+
+float GetCDFIntervalProbability(uint32_t Begin, uint32_t Index)
+{
+	return IBLImportanceBuffer[Begin + Index] - GetCDFIntervalStart(Begin, Index);
+}
+
+/// Probability of the texel to be picked, the same one the sampling below picks it with
+float GetIBLTexelProbabilityHierarchical(uint32_t TexelIndex, uint32_t Width, uint32_t Height)
+{
+	uint32_t Row = TexelIndex / Width;
+	return GetCDFIntervalProbability(0, Row) * GetCDFIntervalProbability(Height + Row * Width, TexelIndex % Width);
+}
+
+/// Random values in [0, 1) pick the texel. Where they fell inside the picked intervals also places the sample inside the texel
+FIBLSample SampleIBLHierarchical(FVector2 RandomValues, uint32_t Width, uint32_t Height)
+{
+	uint32_t Row = FindCDFInterval(0, Height, RandomValues.y);
+	float RowStart = GetCDFIntervalStart(0, Row);
+	float RowOffset = (RandomValues.y - RowStart) / (IBLImportanceBuffer[Row] - RowStart);
+
+	uint32_t RowBegin = Height + Row * Width;
+	uint32_t Column = FindCDFInterval(RowBegin, Width, RandomValues.x);
+	float ColumnStart = GetCDFIntervalStart(RowBegin, Column);
+	float ColumnOffset = (RandomValues.x - ColumnStart) / (IBLImportanceBuffer[RowBegin + Column] - ColumnStart);
+
+	FIBLSample Sample;
+	/// Keep the sample away from the texel edges, rounding could move it to the neighbour
+	Sample.UV = FVector2((float(Column) + clamp(ColumnOffset, 0.001f, 0.999f)) / float(Width), (float(Row) + clamp(RowOffset, 0.001f, 0.999f)) / float(Height));
+	Sample.TexelIndex = Row * Width + Column;
+	return Sample;
+}
+
+#endif // IBL_SAMPLING_H
@@ -0,0 +1,196 @@
+#ifndef LIGHT_BVH_H
+#define LIGHT_BVH_H
+
+#ifndef __cplusplus
+#define FVector3 vec3
+#define uint32_t uint
+#else
+#include "maths.h"
+#include "common_structures.h"
+#endif
+
+/// Stochastic light picking with a light BVH, after "Importance Sampling of Many Lights with Adaptive Tree Splitting" by Conty Estevez and Kulla.
+/// Every internal node goes to one of its children with a probability proportional to the importance of the child for the shading point,
+/// the probability of a light is the product of the probabilities on the way to its leaf, so it's exact and the same for sampling and evaluation.
+/// LightBVHNodes holds the nodes built by BuildLightBVH, whoever includes this header declares it
+
+/// Keeps the importance finite for points that lie on a light
+#define LIGHT_BVH_MIN_DISTANCE_SQUARED 1e-8f
+/// Largest float below one
+#define LIGHT_BVH_ONE_MINUS_EPSILON 0.99999994f
+
+struct FLightBVHSample
+{
+	uint32_t LightIndex;
+	/// Zero if no light can reach the point
+	float Probability;
+};
+
+float LightBVHSafeSqrt(float Value)
+{
+	return sqrt(max(Value, 0.f));
+}
+
+/// Cosine of max(ThetaA - ThetaB, 0)
+float CosSubClamped(float SinThetaA, float CosThetaA, float SinThetaB, float CosThetaB)
+{
+	if (CosThetaA > CosThetaB)
+	{
+		return 1.f;
+	}
+
+	return CosThetaA * CosThetaB + SinThetaA * SinThetaB;
+}
+
+/// Sine of max(ThetaA - ThetaB, 0)
+float SinSubClamped(float SinThetaA, float CosThetaA, float SinThetaB, float CosThetaB)
+{
+	if (CosThetaA > CosThetaB)
+	{
+		return 0.f;
+	}
+
+	return SinThetaA * CosThetaB - CosThetaA * SinThetaB;
+}
+
+/// Upper bound of the light the point with the normal gets from the lights of the node.
+/// It's zero only if none of them can light the point: they're behind the surface, or the point is outside of their emission cones
+float GetLightBVHNodeImportance(FLightBVHNode Node, FVector3 Position, FVector3 Normal)
+{
+	if (Node.Energy <= 0.f)
+	{
+		return 0.f;
+	}
+
+	FVector3 Center = (Node.BoundsMin + Node.BoundsMax) * 0.5f;
+	FVector3 Diagonal = Node.BoundsMax - Node.BoundsMin;
+	float RadiusSquared = dot(Diagonal, Diagonal) * 0.25f;
+	FVector3 ToPoint = Position - Center;
+	float DistanceSquared = dot(ToPoint, ToPoint);
+	/// Lights might be right next to the point, so the distance is never taken below the size of the node
+	float ClampedDistanceSquared = max(DistanceSquared, max(RadiusSquared, LIGHT_BVH_MIN_DISTANCE_SQUARED));
+
+	/// Angle between the axis of the node and the direction to the point
+	float CosThetaW = clamp(dot(ToPoint, Node.Axis) / sqrt(ClampedDistanceSquared), -1.f, 1.f);
+	float SinThetaW = LightBVHSafeSqrt(1.f - CosThetaW * CosThetaW);
+
+	/// Half angle of the cone around the direction to the center that holds the whole node
+	float CosThetaB = DistanceSquared > RadiusSquared ? LightBVHSafeSqrt(1.f - RadiusSquared / DistanceSquared) : -1.f;
+	float SinThetaB = LightBVHSafeSqrt(1.f - CosThetaB * CosThetaB);
+
+	/// Smallest angle between a normal of a light and the direction to the point
+	float SinThetaO = LightBVHSafeSqrt(1.f - Node.CosThetaO * Node.CosThetaO);
+	float CosThetaX = CosSubClamped(SinThetaW, CosThetaW, SinThetaO, Node.CosThetaO);
+	float SinThetaX = SinSubClamped(SinThetaW, CosThetaW, SinThetaO, Node.CosThetaO);
+	float CosThetaP = CosSubClamped(SinThetaX, CosThetaX, SinThetaB, CosThetaB);
+
+	if (CosThetaP <= Node.CosThetaE)
+	{
+		return 0.f;
+	}
+
+	float Importance = Node.Energy * CosThetaP / ClampedDistanceSquared;
+
+	/// Smallest angle between the normal of the point and the direction to a light
+	float CosThetaI = DistanceSquared > 0.f ? clamp(-dot(ToPoint, Normal) / sqrt(DistanceSquared), -1.f, 1.f) : 1.f;
+	float SinThetaI = LightBVHSafeSqrt(1.f - CosThetaI * CosThetaI);
+	Importance *= max(CosSubClamped(SinThetaI, CosThetaI, SinThetaB, CosThetaB), 0.f);
+
+	return Importance;
+}
+
+/// Probability to go to the first child of the internal node, negative if none of the children can light the point
+float GetLightBVHFirstChildProbability(FLightBVHNode Node, FVector3 Position, FVector3 Normal)
+{
+	float FirstImportance = GetLightBVHNodeImportance(LightBVHNodes[Node.FirstChild], Position, Normal);
+	float SecondImportance = GetLightBVHNodeImportance(LightBVHNodes[Node.SecondChild], Position, Normal);
+
+	if (FirstImportance + SecondImportance <= 0.f)
+	{
+		return -1.f;
+	}
+
+	return FirstImportance / (FirstImportance + SecondImportance);
+}
+
+/// Picks a light for the point with a random value in [0, 1)
+FLightBVHSample SampleLightBVH(float RandomValue, FVector3 Position, FVector3 Normal, uint32_t LightsCount)
+{
+	FLightBVHSample Sample;
+	Sample.LightIndex = 0u;
+	Sample.Probability = 0.f;
+
+	if (LightsCount == 0u)
+	{
+		return Sample;
+	}
+
+	/// Leaves go first, so the root is a leaf only if there's a single light
+	uint32_t NodeIndex = LightsCount == 1u ? 0u : LightsCount;
+	float Probability = 1.f;
+
+	while (NodeIndex >= LightsCount)
+	{
+		FLightBVHNode Node = LightBVHNodes[NodeIndex];
+		float FirstProbability = GetLightBVHFirstChildProbability(Node, Position, Normal);
+
+		if (FirstProbability < 0.f)
+		{
+			return Sample;
+		}
+
+		/// The random value is stretched over the picked child, so a single one is enough for the whole way down
+		if (RandomValue < FirstProbability)
+		{
+			NodeIndex = Node.FirstChild;
+			Probability *= FirstProbability;
+			RandomValue = min(RandomValue / FirstProbability, LIGHT_BVH_ONE_MINUS_EPSILON);
+		}
+		else
+		{
+			NodeIndex = Node.SecondChild;
+			Probability *= 1.f - FirstProbability;
+			RandomValue = min((RandomValue - FirstProbability) / (1.f - FirstProbability), LIGHT_BVH_ONE_MINUS_EPSILON);
+		}
+	}
+
+	Sample.LightIndex = NodeIndex;
+	Sample.Probability = Probability;
+	return Sample;
+}
+
+/// Probability of SampleLightBVH to pick the light for the point. Follows the trail of the leaf and makes the same computations, so the values match exactly
+float GetLightBVHProbability(uint32_t LightIndex, FVector3 Position, FVector3 Normal, uint32_t LightsCount)
+{
+	uint32_t Trail = LightBVHNodes[LightIndex].Trail;
+	uint32_t NodeIndex = LightsCount == 1u ? 0u : LightsCount;
+	float Probability = 1.f;
+
+	while (NodeIndex >= LightsCount)
+	{
+		FLightBVHNode Node = LightBVHNodes[NodeIndex];
+		float FirstProbability = GetLightBVHFirstChildProbability(Node, Position, Normal);
+
+		if (FirstProbability < 0.f)
+		{
+			return 0.f;
+		}
+
+		if ((Trail & 1u) == 0u)
+		{
+			NodeIndex = Node.FirstChild;
+			Probability *= FirstProbability;
+		}
+		else
+		{
+			NodeIndex = Node.SecondChild;
+			Probability *= 1.f - FirstProbability;
+		}
+
+		Trail >>= 1u;
+	}
+
+	return Probability;
+}
+
+#endif // LIGHT_BVH_H
@@ -33,7 +33,11 @@ vec4 ComputeUniformPointLightInput(inout FSamplingState SamplingState, uint Poin
         float Attenuation = 1.f / LightDistance;
         Attenuation *= Attenuation;
         /// Here, the probability of sampling a particular point light is one to the number of point lights
+#ifdef LIGHT_BVH
+        ImportanceSamplingPDF = GetLightBVHProbability(LightIndex, ShadingData.IntersectionCoordinatesInWorldSpace, ShadingData.NormalInWorldSpace, PointLightsCount);
+#else
         ImportanceSamplingPDF = PointLightUniform.Power / UtilityData.TotalPointLightPower;
+#endif
         return vec4(PointLightUniform.Color * PointLightUniform.Intensity * Attenuation * NDotI * PointLightsCount, 1.f / PointLightsCount);
     }
     else
@@ -45,6 +49,17 @@ vec4 ComputeUniformPointLightInput(inout FSamplingState SamplingState, uint Poin
 vec4 ComputeImportancePointLightInput(inout FSamplingState SamplingState, uint PointLightsCount, out vec3 Direction, inout float UniformSamplingPDF)
 {
     /// Get light index by importance sampling it
+#ifdef LIGHT_BVH
+    /// The BVH picks lights by how much they can give to this very point, none of them might be able to
+    FLightBVHSample LightSample = SampleLightBVH(RandomFloat(SamplingState), ShadingData.IntersectionCoordinatesInWorldSpace, ShadingData.NormalInWorldSpace, PointLightsCount);
+
+    if (LightSample.Probability <= 0)
+    {
+        return vec4(0);
+    }
+
+    uint ImportanceLightIndex = LightSample.LightIndex;
+#else
     uint ImportanceLightIndex = uint(RandomFloat(SamplingState) * PointLightsCount);
     FDeviceAliasTableEntry ImportanceSampleTableEntry = PointLightsImportanceBuffer[ImportanceLightIndex];
 
@@ -52,6 +67,7 @@ vec4 ComputeImportancePointLightInput(inout FSamplingState SamplingState, uint P
     {
         ImportanceLightIndex = ImportanceSampleTableEntry.Alias;
     }
+#endif
 
     FPointLight PointLightImportance = PointLightsBuffer[ImportanceLightIndex];
 
@@ -82,7 +98,11 @@ vec4 ComputeImportancePointLightInput(inout FSamplingState SamplingState, uint P
         float Attenuation = 1.f / LightDistance;
         Attenuation *= Attenuation;
         /// Here, the probability of sampling a particular point light depends on it's power and total power of all lights
+#ifdef LIGHT_BVH
+        float PDF = LightSample.Probability;
+#else
         float PDF = PointLightImportance.Power / UtilityData.TotalPointLightPower;
+#endif
         UniformSamplingPDF = 1.f / PointLightsCount;
         return vec4(PointLightImportance.Color * PointLightImportance.Intensity * Attenuation * NDotI / PDF, PDF);
     }
@@ -642,6 +662,16 @@ vec4 ComputeBXDFAreaLightInput(inout FSamplingState SamplingState, vec3 LightDir
     return vec4(0);
 }
 
+/// Probability of the IBL importance sampling to pick the texel
+float GetIBLTexelProbability(uint TexelIndex, uvec2 IBLSize)
+{
+#ifdef IBL_HIERARCHICAL_SAMPLING
+    return GetIBLTexelProbabilityHierarchical(TexelIndex, IBLSize.x, IBLSize.y);
+#else
+    return IBLPDFBuffer[TexelIndex];
+#endif
+}
+
 vec4 ComputeUniformIBLInput(inout FSamplingState SamplingState, out vec3 LightDirection, inout float UniformSamplingImportancePDF, inout float UniformSamplingBXDFPDF)
 {
     /// TODO: Verify that sampling is uniform
@@ -665,7 +695,7 @@ vec4 ComputeUniformIBLInput(inout FSamplingState SamplingState, out vec3 LightDi
 
         float NDotL = dot(ShadingData.NormalInWorldSpace, LightDirection);
         float PDF = 0.5f * M_INV_PI;
-        UniformSamplingImportancePDF = IBLPDFBuffer[TexelIndex];
+        UniformSamplingImportancePDF = GetIBLTexelProbability(TexelIndex, IBLSize);
         UniformSamplingBXDFPDF = EvaluateScatteringPDF(Material, ShadingData.MaterialInteractionType, LightDirection);
         return vec4(texture(IBLTextureSamplerLinear, IBLUV).xyz * NDotL / PDF, PDF);
     }
@@ -679,6 +709,11 @@ vec4 ComputeImportanceIBLInput(inout FSamplingState SamplingState, out vec3 Ligh
 {
     vec2 UVCoordinates = Sample2DUnitQuad(SamplingState);
     const uvec2 IBLSize = textureSize(IBLTextureSamplerLinear, 0);
+#ifdef IBL_HIERARCHICAL_SAMPLING
+    FIBLSample IBLSample = SampleIBLHierarchical(UVCoordinates, IBLSize.x, IBLSize.y);
+    UVCoordinates = IBLSample.UV;
+    uint TexelIndex = IBLSample.TexelIndex;
+#else
     uint TexelIndex = uint(IBLSize.x * IBLSize.y * UVCoordinates.y) + uint(IBLSize.x * UVCoordinates.x);
 
     FDeviceAliasTableEntry AliasTableEntry = IBLImportanceBuffer[TexelIndex];
@@ -689,6 +724,7 @@ vec4 ComputeImportanceIBLInput(inout FSamplingState SamplingState, out vec3 Ligh
         /// Transform texel index into actual UV coordinates
         UVCoordinates = vec2((float(TexelIndex % IBLSize.x) + 0.5) / float(IBLSize.x), (float(TexelIndex / IBLSize.x) + 0.5) / float(IBLSize.y));
     }
+#endif
 
     /// Map UV coordinates to spherical coordinates
     vec2 SphericalCoordinates = UVCoordinates * vec2(M_2_PI, M_PI);
@@ -715,7 +751,7 @@ vec4 ComputeImportanceIBLInput(inout FSamplingState SamplingState, out vec3 Ligh
     /// And if we didn't hit any geometry, then we sample the IBL
     if (HitPayload.RenderableIndex == UINT_MAX)
     {
-        float PDF = IBLPDFBuffer[TexelIndex] * IBLSize.x * IBLSize.y;
+        float PDF = GetIBLTexelProbability(TexelIndex, IBLSize) * IBLSize.x * IBLSize.y;
         ImportanceSamplingUniformPDF = 0.5f * M_INV_PI;
         ImportanceSamplingBXDFPDF = EvaluateScatteringPDF(Material, ShadingData.MaterialInteractionType, LightDirection);
         return vec4(texture(IBLTextureSamplerLinear, UVCoordinates).xyz * NDotL / PDF, PDF);
@@ -746,7 +782,7 @@ vec4 ComputeBXDFIBLInput(inout FSamplingState SamplingState, vec3 LightDirection
 
         float PDF = BXDFSamplingPDF;
         BXDFSamplingUniformPDF = 0.5f * M_INV_PI;
-        BXDFSamplingImportancePDF = IBLPDFBuffer[TexelIndex];
+        BXDFSamplingImportancePDF = GetIBLTexelProbability(TexelIndex, IBLSize);
         /// We use abs because LightDirection is actually the direction of scattered ray and that ray can not be on the wrong side of the hemisphere
         float NDotL = abs(dot(ShadingData.NormalInWorldSpace, LightDirection));
         return vec4(texture(IBLTextureSamplerLinear, IBLUV).xyz * NDotL / PDF, PDF);
@@ -3,35 +3,50 @@
 
 #define OREN_NAYAR
 
+/// Material specialization can define DISABLE_<LAYER>_LAYER for layers with zero weight, so their code is compiled out.
+/// Transmission turns reflected rays into SPECULAR_LAYER, so the specular evaluation stays while any of the two is enabled
+
 uint SelectLayer(FDeviceMaterial Material, float MaterialSample)
 {
 	float TotalWeight = Material.BaseWeight + Material.SpecularWeight + Material.TransmissionWeight + Material.SubsurfaceWeight + Material.SheenWeight + Material.CoatWeight  + Material.EmissionWeight;
 	float Weight = 0;
 	MaterialSample *= TotalWeight;
 
+#ifndef DISABLE_DIFFUSE_LAYER
 	Weight += Material.BaseWeight;
 	if (MaterialSample <= Weight)
 		return DIFFUSE_LAYER;
+#endif
 
+#ifndef DISABLE_SPECULAR_LAYER
 	Weight += Material.SpecularWeight;
 	if (MaterialSample <= Weight)
 		return SPECULAR_LAYER;
+#endif
 
+#ifndef DISABLE_TRANSMISSION_LAYER
 	Weight += Material.TransmissionWeight;
 	if (MaterialSample <= Weight)
 		return TRANSMISSION_LAYER;
+#endif
 
+#ifndef DISABLE_SUBSURFACE_LAYER
 	Weight += Material.SubsurfaceWeight;
 	if (MaterialSample <= Weight)
 		return SUBSURFACE_LAYER;
+#endif
 
+#ifndef DISABLE_SHEEN_LAYER
 	Weight += Material.SheenWeight;
 	if (MaterialSample <= Weight)
 		return SHEEN_LAYER;
+#endif
 
+#ifndef DISABLE_COAT_LAYER
 	Weight += Material.CoatWeight;
 	if (MaterialSample <= Weight)
 		return COAT_LAYER;
+#endif
 
 	return EMISSION_LAYER;
 }
@@ -134,6 +149,7 @@ float ScatterMaterial(FDeviceMaterial Material, out uint RayType, inout FRayData
 
 	switch (RayType)
 	{
+#ifndef DISABLE_DIFFUSE_LAYER
 		case DIFFUSE_LAYER:
 		{
 			vec4 ScatterDiffuseResult = ScatterDiffuse(SamplingState);
@@ -142,6 +158,8 @@ float ScatterMaterial(FDeviceMaterial Material, out uint RayType, inout FRayData
 			ShadingData.IsScatteredRaySingular = false;
 			break;
 		}
+#endif
+#ifndef DISABLE_SPECULAR_LAYER
 		case SPECULAR_LAYER:
 		{
 			vec4 ScatterSpecularResult = ScatterSpecular(SamplingState, -ShadingData.TangentSpaceIncomingDirection, Material.SpecularRoughness);
@@ -150,6 +168,8 @@ float ScatterMaterial(FDeviceMaterial Material, out uint RayType, inout FRayData
 			ShadingData.IsScatteredRaySingular = Material.SpecularRoughness == 0 ? true : false;
 			break;
 		}
+#endif
+#ifndef DISABLE_TRANSMISSION_LAYER
 		case TRANSMISSION_LAYER:
 		{
 			float IOR1 = RayData.Eta;
@@ -284,21 +304,28 @@ float ScatterMaterial(FDeviceMaterial Material, out uint RayType, inout FRayData
 			/// If we are here, it means that ray's failed to leave the surface, thus PDF remains 0
 			break;
 		}
+#endif
+#ifndef DISABLE_SUBSURFACE_LAYER
 		case SUBSURFACE_LAYER:
 		{
 			PDF = 0.f;
 			break;
 		}
+#endif
+#ifndef DISABLE_SHEEN_LAYER
 		case SHEEN_LAYER:
 		{
 			PDF = 0.f;
 			break;
 		}
+#endif
+#ifndef DISABLE_COAT_LAYER
 		case COAT_LAYER:
 		{
 			PDF = 0.f;
 			break;
 		}
+#endif
 		case EMISSION_LAYER:
 		{
 			PDF = 0.f;
@@ -319,6 +346,7 @@ vec3 EvaluateMaterialInteraction(FDeviceMaterial Material, uint RayType, vec3 Wo
 
 	switch (RayType)
 	{
+#ifndef DISABLE_DIFFUSE_LAYER
 		case DIFFUSE_LAYER:
 		{
 #ifdef OREN_NAYAR
@@ -329,6 +357,8 @@ vec3 EvaluateMaterialInteraction(FDeviceMaterial Material, uint RayType, vec3 Wo
 #endif
 			break;
 		}
+#endif
+#if !defined(DISABLE_SPECULAR_LAYER) || !defined(DISABLE_TRANSMISSION_LAYER)
 		case SPECULAR_LAYER:
 		{
 			vec3 V = - ShadingData.WorldSpaceIncomingDirection;
@@ -366,26 +396,35 @@ vec3 EvaluateMaterialInteraction(FDeviceMaterial Material, uint RayType, vec3 Wo
 			BXDF += DiffuseBRDF * DiffuseRatio;
 			break;
 		}
+#endif
+#ifndef DISABLE_TRANSMISSION_LAYER
 		case TRANSMISSION_LAYER:
 		{
 			BXDF = Material.TransmissionColor;
 			break;
 		}
+#endif
+#ifndef DISABLE_SUBSURFACE_LAYER
 		case SUBSURFACE_LAYER:
 		{
 			BXDF.xyz = Material.SubsurfaceColor;
 			break;
 		}
+#endif
+#ifndef DISABLE_SHEEN_LAYER
 		case SHEEN_LAYER:
 		{
 			BXDF.xyz = Material.SheenColor;
 			break;
 		}
+#endif
+#ifndef DISABLE_COAT_LAYER
 		case COAT_LAYER:
 		{
 			BXDF.xyz = Material.CoatColor;
 			break;
 		}
+#endif
 		case EMISSION_LAYER:
 		{
 			BXDF.xyz = Material.EmissionColor;
@@ -403,6 +442,7 @@ float EvaluateScatteringPDF(FDeviceMaterial Material, uint RayType, vec3 WorldSp
 
 	switch (RayType)
 	{
+#ifndef DISABLE_DIFFUSE_LAYER
 		case DIFFUSE_LAYER:
 		{
 #ifdef OREN_NAYAR
@@ -411,6 +451,8 @@ float EvaluateScatteringPDF(FDeviceMaterial Material, uint RayType, vec3 WorldSp
 			return PDFLambertian(TangentSpaceLightDirection);
 #endif
 		}
+#endif
+#if !defined(DISABLE_SPECULAR_LAYER) || !defined(DISABLE_TRANSMISSION_LAYER)
 		case SPECULAR_LAYER:
 		{
 			if (Material.SpecularRoughness == 0.f)
@@ -430,23 +472,32 @@ float EvaluateScatteringPDF(FDeviceMaterial Material, uint RayType, vec3 WorldSp
 				return VNDPDF(ApproximatedNormal.xzy, Material.SpecularRoughness, Material.SpecularRoughness, -ShadingData.TangentSpaceIncomingDirection.xzy);
 			}
 		}
+#endif
+#ifndef DISABLE_TRANSMISSION_LAYER
 		case TRANSMISSION_LAYER:
 		{
 			/// If the ray is over the surface, then in case of transmissive it cannot be refracted.
 			return 0.f;
 		}
+#endif
+#ifndef DISABLE_SUBSURFACE_LAYER
 		case SUBSURFACE_LAYER:
 		{
 			return 1.f;
 		}
+#endif
+#ifndef DISABLE_SHEEN_LAYER
 		case SHEEN_LAYER:
 		{
 			return 1.f;
 		}
+#endif
+#ifndef DISABLE_COAT_LAYER
 		case COAT_LAYER:
 		{
 			return 1.f;
 		}
+#endif
 		case EMISSION_LAYER:
 		{
 			return 1.f;
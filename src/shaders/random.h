@@ -18,6 +18,7 @@
 #define SAMPLE_TYPE_GENERATE_RAYS 	0x10000001
 #define SAMPLE_TYPE_INTERACT_RAYS 	0x20000001
 #define SAMPLE_TYPE_LIGHT		 	0x30000001
+#define SAMPLE_TYPE_RUSSIAN_ROULETTE	0x40000001
 
 struct FSamplingState
 {
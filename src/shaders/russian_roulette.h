@@ -0,0 +1,31 @@
+#ifndef RUSSIAN_ROULETTE_H
+#define RUSSIAN_ROULETTE_H
+
+#ifdef __cplusplus
+#include "maths.h"
+#endif
+
+#include "random.h"
+
+/// Probability for a path to go on after a bounce. The throughput already carries the albedo of every surface the path bounced off,
+/// so its largest channel tells how much light the path can still bring. Clamped, so that even bright paths end eventually
+float RussianRouletteSurvivalProbability(FVector3 Throughput, float MaxSurvivalProbability)
+{
+	float MaxChannel = max(max(Throughput.x, Throughput.y), Throughput.z);
+	return clamp(MaxChannel, 0.f, MaxSurvivalProbability);
+}
+
+/// Weight the throughput is multiplied by after the bounce: 1 / p for the paths that survive, 0 for the terminated ones.
+/// Paths always go on for the first StartDepth bounces
+float RussianRouletteWeight(FVector3 Throughput, uint32_t BounceIndex, uint32_t StartDepth, float MaxSurvivalProbability, float RandomValue)
+{
+	if (BounceIndex < StartDepth)
+	{
+		return 1.f;
+	}
+
+	float SurvivalProbability = RussianRouletteSurvivalProbability(Throughput, MaxSurvivalProbability);
+	return (RandomValue < SurvivalProbability) ? (1.f / SurvivalProbability) : 0.f;
+}
+
+#endif // RUSSIAN_ROULETTE_H
@@ -469,6 +469,38 @@ FSynchronizationPoint FImguiTask::Submit(VkPipelineStageFlags& PipelineStageFlag
 				Render->SetAccumulateBounces(bAccumulateBounces);
 			}
 
+			static int RussianRouletteStartDepth = 2;
+			if (ImGui::SliderInt("Russian roulette start depth", &RussianRouletteStartDepth, 0, 7))
+			{
+				Render->SetRussianRouletteStartDepth(RussianRouletteStartDepth);
+			}
+
+			static float RussianRouletteMaxSurvivalProbability = 0.95f;
+			if (ImGui::SliderFloat("Russian roulette max survival probability", &RussianRouletteMaxSurvivalProbability, 0.05f, 1.f))
+			{
+				Render->SetRussianRouletteMaxSurvivalProbability(RussianRouletteMaxSurvivalProbability);
+			}
+
+			static float AdaptiveSamplingThreshold = 0.01f;
+			if (ImGui::SliderFloat("Adaptive sampling threshold", &AdaptiveSamplingThreshold, 0.f, 0.1f))
+			{
+				Render->SetAdaptiveSamplingThreshold(AdaptiveSamplingThreshold);
+			}
+
+			static int AdaptiveSamplingMinSamples = 32;
+			if (ImGui::SliderInt("Adaptive sampling min samples", &AdaptiveSamplingMinSamples, 2, 256))
+			{
+				Render->SetAdaptiveSamplingMinSamples(AdaptiveSamplingMinSamples);
+			}
+
+			static int AdaptiveSamplingMaxSamples = 4096;
+			if (ImGui::SliderInt("Adaptive sampling max samples", &AdaptiveSamplingMaxSamples, 256, 65536))
+			{
+				Render->SetAdaptiveSamplingMaxSamples(AdaptiveSamplingMaxSamples);
+			}
+
+			ImGui::Text("Converged pixels: %u, samples skipped: %.1f%%%s", Render->ConvergedPixelCount, 100.f * Render->GetSkippedSamplesFraction(), Render->IsConverged() ? " (converged)" : "");
+
 			ImGui::End();
 		}
 	}
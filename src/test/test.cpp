@@ -13,6 +13,9 @@
 
 #include "scene_loader.h"
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <fstream>
 #include <random>
@@ -56,6 +59,17 @@ bool TestScene(const std::string& SceneName)
     return Result;
 }
 
+/// Same definitions the render passes to the shaders with the default recursion depths
+FCompileDefinitions GetDefaultRecursionDefinitions()
+{
+	FCompileDefinitions CompileDefinitions;
+	CompileDefinitions.Push("LAST_BOUNCE", "6");
+	CompileDefinitions.Push("LAST_DIFFUSE_BOUNCE", "3");
+	CompileDefinitions.Push("LAST_REFLECTION_BOUNCE", "3");
+	CompileDefinitions.Push("LAST_REFRACTION_BOUNCE", "6");
+	return CompileDefinitions;
+}
+
 TEST_CASE( SCENE_AREA_LIGHTS, "[Scenes]")
 {
     CHECK(TestScene(Catch::getResultCapture().getCurrentTestName()));
@@ -170,6 +184,321 @@ TEST_CASE( "Basic scene loading", "[Basic]" )
 	Render = nullptr;
 }
 
+TEST_CASE( "Upload throughput", "[.Benchmark]")
+{
+	INIT_VK_CONTEXT({});
+	auto Render = std::make_shared<FRender>(1920, 1080);
+
+	/// Lots of small writes, like per-entity transform or material updates
+	const VkDeviceSize UploadSize = 256;
+	const uint32_t UploadsCount = 20000;
+	std::vector<char> Data(UploadSize * UploadsCount, 1);
+	auto Buffer = RESOURCE_ALLOCATOR()->CreateBuffer(Data.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Upload_Benchmark_Buffer");
+
+	auto MeasureUploads = [&](const std::string& Name, const std::function<void(VkDeviceSize Offset)>& Upload)
+	{
+		auto Start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < UploadsCount; ++i)
+		{
+			Upload(i * UploadSize);
+		}
+
+		RESOURCE_ALLOCATOR()->WaitForUploads();
+		std::chrono::duration<double> Duration = std::chrono::high_resolution_clock::now() - Start;
+		std::cout << Name << ": " << double(Data.size()) / (1024. * 1024.) / Duration.count() << " MB/s" << std::endl;
+	};
+
+	MeasureUploads("Upload ring", [&](VkDeviceSize Offset)
+	{
+		RESOURCE_ALLOCATOR()->LoadDataToBuffer(Buffer, {UploadSize}, {Offset}, {Data.data() + Offset});
+	});
+
+	MeasureUploads("Blocking staging buffer copies", [&](VkDeviceSize Offset)
+	{
+		RESOURCE_ALLOCATOR()->LoadDataToBufferImmediate(Buffer, {UploadSize}, {Offset}, {Data.data() + Offset});
+	});
+
+	RESOURCE_ALLOCATOR()->DestroyBuffer(Buffer);
+	Render = nullptr;
+}
+
+TEST_CASE( "Readback throughput", "[.Benchmark]")
+{
+	INIT_VK_CONTEXT({});
+	auto Render = std::make_shared<FRender>(1920, 1080);
+
+	/// Several times bigger than the readback buffer, so it's read in chunks
+	const VkDeviceSize ReadbackSize = uint64_t(512) * 1024 * 1024;
+	std::vector<char> Data(ReadbackSize);
+	auto Buffer = RESOURCE_ALLOCATOR()->CreateBuffer(ReadbackSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Readback_Benchmark_Buffer");
+
+	auto MeasureReadback = [&](const std::string& Name, const std::function<void()>& Readback)
+	{
+		auto Start = std::chrono::high_resolution_clock::now();
+		Readback();
+		std::chrono::duration<double> Duration = std::chrono::high_resolution_clock::now() - Start;
+		std::cout << Name << ": " << double(ReadbackSize) / (1024. * 1024.) / Duration.count() << " MB/s" << std::endl;
+	};
+
+	MeasureReadback("Double buffered readback", [&]()
+	{
+		RESOURCE_ALLOCATOR()->LoadDataFromBuffer(Buffer, ReadbackSize, 0, Data.data());
+	});
+
+	MeasureReadback("Blocking staging buffer copies", [&]()
+	{
+		const VkDeviceSize ChunkSize = RESOURCE_ALLOCATOR()->StagingBufferSize;
+
+		for (VkDeviceSize Offset = 0; Offset < ReadbackSize; Offset += ChunkSize)
+		{
+			VkDeviceSize Size = std::min(ChunkSize, ReadbackSize - Offset);
+			RESOURCE_ALLOCATOR()->CopyBuffer(Buffer, RESOURCE_ALLOCATOR()->StagingBuffer, {Size}, {Offset}, {0});
+			RESOURCE_ALLOCATOR()->LoadDataFromStagingBuffer(Size, Data.data() + Offset, 0);
+		}
+	});
+
+	RESOURCE_ALLOCATOR()->DestroyBuffer(Buffer);
+	Render = nullptr;
+}
+
+TEST_CASE( "Pipeline creation", "[.Benchmark]")
+{
+	INIT_VK_CONTEXT({});
+	auto Render = std::make_shared<FRender>(1920, 1080);
+	Render->Init();
+	auto Camera = Render->CreateCamera();
+	Render->SetActiveCamera(Camera);
+	auto SceneLoader = std::make_shared<FSceneLoader>(Render);
+	SceneLoader->LoadScene(SCENE_CORNELL_BOX);
+	Render->Update();
+	Render->Render();
+	Render->WaitIdle();
+
+	FCompileDefinitions CompileDefinitions = GetDefaultRecursionDefinitions();
+
+	std::vector<std::shared_ptr<FExecutableTask>> Tasks = {Render->RayTraceTask, Render->ClearTotalMaterialsCountTask, Render->CountMaterialsPerChunkTask,
+		Render->ComputePrefixSumsUpSweepTask, Render->ComputePrefixSumsZeroOutTask, Render->ComputePrefixSumsDownSweepTask, Render->ComputeOffsetsPerMaterialTask,
+		Render->SortMaterialsTask, Render->MasterShader, Render->MissTask, Render->AccumulateTask, Render->AdvanceRenderCountTask};
+
+	/// Shaders are compiled once, so that only the pipeline creation is measured
+	std::vector<std::vector<std::vector<uint32_t>>> TasksSPIRVData;
+
+	for (auto& Task : Tasks)
+	{
+		TasksSPIRVData.push_back(SHADER_COMPILATION_POOL()->CompileBatch(Task->GetShaderCompilationJobs(&CompileDefinitions)));
+	}
+
+	auto MeasurePipelineCreation = [&](const std::string& Name)
+	{
+		auto Start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < Tasks.size(); ++i)
+		{
+			Tasks[i]->DestroyPipeline();
+			Tasks[i]->CreatePipeline(TasksSPIRVData[i]);
+		}
+
+		std::chrono::duration<double> Duration = std::chrono::high_resolution_clock::now() - Start;
+		std::cout << Name << ": " << Duration.count() * 1000. << " ms" << std::endl;
+	};
+
+	/// Drivers might have their own disk caches, so the cold cache is not necessarily a cold start
+	VK_CONTEXT()->DestroyPipelineCache();
+	VK_CONTEXT()->CreatePipelineCache(false);
+	MeasurePipelineCreation("Cold pipeline cache");
+
+	VK_CONTEXT()->SavePipelineCache();
+	VK_CONTEXT()->DestroyPipelineCache();
+	VK_CONTEXT()->CreatePipelineCache(true);
+	MeasurePipelineCreation("Pipeline cache loaded from the file");
+
+	Render = nullptr;
+}
+
+TEST_CASE( "Material pipeline modes", "[.Benchmark]")
+{
+	auto MeasureMode = [](const std::string& Name, EMaterialPipelineMode MaterialPipelineMode)
+	{
+		INIT_VK_CONTEXT({});
+		auto Render = std::make_shared<FRender>(1920, 1080);
+		Render->MaterialPipelineMode = MaterialPipelineMode;
+		Render->Init();
+		auto Camera = Render->CreateCamera();
+		Render->SetActiveCamera(Camera);
+		auto SceneLoader = std::make_shared<FSceneLoader>(Render);
+		SceneLoader->LoadScene(SCENE_CORNELL_BOX);
+		LoadCamera(Camera, Render, std::string("../data/cameras/") + SCENE_CORNELL_BOX);
+		Render->Update();
+		Render->Render();
+		Render->WaitIdle();
+
+		FCompileDefinitions CompileDefinitions = GetDefaultRecursionDefinitions();
+
+		/// No shader cache, so that the shaders are actually compiled
+		FShaderCompilationPool ShaderCompilationPool(std::max(1u, std::thread::hardware_concurrency()), nullptr);
+		auto Start = std::chrono::high_resolution_clock::now();
+		auto SPIRVData = ShaderCompilationPool.CompileBatch(Render->MasterShader->GetShaderCompilationJobs(&CompileDefinitions));
+		std::chrono::duration<double> CompilationDuration = std::chrono::high_resolution_clock::now() - Start;
+
+		Start = std::chrono::high_resolution_clock::now();
+		Render->MasterShader->DestroyPipeline();
+		Render->MasterShader->CreatePipeline(SPIRVData);
+		std::chrono::duration<double> PipelineCreationDuration = std::chrono::high_resolution_clock::now() - Start;
+
+		Render->MasterShader->SetDirty(OUTDATED_COMMAND_BUFFER);
+		const uint32_t FramesCount = 100;
+		Start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < FramesCount; ++i)
+		{
+			Render->Update();
+			Render->Render();
+		}
+
+		Render->WaitIdle();
+		std::chrono::duration<double> RenderDuration = std::chrono::high_resolution_clock::now() - Start;
+
+		std::cout << Name << ":" << std::endl;
+		std::cout << "    Pipelines: " << Render->MasterShader->GetPipelineCount() << std::endl;
+		std::cout << "    Shader compilation: " << CompilationDuration.count() * 1000. << " ms" << std::endl;
+		std::cout << "    Pipeline creation: " << PipelineCreationDuration.count() * 1000. << " ms" << std::endl;
+		std::cout << "    Commands per bounce: " << Render->MasterShader->CommandsPerBounce << std::endl;
+		std::cout << "    Frame: " << RenderDuration.count() * 1000. / FramesCount << " ms" << std::endl;
+
+		Render = nullptr;
+	};
+
+	MeasureMode("Pipeline per material", EMaterialPipelineMode::PerMaterial);
+	MeasureMode("Uber shader", EMaterialPipelineMode::Uber);
+}
+
+/// Every SPIR-V instruction starts with a word holding its length in words in the high 16 bits, right after the 5 words of the header
+uint32_t CountSpirVInstructions(const std::vector<uint32_t>& SpirV)
+{
+	uint32_t InstructionsCount = 0;
+
+	for (size_t i = 5; i < SpirV.size(); i += std::max(1u, SpirV[i] >> 16))
+	{
+		++InstructionsCount;
+	}
+
+	return InstructionsCount;
+}
+
+TEST_CASE( "Material specialization", "[.Benchmark]")
+{
+	const std::vector<std::string> Scenes = {SCENE_AREA_LIGHTS, SCENE_AREA_LIGHTS_2, SCENE_BIG_PLANES, SCENE_COORDINATE_SYSTEM_REMINDER, SCENE_CORNELL_BOX,
+		SCENE_CORNELL_BOX_2, SCENE_CORNELL_BOX_ANIMATED, SCENE_DIFFUSE_MATERIAL, SCENE_DIRECTIONAL_LIGHT, SCENE_FLOATING_SPHERES, SCENE_GLASS_PLANES,
+		SCENE_POINT_LIGHT, SCENE_ROUGH_GLASS, SCENE_SPECULAR_ROUGHNESS, SCENE_SPOT_LIGHT, SCENE_STANFORD_DRAGON, SCENE_THREE_SPHERES, SCENE_VIKINGS_ROOM,
+		SCENE_WHITE_FURNACE};
+
+	for (auto& Scene : Scenes)
+	{
+		INIT_VK_CONTEXT({});
+		auto Render = std::make_shared<FRender>(1920, 1080);
+		Render->Init();
+		auto Camera = Render->CreateCamera();
+		Render->SetActiveCamera(Camera);
+		auto SceneLoader = std::make_shared<FSceneLoader>(Render);
+		SceneLoader->LoadScene(Scene);
+		Render->Update();
+		Render->WaitIdle();
+
+		FCompileDefinitions CompileDefinitions = GetDefaultRecursionDefinitions();
+
+		std::cout << Scene << ":" << std::endl;
+
+		for (bool bSpecializeMaterials : {false, true})
+		{
+			Render->MasterShader->bSpecializeMaterials = bSpecializeMaterials;
+
+			/// No shader cache, so that the shaders are actually compiled
+			FShaderCompilationPool ShaderCompilationPool(std::max(1u, std::thread::hardware_concurrency()), nullptr);
+			auto Start = std::chrono::high_resolution_clock::now();
+			auto SPIRVData = ShaderCompilationPool.CompileBatch(Render->MasterShader->GetShaderCompilationJobs(&CompileDefinitions));
+			std::chrono::duration<double> CompilationDuration = std::chrono::high_resolution_clock::now() - Start;
+
+			/// The first two are the closest hit and miss shaders, the rest are ray generation shaders of the materials
+			uint32_t InstructionsCount = 0;
+
+			for (size_t i = 2; i < SPIRVData.size(); ++i)
+			{
+				InstructionsCount += CountSpirVInstructions(SPIRVData[i]);
+			}
+
+			std::cout << "    " << (bSpecializeMaterials ? "Specialized" : "Generic") << ": " << SPIRVData.size() - 2 << " materials, "
+				<< InstructionsCount << " instructions, " << CompilationDuration.count() * 1000. << " ms" << std::endl;
+		}
+
+		Render = nullptr;
+	}
+}
+
+TEST_CASE( "Frame graph submits per frame", "[.Benchmark]")
+{
+	INIT_VK_CONTEXT({});
+	auto Render = std::make_shared<FRender>(1920, 1080);
+	Render->Init();
+	auto Camera = Render->CreateCamera();
+	Render->SetActiveCamera(Camera);
+	auto SceneLoader = std::make_shared<FSceneLoader>(Render);
+	SceneLoader->LoadScene(SCENE_CORNELL_BOX);
+	LoadCamera(Camera, Render, std::string("../data/cameras/") + SCENE_CORNELL_BOX);
+	Render->Update();
+	Render->Render();
+	Render->WaitIdle();
+
+	for (bool bUseFrameGraph : {false, true})
+	{
+		Render->bUseFrameGraph = bUseFrameGraph;
+		const uint32_t FramesCount = 100;
+		auto Start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < FramesCount; ++i)
+		{
+			Render->Update();
+			Render->Render();
+		}
+
+		Render->WaitIdle();
+		std::chrono::duration<double> RenderDuration = std::chrono::high_resolution_clock::now() - Start;
+
+		std::cout << (bUseFrameGraph ? "Frame graph" : "Submit per pass") << ":" << std::endl;
+		std::cout << "    Submits per frame: " << Render->SubmitsPerFrame << std::endl;
+		std::cout << "    Frame: " << RenderDuration.count() * 1000. / FramesCount << " ms" << std::endl;
+	}
+
+	Render = nullptr;
+}
+
+TEST_CASE( "Scene memory usage", "[.Benchmark]")
+{
+	INIT_VK_CONTEXT({});
+
+	for (const std::string& SceneName : {SCENE_AREA_LIGHTS, SCENE_AREA_LIGHTS_2, SCENE_BIG_PLANES, SCENE_CORNELL_BOX, SCENE_CORNELL_BOX_2,
+		SCENE_DIFFUSE_MATERIAL, SCENE_DIRECTIONAL_LIGHT, SCENE_GLASS_PLANES, SCENE_POINT_LIGHT, SCENE_ROUGH_GLASS, SCENE_SPECULAR_ROUGHNESS,
+		SCENE_SPOT_LIGHT, SCENE_STANFORD_DRAGON, SCENE_THREE_SPHERES, SCENE_VIKINGS_ROOM, SCENE_WHITE_FURNACE})
+	{
+		auto Render = std::make_shared<FRender>(1920, 1080);
+		Render->Init();
+		auto Camera = Render->CreateCamera();
+		Render->SetActiveCamera(Camera);
+		auto SceneLoader = std::make_shared<FSceneLoader>(Render);
+		SceneLoader->LoadScene(SceneName);
+		LoadCamera(Camera, Render, "../data/cameras/" + SceneName);
+		Render->Update();
+		Render->Render();
+		Render->WaitIdle();
+
+		std::cout << "Memory usage of scene " << SceneName << ":" << std::endl;
+		RESOURCE_ALLOCATOR()->PrintMemoryStatistics();
+
+		SceneLoader = nullptr;
+		Render = nullptr;
+	}
+}
+
 TEST_CASE( "Test random Mersenne twister", "[Utility]")
 {
 	/// Generate some random values with default mersenne twister
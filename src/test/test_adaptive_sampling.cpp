@@ -0,0 +1,253 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include "maths.h"
+#include "adaptive_sampling.h"
+
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct FReferenceMoments
+	{
+		double Mean = 0.;
+		double Variance = 0.;
+	};
+
+	/// Two pass mean and sample variance in double precision
+	FReferenceMoments CalculateReferenceMoments(const std::vector<float>& Samples)
+	{
+		FReferenceMoments Result;
+
+		for (auto Sample : Samples)
+		{
+			Result.Mean += Sample;
+		}
+
+		Result.Mean /= double(Samples.size());
+
+		for (auto Sample : Samples)
+		{
+			Result.Variance += (Sample - Result.Mean) * (Sample - Result.Mean);
+		}
+
+		Result.Variance /= double(Samples.size() - 1);
+
+		return Result;
+	}
+
+	FVector4 AccumulateMoments(const std::vector<float>& Samples)
+	{
+		FVector4 Moments{0.f, 0.f, 0.f, 0.f};
+
+		for (auto Sample : Samples)
+		{
+			Moments = UpdateLuminanceMoments(Moments, Sample);
+		}
+
+		return Moments;
+	}
+
+	/// Number of samples after which a pixel with the given noise stops
+	uint32_t SamplesUntilConverged(std::mt19937& Generator, float Mean, float StandardDeviation, uint32_t MinSamples, uint32_t MaxSamples, float Threshold)
+	{
+		std::normal_distribution<float> Distribution(Mean, StandardDeviation);
+		FVector4 Moments{0.f, 0.f, 0.f, 0.f};
+
+		while (!IsPixelConverged(Moments, MinSamples, MaxSamples, Threshold))
+		{
+			Moments = UpdateLuminanceMoments(Moments, Distribution(Generator));
+		}
+
+		return uint32_t(Moments.x);
+	}
+}
+
+TEST_CASE( "Luminance moments", "[AdaptiveSampling]")
+{
+	std::mt19937 Generator(7);
+
+	/// Plain noise, noise far from zero and fireflies
+	std::vector<std::function<float()>> Distributions = {
+		[&]() { return std::normal_distribution<float>(0.5f, 0.2f)(Generator); },
+		[&]() { return std::normal_distribution<float>(100.f, 1.f)(Generator); },
+		[&]() { return std::lognormal_distribution<float>(-2.f, 1.5f)(Generator); },
+	};
+
+	for (auto& Distribution : Distributions)
+	{
+		std::vector<float> Samples;
+
+		for (int i = 0; i < 10000; ++i)
+		{
+			Samples.push_back(Distribution());
+		}
+
+		auto Reference = CalculateReferenceMoments(Samples);
+		auto Moments = AccumulateMoments(Samples);
+
+		CHECK(Moments.x == 10000.f);
+		CHECK(std::abs(Moments.y - Reference.Mean) <= 1e-4 * std::abs(Reference.Mean));
+		CHECK(std::abs(Moments.z / (Moments.x - 1.f) - Reference.Variance) <= 1e-3 * Reference.Variance);
+	}
+
+	/// Constant samples have no variance at all
+	auto Moments = AccumulateMoments(std::vector<float>(100, 0.25f));
+	CHECK(Moments.y == 0.25f);
+	CHECK(Moments.z == 0.f);
+	CHECK(EstimateRelativeError(Moments) == 0.f);
+
+	/// A single sample says nothing about the error
+	CHECK(EstimateRelativeError(AccumulateMoments({0.5f})) == ADAPTIVE_SAMPLING_UNKNOWN_ERROR);
+}
+
+TEST_CASE( "Relative error estimate", "[AdaptiveSampling]")
+{
+	std::mt19937 Generator(11);
+	const float Mean = 0.3f;
+	const float StandardDeviation = 0.15f;
+	const uint32_t Trials = 4000;
+	const uint32_t SamplesPerTrial = 64;
+
+	uint32_t MeanWithinTwoErrors = 0;
+	double AverageRelativeError = 0.;
+
+	for (uint32_t i = 0; i < Trials; ++i)
+	{
+		std::normal_distribution<float> Distribution(Mean, StandardDeviation);
+		FVector4 Moments{0.f, 0.f, 0.f, 0.f};
+
+		for (uint32_t j = 0; j < SamplesPerTrial; ++j)
+		{
+			Moments = UpdateLuminanceMoments(Moments, Distribution(Generator));
+		}
+
+		float RelativeError = EstimateRelativeError(Moments);
+		AverageRelativeError += RelativeError / Trials;
+		MeanWithinTwoErrors += std::abs(Moments.y - Mean) <= 2.f * RelativeError * Moments.y ? 1 : 0;
+	}
+
+	/// The estimate is close to the true relative error of the mean, and about 95% of the means are within two of them
+	double ExpectedRelativeError = StandardDeviation / (Mean * std::sqrt(double(SamplesPerTrial)));
+	CHECK(std::abs(AverageRelativeError - ExpectedRelativeError) < 0.05 * ExpectedRelativeError);
+	CHECK(MeanWithinTwoErrors > Trials * 0.92);
+	CHECK(MeanWithinTwoErrors < Trials * 0.98);
+
+	/// Dark pixels are measured against the floor luminance
+	auto DarkMoments = AccumulateMoments({0.001f, 0.003f, 0.002f, 0.f});
+	auto Reference = CalculateReferenceMoments({0.001f, 0.003f, 0.002f, 0.f});
+	CHECK(std::abs(EstimateRelativeError(DarkMoments) - std::sqrt(Reference.Variance / 4.) / ADAPTIVE_SAMPLING_MIN_LUMINANCE) < 1e-4);
+}
+
+TEST_CASE( "Adaptive sampling stopping rule", "[AdaptiveSampling]")
+{
+	std::mt19937 Generator(5);
+	const uint32_t MinSamples = 16;
+	const uint32_t MaxSamples = 4096;
+
+	/// Threshold of 0 keeps sampling forever
+	auto ConstantMoments = AccumulateMoments(std::vector<float>(MaxSamples, 0.5f));
+	CHECK_FALSE(IsPixelConverged(ConstantMoments, MinSamples, MaxSamples, 0.f));
+
+	/// No noise stops right at the minimum, never before it
+	CHECK(SamplesUntilConverged(Generator, 0.5f, 0.f, MinSamples, MaxSamples, 0.01f) == MinSamples);
+	CHECK_FALSE(IsPixelConverged(AccumulateMoments(std::vector<float>(MinSamples - 1, 0.5f)), MinSamples, MaxSamples, 0.01f));
+
+	/// Noise that never gets under the threshold stops at the maximum
+	CHECK(SamplesUntilConverged(Generator, 0.5f, 10.f, MinSamples, MaxSamples, 0.01f) == MaxSamples);
+
+	/// Relative noise of 0.5 needs (0.5 / 0.05)^2 = 100 samples to get under 5% on average
+	double AverageSamples = 0.;
+
+	for (int i = 0; i < 500; ++i)
+	{
+		AverageSamples += SamplesUntilConverged(Generator, 0.4f, 0.2f, MinSamples, MaxSamples, 0.05f) / 500.;
+	}
+
+	CHECK(AverageSamples > 80.);
+	CHECK(AverageSamples < 120.);
+
+	/// Noisier pixels take more samples
+	CHECK(SamplesUntilConverged(Generator, 0.4f, 0.4f, MinSamples, MaxSamples, 0.05f) > SamplesUntilConverged(Generator, 0.4f, 0.04f, MinSamples, MaxSamples, 0.05f));
+
+	/// Noise of almost black pixels is invisible, so they stop early
+	CHECK(SamplesUntilConverged(Generator, 0.001f, 0.001f, MinSamples, MaxSamples, 0.05f) == MinSamples);
+}
+
+TEST_CASE( "Adaptive sampling of a noisy image", "[AdaptiveSampling]")
+{
+	/// Pixels with their own brightness and noise, sampled frame by frame the way the accumulate and the convergence passes do it
+	std::mt19937 Generator(3);
+	std::uniform_real_distribution<float> MeanDistribution(0.05f, 1.f);
+	std::uniform_real_distribution<float> RelativeNoiseDistribution(0.02f, 1.f);
+
+	const uint32_t PixelCount = 64 * 64;
+	const uint32_t MinSamples = 32;
+	const uint32_t MaxSamples = 4096;
+	const float Threshold = 0.02f;
+
+	std::vector<float> Means(PixelCount);
+	std::vector<float> StandardDeviations(PixelCount);
+
+	for (uint32_t i = 0; i < PixelCount; ++i)
+	{
+		Means[i] = MeanDistribution(Generator);
+		StandardDeviations[i] = Means[i] * RelativeNoiseDistribution(Generator);
+	}
+
+	std::vector<FVector4> Moments(PixelCount, FVector4{0.f, 0.f, 0.f, 0.f});
+	std::vector<uint32_t> ConvergenceMask(PixelCount, 0);
+	uint32_t ConvergedPixels = 0;
+	uint64_t SkippedSamples = 0;
+	uint32_t Frames = 0;
+
+	/// Global stop: every pixel converged
+	while (ConvergedPixels < PixelCount)
+	{
+		for (uint32_t i = 0; i < PixelCount; ++i)
+		{
+			if (ConvergenceMask[i] == 0)
+			{
+				Moments[i] = UpdateLuminanceMoments(Moments[i], std::normal_distribution<float>(Means[i], StandardDeviations[i])(Generator));
+			}
+		}
+
+		for (uint32_t i = 0; i < PixelCount; ++i)
+		{
+			if (ConvergenceMask[i] != 0)
+			{
+				SkippedSamples++;
+			}
+			else if (IsPixelConverged(Moments[i], MinSamples, MaxSamples, Threshold))
+			{
+				ConvergenceMask[i] = 1;
+				ConvergedPixels++;
+			}
+		}
+
+		Frames++;
+		REQUIRE(Frames <= MaxSamples);
+	}
+
+	/// Pixels which stopped on their error are about as accurate as asked for
+	uint32_t StoppedOnError = 0;
+	uint32_t Accurate = 0;
+
+	for (uint32_t i = 0; i < PixelCount; ++i)
+	{
+		if (Moments[i].x < MaxSamples)
+		{
+			StoppedOnError++;
+			Accurate += std::abs(Moments[i].y - Means[i]) <= 3.f * Threshold * Means[i] ? 1 : 0;
+		}
+	}
+
+	CHECK(StoppedOnError > PixelCount * 0.9);
+	CHECK(Accurate > StoppedOnError * 0.95);
+
+	/// The noisiest pixel decides how long it takes, every other one stops before
+	double SkippedFraction = double(SkippedSamples) / (double(Frames) * PixelCount);
+	INFO("Adaptive sampling converged after " << Frames << " frames, " << 100. * SkippedFraction << "% of the samples skipped");
+	CHECK(SkippedFraction > 0.5);
+}
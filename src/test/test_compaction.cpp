@@ -0,0 +1,172 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "common_defines.h"
+#include "ray_compaction.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+	/// Material of every pixel: a live ray hit one of the materials, a dead one missed or was terminated
+	std::vector<uint32_t> CreateMaterials(const std::vector<bool>& AliveMask, std::mt19937& Generator)
+	{
+		std::uniform_int_distribution<uint32_t> LiveMaterials(0, IBL_MATERIAL_INDEX - 1);
+		std::uniform_int_distribution<uint32_t> DeadMaterials(IBL_MATERIAL_INDEX, INACTIVE_MATERIAL_INDEX);
+		std::vector<uint32_t> Materials(AliveMask.size());
+
+		for (size_t i = 0; i < AliveMask.size(); ++i)
+		{
+			Materials[i] = AliveMask[i] ? LiveMaterials(Generator) : DeadMaterials(Generator);
+		}
+
+		return Materials;
+	}
+
+	std::vector<bool> CreateAliveMask(uint32_t Size, float AliveProbability, std::mt19937& Generator)
+	{
+		std::bernoulli_distribution Distribution(AliveProbability);
+		std::vector<bool> AliveMask(Size);
+
+		for (uint32_t i = 0; i < Size; ++i)
+		{
+			AliveMask[i] = Distribution(Generator);
+		}
+
+		return AliveMask;
+	}
+}
+
+TEST_CASE( "Compaction against alive masks", "[Compaction]")
+{
+	std::mt19937 Generator(19);
+
+	for (uint32_t Size : {0u, 1u, BASIC_CHUNK_SIZE - 1u, uint32_t(BASIC_CHUNK_SIZE), BASIC_CHUNK_SIZE * 7u + 13u, 640u * 480u})
+	{
+		for (float AliveProbability : {0.f, 0.05f, 0.5f, 0.95f, 1.f})
+		{
+			auto AliveMask = CreateAliveMask(Size, AliveProbability, Generator);
+			auto Materials = CreateMaterials(AliveMask, Generator);
+
+			/// Rays come in a shuffled order, like after a sort by material in the previous bounce
+			std::vector<uint32_t> PixelIndices(Size);
+			std::iota(PixelIndices.begin(), PixelIndices.end(), 0);
+			std::shuffle(PixelIndices.begin(), PixelIndices.end(), Generator);
+
+			auto CompactedRays = CompactRays(PixelIndices, Size, Materials, TOTAL_MATERIALS, BASIC_CHUNK_SIZE);
+			REQUIRE(CompactedRays.PixelIndices.size() == Size);
+			REQUIRE(CompactedRays.MaterialOffsets.size() == TOTAL_MATERIALS);
+
+			/// Live rays form the dense prefix, in the order they came in
+			std::vector<uint32_t> AlivePixels;
+			std::copy_if(PixelIndices.begin(), PixelIndices.end(), std::back_inserter(AlivePixels), [&](uint32_t PixelIndex){return AliveMask[PixelIndex];});
+			uint32_t ActiveRayCount = CompactedRays.MaterialOffsets[IBL_MATERIAL_INDEX];
+			REQUIRE(ActiveRayCount == AlivePixels.size());
+
+			std::vector<uint32_t> CompactedAlivePixels(CompactedRays.PixelIndices.begin(), CompactedRays.PixelIndices.begin() + ActiveRayCount);
+			std::sort(AlivePixels.begin(), AlivePixels.end());
+			std::sort(CompactedAlivePixels.begin(), CompactedAlivePixels.end());
+			CHECK(CompactedAlivePixels == AlivePixels);
+
+			/// Same as a stable sort by material, every pixel is kept once
+			auto SortedPixels = PixelIndices;
+			std::stable_sort(SortedPixels.begin(), SortedPixels.end(), [&](uint32_t A, uint32_t B){return Materials[A] < Materials[B];});
+			CHECK(CompactedRays.PixelIndices == SortedPixels);
+
+			for (uint32_t Material = 0; Material < TOTAL_MATERIALS; ++Material)
+			{
+				uint32_t End = (Material + 1 < TOTAL_MATERIALS) ? CompactedRays.MaterialOffsets[Material + 1] : Size;
+				REQUIRE(CompactedRays.MaterialOffsets[Material] <= End);
+
+				for (uint32_t i = CompactedRays.MaterialOffsets[Material]; i < End; ++i)
+				{
+					REQUIRE(Materials[CompactedRays.PixelIndices[i]] == Material);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE( "Compaction between bounces", "[Compaction]")
+{
+	const uint32_t TotalSize = 320 * 240;
+	std::mt19937 Generator(7);
+	std::bernoulli_distribution Survives(0.6);
+
+	/// The first bounce visits every pixel, the next ones only the rays which hit a material in the previous bounce
+	std::vector<uint32_t> PixelIndices(TotalSize);
+	std::iota(PixelIndices.begin(), PixelIndices.end(), 0);
+	std::vector<bool> AliveMask(TotalSize, true);
+	std::vector<FBounceRayCounts> RaySurvivalHistogram;
+	uint32_t RayCount = TotalSize;
+
+	for (int Bounce = 0; Bounce < 6; ++Bounce)
+	{
+		for (uint32_t i = 0; i < RayCount; ++i)
+		{
+			AliveMask[PixelIndices[i]] = Survives(Generator);
+		}
+
+		auto Materials = CreateMaterials(AliveMask, Generator);
+		auto CompactedRays = CompactRays(PixelIndices, RayCount, Materials, TOTAL_MATERIALS, BASIC_CHUNK_SIZE);
+		uint32_t ActiveRayCount = CompactedRays.MaterialOffsets[IBL_MATERIAL_INDEX];
+		uint32_t MissedRayCount = CompactedRays.MaterialOffsets[INACTIVE_MATERIAL_INDEX] - ActiveRayCount;
+
+		/// Rays that died in earlier bounces aren't visited again, so none of them comes back
+		uint32_t AliveCount = 0;
+
+		for (uint32_t i = 0; i < RayCount; ++i)
+		{
+			AliveCount += AliveMask[PixelIndices[i]] ? 1 : 0;
+		}
+
+		CHECK(ActiveRayCount == AliveCount);
+		CHECK(ActiveRayCount <= RayCount);
+
+		std::copy(CompactedRays.PixelIndices.begin(), CompactedRays.PixelIndices.end(), PixelIndices.begin());
+		RaySurvivalHistogram.push_back({ActiveRayCount, MissedRayCount});
+		RayCount = ActiveRayCount;
+
+		for (uint32_t i = 0; i < RayCount; ++i)
+		{
+			REQUIRE(AliveMask[PixelIndices[i]]);
+		}
+	}
+
+	/// The whole map is still a permutation of the pixels
+	auto SortedPixels = PixelIndices;
+	std::sort(SortedPixels.begin(), SortedPixels.end());
+	CHECK(std::adjacent_find(SortedPixels.begin(), SortedPixels.end()) == SortedPixels.end());
+
+	/// Every bounce compacts as many rays as it traces
+	auto DispatchSizes = CalculateBounceDispatchSizes(TotalSize, RaySurvivalHistogram, BASIC_CHUNK_SIZE);
+
+	for (size_t i = 1; i < DispatchSizes.size(); ++i)
+	{
+		CHECK(DispatchSizes[i].TraceRaysWidth == RaySurvivalHistogram[i - 1].ActiveRays);
+	}
+}
+
+TEST_CASE( "Compaction cost", "[.Benchmark]")
+{
+	const uint32_t TotalSize = 1920 * 1080;
+	std::mt19937 Generator(42);
+	auto AliveMask = CreateAliveMask(TotalSize, 0.5f, Generator);
+	auto Materials = CreateMaterials(AliveMask, Generator);
+	std::vector<uint32_t> PixelIndices(TotalSize);
+	std::iota(PixelIndices.begin(), PixelIndices.end(), 0);
+	std::shuffle(PixelIndices.begin(), PixelIndices.end(), Generator);
+
+	/// Compacting the live rays only costs less with every bounce, compacting the whole frame costs the same
+	for (uint32_t RayCount : {TotalSize, TotalSize / 4, TotalSize / 16, TotalSize / 64})
+	{
+		BENCHMARK("Compact " + std::to_string(RayCount) + " rays")
+		{
+			return CompactRays(PixelIndices, RayCount, Materials, TOTAL_MATERIALS, BASIC_CHUNK_SIZE);
+		};
+	}
+}
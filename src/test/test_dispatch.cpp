@@ -0,0 +1,102 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include "common_defines.h"
+#include "utils.h"
+
+#include <random>
+#include <vector>
+
+TEST_CASE( "Group count", "[Dispatch]")
+{
+	CHECK(CalculateGroupCount(0, BASIC_CHUNK_SIZE) == 0);
+	CHECK(CalculateGroupCount(1, BASIC_CHUNK_SIZE) == 1);
+	CHECK(CalculateGroupCount(BASIC_CHUNK_SIZE - 1, BASIC_CHUNK_SIZE) == 1);
+	CHECK(CalculateGroupCount(BASIC_CHUNK_SIZE, BASIC_CHUNK_SIZE) == 1);
+	CHECK(CalculateGroupCount(BASIC_CHUNK_SIZE + 1, BASIC_CHUNK_SIZE) == 2);
+	CHECK(CalculateGroupCount(1920 * 1080, BASIC_CHUNK_SIZE) == 8100);
+	CHECK(CalculateGroupCount(1920 * 1080, 1) == 1920 * 1080);
+
+	/// Doesn't overflow for the largest counts
+	CHECK(CalculateGroupCount(UINT32_MAX, BASIC_CHUNK_SIZE) == 16777216);
+	CHECK(CalculateGroupCount(UINT32_MAX, 1) == UINT32_MAX);
+	CHECK(CalculateGroupCount(UINT32_MAX, UINT32_MAX) == 1);
+
+	std::mt19937 Generator(7);
+	std::uniform_int_distribution<uint32_t> Distribution(0, 1u << 24);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		uint32_t NumberOfElements = Distribution(Generator);
+		uint32_t GroupCount = CalculateGroupCount(NumberOfElements, BASIC_CHUNK_SIZE);
+
+		/// Just enough groups to cover every element
+		CHECK(uint64_t(GroupCount) * BASIC_CHUNK_SIZE >= NumberOfElements);
+		CHECK((GroupCount == 0 || uint64_t(GroupCount - 1) * BASIC_CHUNK_SIZE < NumberOfElements));
+
+		/// Buffers sized by the max group count have a power of two rows that fit every group
+		uint32_t MaxGroupCount = CalculateMaxGroupCount(NumberOfElements, BASIC_CHUNK_SIZE);
+		CHECK(MaxGroupCount >= GroupCount);
+		CHECK((MaxGroupCount & (MaxGroupCount - 1)) == 0);
+	}
+}
+
+TEST_CASE( "Bounce dispatch sizes", "[Dispatch]")
+{
+	/// Rays which hit a material and which missed, recorded on every bounce of a 1000 pixel frame
+	std::vector<FBounceRayCounts> RaySurvivalHistogram = {{700, 300}, {400, 250}, {100, 300}, {0, 100}};
+	auto DispatchSizes = CalculateBounceDispatchSizes(1000, RaySurvivalHistogram, BASIC_CHUNK_SIZE);
+
+	REQUIRE(DispatchSizes.size() == 4);
+	CHECK(DispatchSizes[0].TraceRaysWidth == 1000);
+	CHECK(DispatchSizes[0].MissGroupCount == 2);
+	CHECK(DispatchSizes[1].TraceRaysWidth == 700);
+	CHECK(DispatchSizes[1].MissGroupCount == 1);
+	CHECK(DispatchSizes[2].TraceRaysWidth == 400);
+	CHECK(DispatchSizes[2].MissGroupCount == 2);
+	/// The last bounce traces what survived the previous one, and nothing survives it
+	CHECK(DispatchSizes[3].TraceRaysWidth == 100);
+	CHECK(DispatchSizes[3].MissGroupCount == 1);
+}
+
+TEST_CASE( "Bounce dispatch sizes of a recorded frame", "[Dispatch]")
+{
+	const uint32_t TotalSize = 1920 * 1080;
+	const uint32_t FullGroupCount = CalculateGroupCount(TotalSize, BASIC_CHUNK_SIZE);
+
+	/// Every bounce a part of the traced rays misses, a part is terminated by the material and the rest goes on
+	std::mt19937 Generator(42);
+	std::uniform_real_distribution<float> Distribution(0.1f, 0.4f);
+	std::vector<FBounceRayCounts> RaySurvivalHistogram;
+	uint32_t TracedRays = TotalSize;
+
+	for (int i = 0; i < 7; ++i)
+	{
+		uint32_t MissedRays = uint32_t(float(TracedRays) * Distribution(Generator));
+		uint32_t TerminatedRays = uint32_t(float(TracedRays - MissedRays) * Distribution(Generator));
+		RaySurvivalHistogram.push_back({TracedRays - MissedRays - TerminatedRays, MissedRays});
+		TracedRays = RaySurvivalHistogram.back().ActiveRays;
+	}
+
+	auto DispatchSizes = CalculateBounceDispatchSizes(TotalSize, RaySurvivalHistogram, BASIC_CHUNK_SIZE);
+	REQUIRE(DispatchSizes.size() == RaySurvivalHistogram.size());
+
+	uint64_t MissInvocations = 0;
+	uint64_t TracedRaysTotal = 0;
+
+	for (uint32_t i = 0; i < DispatchSizes.size(); ++i)
+	{
+		/// Traced rays never grow, and the miss pass covers exactly the missed rays, rounded up to a group
+		CHECK(DispatchSizes[i].TraceRaysWidth <= (i == 0 ? TotalSize : DispatchSizes[i - 1].TraceRaysWidth));
+		CHECK(RaySurvivalHistogram[i].ActiveRays + RaySurvivalHistogram[i].MissedRays <= DispatchSizes[i].TraceRaysWidth);
+		CHECK(uint64_t(DispatchSizes[i].MissGroupCount) * BASIC_CHUNK_SIZE >= RaySurvivalHistogram[i].MissedRays);
+		CHECK(uint64_t(DispatchSizes[i].MissGroupCount) * BASIC_CHUNK_SIZE < RaySurvivalHistogram[i].MissedRays + BASIC_CHUNK_SIZE);
+		CHECK(DispatchSizes[i].MissGroupCount <= FullGroupCount);
+
+		MissInvocations += uint64_t(DispatchSizes[i].MissGroupCount) * BASIC_CHUNK_SIZE;
+		TracedRaysTotal += DispatchSizes[i].TraceRaysWidth;
+	}
+
+	/// Far less work than dispatching every pass for the whole frame
+	CHECK(MissInvocations < uint64_t(TotalSize) * DispatchSizes.size() / 2);
+	CHECK(TracedRaysTotal < uint64_t(TotalSize) * DispatchSizes.size() / 2);
+}
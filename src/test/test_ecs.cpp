@@ -0,0 +1,571 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "component_manager.h"
+#include "coordinator.h"
+#include "entity_manager.h"
+#include "system_manager.h"
+
+#include "components/acceleration_structure_component.h"
+#include "components/device_camera_component.h"
+#include "components/device_mesh_component.h"
+#include "components/device_renderable_component.h"
+#include "components/device_transform_component.h"
+#include "components/framebuffer_component.h"
+#include "components/light_component.h"
+#include "components/material_component.h"
+#include "components/mesh_component.h"
+#include "components/texture_component.h"
+#include "components/transform_component.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+/// Upper bound of memory that component arrays are allowed to allocate for a small scene
+size_t ComponentsMemoryBound = 16 * 1024 * 1024;
+/// Number of entities used in the ECS benchmarks
+const uint32_t ECSBenchmarkEntitiesCount = 100000;
+/// Number of entities used in the random access benchmark
+const uint32_t ECSRandomAccessEntitiesCount = 1024 * 1024;
+/// Number of entities used in the systems benchmark
+const uint32_t ECSSystemsEntitiesCount = 500000;
+
+/// Systems with different signatures used to test entity lists
+class FTestSystemA : public ECS::SYSTEMS::FSystem {};
+class FTestSystemB : public ECS::SYSTEMS::FSystem {};
+class FTestSystemC : public ECS::SYSTEMS::FSystem {};
+
+/// Component that is registered only in tests
+struct FTestComponent
+{
+	uint32_t Value = 0;
+};
+
+/// Copy of the component array layout that was used before component arrays became paged sparse sets.
+/// It's kept here only to compare the throughput of both layouts.
+template<typename T>
+class TFixedComponentArray
+{
+public:
+	void InsertData(ECS::FEntity Entity, T Component)
+	{
+		size_t NewIndex = ArraySize;
+		EntityToIndexMap[Entity] = NewIndex;
+		IndexToEntityMap[NewIndex] = Entity;
+		ComponentArray[NewIndex] = Component;
+		++ArraySize;
+	}
+
+	void RemoveData(ECS::FEntity Entity)
+	{
+		size_t IndexOfRemovedEntity = EntityToIndexMap[Entity];
+		size_t IndexOfLastElement = ArraySize - 1;
+		ComponentArray[IndexOfRemovedEntity] = ComponentArray[IndexOfLastElement];
+
+		ECS::FEntity EntityOfLastElement = IndexToEntityMap[IndexOfLastElement];
+		EntityToIndexMap[EntityOfLastElement] = IndexOfRemovedEntity;
+		IndexToEntityMap[IndexOfRemovedEntity] = EntityOfLastElement;
+
+		EntityToIndexMap.erase(Entity);
+		IndexToEntityMap.erase(IndexOfLastElement);
+
+		--ArraySize;
+	}
+
+	T& GetData(ECS::FEntity Entity)
+	{
+		return ComponentArray[EntityToIndexMap[Entity]];
+	}
+
+	T& GetDataByIndex(uint32_t ComponentIndex)
+	{
+		return ComponentArray[ComponentIndex];
+	}
+
+private:
+	std::array<T, ECS::MAX_ENTITIES> ComponentArray;
+	std::unordered_map<ECS::FEntity, size_t> EntityToIndexMap;
+	std::unordered_map<size_t, ECS::FEntity> IndexToEntityMap;
+	size_t ArraySize = 0;
+};
+
+/// Copy of the component lookup that was used before component types got dense indices.
+/// It's kept here only to compare the cost of GetComponent calls.
+class FTypeNameComponentManager
+{
+public:
+	template<typename T>
+	void RegisterComponent()
+	{
+		ComponentArrays.insert({typeid(T).name(), std::make_shared<ECS::TComponentArray<T>>()});
+	}
+
+	template<typename T>
+	std::shared_ptr<ECS::TComponentArray<T>> GetComponentArray()
+	{
+		return std::static_pointer_cast<ECS::TComponentArray<T>>(ComponentArrays[typeid(T).name()]);
+	}
+
+	template<typename T>
+	T& GetComponent(ECS::FEntity Entity)
+	{
+		return GetComponentArray<T>()->GetData(Entity);
+	}
+
+private:
+	std::unordered_map<const char*, std::shared_ptr<ECS::IComponentArray>> ComponentArrays{};
+};
+
+template<typename T>
+void AddComponents(ECS::FComponentManager& ComponentManager, uint32_t Count)
+{
+	for (ECS::FEntity Entity = 0; Entity < Count; ++Entity)
+	{
+		ComponentManager.AddComponent<T>(Entity, T{});
+	}
+}
+
+template<typename ArrayType>
+float RandomAccess(ArrayType& Array, const std::vector<ECS::FEntity>& Entities)
+{
+	float Sum = 0.f;
+
+	for (auto Entity : Entities)
+	{
+		Sum += Array.GetData(Entity).Position.X;
+	}
+
+	return Sum;
+}
+
+template<typename ArrayType>
+float InsertIterateRemove(ArrayType& Array)
+{
+	for (ECS::FEntity Entity = 0; Entity < ECSBenchmarkEntitiesCount; ++Entity)
+	{
+		Array.InsertData(Entity, {FVector3(float(Entity), 0.f, 0.f)});
+	}
+
+	float Sum = 0.f;
+
+	for (uint32_t i = 0; i < ECSBenchmarkEntitiesCount; ++i)
+	{
+		Sum += Array.GetDataByIndex(i).Position.X;
+	}
+
+	for (ECS::FEntity Entity = 0; Entity < ECSBenchmarkEntitiesCount; ++Entity)
+	{
+		Array.RemoveData(Entity);
+	}
+
+	return Sum;
+}
+
+TEST_CASE( "Component arrays memory", "[ECS]")
+{
+	/// A small scene: a dozen entities of every component type
+	const uint32_t EntitiesCount = 12;
+	ECS::FComponentManager ComponentManager;
+
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FAccelerationStructureComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FAreaLightComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FDeviceCameraComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FDeviceMeshComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FDeviceRenderableComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FDeviceTransformComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FDirectionalLightComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FMaterialComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FMeshComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FMeshInstanceComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FPointLightComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FSpotLightComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FTransformComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FTextureComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FFramebufferComponent>();
+
+	/// Nothing should be allocated before components are added
+	CHECK(ComponentManager.GetAllocatedMemory() == 0);
+
+	AddComponents<ECS::COMPONENTS::FAccelerationStructureComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FAreaLightComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FDeviceCameraComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FDeviceMeshComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FDeviceRenderableComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FDeviceTransformComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FDirectionalLightComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FMaterialComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FMeshComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FMeshInstanceComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FPointLightComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FSpotLightComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FTransformComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FTextureComponent>(ComponentManager, EntitiesCount);
+	AddComponents<ECS::COMPONENTS::FFramebufferComponent>(ComponentManager, EntitiesCount);
+
+	CHECK(ComponentManager.GetAllocatedMemory() <= ComponentsMemoryBound);
+
+	/// Components should stay contiguous inside a page, and offsets should be the same as in a flat array
+	auto Ranges = ComponentManager.GetRanges<ECS::COMPONENTS::FTransformComponent>();
+	REQUIRE(Ranges.size() == 1);
+	CHECK(Ranges[0].Count == EntitiesCount);
+	CHECK(ComponentManager.Data<ECS::COMPONENTS::FTransformComponent>(3) == Ranges[0].Data + 3);
+	CHECK(ComponentManager.GetOffset<ECS::COMPONENTS::FTransformComponent>(3) == 3 * sizeof(ECS::COMPONENTS::FTransformComponent));
+}
+
+TEST_CASE( "Component array pages", "[ECS]")
+{
+	ECS::TComponentArray<ECS::COMPONENTS::FTransformComponent> Array;
+
+	for (ECS::FEntity Entity = 0; Entity < ECS::COMPONENT_PAGE_SIZE * 3; ++Entity)
+	{
+		Array.InsertData(Entity, {FVector3(float(Entity), 0.f, 0.f)});
+	}
+
+	auto Ranges = Array.GetRanges();
+	REQUIRE(Ranges.size() == 3);
+
+	for (uint32_t i = 0; i < Ranges.size(); ++i)
+	{
+		CHECK(Ranges[i].FirstIndex == i * ECS::COMPONENT_PAGE_SIZE);
+		CHECK(Ranges[i].Count == ECS::COMPONENT_PAGE_SIZE);
+		CHECK(Ranges[i].Data[0].Position.X == float(i * ECS::COMPONENT_PAGE_SIZE));
+	}
+
+	auto Gathered = Array.GatherData();
+	REQUIRE(Gathered.size() == ECS::COMPONENT_PAGE_SIZE * 3);
+
+	for (uint32_t i = 0; i < Gathered.size(); ++i)
+	{
+		CHECK(Gathered[i].Position.X == float(i));
+	}
+
+	/// Removing components should release the pages, except the spare one
+	size_t MemoryWithAllPages = Array.GetAllocatedMemory();
+
+	for (ECS::FEntity Entity = 0; Entity < ECS::COMPONENT_PAGE_SIZE * 3; ++Entity)
+	{
+		Array.RemoveData(Entity);
+	}
+
+	CHECK(Array.Size() == 0);
+	CHECK(Array.GetRanges().empty());
+	CHECK(Array.GetAllocatedMemory() < MemoryWithAllPages);
+}
+
+TEST_CASE( "Component array insert remove reinsert", "[ECS]")
+{
+	ECS::TComponentArray<ECS::COMPONENTS::FTransformComponent> Array;
+
+	for (ECS::FEntity Entity = 0; Entity < 5; ++Entity)
+	{
+		Array.InsertData(Entity, {FVector3(float(Entity), 0.f, 0.f)});
+	}
+
+	/// Removing an entity moves the last component into its place
+	Array.RemoveData(1);
+	CHECK_FALSE(Array.HasData(1));
+	CHECK(Array.GetIndex(4) == 1);
+	CHECK(Array.GetEntity(1) == 4);
+	CHECK(Array.GetDataByIndex(1).Position.X == 4.f);
+	CHECK(Array.Size() == 4 * sizeof(ECS::COMPONENTS::FTransformComponent));
+
+	/// Removing the last component doesn't move anything
+	Array.RemoveData(3);
+	CHECK(Array.GetIndex(0) == 0);
+	CHECK(Array.GetIndex(4) == 1);
+	CHECK(Array.GetIndex(2) == 2);
+
+	/// Reinserted entities are appended to the end
+	Array.InsertData(1, {FVector3(10.f, 0.f, 0.f)});
+	CHECK(Array.GetIndex(1) == 3);
+	CHECK(Array.GetEntity(3) == 1);
+	CHECK(Array.GetData(1).Position.X == 10.f);
+
+	/// Entities far from each other should land in different sparse pages
+	ECS::FEntity FarEntity = ECS::SPARSE_PAGE_SIZE * 100 + 7;
+	Array.InsertData(FarEntity, {FVector3(20.f, 0.f, 0.f)});
+	CHECK(Array.GetIndex(FarEntity) == 4);
+	CHECK(Array.GetData(FarEntity).Position.X == 20.f);
+	CHECK_FALSE(Array.HasData(FarEntity + 1));
+
+	Array.EntityDestroyed(0);
+	CHECK_FALSE(Array.HasData(0));
+	CHECK(Array.GetIndex(FarEntity) == 0);
+	CHECK(Array.GetEntity(0) == FarEntity);
+}
+
+TEST_CASE( "Component types", "[ECS]")
+{
+	ECS::FComponentManager ComponentManager;
+
+	/// Signature bits are assigned in the order of registration, no matter what the type indices are
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FTextureComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FTransformComponent>();
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FPointLightComponent>();
+
+	CHECK(ComponentManager.GetComponentType<ECS::COMPONENTS::FTextureComponent>() == 0);
+	CHECK(ComponentManager.GetComponentType<ECS::COMPONENTS::FTransformComponent>() == 1);
+	CHECK(ComponentManager.GetComponentType<ECS::COMPONENTS::FPointLightComponent>() == 2);
+
+	/// Type indices are the same for all component managers
+	CHECK(ECS::GetComponentTypeIndex<ECS::COMPONENTS::FTextureComponent>() != ECS::GetComponentTypeIndex<ECS::COMPONENTS::FTransformComponent>());
+	CHECK(ECS::GetComponentTypeIndex<ECS::COMPONENTS::FTransformComponent>() != ECS::GetComponentTypeIndex<ECS::COMPONENTS::FPointLightComponent>());
+
+	ComponentManager.AddComponent<ECS::COMPONENTS::FTransformComponent>(5, {FVector3(5.f, 0.f, 0.f)});
+	ComponentManager.AddComponent<ECS::COMPONENTS::FTextureComponent>(5, {7});
+	CHECK(ComponentManager.GetComponent<ECS::COMPONENTS::FTransformComponent>(5).Position.X == 5.f);
+	CHECK(ComponentManager.GetComponent<ECS::COMPONENTS::FTextureComponent>(5).TextureIndex == 7);
+
+	ComponentManager.EntityDestroyed(5);
+	CHECK(ComponentManager.Size<ECS::COMPONENTS::FTransformComponent>() == 0);
+	CHECK(ComponentManager.Size<ECS::COMPONENTS::FTextureComponent>() == 0);
+}
+
+TEST_CASE( "System entity lists", "[ECS]")
+{
+	ECS::SYSTEMS::FEntitySet EntitySet;
+
+	for (ECS::FEntity Entity = 0; Entity < 5; ++Entity)
+	{
+		CHECK(EntitySet.insert(Entity));
+	}
+
+	/// Inserting twice does nothing
+	CHECK_FALSE(EntitySet.insert(2));
+	CHECK(EntitySet.size() == 5);
+
+	/// Erasing moves the last entity into the erased place
+	CHECK(EntitySet.erase(1));
+	CHECK_FALSE(EntitySet.erase(1));
+	CHECK_FALSE(EntitySet.contains(1));
+	CHECK(std::vector<ECS::FEntity>(EntitySet.begin(), EntitySet.end()) == std::vector<ECS::FEntity>{0, 4, 2, 3});
+
+	CHECK(EntitySet.erase(3));
+	CHECK(EntitySet.insert(ECS::SPARSE_PAGE_SIZE * 10));
+	CHECK(std::vector<ECS::FEntity>(EntitySet.begin(), EntitySet.end()) == std::vector<ECS::FEntity>{0, 4, 2, ECS::SPARSE_PAGE_SIZE * 10});
+
+	/// Sorting keeps the sparse indices valid
+	EntitySet.Sort([](ECS::FEntity Entity){ return UINT32_MAX - Entity; });
+	CHECK(std::vector<ECS::FEntity>(EntitySet.begin(), EntitySet.end()) == std::vector<ECS::FEntity>{ECS::SPARSE_PAGE_SIZE * 10, 4, 2, 0});
+	CHECK(EntitySet.erase(4));
+	CHECK(std::vector<ECS::FEntity>(EntitySet.begin(), EntitySet.end()) == std::vector<ECS::FEntity>{ECS::SPARSE_PAGE_SIZE * 10, 0, 2});
+}
+
+TEST_CASE( "System sorted by component index", "[ECS]")
+{
+	/// Local component manager, so the test doesn't leave anything in the global one
+	ECS::FComponentManager ComponentManager;
+	ComponentManager.RegisterComponent<FTestComponent>();
+
+	FTestSystemA System;
+
+	/// Components are added in the reverse order of entities
+	for (ECS::FEntity Entity = 10; Entity > 0; --Entity)
+	{
+		ComponentManager.AddComponent<FTestComponent>(Entity, {Entity});
+		System.RegisterEntity(Entity);
+	}
+
+	System.EnableSortingByComponentIndex<FTestComponent>(&ComponentManager);
+
+	uint32_t ExpectedIndex = 0;
+
+	for (auto Entity : System)
+	{
+		CHECK(ComponentManager.GetIndex<FTestComponent>(Entity) == ExpectedIndex++);
+	}
+
+	/// Removing a component swaps the last component into its place, the system should resort
+	ComponentManager.RemoveComponent<FTestComponent>(10);
+	System.UnregisterEntity(10);
+
+	ExpectedIndex = 0;
+
+	for (auto Entity : System)
+	{
+		CHECK(ComponentManager.GetIndex<FTestComponent>(Entity) == ExpectedIndex++);
+	}
+
+	CHECK(ExpectedIndex == 9);
+
+	/// Removing a component of an entity outside of the system moves a component of the system's entity
+	ComponentManager.AddComponent<FTestComponent>(11, {11});
+	ComponentManager.AddComponent<FTestComponent>(12, {12});
+	System.RegisterEntity(12);
+	System.begin();
+
+	ComponentManager.RemoveComponent<FTestComponent>(1);
+	ComponentManager.AddComponent<FTestComponent>(1, {1});
+	ComponentManager.RemoveComponent<FTestComponent>(11);
+
+	ExpectedIndex = 0;
+
+	for (auto Entity : System)
+	{
+		CHECK(ComponentManager.GetIndex<FTestComponent>(Entity) == ExpectedIndex++);
+	}
+
+	CHECK(ExpectedIndex == 10);
+}
+
+TEST_CASE( "Entity reuse", "[ECS]")
+{
+	ECS::FEntityManager EntityManager;
+
+	/// Entities are handed out by a counter
+	for (ECS::FEntity Expected = 0; Expected < ECS::ENTITY_CHUNK_SIZE + 10; ++Expected)
+	{
+		CHECK(EntityManager.CreateEntity() == Expected);
+	}
+
+	auto Handle = EntityManager.GetHandle(5);
+	CHECK(EntityManager.IsValid(Handle));
+
+	EntityManager.SetSignature(5, ECS::FSignature().set(3));
+	EntityManager.DestroyEntity(5);
+	CHECK_FALSE(EntityManager.IsValid(Handle));
+
+	/// Destroyed entity is reused, with a cleared signature and a new generation
+	CHECK(EntityManager.CreateEntity() == 5);
+	CHECK(EntityManager.GetSignature(5).none());
+	CHECK_FALSE(EntityManager.IsValid(Handle));
+	CHECK(EntityManager.IsValid(EntityManager.GetHandle(5)));
+
+	/// When there's nothing to reuse, the counter continues
+	CHECK(EntityManager.CreateEntity() == ECS::ENTITY_CHUNK_SIZE + 10);
+
+	CHECK_FALSE(EntityManager.IsValid({ECS::INVALID_ENTITY, 0}));
+}
+
+TEST_CASE( "Coordinator startup", "[.Benchmark]")
+{
+	BENCHMARK("Construct coordinator")
+	{
+		ECS::FCoordinator Coordinator;
+		Coordinator.Init();
+		return Coordinator.CreateEntity();
+	};
+}
+
+TEST_CASE( "Systems entity lists", "[.Benchmark]")
+{
+	BENCHMARK("Create, mutate and destroy entities")
+	{
+		ECS::FSystemManager SystemManager;
+
+		SystemManager.RegisterSystem<FTestSystemA>();
+		SystemManager.RegisterSystem<FTestSystemB>();
+		SystemManager.RegisterSystem<FTestSystemC>();
+		SystemManager.SetSignature<FTestSystemA>(ECS::FSignature().set(0));
+		SystemManager.SetSignature<FTestSystemB>(ECS::FSignature().set(0).set(1));
+		SystemManager.SetSignature<FTestSystemC>(ECS::FSignature().set(2));
+
+		for (ECS::FEntity Entity = 0; Entity < ECSSystemsEntitiesCount; ++Entity)
+		{
+			SystemManager.EntitySignatureChanged(Entity, ECS::FSignature().set(0));
+		}
+
+		for (ECS::FEntity Entity = 0; Entity < ECSSystemsEntitiesCount; ++Entity)
+		{
+			SystemManager.EntitySignatureChanged(Entity, ECS::FSignature().set(0).set(1 + Entity % 2));
+		}
+
+		size_t Size = SystemManager.GetSystem<FTestSystemA>()->size() + SystemManager.GetSystem<FTestSystemB>()->size();
+
+		for (ECS::FEntity Entity = 0; Entity < ECSSystemsEntitiesCount; ++Entity)
+		{
+			SystemManager.EntityDestroyed(Entity);
+		}
+
+		return Size;
+	};
+}
+
+TEST_CASE( "Component lookup", "[.Benchmark]")
+{
+	const uint32_t EntitiesCount = 1024;
+	ECS::FComponentManager ComponentManager;
+	FTypeNameComponentManager TypeNameComponentManager;
+
+	ComponentManager.RegisterComponent<ECS::COMPONENTS::FTransformComponent>();
+	TypeNameComponentManager.RegisterComponent<ECS::COMPONENTS::FTransformComponent>();
+	AddComponents<ECS::COMPONENTS::FTransformComponent>(ComponentManager, EntitiesCount);
+
+	for (ECS::FEntity Entity = 0; Entity < EntitiesCount; ++Entity)
+	{
+		TypeNameComponentManager.GetComponentArray<ECS::COMPONENTS::FTransformComponent>()->InsertData(Entity, {});
+	}
+
+	BENCHMARK("Type name lookup: GetComponent")
+	{
+		float Sum = 0.f;
+
+		for (ECS::FEntity Entity = 0; Entity < EntitiesCount; ++Entity)
+		{
+			Sum += TypeNameComponentManager.GetComponent<ECS::COMPONENTS::FTransformComponent>(Entity).Position.X;
+		}
+
+		return Sum;
+	};
+
+	BENCHMARK("Type index lookup: GetComponent")
+	{
+		float Sum = 0.f;
+
+		for (ECS::FEntity Entity = 0; Entity < EntitiesCount; ++Entity)
+		{
+			Sum += ComponentManager.GetComponent<ECS::COMPONENTS::FTransformComponent>(Entity).Position.X;
+		}
+
+		return Sum;
+	};
+}
+
+TEST_CASE( "Component array random access", "[.Benchmark]")
+{
+	std::vector<ECS::FEntity> Entities(ECSRandomAccessEntitiesCount);
+	std::iota(Entities.begin(), Entities.end(), 0);
+	std::shuffle(Entities.begin(), Entities.end(), std::mt19937(42));
+
+	auto FixedArray = std::make_unique<TFixedComponentArray<ECS::COMPONENTS::FTransformComponent>>();
+	auto SparseSetArray = std::make_unique<ECS::TComponentArray<ECS::COMPONENTS::FTransformComponent>>();
+
+	for (auto Entity : Entities)
+	{
+		FixedArray->InsertData(Entity, {FVector3(float(Entity), 0.f, 0.f)});
+		SparseSetArray->InsertData(Entity, {FVector3(float(Entity), 0.f, 0.f)});
+	}
+
+	std::shuffle(Entities.begin(), Entities.end(), std::mt19937(43));
+
+	BENCHMARK("Hash maps: random GetData")
+	{
+		return RandomAccess(*FixedArray, Entities);
+	};
+
+	BENCHMARK("Sparse set: random GetData")
+	{
+		return RandomAccess(*SparseSetArray, Entities);
+	};
+}
+
+TEST_CASE( "Component array layouts", "[.Benchmark]")
+{
+	BENCHMARK("Fixed array: insert, iterate, remove")
+	{
+		auto Array = std::make_unique<TFixedComponentArray<ECS::COMPONENTS::FTransformComponent>>();
+		return InsertIterateRemove(*Array);
+	};
+
+	BENCHMARK("Paged array: insert, iterate, remove")
+	{
+		auto Array = std::make_unique<ECS::TComponentArray<ECS::COMPONENTS::FTransformComponent>>();
+		return InsertIterateRemove(*Array);
+	};
+}
@@ -0,0 +1,354 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "frame_graph.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t COMPUTE_QUEUE = 2;
+	constexpr uint32_t GRAPHICS_QUEUE = 1;
+
+	FFrameGraphResourceAccess Read(const std::string& Resource, uint32_t Stages)
+	{
+		return {Resource, Stages, FRAME_GRAPH_ACCESS_SHADER_READ};
+	}
+
+	FFrameGraphResourceAccess Write(const std::string& Resource, uint32_t Stages)
+	{
+		return {Resource, Stages, FRAME_GRAPH_ACCESS_SHADER_WRITE};
+	}
+
+	FFrameGraphResourceAccess ReadWrite(const std::string& Resource, uint32_t Stages)
+	{
+		return {Resource, Stages, FRAME_GRAPH_ACCESS_SHADER_READ | FRAME_GRAPH_ACCESS_SHADER_WRITE};
+	}
+
+	FFrameGraphResourceAccess Clear(const std::string& Resource)
+	{
+		return {Resource, FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_TRANSFER_WRITE};
+	}
+
+	FFrameGraphResourceAccess Indirect(const std::string& Resource)
+	{
+		return {Resource, FRAME_GRAPH_STAGE_DRAW_INDIRECT, FRAME_GRAPH_ACCESS_INDIRECT_COMMAND_READ};
+	}
+}
+
+/// Passes of a frame of the renderer, with the resources its tasks access
+FFrameGraph CreateRendererFrameGraph(uint32_t RecursionDepth, bool bResetAccumulation)
+{
+	const uint32_t RT = FRAME_GRAPH_STAGE_RAY_TRACING_SHADER;
+	const uint32_t CS = FRAME_GRAPH_STAGE_COMPUTE_SHADER;
+
+	FFrameGraph FrameGraph;
+	FrameGraph.AddPass({"UpdateTLAS", COMPUTE_QUEUE, {{"TLAS", FRAME_GRAPH_STAGE_ACCELERATION_STRUCTURE_BUILD, FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_WRITE}}});
+
+	if (bResetAccumulation)
+	{
+		FrameGraph.AddPass({"ResetRenderIterations", COMPUTE_QUEUE, {Clear("RenderIteration")}});
+		FrameGraph.AddPass({"ClearAccumulator", COMPUTE_QUEUE, {Clear("AccumulatorImage")}});
+		FrameGraph.AddPass({"ClearConvergence", COMPUTE_QUEUE, {Clear("LuminanceMoments"), Clear("ConvergenceMask"), Clear("ConvergenceCounters")}});
+	}
+
+	FrameGraph.AddPass({"ClearCumulativeMaterialColor", COMPUTE_QUEUE, {Clear("CumulativeMaterialColor")}});
+	FrameGraph.AddPass({"ResetActiveRayCount", COMPUTE_QUEUE, {Write("ActiveRayCount", CS)}});
+
+	for (uint32_t i = 0; i < RecursionDepth; ++i)
+	{
+		FrameGraph.AddPass({"ClearCountedMaterialsPerChunk", COMPUTE_QUEUE, {Clear("CountedMaterialsPerChunk")}});
+		FrameGraph.AddPass({"RayTrace", COMPUTE_QUEUE, {{"TLAS", RT, FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_READ}, Indirect("ActiveRayCount"),
+			ReadWrite("Rays", RT), ReadWrite("Throughput", RT), ReadWrite("PixelIndex", RT), Write("Hits", RT), Write("MaterialIndicesAOV", RT), Read("RenderIteration", RT), Read("ConvergenceMask", RT)}});
+		FrameGraph.AddPass({"ClearTotalMaterialsCount", COMPUTE_QUEUE, {Write("TotalCountedMaterials", CS)}});
+		FrameGraph.AddPass({"CountMaterialsPerChunk", COMPUTE_QUEUE, {Indirect("ActiveRayCount"), Read("ActiveRayCount", CS), Read("PixelIndex", CS), Write("UnsortedPixelIndex", CS),
+			Read("MaterialIndicesAOV", CS), ReadWrite("CountedMaterialsPerChunk", CS)}});
+		FrameGraph.AddPass({"PrefixSumsUpSweep", COMPUTE_QUEUE, {ReadWrite("CountedMaterialsPerChunk", CS)}});
+		FrameGraph.AddPass({"PrefixSumsZeroOut", COMPUTE_QUEUE, {ReadWrite("CountedMaterialsPerChunk", CS), ReadWrite("TotalCountedMaterials", CS)}});
+		FrameGraph.AddPass({"PrefixSumsDownSweep", COMPUTE_QUEUE, {ReadWrite("CountedMaterialsPerChunk", CS)}});
+		FrameGraph.AddPass({"ComputeOffsetsPerMaterial", COMPUTE_QUEUE, {ReadWrite("TotalCountedMaterials", CS), ReadWrite("MaterialsOffsets", CS), Write("ActiveRayCount", CS)}});
+		FrameGraph.AddPass({"SortMaterials", COMPUTE_QUEUE, {Indirect("ActiveRayCount"), Read("ActiveRayCount", CS), Read("UnsortedPixelIndex", CS), Read("CountedMaterialsPerChunk", CS), ReadWrite("MaterialsOffsets", CS), Read("MaterialIndicesAOV", CS), Write("PixelIndex", CS)}});
+		FrameGraph.AddPass({"Miss", COMPUTE_QUEUE, {Indirect("ActiveRayCount"), ReadWrite("Rays", CS), Read("PixelIndex", CS), ReadWrite("MaterialIndicesAOV", CS),
+			Read("MaterialsOffsets", CS), ReadWrite("CumulativeMaterialColor", CS), ReadWrite("Throughput", CS), Write("ColorImage", CS), ReadWrite("AOVImage", CS)}});
+		FrameGraph.AddPass({"MasterShader", COMPUTE_QUEUE, {{"TLAS", RT, FRAME_GRAPH_ACCESS_ACCELERATION_STRUCTURE_READ}, Indirect("TotalCountedMaterials"), Indirect("ActiveRayCount"),
+			ReadWrite("Rays", RT), Read("Hits", RT), Read("MaterialsOffsets", RT), Read("PixelIndex", RT), ReadWrite("CumulativeMaterialColor", RT), ReadWrite("Throughput", RT),
+			ReadWrite("ColorImage", RT), ReadWrite("AOVImage", RT), Read("RenderIteration", RT)}});
+	}
+
+	FrameGraph.AddPass({"Accumulate", COMPUTE_QUEUE, {Read("ColorImage", CS), Read("AOVImage", CS), ReadWrite("AccumulatorImage", CS), Write("EstimatedImage", CS),
+		ReadWrite("LuminanceMoments", CS), Read("ConvergenceMask", CS)}});
+	FrameGraph.AddPass({"Convergence", COMPUTE_QUEUE, {Read("LuminanceMoments", CS), ReadWrite("ConvergenceMask", CS),
+		{"ConvergenceCounters", CS | FRAME_GRAPH_STAGE_TRANSFER, FRAME_GRAPH_ACCESS_SHADER_READ_WRITE | FRAME_GRAPH_ACCESS_TRANSFER_READ}, Clear("ConvergenceCountersSnapshot")}});
+	FrameGraph.AddPass({"AdvanceRenderCount", COMPUTE_QUEUE, {ReadWrite("RenderIteration", CS)}});
+	FrameGraph.AddPass({"Passthrough", GRAPHICS_QUEUE, {Read("EstimatedImage", FRAME_GRAPH_STAGE_FRAGMENT_SHADER),
+		{"OutputImage", FRAME_GRAPH_STAGE_COLOR_ATTACHMENT_OUTPUT, FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE}}});
+
+	return FrameGraph;
+}
+
+/// Every hazard between two passes, as they were added, must be kept in the compiled graph:
+/// the passes stay in order, and if they are in the same submit, there's a barrier between them covering both of them
+void CheckHazardsAreSynchronized(const FFrameGraph& FrameGraph, const FCompiledFrameGraph& CompiledFrameGraph)
+{
+	struct FLocation
+	{
+		uint32_t Batch;
+		uint32_t Step;
+		uint32_t Position;
+	};
+
+	std::vector<FLocation> Locations(FrameGraph.GetPasses().size());
+	uint32_t Position = 0;
+
+	for (uint32_t i = 0; i < CompiledFrameGraph.Batches.size(); ++i)
+	{
+		for (uint32_t j = 0; j < CompiledFrameGraph.Batches[i].Steps.size(); ++j)
+		{
+			for (auto Pass : CompiledFrameGraph.Batches[i].Steps[j].Passes)
+			{
+				Locations[Pass] = {i, j, Position++};
+			}
+		}
+	}
+
+	REQUIRE(Position == FrameGraph.GetPasses().size());
+
+	auto IsSynchronized = [&](uint32_t First, uint32_t SrcStages, uint32_t Second, uint32_t DstStages)
+	{
+		if (Locations[First].Position >= Locations[Second].Position)
+		{
+			return false;
+		}
+
+		if (Locations[First].Batch != Locations[Second].Batch)
+		{
+			return true;
+		}
+
+		auto& Steps = CompiledFrameGraph.Batches[Locations[First].Batch].Steps;
+
+		for (uint32_t Step = Locations[First].Step + 1; Step <= Locations[Second].Step; ++Step)
+		{
+			auto& Barrier = Steps[Step].Barrier;
+
+			if ((Barrier.SrcStages & SrcStages) == SrcStages && (Barrier.DstStages & DstStages) == DstStages)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	auto& Passes = FrameGraph.GetPasses();
+
+	for (uint32_t i = 0; i < Passes.size(); ++i)
+	{
+		for (auto& Access : Passes[i].Accesses)
+		{
+			/// Find the next write of the resource, and the reads before it
+			for (uint32_t j = i + 1; j < Passes.size(); ++j)
+			{
+				bool bNextWrite = false;
+
+				for (auto& Other : Passes[j].Accesses)
+				{
+					if (Other.Resource != Access.Resource)
+					{
+						continue;
+					}
+
+					/// Read after write
+					if (Access.IsWrite() && Other.IsRead() && !IsSynchronized(i, Access.Stages, j, Other.Stages))
+					{
+						FAIL("Read after write of " + Access.Resource + " isn't synchronized between " + Passes[i].Name + " and " + Passes[j].Name);
+					}
+
+					/// Write after write, or write after read
+					if (Other.IsWrite())
+					{
+						bNextWrite = true;
+						CHECK(Locations[i].Position < Locations[j].Position);
+					}
+				}
+
+				if (bNextWrite)
+				{
+					break;
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE( "Frame graph of a frame", "[FrameGraph]")
+{
+	for (bool bResetAccumulation : {false, true})
+	{
+		auto FrameGraph = CreateRendererFrameGraph(7, bResetAccumulation);
+		auto CompiledFrameGraph = FrameGraph.Compile();
+
+		CheckHazardsAreSynchronized(FrameGraph, CompiledFrameGraph);
+
+		/// Everything is computed in a single submit, and the graphics queue presents the result
+		REQUIRE(CompiledFrameGraph.Batches.size() == 2);
+		CHECK(CompiledFrameGraph.Batches[0].Queue == COMPUTE_QUEUE);
+		CHECK(CompiledFrameGraph.Batches[1].Queue == GRAPHICS_QUEUE);
+		CHECK(CompiledFrameGraph.Batches[1].Steps.size() == 1);
+		CHECK(CompiledFrameGraph.Batches[1].Steps[0].Barrier.IsEmpty());
+
+		/// Clears of the first bounce and of the frame, and the TLAS update, don't depend on each other
+		auto& FirstStep = CompiledFrameGraph.Batches[0].Steps[0];
+		CHECK(FirstStep.Barrier.IsEmpty());
+		CHECK(FirstStep.Passes.size() == (bResetAccumulation ? 8 : 5));
+
+		/// At most a barrier per step, and no barrier in front of the first one
+		uint32_t StepsCount = CompiledFrameGraph.Batches[0].Steps.size() + CompiledFrameGraph.Batches[1].Steps.size();
+		CHECK(CompiledFrameGraph.GetBarrierCount() < StepsCount);
+		CHECK(StepsCount < FrameGraph.GetPasses().size());
+	}
+}
+
+TEST_CASE( "Frame graph keeps the order of dependent passes", "[FrameGraph]")
+{
+	FFrameGraph FrameGraph;
+	FrameGraph.AddPass({"Write A", 0, {Write("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Write B", 0, {Write("B", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Read A write C", 0, {Read("A", FRAME_GRAPH_STAGE_RAY_TRACING_SHADER), Write("C", FRAME_GRAPH_STAGE_RAY_TRACING_SHADER)}});
+	FrameGraph.AddPass({"Read B", 0, {Read("B", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Write A again", 0, {Clear("A")}});
+	FrameGraph.AddPass({"Read C", 0, {Read("C", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+
+	auto CompiledFrameGraph = FrameGraph.Compile();
+	CheckHazardsAreSynchronized(FrameGraph, CompiledFrameGraph);
+
+	REQUIRE(CompiledFrameGraph.Batches.size() == 1);
+	auto& Steps = CompiledFrameGraph.Batches[0].Steps;
+	REQUIRE(Steps.size() == 3);
+	CHECK(Steps[0].Passes == std::vector<uint32_t>{0, 1});
+	CHECK(Steps[1].Passes == std::vector<uint32_t>{2, 3});
+	CHECK(Steps[2].Passes == std::vector<uint32_t>{4, 5});
+
+	/// Reads of A and B wait for the compute shader writes
+	CHECK(Steps[0].Barrier.IsEmpty());
+	CHECK(Steps[1].Barrier.SrcStages == FRAME_GRAPH_STAGE_COMPUTE_SHADER);
+	CHECK(Steps[1].Barrier.DstStages == (FRAME_GRAPH_STAGE_RAY_TRACING_SHADER | FRAME_GRAPH_STAGE_COMPUTE_SHADER));
+	CHECK(Steps[1].Barrier.SrcAccess == FRAME_GRAPH_ACCESS_SHADER_WRITE);
+	CHECK(Steps[1].Barrier.DstAccess == FRAME_GRAPH_ACCESS_SHADER_READ);
+
+	/// Rewriting A only has to wait for the read to finish, reading C has to see the write
+	CHECK(Steps[2].Barrier.SrcStages == FRAME_GRAPH_STAGE_RAY_TRACING_SHADER);
+	CHECK(Steps[2].Barrier.DstStages == (FRAME_GRAPH_STAGE_TRANSFER | FRAME_GRAPH_STAGE_COMPUTE_SHADER));
+	CHECK(Steps[2].Barrier.SrcAccess == FRAME_GRAPH_ACCESS_SHADER_WRITE);
+	CHECK(Steps[2].Barrier.DstAccess == FRAME_GRAPH_ACCESS_SHADER_READ);
+}
+
+TEST_CASE( "Frame graph doesn't repeat barriers", "[FrameGraph]")
+{
+	FFrameGraph FrameGraph;
+	FrameGraph.AddPass({"Write A", 0, {Write("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Read A", 0, {Read("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER), Write("B", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Read A and B", 0, {Read("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER), Read("B", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Read constants", 0, {Read("Constants", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+
+	auto CompiledFrameGraph = FrameGraph.Compile();
+	CheckHazardsAreSynchronized(FrameGraph, CompiledFrameGraph);
+
+	/// A is already visible to the compute shaders when it's read for the second time
+	REQUIRE(CompiledFrameGraph.Batches.size() == 1);
+	auto& Steps = CompiledFrameGraph.Batches[0].Steps;
+	REQUIRE(Steps.size() == 3);
+	CHECK(CompiledFrameGraph.GetBarrierCount() == 2);
+
+	/// Resources nobody writes never need a barrier, so reading them can start right away
+	CHECK(std::find(Steps[0].Passes.begin(), Steps[0].Passes.end(), 3) != Steps[0].Passes.end());
+
+	/// A pass reading and writing the same resource doesn't wait for itself
+	FFrameGraph ReadWriteFrameGraph;
+	ReadWriteFrameGraph.AddPass({"Accumulate", 0, {ReadWrite("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	ReadWriteFrameGraph.AddPass({"Accumulate again", 0, {ReadWrite("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	auto ReadWriteCompiledFrameGraph = ReadWriteFrameGraph.Compile();
+	REQUIRE(ReadWriteCompiledFrameGraph.Batches[0].Steps.size() == 2);
+	CHECK(ReadWriteCompiledFrameGraph.Batches[0].Steps[0].Barrier.IsEmpty());
+	CHECK(ReadWriteCompiledFrameGraph.Batches[0].Steps[1].Barrier.SrcAccess == FRAME_GRAPH_ACCESS_SHADER_WRITE);
+	CHECK(ReadWriteCompiledFrameGraph.Batches[0].Steps[1].Barrier.DstAccess == (FRAME_GRAPH_ACCESS_SHADER_READ | FRAME_GRAPH_ACCESS_SHADER_WRITE));
+}
+
+TEST_CASE( "Frame graph submits", "[FrameGraph]")
+{
+	FFrameGraph FrameGraph;
+	FrameGraph.AddPass({"Compute", COMPUTE_QUEUE, {Write("A", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Draw", GRAPHICS_QUEUE, {Read("A", FRAME_GRAPH_STAGE_FRAGMENT_SHADER), Write("B", FRAME_GRAPH_STAGE_FRAGMENT_SHADER)}});
+	FrameGraph.AddPass({"Independent compute", COMPUTE_QUEUE, {Write("C", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+	FrameGraph.AddPass({"Compute after draw", COMPUTE_QUEUE, {Read("B", FRAME_GRAPH_STAGE_COMPUTE_SHADER)}});
+
+	auto CompiledFrameGraph = FrameGraph.Compile();
+	CheckHazardsAreSynchronized(FrameGraph, CompiledFrameGraph);
+
+	/// Independent compute work joins the first submit, the semaphores synchronize the rest without barriers
+	REQUIRE(CompiledFrameGraph.Batches.size() == 3);
+	CHECK(CompiledFrameGraph.Batches[0].Steps[0].Passes == std::vector<uint32_t>{0, 2});
+	CHECK(CompiledFrameGraph.Batches[1].Steps[0].Passes == std::vector<uint32_t>{1});
+	CHECK(CompiledFrameGraph.Batches[2].Steps[0].Passes == std::vector<uint32_t>{3});
+	CHECK(CompiledFrameGraph.GetBarrierCount() == 0);
+}
+
+TEST_CASE( "Frame graph resource lifetimes", "[FrameGraph]")
+{
+	auto FrameGraph = CreateRendererFrameGraph(3, false);
+	auto CompiledFrameGraph = FrameGraph.Compile();
+	auto PassOrder = CompiledFrameGraph.GetPassOrder();
+	auto& Passes = FrameGraph.GetPasses();
+
+	for (auto& [Resource, Lifetime] : CompiledFrameGraph.ResourceLifetimes)
+	{
+		REQUIRE(Lifetime.FirstPass <= Lifetime.LastPass);
+
+		for (uint32_t i = 0; i < PassOrder.size(); ++i)
+		{
+			auto& Accesses = Passes[PassOrder[i]].Accesses;
+			bool bUsed = std::any_of(Accesses.begin(), Accesses.end(), [&Resource = Resource](const FFrameGraphResourceAccess& Access){return Access.Resource == Resource;});
+
+			if (i < Lifetime.FirstPass || i > Lifetime.LastPass)
+			{
+				CHECK_FALSE(bUsed);
+			}
+			else if (i == Lifetime.FirstPass || i == Lifetime.LastPass)
+			{
+				CHECK(bUsed);
+			}
+		}
+	}
+
+	/// The sort only needs its buffers during the bounces, while the output image is only used at the very end
+	auto& Chunks = CompiledFrameGraph.ResourceLifetimes.at("CountedMaterialsPerChunk");
+	auto& Output = CompiledFrameGraph.ResourceLifetimes.at("OutputImage");
+	CHECK(Chunks.LastPass < Output.FirstPass);
+	CHECK(Output.FirstPass == Output.LastPass);
+	CHECK(Output.LastPass == PassOrder.size() - 1);
+}
+
+TEST_CASE( "Frame graph barriers and submits", "[.Benchmark]")
+{
+	for (uint32_t RecursionDepth : {1, 4, 7, 16})
+	{
+		auto FrameGraph = CreateRendererFrameGraph(RecursionDepth, false);
+		auto CompiledFrameGraph = FrameGraph.Compile();
+
+		uint32_t StepsCount = 0;
+
+		for (auto& Batch : CompiledFrameGraph.Batches)
+		{
+			StepsCount += Batch.Steps.size();
+		}
+
+		/// Before the frame graph every pass was submitted on its own
+		WARN("Recursion depth " << RecursionDepth << ": " << FrameGraph.GetPasses().size() << " passes, " << StepsCount << " steps, "
+			<< CompiledFrameGraph.GetBarrierCount() << " barriers, " << CompiledFrameGraph.Batches.size() << " submits instead of " << FrameGraph.GetPasses().size());
+
+		BENCHMARK("Compile frame graph of recursion depth " + std::to_string(RecursionDepth))
+		{
+			return FrameGraph.Compile();
+		};
+	}
+}
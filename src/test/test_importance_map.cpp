@@ -0,0 +1,462 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "maths.h"
+#include "vk_utils.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+/// Read by the shader code of the hierarchical sampling below, like the buffer of the master shader
+static std::vector<float> IBLImportanceBuffer;
+
+#include "ibl_sampling.h"
+
+namespace
+{
+	/// Probability of every entry to be picked by the shader: its own part of its cell, plus the parts of the cells that alias it
+	std::vector<double> CalculateTableDistribution(const std::vector<FAliasTableEntry>& AliasTable)
+	{
+		std::vector<double> Distribution(AliasTable.size(), 0.);
+		double CellProbability = 1. / double(AliasTable.size());
+
+		for (uint32_t i = 0; i < AliasTable.size(); ++i)
+		{
+			Distribution[i] += AliasTable[i].Threshold * CellProbability;
+			Distribution[AliasTable[i].Alias] += (1. - AliasTable[i].Threshold) * CellProbability;
+		}
+
+		return Distribution;
+	}
+
+	/// Same sampling as in the IBL importance sampling of the shader
+	uint32_t SampleAliasTable(const std::vector<FAliasTableEntry>& AliasTable, std::mt19937& Generator)
+	{
+		uint32_t Index = std::uniform_int_distribution<uint32_t>(0, AliasTable.size() - 1)(Generator);
+
+		if (std::uniform_real_distribution<float>(0.f, 1.f)(Generator) > AliasTable[Index].Threshold)
+		{
+			Index = AliasTable[Index].Alias;
+		}
+
+		return Index;
+	}
+
+	/// Pearson's chi-square test of the histogram of samples against the expected distribution, at 0.1% significance.
+	/// Bins expecting less than 5 samples are merged into one
+	void CheckChiSquare(const std::vector<uint32_t>& Histogram, const std::vector<double>& Expected, uint32_t SamplesCount)
+	{
+		double ChiSquare = 0.;
+		uint32_t Bins = 0;
+		double MergedExpected = 0.;
+		double MergedObserved = 0.;
+
+		for (uint32_t i = 0; i < Histogram.size(); ++i)
+		{
+			double ExpectedCount = Expected[i] * SamplesCount;
+
+			if (Expected[i] == 0.)
+			{
+				/// Entries with nothing in them must never be picked
+				CHECK(Histogram[i] == 0);
+			}
+			else if (ExpectedCount < 5.)
+			{
+				MergedExpected += ExpectedCount;
+				MergedObserved += Histogram[i];
+			}
+			else
+			{
+				ChiSquare += (Histogram[i] - ExpectedCount) * (Histogram[i] - ExpectedCount) / ExpectedCount;
+				Bins++;
+			}
+		}
+
+		if (MergedExpected >= 5.)
+		{
+			ChiSquare += (MergedObserved - MergedExpected) * (MergedObserved - MergedExpected) / MergedExpected;
+			Bins++;
+		}
+
+		REQUIRE(Bins > 1);
+
+		/// Wilson-Hilferty approximation of the critical value
+		double DegreesOfFreedom = Bins - 1;
+		double CriticalValue = DegreesOfFreedom * std::pow(1. - 2. / (9. * DegreesOfFreedom) + 3.09 * std::sqrt(2. / (9. * DegreesOfFreedom)), 3.);
+		CHECK(ChiSquare < CriticalValue);
+	}
+
+	void CheckAliasTable(const std::vector<FAliasTableEntry>& AliasTable, const std::vector<float>& PDF, const std::vector<double>& ExpectedPDF)
+	{
+		REQUIRE(AliasTable.size() == ExpectedPDF.size());
+		REQUIRE(PDF.size() == ExpectedPDF.size());
+
+		auto TableDistribution = CalculateTableDistribution(AliasTable);
+
+		for (uint32_t i = 0; i < AliasTable.size(); ++i)
+		{
+			CHECK(AliasTable[i].Threshold >= 0.f);
+			CHECK(AliasTable[i].Threshold <= 1.f);
+			CHECK(AliasTable[i].Alias < AliasTable.size());
+			CHECK(std::abs(PDF[i] - ExpectedPDF[i]) <= 1e-4 * ExpectedPDF[i] + 1e-12);
+			/// The table picks entries with the probabilities the shader weights them with
+			CHECK(std::abs(TableDistribution[i] - ExpectedPDF[i]) <= 1e-4 * ExpectedPDF[i] + 1e-9);
+		}
+	}
+
+	std::vector<double> Normalize(std::vector<double> Values)
+	{
+		double Sum = 0.;
+
+		for (auto Value : Values)
+		{
+			Sum += Value;
+		}
+
+		for (auto& Value : Values)
+		{
+			Value /= Sum;
+		}
+
+		return Values;
+	}
+
+	float Luminance(FVector4 Color)
+	{
+		return 0.2126f * Color.x + 0.7152f * Color.y + 0.0722f * Color.z;
+	}
+
+	/// Latitude-longitude sky: a gradient from the zenith to the horizon, a dark ground and a small bright sun
+	std::vector<FVector4> CreateLatLongSky(uint32_t Width, uint32_t Height)
+	{
+		std::vector<FVector4> Sky(Width * Height);
+
+		for (uint32_t h = 0; h < Height; ++h)
+		{
+			float Theta = (h + 0.5f) * M_PI / Height;
+
+			for (uint32_t w = 0; w < Width; ++w)
+			{
+				float Phi = (w + 0.5f) * 2.f * M_PI / Width;
+				float SunDistance = std::sqrt((Theta - 0.7f) * (Theta - 0.7f) + (Phi - 2.f) * (Phi - 2.f));
+
+				if (SunDistance < 0.05f)
+				{
+					Sky[h * Width + w] = FVector4(5000.f, 4500.f, 4000.f, 1.f);
+				}
+				else if (Theta < M_PI * 0.5f)
+				{
+					float Gradient = 0.5f + 0.5f * std::cos(Theta);
+					Sky[h * Width + w] = FVector4(0.3f * Gradient, 0.5f * Gradient, Gradient, 1.f);
+				}
+				else
+				{
+					Sky[h * Width + w] = FVector4(0.1f, 0.08f, 0.05f, 1.f);
+				}
+			}
+		}
+
+		return Sky;
+	}
+
+	/// Texel probabilities of the hierarchical map in IBLImportanceBuffer, computed by the same code the shader runs.
+	/// The CDFs are float, so probabilities taken from their differences are off by a couple of float epsilons of the row or column probability
+	void CheckHierarchicalMap(uint32_t Width, uint32_t Height, const std::vector<double>& ExpectedPDF)
+	{
+		REQUIRE(IBLImportanceBuffer.size() == Height + Width * Height);
+
+		double Sum = 0.;
+
+		for (uint32_t Row = 0; Row < Height; ++Row)
+		{
+			double RowProbability = 0.;
+
+			for (uint32_t Column = 0; Column < Width; ++Column)
+			{
+				RowProbability += ExpectedPDF[Row * Width + Column];
+			}
+
+			for (uint32_t Column = 0; Column < Width; ++Column)
+			{
+				uint32_t Texel = Row * Width + Column;
+				double Probability = GetIBLTexelProbabilityHierarchical(Texel, Width, Height);
+				double ColumnProbability = RowProbability > 0. ? ExpectedPDF[Texel] / RowProbability : 0.;
+				CHECK(std::abs(Probability - ExpectedPDF[Texel]) <= 1e-5 * ExpectedPDF[Texel] + 2.5e-7 * (RowProbability + ColumnProbability));
+				Sum += Probability;
+			}
+		}
+
+		CHECK(std::abs(Sum - 1.) < 1e-5);
+	}
+
+	/// Samples the hierarchical map the way the shader does, and checks that the UV stays in the picked texel
+	uint32_t SampleHierarchicalMap(uint32_t Width, uint32_t Height, std::mt19937& Generator)
+	{
+		std::uniform_real_distribution<float> Distribution(0.f, 1.f);
+		FIBLSample Sample = SampleIBLHierarchical(FVector2(Distribution(Generator), Distribution(Generator)), Width, Height);
+
+		uint32_t Column = uint32_t(Sample.UV.x * Width);
+		uint32_t Row = uint32_t(Sample.UV.y * Height);
+
+		if (Row * Width + Column != Sample.TexelIndex)
+		{
+			FAIL("Sample UV " << Sample.UV.x << ", " << Sample.UV.y << " is outside of texel " << Sample.TexelIndex);
+		}
+
+		return Sample.TexelIndex;
+	}
+
+	/// Lat-long map weighted by the solid angle every row covers
+	std::vector<double> CalculateLatLongPDF(const std::vector<FVector4>& Map, uint32_t Width, uint32_t Height)
+	{
+		std::vector<double> PDF(Width * Height);
+
+		for (uint32_t h = 0; h < Height; ++h)
+		{
+			for (uint32_t w = 0; w < Width; ++w)
+			{
+				PDF[h * Width + w] = Luminance(Map[h * Width + w]) * std::sin((h + 0.5) * M_PI / Height);
+			}
+		}
+
+		return Normalize(PDF);
+	}
+}
+
+TEST_CASE( "Importance map of random values", "[ImportanceMap]")
+{
+	std::mt19937 Generator(17);
+	const uint32_t SamplesCount = 2000000;
+
+	std::vector<std::function<float()>> Distributions = {
+		[&]() { return std::uniform_real_distribution<float>(0.f, 1.f)(Generator); },
+		/// Mostly black, like a few lights that are turned off
+		[&]() { return std::uniform_real_distribution<float>(0.f, 1.f)(Generator) < 0.9f ? 0.f : std::exponential_distribution<float>(1.f)(Generator); },
+		/// Huge dynamic range
+		[&]() { return std::lognormal_distribution<float>(0.f, 3.f)(Generator); },
+	};
+
+	for (auto& Distribution : Distributions)
+	{
+		for (uint32_t Count : {1u, 7u, 1000u})
+		{
+			std::vector<float> Values(Count);
+			std::vector<double> ExpectedPDF(Count);
+
+			for (uint32_t i = 0; i < Count; ++i)
+			{
+				Values[i] = Distribution();
+				ExpectedPDF[i] = Values[i];
+			}
+
+			/// Make sure at least one value is lit
+			Values[0] = ExpectedPDF[0] = 1.f;
+			ExpectedPDF = Normalize(ExpectedPDF);
+
+			auto [AliasTable, PDF] = GenerateImportanceMapFast<float>(Values.data(), Count, 1, [](float Value){return double(Value);});
+			CheckAliasTable(AliasTable, PDF, ExpectedPDF);
+
+			std::vector<uint32_t> Histogram(Count, 0);
+
+			for (uint32_t i = 0; i < SamplesCount; ++i)
+			{
+				Histogram[SampleAliasTable(AliasTable, Generator)]++;
+			}
+
+			if (Count > 1)
+			{
+				CheckChiSquare(Histogram, ExpectedPDF, SamplesCount);
+			}
+		}
+	}
+}
+
+TEST_CASE( "Importance map edge cases", "[ImportanceMap]")
+{
+	/// Black map falls back to a single entry
+	std::vector<float> Black(64, 0.f);
+	auto [BlackAliasTable, BlackPDF] = GenerateImportanceMapFast<float>(Black.data(), 8, 8, [](float Value){return double(Value);});
+	CHECK(BlackAliasTable.size() == 1);
+	CHECK(BlackPDF.size() == 1);
+
+	/// Nothing to build a table of
+	auto [EmptyAliasTable, EmptyPDF] = GenerateImportanceMapFast<float>(nullptr, 0, 1, [](float Value){return double(Value);});
+	CHECK(EmptyAliasTable.size() == 1);
+
+	/// Equal values never alias
+	std::vector<float> Uniform(100, 2.f);
+	auto [UniformAliasTable, UniformPDF] = GenerateImportanceMapFast<float>(Uniform.data(), 100, 1, [](float Value){return double(Value);});
+
+	for (uint32_t i = 0; i < 100; ++i)
+	{
+		CHECK(UniformAliasTable[i].Threshold == 1.f);
+		CHECK(UniformAliasTable[i].Alias == i);
+		CHECK(UniformPDF[i] == 0.01f);
+	}
+
+	/// Negative and NaN values are never sampled
+	std::vector<float> Broken = {1.f, -1.f, std::nanf(""), 3.f};
+	auto [BrokenAliasTable, BrokenPDF] = GenerateImportanceMapFast<float>(Broken.data(), 4, 1, [](float Value){return double(Value);});
+	CheckAliasTable(BrokenAliasTable, BrokenPDF, {0.25, 0., 0., 0.75});
+}
+
+TEST_CASE( "Importance map of a latitude-longitude sky", "[ImportanceMap]")
+{
+	const uint32_t Width = 512;
+	const uint32_t Height = 256;
+	auto Sky = CreateLatLongSky(Width, Height);
+	auto ExpectedPDF = CalculateLatLongPDF(Sky, Width, Height);
+
+	/// Sample tiles of 16x16 texels, single texels don't get enough samples
+	const uint32_t TileSize = 16;
+	const uint32_t TilesX = Width / TileSize;
+	const uint32_t SamplesCount = 4000000;
+	std::vector<double> ExpectedTiles((Width / TileSize) * (Height / TileSize), 0.);
+
+	auto GetTile = [&](uint32_t Texel)
+	{
+		return (Texel / Width / TileSize) * TilesX + (Texel % Width) / TileSize;
+	};
+
+	for (uint32_t i = 0; i < ExpectedPDF.size(); ++i)
+	{
+		ExpectedTiles[GetTile(i)] += ExpectedPDF[i];
+	}
+
+	SECTION("Alias table")
+	{
+		auto [AliasTable, PDF] = GenerateImportanceMapFast<FVector4, true>(Sky.data(), Width, Height, [](FVector4 Color){return Luminance(Color);});
+		CheckAliasTable(AliasTable, PDF, ExpectedPDF);
+
+		std::mt19937 Generator(23);
+		std::vector<uint32_t> Histogram(ExpectedTiles.size(), 0);
+
+		for (uint32_t i = 0; i < SamplesCount; ++i)
+		{
+			Histogram[GetTile(SampleAliasTable(AliasTable, Generator))]++;
+		}
+
+		CheckChiSquare(Histogram, ExpectedTiles, SamplesCount);
+	}
+
+	SECTION("Hierarchical")
+	{
+		IBLImportanceBuffer = GenerateHierarchicalImportanceMap<FVector4, true>(Sky.data(), Width, Height, [](FVector4 Color){return Luminance(Color);});
+		CheckHierarchicalMap(Width, Height, ExpectedPDF);
+
+		std::mt19937 Generator(23);
+		std::vector<uint32_t> Histogram(ExpectedTiles.size(), 0);
+
+		for (uint32_t i = 0; i < SamplesCount; ++i)
+		{
+			Histogram[GetTile(SampleHierarchicalMap(Width, Height, Generator))]++;
+		}
+
+		CheckChiSquare(Histogram, ExpectedTiles, SamplesCount);
+	}
+}
+
+TEST_CASE( "Importance map sine weighting", "[ImportanceMap]")
+{
+	const uint32_t Width = 16;
+	const uint32_t Height = 8;
+	std::vector<float> White(Width * Height, 1.f);
+
+	/// Texels near the poles cover less of the sphere
+	auto [SineWeightedAliasTable, SineWeightedPDF] = GenerateImportanceMapFast<float, true>(White.data(), Width, Height, [](float Value){return double(Value);});
+	CHECK(SineWeightedPDF[0] < SineWeightedPDF[(Height / 2) * Width]);
+	CHECK(std::abs(SineWeightedPDF[0] / SineWeightedPDF[(Height / 2) * Width] - std::sin(0.5 * M_PI / Height) / std::sin((Height / 2 + 0.5) * M_PI / Height)) < 1e-5);
+	CHECK(SineWeightedPDF[0] == SineWeightedPDF[(Height - 1) * Width]);
+
+	/// Everything else is weighted by the value only
+	auto [AliasTable, PDF] = GenerateImportanceMapFast<float>(White.data(), Width, Height, [](float Value){return double(Value);});
+
+	for (auto Value : PDF)
+	{
+		CHECK(Value == 1.f / (Width * Height));
+	}
+}
+
+TEST_CASE( "Hierarchical importance map of random values", "[ImportanceMap]")
+{
+	std::mt19937 Generator(29);
+	std::lognormal_distribution<float> Distribution(0.f, 2.f);
+	const uint32_t SamplesCount = 2000000;
+
+	for (auto [Width, Height] : {std::pair<uint32_t, uint32_t>{1, 1}, {7, 5}, {64, 32}, {1, 300}})
+	{
+		std::vector<float> Values(Width * Height);
+		std::vector<double> ExpectedPDF(Width * Height);
+
+		for (uint32_t i = 0; i < Values.size(); ++i)
+		{
+			/// Every third row is black
+			Values[i] = (i / Width) % 3 == 1 ? 0.f : Distribution(Generator);
+			ExpectedPDF[i] = Values[i];
+		}
+
+		Values[0] = ExpectedPDF[0] = 1.f;
+		ExpectedPDF = Normalize(ExpectedPDF);
+
+		IBLImportanceBuffer = GenerateHierarchicalImportanceMap<float>(Values.data(), Width, Height, [](float Value){return double(Value);});
+		CheckHierarchicalMap(Width, Height, ExpectedPDF);
+
+		std::vector<uint32_t> Histogram(Width * Height, 0);
+
+		for (uint32_t i = 0; i < SamplesCount; ++i)
+		{
+			Histogram[SampleHierarchicalMap(Width, Height, Generator)]++;
+		}
+
+		if (Width * Height > 1)
+		{
+			CheckChiSquare(Histogram, ExpectedPDF, SamplesCount);
+		}
+	}
+
+	/// Black map is sampled uniformly, rather than not at all
+	std::vector<float> Black(8 * 4, 0.f);
+	IBLImportanceBuffer = GenerateHierarchicalImportanceMap<float>(Black.data(), 8, 4, [](float Value){return double(Value);});
+	CheckHierarchicalMap(8, 4, std::vector<double>(32, 1. / 32.));
+
+	/// Nothing to build CDFs of
+	IBLImportanceBuffer = GenerateHierarchicalImportanceMap<float>(nullptr, 8, 0, [](float Value){return double(Value);});
+	CheckHierarchicalMap(1, 1, {1.});
+	IBLImportanceBuffer = GenerateHierarchicalImportanceMap<float>(nullptr, 0, 4, [](float Value){return double(Value);});
+	CheckHierarchicalMap(1, 1, {1.});
+}
+
+TEST_CASE( "Importance map generation", "[.Benchmark]")
+{
+	std::mt19937 Generator(42);
+	std::lognormal_distribution<float> Distribution(0.f, 2.f);
+
+	for (uint32_t Width : {2048u, 4096u, 8192u})
+	{
+		uint32_t Height = Width / 2;
+		std::vector<FVector4> Map(Width * Height);
+
+		for (auto& Texel : Map)
+		{
+			Texel = FVector4(Distribution(Generator), Distribution(Generator), Distribution(Generator), 1.f);
+		}
+
+		std::string MapName = std::to_string(Width) + "x" + std::to_string(Height);
+
+		/// Alias table and the probability of every texel, against the CDFs which give both
+		WARN(MapName << " alias table: " << (sizeof(FAliasTableEntry) + sizeof(float)) * Width * Height / (1024 * 1024) << " MB, hierarchical: "
+			<< sizeof(float) * (Height + Width * Height) / (1024 * 1024) << " MB");
+
+		BENCHMARK(MapName + " alias table")
+		{
+			return GenerateImportanceMapFast<FVector4, true>(Map.data(), Width, Height, [](FVector4 Color){return Luminance(Color);});
+		};
+
+		BENCHMARK(MapName + " hierarchical")
+		{
+			return GenerateHierarchicalImportanceMap<FVector4, true>(Map.data(), Width, Height, [](FVector4 Color){return Luminance(Color);});
+		};
+	}
+}
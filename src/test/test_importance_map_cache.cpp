@@ -0,0 +1,320 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "importance_map_cache.h"
+#include "maths.h"
+#include "test_utils.h"
+#include "vk_utils.h"
+
+#include "tinyexr.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	/// Tables the way CreateEXRImageFromFile builds them
+	struct FImportanceTables
+	{
+		std::vector<char> Importance;
+		std::vector<char> PDF;
+	};
+
+	template <typename T>
+	std::vector<char> ToBytes(const std::vector<T>& Values)
+	{
+		std::vector<char> Bytes(Values.size() * sizeof(T));
+		std::memcpy(Bytes.data(), Values.data(), Bytes.size());
+		return Bytes;
+	}
+
+	FImportanceTables BuildTables(std::vector<FVector4>& Pixels, uint32_t Width, uint32_t Height, EIBLSamplingMode SamplingMode)
+	{
+		auto Luminance = [](FVector4 Val){return 0.2126 * Val.x+ 0.7152 * Val.y + 0.0722 * Val.z;};
+
+		if (SamplingMode == EIBLSamplingMode::Hierarchical)
+		{
+			return {ToBytes(GenerateHierarchicalImportanceMap<FVector4, true>(Pixels.data(), Width, Height, Luminance)), ToBytes(std::vector<float>{0.f})};
+		}
+
+		auto [AliasTable, PDF] = GenerateImportanceMapFast<FVector4, true>(Pixels.data(), Width, Height, Luminance);
+		return {ToBytes(AliasTable), ToBytes(PDF)};
+	}
+
+	std::vector<FVector4> CreateRandomImage(uint32_t Width, uint32_t Height, uint32_t Seed)
+	{
+		std::mt19937 Generator(Seed);
+		std::exponential_distribution<float> Distribution(1.f);
+		std::vector<FVector4> Pixels(Width * Height);
+
+		for (auto& Pixel : Pixels)
+		{
+			Pixel = {Distribution(Generator), Distribution(Generator), Distribution(Generator), 1.f};
+		}
+
+		return Pixels;
+	}
+
+	FImportanceMapCacheKey CreateKey(const std::vector<FVector4>& Pixels, uint32_t Width, uint32_t Height, EIBLSamplingMode SamplingMode)
+	{
+		return {ComputeContentHash(Pixels.data(), Pixels.size() * sizeof(FVector4)), Width, Height, uint32_t(SamplingMode), 1};
+	}
+
+	bool Store(FImportanceMapCache& Cache, const std::string& SourcePath, const FImportanceMapCacheKey& Key, const FImportanceTables& Tables)
+	{
+		return Cache.Store(SourcePath, Key, Tables.Importance.data(), Tables.Importance.size(), Tables.PDF.data(), Tables.PDF.size());
+	}
+
+	bool IsEqual(const FImportanceMapCacheEntry& Entry, const FImportanceTables& Tables)
+	{
+		return Entry.GetImportanceSize() == Tables.Importance.size() && Entry.GetPDFSize() == Tables.PDF.size() &&
+			std::memcmp(Entry.GetImportanceData(), Tables.Importance.data(), Tables.Importance.size()) == 0 &&
+			std::memcmp(Entry.GetPDFData(), Tables.PDF.data(), Tables.PDF.size()) == 0;
+	}
+}
+
+TEST_CASE("Content hash", "[ImportanceMap]")
+{
+	std::vector<char> Data(1000);
+	std::iota(Data.begin(), Data.end(), 0);
+
+	auto Hash = ComputeContentHash(Data.data(), Data.size());
+	CHECK(Hash == ComputeContentHash(Data.data(), Data.size()));
+
+	/// Every byte matters, the ones hashed in the lanes and the tail alike
+	for (size_t Index : {size_t(0), size_t(17), size_t(500), size_t(995), size_t(999)})
+	{
+		Data[Index] ^= 1;
+		CHECK(Hash != ComputeContentHash(Data.data(), Data.size()));
+		Data[Index] ^= 1;
+	}
+
+	/// So does the size, even when the extra bytes are zero
+	Data.push_back(0);
+	CHECK(Hash != ComputeContentHash(Data.data(), Data.size()));
+	CHECK(ComputeContentHash(Data.data(), 0) != ComputeContentHash(Data.data(), 1));
+}
+
+TEST_CASE("Importance map cache round trip", "[ImportanceMap]")
+{
+	FImportanceMapCache Cache(CreateTestDirectory("importance_map_cache_round_trip"));
+	const uint32_t Width = 67;
+	const uint32_t Height = 31;
+	auto Pixels = CreateRandomImage(Width, Height, 1);
+
+	for (auto SamplingMode : {EIBLSamplingMode::AliasTable, EIBLSamplingMode::Hierarchical})
+	{
+		auto Key = CreateKey(Pixels, Width, Height, SamplingMode);
+		auto Tables = BuildTables(Pixels, Width, Height, SamplingMode);
+
+		CHECK_FALSE(Cache.Load("sky.exr", Key));
+		REQUIRE(Store(Cache, "sky.exr", Key, Tables));
+
+		auto Entry = Cache.Load("sky.exr", Key);
+		REQUIRE(Entry);
+		CHECK(IsEqual(*Entry, Tables));
+
+		/// Moved entry keeps the mapping
+		FImportanceMapCacheEntry MovedEntry = std::move(*Entry);
+		CHECK(IsEqual(MovedEntry, Tables));
+	}
+
+	/// Both modes of one file have their own entries
+	CHECK(Cache.GetHitsCount() == 2);
+	CHECK(Cache.GetMissesCount() == 2);
+	CHECK(Cache.Load("sky.exr", CreateKey(Pixels, Width, Height, EIBLSamplingMode::AliasTable)));
+	CHECK(Cache.Load("sky.exr", CreateKey(Pixels, Width, Height, EIBLSamplingMode::Hierarchical)));
+
+	Cache.Clear();
+	CHECK_FALSE(Cache.Load("sky.exr", CreateKey(Pixels, Width, Height, EIBLSamplingMode::AliasTable)));
+}
+
+TEST_CASE("Importance map cache stale entries", "[ImportanceMap]")
+{
+	FImportanceMapCache Cache(CreateTestDirectory("importance_map_cache_stale"));
+	const uint32_t Width = 32;
+	const uint32_t Height = 16;
+	auto Pixels = CreateRandomImage(Width, Height, 2);
+	auto Key = CreateKey(Pixels, Width, Height, EIBLSamplingMode::AliasTable);
+	auto Tables = BuildTables(Pixels, Width, Height, EIBLSamplingMode::AliasTable);
+	auto EntryPath = Cache.GetEntryPath("sky.exr", Key);
+
+	auto EditedPixels = Pixels;
+	EditedPixels[100].x += 1.f;
+	auto EditedKey = CreateKey(EditedPixels, Width, Height, EIBLSamplingMode::AliasTable);
+	/// Same content hash, but the image is transposed
+	auto ResizedKey = Key;
+	ResizedKey.Width = Height;
+	ResizedKey.Height = Width;
+	auto UnweightedKey = Key;
+	UnweightedKey.bSineWeighted = 0;
+
+	/// The same file, so the same entry, but it was built from something else
+	for (auto& StaleKey : {EditedKey, ResizedKey, UnweightedKey})
+	{
+		REQUIRE(Store(Cache, "sky.exr", Key, Tables));
+		CHECK(Cache.GetEntryPath("sky.exr", StaleKey) == EntryPath);
+		CHECK_FALSE(Cache.Load("sky.exr", StaleKey));
+		CHECK_FALSE(std::filesystem::exists(EntryPath));
+	}
+
+	/// Rebuilt entry replaces the stale one
+	auto EditedTables = BuildTables(EditedPixels, Width, Height, EIBLSamplingMode::AliasTable);
+	REQUIRE(Store(Cache, "sky.exr", Key, Tables));
+	REQUIRE(Store(Cache, "sky.exr", EditedKey, EditedTables));
+	CHECK_FALSE(Cache.Load("sky.exr", Key));
+	REQUIRE(Store(Cache, "sky.exr", EditedKey, EditedTables));
+	auto Entry = Cache.Load("sky.exr", EditedKey);
+	REQUIRE(Entry);
+	CHECK(IsEqual(*Entry, EditedTables));
+
+	/// Another file with the same content has its own entry
+	CHECK(Cache.GetEntryPath("other_sky.exr", EditedKey) != EntryPath);
+	CHECK_FALSE(Cache.Load("other_sky.exr", EditedKey));
+	CHECK(Cache.Load("sky.exr", EditedKey));
+}
+
+TEST_CASE("Importance map cache corrupted entries", "[ImportanceMap]")
+{
+	FImportanceMapCache Cache(CreateTestDirectory("importance_map_cache_corrupted"));
+	const uint32_t Width = 32;
+	const uint32_t Height = 16;
+	auto Pixels = CreateRandomImage(Width, Height, 3);
+	auto Key = CreateKey(Pixels, Width, Height, EIBLSamplingMode::Hierarchical);
+	auto Tables = BuildTables(Pixels, Width, Height, EIBLSamplingMode::Hierarchical);
+	auto EntryPath = Cache.GetEntryPath("sky.exr", Key);
+
+	std::vector<std::function<void(uint64_t)>> Corruptions =
+	{
+		/// Truncated tables
+		[&](uint64_t FileSize){ std::filesystem::resize_file(EntryPath, FileSize - sizeof(float)); },
+		/// Truncated header
+		[&](uint64_t){ std::filesystem::resize_file(EntryPath, 20); },
+		[&](uint64_t){ std::filesystem::resize_file(EntryPath, 0); },
+		/// Flipped byte of the tables
+		[&](uint64_t FileSize)
+		{
+			std::fstream File(EntryPath, std::ios::in | std::ios::out | std::ios::binary);
+			File.seekg(FileSize - 10);
+			char Byte = char(File.get() ^ 0x5A);
+			File.seekp(FileSize - 10);
+			File.put(Byte);
+		},
+		/// Flipped byte of the header
+		[&](uint64_t)
+		{
+			std::fstream File(EntryPath, std::ios::in | std::ios::out | std::ios::binary);
+			File.seekp(2);
+			File.put(char(0x5A));
+		},
+		[&](uint64_t)
+		{
+			std::ofstream File(EntryPath, std::ios::out | std::ios::binary);
+			File << "Not an importance map";
+		}
+	};
+
+	for (auto& Corrupt : Corruptions)
+	{
+		REQUIRE(Store(Cache, "sky.exr", Key, Tables));
+		Corrupt(std::filesystem::file_size(EntryPath));
+
+		CHECK_FALSE(Cache.Load("sky.exr", Key));
+		CHECK_FALSE(std::filesystem::exists(EntryPath));
+	}
+
+	/// Rebuilt entry is used again
+	REQUIRE(Store(Cache, "sky.exr", Key, Tables));
+	auto Entry = Cache.Load("sky.exr", Key);
+	REQUIRE(Entry);
+	CHECK(IsEqual(*Entry, Tables));
+}
+
+TEST_CASE("Disabled importance map cache", "[ImportanceMap]")
+{
+	FImportanceMapCache Cache("");
+	const uint32_t Width = 8;
+	const uint32_t Height = 4;
+	auto Pixels = CreateRandomImage(Width, Height, 4);
+	auto Key = CreateKey(Pixels, Width, Height, EIBLSamplingMode::AliasTable);
+
+	CHECK_FALSE(Store(Cache, "sky.exr", Key, BuildTables(Pixels, Width, Height, EIBLSamplingMode::AliasTable)));
+	CHECK_FALSE(Cache.Load("sky.exr", Key));
+}
+
+TEST_CASE("Importance map cache startup", "[.Benchmark]")
+{
+	FImportanceMapCache Cache(CreateTestDirectory("importance_map_cache_startup"));
+
+	for (auto& File : std::filesystem::directory_iterator("../resources/"))
+	{
+		if (File.path().extension() != ".exr")
+		{
+			continue;
+		}
+
+		float* Out = nullptr;
+		int Width = 0;
+		int Height = 0;
+		const char* Err = nullptr;
+
+		if (LoadEXR(&Out, &Width, &Height, File.path().string().c_str(), &Err) != TINYEXR_SUCCESS)
+		{
+			FreeEXRErrorMessage(Err);
+			continue;
+		}
+
+		std::vector<FVector4> Pixels(Width * Height);
+		std::memcpy(Pixels.data(), Out, Pixels.size() * sizeof(FVector4));
+		free(Out);
+
+		for (auto SamplingMode : {EIBLSamplingMode::AliasTable, EIBLSamplingMode::Hierarchical})
+		{
+			/// Everything CreateEXRImageFromFile does on top of decoding the image
+			auto Startup = [&]()
+			{
+				auto Key = CreateKey(Pixels, Width, Height, SamplingMode);
+				auto Entry = Cache.Load(File.path().string(), Key);
+
+				if (Entry)
+				{
+					/// Touch every page, like the upload to the GPU does
+					uint64_t Sum = 0;
+					auto Bytes = static_cast<const unsigned char*>(Entry->GetImportanceData());
+
+					for (uint64_t i = 0; i < Entry->GetImportanceSize() + Entry->GetPDFSize(); i += 4096)
+					{
+						Sum += Bytes[i];
+					}
+
+					return Sum;
+				}
+
+				auto Tables = BuildTables(Pixels, Width, Height, SamplingMode);
+				Store(Cache, File.path().string(), Key, Tables);
+				return uint64_t(Tables.Importance.size());
+			};
+
+			std::string Name = File.path().filename().string() + " " + std::to_string(Width) + "x" + std::to_string(Height) +
+				(SamplingMode == EIBLSamplingMode::Hierarchical ? " hierarchical" : " alias table");
+
+			/// Clearing the cache only removes a file, which is nothing next to building the tables
+			BENCHMARK(Name + ", cold")
+			{
+				Cache.Clear();
+				return Startup();
+			};
+
+			BENCHMARK(Name + ", warm")
+			{
+				return Startup();
+			};
+		}
+	}
+}
@@ -0,0 +1,414 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "maths.h"
+#include "light_bvh_builder.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+/// Read by the shader code of the light BVH below, like the buffer of the master shader
+static std::vector<FLightBVHNode> LightBVHNodes;
+
+#include "light_bvh.h"
+
+namespace
+{
+	FVector3 RandomDirection(std::mt19937& Generator)
+	{
+		std::normal_distribution<float> Distribution;
+		FVector3 Direction;
+
+		do
+		{
+			Direction = {Distribution(Generator), Distribution(Generator), Distribution(Generator)};
+		} while (dot(Direction, Direction) < 1e-6f);
+
+		return normalize(Direction);
+	}
+
+	std::vector<FLightBounds> CreateRandomPointLights(uint32_t Count, uint32_t Seed)
+	{
+		std::mt19937 Generator(Seed);
+		std::uniform_real_distribution<float> Position(-10.f, 10.f);
+		std::exponential_distribution<float> Power(1.f);
+		std::vector<FLightBounds> Lights(Count);
+
+		for (auto& Light : Lights)
+		{
+			FPointLight PointLight;
+			PointLight.Position = {Position(Generator), Position(Generator), Position(Generator)};
+			PointLight.Power = Power(Generator);
+			Light = GetPointLightBounds(PointLight);
+		}
+
+		return Lights;
+	}
+
+	/// Lights that emit into a cone around their normal, like spot lights
+	std::vector<FLightBounds> CreateRandomSpotLights(uint32_t Count, uint32_t Seed)
+	{
+		std::mt19937 Generator(Seed);
+		std::uniform_real_distribution<float> Position(-10.f, 10.f);
+		std::uniform_real_distribution<float> Angle(0.05f, float(M_PI_2));
+		std::exponential_distribution<float> Power(1.f);
+		std::vector<FLightBounds> Lights(Count);
+
+		for (auto& Light : Lights)
+		{
+			Light.BoundsMin = {Position(Generator), Position(Generator), Position(Generator)};
+			Light.BoundsMax = Light.BoundsMin;
+			Light.Energy = Power(Generator);
+			Light.Axis = RandomDirection(Generator);
+			Light.CosThetaO = 1.f;
+			Light.CosThetaE = std::cos(Angle(Generator));
+		}
+
+		return Lights;
+	}
+
+	/// Leaf the trail of the light leads to
+	uint32_t FollowTrail(uint32_t LightIndex, uint32_t LightsCount, uint32_t& Depth)
+	{
+		uint32_t Trail = LightBVHNodes[LightIndex].Trail;
+		uint32_t NodeIndex = LightsCount == 1 ? 0 : LightsCount;
+		Depth = 0;
+
+		while (NodeIndex >= LightsCount && Depth <= LIGHT_BVH_MAX_DEPTH)
+		{
+			NodeIndex = (Trail & 1u) == 0 ? LightBVHNodes[NodeIndex].FirstChild : LightBVHNodes[NodeIndex].SecondChild;
+			Trail >>= 1u;
+			Depth++;
+		}
+
+		return NodeIndex;
+	}
+
+	bool Contains(const FLightBVHNode& Parent, const FLightBVHNode& Child)
+	{
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			if (Child.BoundsMin[Axis] < Parent.BoundsMin[Axis] || Child.BoundsMax[Axis] > Parent.BoundsMax[Axis])
+			{
+				return false;
+			}
+		}
+
+		/// Cone of the child fits into the cone of the parent, acos is imprecise around identical axes so the tolerance is loose
+		if (Parent.CosThetaO > -1.f)
+		{
+			float ThetaParent = std::acos(Parent.CosThetaO);
+			float ThetaChild = std::acos(Child.CosThetaO);
+			float ThetaD = std::acos(clamp(dot(Parent.Axis, Child.Axis), -1.f, 1.f));
+
+			if (ThetaD + ThetaChild > ThetaParent + 1e-3f)
+			{
+				return false;
+			}
+		}
+
+		return Child.CosThetaE >= Parent.CosThetaE;
+	}
+
+	/// Every light has a single leaf its trail leads to, and internal nodes bound their children
+	void CheckLightBVH(const std::vector<FLightBounds>& Lights)
+	{
+		LightBVHNodes = BuildLightBVH(Lights);
+		auto LightsCount = uint32_t(Lights.size());
+		REQUIRE(LightBVHNodes.size() == 2 * Lights.size() - 1);
+
+		for (uint32_t i = 0; i < LightsCount; ++i)
+		{
+			uint32_t Depth = 0;
+			CHECK(FollowTrail(i, LightsCount, Depth) == i);
+			CHECK(Depth <= LIGHT_BVH_MAX_DEPTH);
+			CHECK(LightBVHNodes[i].Energy == Lights[i].Energy);
+		}
+
+		std::vector<uint32_t> ParentsCount(LightBVHNodes.size(), 0);
+		double TotalEnergy = 0.;
+
+		for (auto& Light : Lights)
+		{
+			TotalEnergy += Light.Energy;
+		}
+
+		for (uint32_t i = LightsCount; i < LightBVHNodes.size(); ++i)
+		{
+			auto& Node = LightBVHNodes[i];
+			REQUIRE(Node.FirstChild < LightBVHNodes.size());
+			REQUIRE(Node.SecondChild < LightBVHNodes.size());
+			ParentsCount[Node.FirstChild]++;
+			ParentsCount[Node.SecondChild]++;
+
+			CHECK(Contains(Node, LightBVHNodes[Node.FirstChild]));
+			CHECK(Contains(Node, LightBVHNodes[Node.SecondChild]));
+			CHECK(std::abs(Node.Energy - LightBVHNodes[Node.FirstChild].Energy - LightBVHNodes[Node.SecondChild].Energy) <= 1e-5f * Node.Energy);
+		}
+
+		if (LightsCount > 1)
+		{
+			CHECK(std::abs(LightBVHNodes[LightsCount].Energy - TotalEnergy) <= 1e-4 * TotalEnergy);
+
+			/// Every node but the root has a single parent
+			for (uint32_t i = 0; i < ParentsCount.size(); ++i)
+			{
+				CHECK(ParentsCount[i] == (i == LightsCount ? 0u : 1u));
+			}
+		}
+	}
+
+	/// Whether the light can light the point at all: the point is above the surface and inside the emission cone of the light
+	bool CanLight(const FLightBounds& Light, const FVector3& Position, const FVector3& Normal)
+	{
+		FVector3 ToLight = Light.BoundsMin - Position;
+
+		if (dot(ToLight, Normal) <= 0.f)
+		{
+			return false;
+		}
+
+		if (Light.CosThetaO <= -1.f)
+		{
+			return true;
+		}
+
+		float CosTheta = dot(normalize(ToLight * -1.f), Light.Axis);
+		return std::acos(clamp(CosTheta, -1.f, 1.f)) < std::acos(Light.CosThetaO) + std::acos(Light.CosThetaE);
+	}
+
+	void CheckChiSquare(const std::vector<uint32_t>& Histogram, const std::vector<double>& Expected, uint32_t SamplesCount)
+	{
+		double ChiSquare = 0.;
+		uint32_t Bins = 0;
+		double MergedExpected = 0.;
+		double MergedObserved = 0.;
+
+		for (uint32_t i = 0; i < Histogram.size(); ++i)
+		{
+			double ExpectedCount = Expected[i] * SamplesCount;
+
+			if (Expected[i] == 0.)
+			{
+				CHECK(Histogram[i] == 0);
+			}
+			else if (ExpectedCount < 5.)
+			{
+				MergedExpected += ExpectedCount;
+				MergedObserved += Histogram[i];
+			}
+			else
+			{
+				ChiSquare += (Histogram[i] - ExpectedCount) * (Histogram[i] - ExpectedCount) / ExpectedCount;
+				Bins++;
+			}
+		}
+
+		if (MergedExpected >= 5.)
+		{
+			ChiSquare += (MergedObserved - MergedExpected) * (MergedObserved - MergedExpected) / MergedExpected;
+			Bins++;
+		}
+
+		if (Bins < 2)
+		{
+			return;
+		}
+
+		/// Wilson-Hilferty approximation of the critical value
+		double DegreesOfFreedom = Bins - 1;
+		double CriticalValue = DegreesOfFreedom * std::pow(1. - 2. / (9. * DegreesOfFreedom) + 3.09 * std::sqrt(2. / (9. * DegreesOfFreedom)), 3.);
+		CHECK(ChiSquare < CriticalValue);
+	}
+
+	/// Sampling picks lights with the probabilities given by evaluation for random shading points and never skips a light that can light the point
+	void CheckLightBVHProbabilities(const std::vector<FLightBounds>& Lights, uint32_t PointsCount, uint32_t SamplesCount, uint32_t Seed)
+	{
+		LightBVHNodes = BuildLightBVH(Lights);
+		auto LightsCount = uint32_t(Lights.size());
+		std::mt19937 Generator(Seed);
+		std::uniform_real_distribution<float> Position(-12.f, 12.f);
+		std::uniform_real_distribution<float> RandomValue(0.f, 1.f);
+
+		for (uint32_t Point = 0; Point < PointsCount; ++Point)
+		{
+			FVector3 ShadingPosition = {Position(Generator), Position(Generator), Position(Generator)};
+			FVector3 ShadingNormal = RandomDirection(Generator);
+
+			std::vector<double> Probabilities(LightsCount);
+			double ProbabilitiesSum = 0.;
+			bool bAnyLight = false;
+			bool bAllLights = true;
+
+			for (uint32_t i = 0; i < LightsCount; ++i)
+			{
+				Probabilities[i] = GetLightBVHProbability(i, ShadingPosition, ShadingNormal, LightsCount);
+				ProbabilitiesSum += Probabilities[i];
+
+				if (CanLight(Lights[i], ShadingPosition, ShadingNormal) && Lights[i].Energy > 0.f)
+				{
+					bAnyLight = true;
+					CHECK(Probabilities[i] > 0.);
+				}
+				else
+				{
+					bAllLights = false;
+				}
+			}
+
+			/// Bounds of internal nodes are looser than the ones of their children, so a walk might end in a node where none of the children can light the point.
+			/// It's the same for sampling and evaluation, it only loses some samples
+			CHECK(ProbabilitiesSum <= 1. + 1e-4);
+
+			if (bAnyLight)
+			{
+				CHECK(ProbabilitiesSum > 0.);
+			}
+
+			/// Nothing is lost if every light can light the point
+			if (bAllLights)
+			{
+				CHECK(std::abs(ProbabilitiesSum - 1.) < 1e-4);
+			}
+
+			std::vector<uint32_t> Histogram(LightsCount, 0);
+			uint32_t SampledCount = 0;
+
+			for (uint32_t i = 0; i < SamplesCount; ++i)
+			{
+				auto Sample = SampleLightBVH(RandomValue(Generator), ShadingPosition, ShadingNormal, LightsCount);
+
+				if (Sample.Probability == 0.f)
+				{
+					continue;
+				}
+
+				REQUIRE(Sample.LightIndex < LightsCount);
+				/// Evaluation repeats the same computations as sampling
+				CHECK(Sample.Probability == GetLightBVHProbability(Sample.LightIndex, ShadingPosition, ShadingNormal, LightsCount));
+				Histogram[Sample.LightIndex]++;
+				SampledCount++;
+			}
+
+			if (bAnyLight && LightsCount > 1)
+			{
+				/// Lost samples have a bin of their own
+				Histogram.push_back(SamplesCount - SampledCount);
+				Probabilities.push_back(std::max(1. - ProbabilitiesSum, 0.));
+				CheckChiSquare(Histogram, Probabilities, SamplesCount);
+			}
+		}
+	}
+}
+
+TEST_CASE("Light BVH structure", "[LightBVH]")
+{
+	for (uint32_t Count : {1u, 2u, 3u, 17u, 1000u})
+	{
+		CheckLightBVH(CreateRandomPointLights(Count, Count));
+		CheckLightBVH(CreateRandomSpotLights(Count, Count + 1));
+	}
+
+	/// Lights at the same place can only be split in halves
+	std::vector<FLightBounds> SamePosition(100, CreateRandomPointLights(1, 0)[0]);
+	CheckLightBVH(SamePosition);
+
+	/// Lights spread further and further apart make the heuristic split off a light at a time, the depth is still limited
+	std::vector<FLightBounds> Spread(300);
+
+	for (uint32_t i = 0; i < Spread.size(); ++i)
+	{
+		FPointLight PointLight;
+		PointLight.Position = {std::pow(1.2f, float(i)), 0.f, 0.f};
+		PointLight.Power = 1.f;
+		Spread[i] = GetPointLightBounds(PointLight);
+	}
+
+	CheckLightBVH(Spread);
+}
+
+TEST_CASE("Light BVH probabilities", "[LightBVH]")
+{
+	CheckLightBVHProbabilities(CreateRandomPointLights(1, 1), 20, 100, 1);
+	CheckLightBVHProbabilities(CreateRandomPointLights(2, 2), 20, 10000, 2);
+	CheckLightBVHProbabilities(CreateRandomPointLights(100, 3), 20, 100000, 3);
+	CheckLightBVHProbabilities(CreateRandomSpotLights(100, 4), 20, 100000, 4);
+
+	/// Lights without power are never picked
+	auto Lights = CreateRandomPointLights(50, 5);
+
+	for (uint32_t i = 0; i < Lights.size(); i += 3)
+	{
+		Lights[i].Energy = 0.f;
+	}
+
+	CheckLightBVHProbabilities(Lights, 20, 100000, 5);
+
+	/// Points facing up at lights that are all above them lose nothing on the way down, probabilities of all lights add up to one
+	auto Above = CreateRandomPointLights(1000, 6);
+
+	for (auto& Light : Above)
+	{
+		Light.BoundsMin += FVector3(0.f, 0.f, 30.f);
+		Light.BoundsMax += FVector3(0.f, 0.f, 30.f);
+	}
+
+	LightBVHNodes = BuildLightBVH(Above);
+	std::mt19937 Generator(6);
+	std::uniform_real_distribution<float> Position(-12.f, 12.f);
+
+	for (uint32_t Point = 0; Point < 20; ++Point)
+	{
+		FVector3 ShadingPosition = {Position(Generator), Position(Generator), Position(Generator)};
+		double ProbabilitiesSum = 0.;
+
+		for (uint32_t i = 0; i < Above.size(); ++i)
+		{
+			ProbabilitiesSum += GetLightBVHProbability(i, ShadingPosition, FVector3(0.f, 0.f, 1.f), uint32_t(Above.size()));
+		}
+
+		CHECK(std::abs(ProbabilitiesSum - 1.) < 1e-4);
+	}
+}
+
+TEST_CASE("Light BVH favors close lights", "[LightBVH]")
+{
+	/// Two clusters of equal power, the one next to the point gets most of the samples
+	std::vector<FLightBounds> Lights;
+	auto Near = CreateRandomPointLights(100, 6);
+	auto Far = CreateRandomPointLights(100, 7);
+
+	for (auto& Light : Far)
+	{
+		Light.BoundsMin += FVector3(1000.f, 0.f, 0.f);
+		Light.BoundsMax += FVector3(1000.f, 0.f, 0.f);
+	}
+
+	Lights.insert(Lights.end(), Near.begin(), Near.end());
+	Lights.insert(Lights.end(), Far.begin(), Far.end());
+	LightBVHNodes = BuildLightBVH(Lights);
+
+	double NearProbability = 0.;
+
+	for (uint32_t i = 0; i < Near.size(); ++i)
+	{
+		NearProbability += GetLightBVHProbability(i, {0.f, 0.f, 30.f}, {0.f, 0.f, -1.f}, uint32_t(Lights.size()));
+	}
+
+	CHECK(NearProbability > 0.99);
+}
+
+TEST_CASE("Light BVH build", "[.Benchmark]")
+{
+	for (uint32_t Count : {10000u, 100000u, 1000000u})
+	{
+		auto Lights = CreateRandomPointLights(Count, Count);
+
+		BENCHMARK("Build BVH of " + std::to_string(Count) + " point lights")
+		{
+			return BuildLightBVH(Lights);
+		};
+	}
+}
@@ -0,0 +1,566 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "memory_pool.h"
+#include "ring_allocator.h"
+#include "suballocator.h"
+#include "transfer_chunks.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+/// Number of random allocations and frees done by the suballocator stress test
+const uint32_t SuballocatorStressIterations = 1000 * 1000;
+
+struct FTestAllocation
+{
+	uint64_t Offset;
+	uint64_t Size;
+};
+
+/// Do random allocations and frees, returns live allocations
+std::vector<FTestAllocation> RandomAllocationsAndFrees(FSuballocator& Suballocator, uint32_t Iterations, std::mt19937& RNG)
+{
+	std::uniform_int_distribution<uint64_t> SizeDistribution(1, 4096);
+	std::uniform_int_distribution<uint32_t> AlignmentDistribution(0, 8);
+	std::bernoulli_distribution ShouldAllocate(0.5);
+	std::vector<FTestAllocation> Allocations;
+
+	for (uint32_t i = 0; i < Iterations; ++i)
+	{
+		if (Allocations.empty() || ShouldAllocate(RNG))
+		{
+			uint64_t Size = SizeDistribution(RNG);
+			uint64_t Alignment = uint64_t(1) << AlignmentDistribution(RNG);
+			auto Offset = Suballocator.Allocate(Size, Alignment);
+
+			if (Offset)
+			{
+				Allocations.push_back({*Offset, Size});
+			}
+		}
+		else
+		{
+			std::uniform_int_distribution<size_t> IndexDistribution(0, Allocations.size() - 1);
+			size_t Index = IndexDistribution(RNG);
+			Suballocator.Free(Allocations[Index].Offset, Allocations[Index].Size);
+			Allocations[Index] = Allocations.back();
+			Allocations.pop_back();
+		}
+	}
+
+	return Allocations;
+}
+
+TEST_CASE( "Suballocator alignment", "[Memory]")
+{
+	FSuballocator Suballocator(1024);
+
+	auto A = Suballocator.Allocate(3);
+	auto B = Suballocator.Allocate(16, 256);
+	REQUIRE(A);
+	REQUIRE(B);
+	CHECK(*A == 0);
+	CHECK(*B == 256);
+	CHECK(Suballocator.GetUsedSize() == 19);
+
+	/// Padding in front of the aligned allocation stays free and can be used
+	auto C = Suballocator.Allocate(100);
+	REQUIRE(C);
+	CHECK(*C == 3);
+
+	/// Nothing fits
+	CHECK_FALSE(Suballocator.Allocate(1024));
+
+	Suballocator.Free(*B, 16);
+	Suballocator.Free(*A, 3);
+	Suballocator.Free(*C, 100);
+
+	CHECK(Suballocator.GetFreeBlocksCount() == 1);
+	CHECK(Suballocator.GetLargestFreeBlock() == 1024);
+	CHECK(Suballocator.GetAllocationsCount() == 0);
+}
+
+TEST_CASE( "Suballocator stress", "[Memory]")
+{
+	const uint64_t Size = 64 * 1024 * 1024;
+	FSuballocator Suballocator(Size);
+	std::mt19937 RNG(42);
+
+	auto Allocations = RandomAllocationsAndFrees(Suballocator, SuballocatorStressIterations, RNG);
+
+	/// Live allocations should not overlap and should stay inside the range
+	std::map<uint64_t, uint64_t> SortedAllocations;
+	uint64_t UsedSize = 0;
+
+	for (auto& Allocation : Allocations)
+	{
+		SortedAllocations[Allocation.Offset] = Allocation.Size;
+		UsedSize += Allocation.Size;
+	}
+
+	REQUIRE(SortedAllocations.size() == Allocations.size());
+	CHECK(Suballocator.GetUsedSize() == UsedSize);
+	CHECK(Suballocator.GetAllocationsCount() == Allocations.size());
+
+	uint64_t PreviousEnd = 0;
+
+	for (auto& [Offset, AllocationSize] : SortedAllocations)
+	{
+		CHECK(Offset >= PreviousEnd);
+		PreviousEnd = Offset + AllocationSize;
+	}
+
+	CHECK(PreviousEnd <= Size);
+
+	/// After everything is freed, all free blocks should be merged back into one
+	for (auto& Allocation : Allocations)
+	{
+		Suballocator.Free(Allocation.Offset, Allocation.Size);
+	}
+
+	CHECK(Suballocator.GetUsedSize() == 0);
+	CHECK(Suballocator.GetFreeBlocksCount() == 1);
+	CHECK(Suballocator.GetLargestFreeBlock() == Size);
+	CHECK(Suballocator.GetFragmentation() == 0.);
+}
+
+/// Block provider that doesn't allocate anything, only keeps track of live blocks
+class FFakeMemoryProvider : public IMemoryBlockProvider
+{
+public:
+	uint64_t AllocateBlock(uint32_t, uint64_t Size) override
+	{
+		if (TotalSize + Size > Capacity)
+		{
+			return 0;
+		}
+
+		TotalSize += Size;
+		TotalAllocationsCount++;
+		LiveBlocks[++LastHandle] = Size;
+		return LastHandle;
+	}
+
+	void FreeBlock(uint64_t Block) override
+	{
+		REQUIRE(LiveBlocks.find(Block) != LiveBlocks.end());
+		TotalSize -= LiveBlocks[Block];
+		LiveBlocks.erase(Block);
+	}
+
+	uint64_t Capacity = UINT64_MAX;
+	uint64_t TotalSize = 0;
+	uint32_t TotalAllocationsCount = 0;
+	uint64_t LastHandle = 0;
+	std::map<uint64_t, uint64_t> LiveBlocks;
+};
+
+TEST_CASE( "Memory pools placement", "[Memory]")
+{
+	const uint64_t BlockSize = 1024 * 1024;
+	FFakeMemoryProvider Provider;
+
+	{
+		FMemoryPools MemoryPools(&Provider, BlockSize, BlockSize / 2);
+
+		/// A thousand small resources share a single block
+		std::vector<FPoolAllocation> Allocations;
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			auto Allocation = MemoryPools.Allocate(0, 1000, 256);
+			REQUIRE(Allocation);
+			CHECK(Allocation->Offset % 256 == 0);
+			CHECK(!Allocation->bDedicated);
+			Allocations.push_back(*Allocation);
+		}
+
+		CHECK(Provider.LiveBlocks.size() == 1);
+
+		/// Different memory types never share blocks
+		auto OtherType = MemoryPools.Allocate(1, 1000, 256);
+		REQUIRE(OtherType);
+		CHECK(OtherType->Block != Allocations[0].Block);
+		CHECK(Provider.LiveBlocks.size() == 2);
+
+		/// Allocations that don't fit into the first block go to a new one
+		auto Big = MemoryPools.Allocate(0, BlockSize / 2, 4096);
+		REQUIRE(Big);
+		CHECK(Big->Block != Allocations[0].Block);
+		CHECK(Big->Offset % 4096 == 0);
+		CHECK(Provider.LiveBlocks.size() == 3);
+
+		/// Large resources get their own block
+		auto Dedicated = MemoryPools.Allocate(0, BlockSize / 2 + 1, 4096);
+		REQUIRE(Dedicated);
+		CHECK(Dedicated->bDedicated);
+		CHECK(Dedicated->Offset == 0);
+		CHECK(Provider.LiveBlocks[Dedicated->Block] == BlockSize / 2 + 1);
+
+		auto ExplicitlyDedicated = MemoryPools.Allocate(0, 16, 16, true);
+		REQUIRE(ExplicitlyDedicated);
+		CHECK(ExplicitlyDedicated->bDedicated);
+
+		auto Statistics = MemoryPools.GetStatistics(0);
+		CHECK(Statistics.AllocationsCount == 1003);
+		CHECK(Statistics.BlocksCount == 2);
+		CHECK(Statistics.DedicatedAllocationsCount == 2);
+		CHECK(Statistics.UsedSize == 1000 * 1000 + BlockSize / 2 + BlockSize / 2 + 1 + 16);
+		CHECK(Statistics.ReservedSize == 2 * BlockSize + BlockSize / 2 + 1 + 16);
+		CHECK(MemoryPools.GetTotalStatistics().AllocationsCount == 1004);
+
+		/// Live allocations inside a block should not overlap
+		std::map<uint64_t, uint64_t> SortedAllocations;
+
+		for (auto& Allocation : Allocations)
+		{
+			SortedAllocations[Allocation.Offset] = Allocation.Size;
+		}
+
+		uint64_t PreviousEnd = 0;
+
+		for (auto& [Offset, AllocationSize] : SortedAllocations)
+		{
+			CHECK(Offset >= PreviousEnd);
+			PreviousEnd = Offset + AllocationSize;
+		}
+
+		CHECK(PreviousEnd <= BlockSize);
+
+		/// Dedicated allocations are returned to the provider right away, empty blocks are released but the last one of the pool is kept
+		MemoryPools.Free(*Dedicated);
+		MemoryPools.Free(*ExplicitlyDedicated);
+		MemoryPools.Free(*Big);
+		CHECK(Provider.LiveBlocks.size() == 2);
+
+		for (auto& Allocation : Allocations)
+		{
+			MemoryPools.Free(Allocation);
+		}
+
+		MemoryPools.Free(*OtherType);
+		CHECK(Provider.LiveBlocks.size() == 2);
+		CHECK(MemoryPools.GetTotalStatistics().AllocationsCount == 0);
+		CHECK(MemoryPools.GetTotalStatistics().UsedSize == 0);
+	}
+
+	/// Pools return all the blocks when destroyed
+	CHECK(Provider.LiveBlocks.empty());
+	CHECK(Provider.TotalAllocationsCount == 5);
+}
+
+TEST_CASE( "Memory pools out of memory", "[Memory]")
+{
+	const uint64_t BlockSize = 1024 * 1024;
+	FFakeMemoryProvider Provider;
+	Provider.Capacity = BlockSize;
+	FMemoryPools MemoryPools(&Provider, BlockSize, BlockSize / 2);
+
+	auto A = MemoryPools.Allocate(0, BlockSize / 2, 1);
+	auto B = MemoryPools.Allocate(0, BlockSize / 2, 1);
+	REQUIRE(A);
+	REQUIRE(B);
+
+	/// The only block is full and the provider can't allocate another one
+	CHECK_FALSE(MemoryPools.Allocate(0, 1, 1));
+	CHECK_FALSE(MemoryPools.Allocate(0, BlockSize, 1));
+
+	MemoryPools.Free(*A);
+	auto C = MemoryPools.Allocate(0, 1024, 1024);
+	REQUIRE(C);
+	CHECK(C->Offset == 0);
+
+	MemoryPools.Free(*B);
+	MemoryPools.Free(*C);
+}
+
+TEST_CASE( "Memory pools outlived by resources", "[Memory]")
+{
+	const uint64_t BlockSize = 1024 * 1024;
+	FFakeMemoryProvider Provider;
+
+	{
+		FMemoryPools MemoryPools(&Provider, BlockSize, BlockSize / 2);
+		REQUIRE(MemoryPools.Allocate(0, 1024, 1));
+		REQUIRE(MemoryPools.Allocate(0, BlockSize, 1));
+		REQUIRE(MemoryPools.Allocate(1, 16, 16, true));
+		CHECK(Provider.LiveBlocks.size() == 3);
+	}
+
+	/// Resources that are never freed don't keep their blocks, dedicated ones included
+	CHECK(Provider.LiveBlocks.empty());
+}
+
+TEST_CASE( "Ring allocator wraparound", "[Memory]")
+{
+	FRingAllocator Ring(100);
+
+	auto A = Ring.Allocate(40);
+	auto B = Ring.Allocate(10, 16);
+	REQUIRE(A);
+	REQUIRE(B);
+	CHECK(*A == 0);
+	CHECK(*B == 48);
+	CHECK(Ring.GetUsedSize() == 58);
+	Ring.Submit(1);
+
+	auto C = Ring.Allocate(30);
+	REQUIRE(C);
+	CHECK(*C == 58);
+	Ring.Submit(2);
+
+	/// Only 12 bytes are left at the end and the beginning is still in use
+	CHECK_FALSE(Ring.Allocate(20));
+
+	/// Once the first batch is retired the allocation wraps around, skipping the end of the ring
+	Ring.Retire(1);
+	CHECK(Ring.GetUsedSize() == 30);
+	auto D = Ring.Allocate(20);
+	REQUIRE(D);
+	CHECK(*D == 0);
+	CHECK(Ring.GetUsedSize() == 62);
+
+	/// Free space between the head and the oldest live allocation
+	auto E = Ring.Allocate(38);
+	REQUIRE(E);
+	CHECK(*E == 20);
+	CHECK_FALSE(Ring.Allocate(1));
+	Ring.Submit(3);
+
+	Ring.Retire(3);
+	CHECK(Ring.GetUsedSize() == 0);
+	CHECK(Ring.GetBatchesInFlightCount() == 0);
+
+	/// Empty ring starts from the beginning
+	auto F = Ring.Allocate(100);
+	REQUIRE(F);
+	CHECK(*F == 0);
+}
+
+TEST_CASE( "Ring allocator fence retirement", "[Memory]")
+{
+	FRingAllocator Ring(1024);
+
+	for (uint64_t FenceValue = 1; FenceValue <= 4; ++FenceValue)
+	{
+		REQUIRE(Ring.Allocate(200));
+		Ring.Submit(FenceValue);
+	}
+
+	/// Submitting with no allocations doesn't create a batch
+	Ring.Submit(5);
+	CHECK(Ring.GetBatchesInFlightCount() == 4);
+	CHECK(*Ring.GetOldestFenceValue() == 1);
+
+	/// Unsubmitted allocations are never retired
+	REQUIRE(Ring.Allocate(100));
+	CHECK(Ring.HasPendingAllocations());
+
+	Ring.Retire(2);
+	CHECK(Ring.GetBatchesInFlightCount() == 2);
+	CHECK(*Ring.GetOldestFenceValue() == 3);
+	CHECK(Ring.GetUsedSize() == 500);
+
+	Ring.Retire(10);
+	CHECK(Ring.GetBatchesInFlightCount() == 0);
+	CHECK_FALSE(Ring.GetOldestFenceValue());
+	CHECK(Ring.GetUsedSize() == 100);
+
+	Ring.Submit(11);
+	Ring.Retire(11);
+	CHECK(Ring.GetUsedSize() == 0);
+}
+
+TEST_CASE( "Ring allocator oversize", "[Memory]")
+{
+	FRingAllocator Ring(1024);
+
+	/// Allocations bigger than the ring can never succeed, the caller has to use another path
+	CHECK_FALSE(Ring.Allocate(1025));
+	CHECK_FALSE(Ring.Allocate(0));
+	CHECK(Ring.GetUsedSize() == 0);
+
+	auto A = Ring.Allocate(1024);
+	REQUIRE(A);
+	CHECK(*A == 0);
+	CHECK_FALSE(Ring.Allocate(1));
+}
+
+TEST_CASE( "Ring allocator stress", "[Memory]")
+{
+	const uint64_t Size = 1024 * 1024;
+	FRingAllocator Ring(Size);
+	std::mt19937 RNG(42);
+	std::uniform_int_distribution<uint64_t> SizeDistribution(1, 16 * 1024);
+	uint64_t FenceValue = 0;
+	uint64_t CompletedFenceValue = 0;
+	/// (Fence value, Offset, Size) of every live allocation
+	std::vector<std::tuple<uint64_t, uint64_t, uint64_t>> LiveAllocations;
+
+	for (int i = 0; i < 100000; ++i)
+	{
+		uint64_t AllocationSize = SizeDistribution(RNG);
+		auto Offset = Ring.Allocate(AllocationSize, 16);
+
+		/// Emulate the GPU lagging a few submissions behind
+		if (!Offset)
+		{
+			Ring.Submit(++FenceValue);
+			CompletedFenceValue = FenceValue - std::min<uint64_t>(FenceValue, 2);
+			Ring.Retire(CompletedFenceValue);
+			LiveAllocations.erase(std::remove_if(LiveAllocations.begin(), LiveAllocations.end(), [&](auto& Allocation){ return std::get<0>(Allocation) <= CompletedFenceValue; }), LiveAllocations.end());
+			continue;
+		}
+
+		CHECK(*Offset % 16 == 0);
+		CHECK(*Offset + AllocationSize <= Size);
+
+		for (auto& [LiveFenceValue, LiveOffset, LiveSize] : LiveAllocations)
+		{
+			if (*Offset < LiveOffset + LiveSize && LiveOffset < *Offset + AllocationSize)
+			{
+				FAIL("Ring allocation overlaps a live allocation");
+			}
+		}
+
+		LiveAllocations.emplace_back(FenceValue + 1, *Offset, AllocationSize);
+
+		if (i % 8 == 0)
+		{
+			Ring.Submit(++FenceValue);
+		}
+	}
+}
+
+TEST_CASE( "Transfer chunks", "[Memory]")
+{
+	/// Size that is not a multiple of the chunk size
+	auto Chunks = SplitTransfer(1000, 24, 256);
+	REQUIRE(Chunks.size() == 4);
+
+	uint64_t TotalSize = 0;
+
+	for (uint32_t i = 0; i < Chunks.size(); ++i)
+	{
+		CHECK(Chunks[i].SourceOffset == 24 + i * 256);
+		CHECK(Chunks[i].DestinationOffset == i * 256);
+		CHECK(Chunks[i].StagingSlot == i % 2);
+		TotalSize += Chunks[i].Size;
+	}
+
+	CHECK(Chunks.back().Size == 1000 - 3 * 256);
+	CHECK(TotalSize == 1000);
+
+	/// Exact multiple doesn't produce an empty chunk
+	Chunks = SplitTransfer(1024, 0, 256);
+	REQUIRE(Chunks.size() == 4);
+	CHECK(Chunks.back().Size == 256);
+
+	/// Smaller than a single chunk
+	Chunks = SplitTransfer(100, 0, 256);
+	REQUIRE(Chunks.size() == 1);
+	CHECK(Chunks[0].Size == 100);
+	CHECK(Chunks[0].StagingSlot == 0);
+
+	CHECK(SplitTransfer(0, 0, 256).empty());
+}
+
+TEST_CASE( "Transfer chunks granularity", "[Memory]")
+{
+	/// Rows of 3 * 16 bytes, a chunk of 100 bytes can hold only two of them
+	const uint64_t RowSize = 3 * 16;
+	auto Chunks = SplitTransfer(RowSize * 7, 0, 100, RowSize, 3);
+	REQUIRE(Chunks.size() == 4);
+
+	for (uint32_t i = 0; i < Chunks.size(); ++i)
+	{
+		CHECK(Chunks[i].SourceOffset % RowSize == 0);
+		CHECK(Chunks[i].Size % RowSize == 0);
+		CHECK(Chunks[i].Size <= 100);
+		CHECK(Chunks[i].StagingSlot == i % 3);
+	}
+
+	CHECK(Chunks.back().Size == RowSize);
+}
+
+TEST_CASE( "Transfer chunks cover the whole range", "[Memory]")
+{
+	std::mt19937 RNG(42);
+	std::uniform_int_distribution<uint64_t> SizeDistribution(0, 100000);
+	std::uniform_int_distribution<uint64_t> ChunkSizeDistribution(1, 4096);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		uint64_t Size = SizeDistribution(RNG);
+		uint64_t Offset = SizeDistribution(RNG);
+		uint64_t ChunkSize = ChunkSizeDistribution(RNG);
+		auto Chunks = SplitTransfer(Size, Offset, ChunkSize);
+
+		uint64_t Expected = 0;
+
+		for (auto& Chunk : Chunks)
+		{
+			CHECK(Chunk.Size > 0);
+			CHECK(Chunk.Size <= ChunkSize);
+			CHECK(Chunk.DestinationOffset == Expected);
+			CHECK(Chunk.SourceOffset == Offset + Expected);
+			Expected += Chunk.Size;
+		}
+
+		CHECK(Expected == Size);
+	}
+}
+
+TEST_CASE( "Ring allocator throughput", "[.Benchmark]")
+{
+	BENCHMARK("Many small ring allocations")
+	{
+		FRingAllocator Ring(64 * 1024 * 1024);
+		uint64_t FenceValue = 0;
+		uint64_t Total = 0;
+
+		for (int i = 0; i < 1000000; ++i)
+		{
+			auto Offset = Ring.Allocate(64, 16);
+
+			if (!Offset)
+			{
+				Ring.Submit(++FenceValue);
+				Ring.Retire(FenceValue);
+				Offset = Ring.Allocate(64, 16);
+			}
+
+			Total += *Offset;
+
+			if (i % 1000 == 0)
+			{
+				Ring.Submit(++FenceValue);
+				Ring.Retire(FenceValue - 1);
+			}
+		}
+
+		return Total;
+	};
+}
+
+TEST_CASE( "Suballocator throughput", "[.Benchmark]")
+{
+	const uint32_t Iterations = 100000;
+
+	BENCHMARK("Random allocations and frees")
+	{
+		FSuballocator Suballocator(64 * 1024 * 1024);
+		std::mt19937 RNG(42);
+		return RandomAllocationsAndFrees(Suballocator, Iterations, RNG).size();
+	};
+
+	FSuballocator Suballocator(64 * 1024 * 1024);
+	std::mt19937 RNG(42);
+	RandomAllocationsAndFrees(Suballocator, Iterations, RNG);
+	WARN("Suballocator fragmentation after " << Iterations << " random operations: " << Suballocator.GetFragmentation()
+		<< ", free blocks: " << Suballocator.GetFreeBlocksCount());
+}
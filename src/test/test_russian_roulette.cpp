@@ -0,0 +1,189 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include "maths.h"
+#include "random.h"
+#include "russian_roulette.h"
+
+#include <random>
+
+namespace
+{
+	/// Closed-form furnace: a diffuse surface in a uniform environment which is visible from a part of its hemisphere.
+	/// Every bounce gathers the environment, then the scattered ray escapes into the environment with the probability of the visible part,
+	/// or hits the surface again
+	struct FFurnaceScene
+	{
+		FVector3 Albedo;
+		FVector3 EnvironmentRadiance;
+		float Visibility;
+		uint32_t RecursionDepth;
+
+		/// Expected radiance, the sum over bounces of the throughput which reaches them times the light they gather
+		FVector3 GetExpectedRadiance() const
+		{
+			FVector3 Radiance{0.f, 0.f, 0.f};
+			FVector3 Throughput{1.f, 1.f, 1.f};
+
+			for (uint32_t i = 0; i < RecursionDepth; ++i)
+			{
+				Radiance = Radiance + Throughput * Albedo * EnvironmentRadiance * Visibility;
+				Throughput = Throughput * Albedo * (1.f - Visibility);
+			}
+
+			return Radiance;
+		}
+	};
+
+	struct FPathResult
+	{
+		FVector3 Radiance{0.f, 0.f, 0.f};
+		uint32_t Bounces = 0;
+	};
+
+	/// Scalar port of the master shader's throughput update for the furnace. Cosine sampled diffuse gives BxDF * NDotI / PDF = Albedo.
+	/// The scene itself is sampled with an independent generator, so only the roulette draws come from the shader's sampler
+	FPathResult TracePath(const FFurnaceScene& Scene, std::mt19937& Generator, uint32_t RenderIteration, uint32_t PixelIndex, bool bRussianRoulette, uint32_t StartDepth, float MaxSurvivalProbability)
+	{
+		FPathResult Result;
+		FVector3 ThroughputBeforeThisBounce{1.f, 1.f, 1.f};
+
+		for (uint32_t BounceIndex = 0; BounceIndex < Scene.RecursionDepth; ++BounceIndex)
+		{
+			Result.Bounces++;
+
+			FVector3 ThroughputForThisBounce = Scene.Albedo;
+			Result.Radiance = Result.Radiance + ThroughputBeforeThisBounce * ThroughputForThisBounce * Scene.EnvironmentRadiance * Scene.Visibility;
+
+			/// Scattered ray found the environment, it was already gathered
+			if (std::uniform_real_distribution<float>(0.f, 1.f)(Generator) < Scene.Visibility || BounceIndex == Scene.RecursionDepth - 1)
+			{
+				break;
+			}
+
+			FVector3 PathThroughput = ThroughputBeforeThisBounce * ThroughputForThisBounce;
+
+			if (bRussianRoulette)
+			{
+				FSamplingState SamplingState = {RenderIteration, BounceIndex, 0, PixelIndex, SAMPLE_TYPE_RUSSIAN_ROULETTE};
+				float RouletteWeight = RussianRouletteWeight(PathThroughput, BounceIndex, StartDepth, MaxSurvivalProbability, RandomFloat(SamplingState));
+
+				if (RouletteWeight == 0.f)
+				{
+					break;
+				}
+
+				PathThroughput = PathThroughput * RouletteWeight;
+			}
+
+			ThroughputBeforeThisBounce = PathThroughput;
+		}
+
+		return Result;
+	}
+
+	struct FEstimate
+	{
+		FVector3 Mean{0.f, 0.f, 0.f};
+		FVector3 StandardError{0.f, 0.f, 0.f};
+		double AveragePathLength = 0.;
+	};
+
+	/// Paths of a few frames of a small image, seeded the way the shader seeds them
+	FEstimate Estimate(const FFurnaceScene& Scene, bool bRussianRoulette, uint32_t StartDepth, float MaxSurvivalProbability)
+	{
+		const uint32_t RenderIterations = 64;
+		const uint32_t Pixels = 4096;
+		const double PathsCount = double(RenderIterations) * Pixels;
+
+		double Sum[3] = {0., 0., 0.};
+		double SumOfSquares[3] = {0., 0., 0.};
+		double TotalBounces = 0.;
+		std::mt19937 Generator(42);
+
+		for (uint32_t RenderIteration = 0; RenderIteration < RenderIterations; ++RenderIteration)
+		{
+			for (uint32_t PixelIndex = 0; PixelIndex < Pixels; ++PixelIndex)
+			{
+				auto Path = TracePath(Scene, Generator, RenderIteration, PixelIndex, bRussianRoulette, StartDepth, MaxSurvivalProbability);
+				float Channels[3] = {Path.Radiance.X, Path.Radiance.Y, Path.Radiance.Z};
+
+				for (int i = 0; i < 3; ++i)
+				{
+					Sum[i] += Channels[i];
+					SumOfSquares[i] += double(Channels[i]) * Channels[i];
+				}
+
+				TotalBounces += Path.Bounces;
+			}
+		}
+
+		float Mean[3];
+		float StandardError[3];
+
+		for (int i = 0; i < 3; ++i)
+		{
+			double ChannelMean = Sum[i] / PathsCount;
+			double Variance = std::max(0., SumOfSquares[i] / PathsCount - ChannelMean * ChannelMean);
+			Mean[i] = float(ChannelMean);
+			StandardError[i] = float(std::sqrt(Variance / PathsCount));
+		}
+
+		return {{Mean[0], Mean[1], Mean[2]}, {StandardError[0], StandardError[1], StandardError[2]}, TotalBounces / PathsCount};
+	}
+
+	void CheckWithinConfidenceBounds(const FEstimate& Estimate, const FVector3& Expected)
+	{
+		/// Five standard errors, plus a bit for the float accumulation
+		CHECK(std::abs(Estimate.Mean.X - Expected.X) <= 5.f * Estimate.StandardError.X + 1e-4f);
+		CHECK(std::abs(Estimate.Mean.Y - Expected.Y) <= 5.f * Estimate.StandardError.Y + 1e-4f);
+		CHECK(std::abs(Estimate.Mean.Z - Expected.Z) <= 5.f * Estimate.StandardError.Z + 1e-4f);
+	}
+}
+
+TEST_CASE( "Russian roulette survival probability", "[RussianRoulette]")
+{
+	/// Largest channel decides, clamped from above
+	CHECK(RussianRouletteSurvivalProbability({0.2f, 0.5f, 0.1f}, 0.95f) == 0.5f);
+	CHECK(RussianRouletteSurvivalProbability({2.f, 0.5f, 0.1f}, 0.95f) == 0.95f);
+	CHECK(RussianRouletteSurvivalProbability({0.f, 0.f, 0.f}, 0.95f) == 0.f);
+
+	/// Before the start depth every path goes on unweighted
+	CHECK(RussianRouletteWeight({0.01f, 0.01f, 0.01f}, 1, 2, 0.95f, 0.99f) == 1.f);
+	/// Survivors carry the light of the terminated paths
+	CHECK(RussianRouletteWeight({0.25f, 0.1f, 0.f}, 2, 2, 0.95f, 0.2f) == 4.f);
+	CHECK(RussianRouletteWeight({0.25f, 0.1f, 0.f}, 2, 2, 0.95f, 0.3f) == 0.f);
+	/// Black paths always end
+	CHECK(RussianRouletteWeight({0.f, 0.f, 0.f}, 5, 2, 0.95f, 0.f) == 0.f);
+}
+
+TEST_CASE( "Russian roulette is unbiased in a furnace", "[RussianRoulette]")
+{
+	FFurnaceScene Scenes[] = {
+		{{0.8f, 0.5f, 0.2f}, {1.f, 1.f, 1.f}, 0.3f, 7},
+		{{0.95f, 0.95f, 0.95f}, {0.5f, 1.f, 2.f}, 0.1f, 7},
+		{{0.3f, 0.3f, 0.3f}, {1.f, 1.f, 1.f}, 0.05f, 4},
+	};
+
+	for (auto& Scene : Scenes)
+	{
+		FVector3 Expected = Scene.GetExpectedRadiance();
+
+		auto WithoutRoulette = Estimate(Scene, false, 0, 1.f);
+		CheckWithinConfidenceBounds(WithoutRoulette, Expected);
+
+		for (uint32_t StartDepth : {0u, 2u})
+		{
+			for (float MaxSurvivalProbability : {0.5f, 0.95f})
+			{
+				auto WithRoulette = Estimate(Scene, true, StartDepth, MaxSurvivalProbability);
+
+				INFO("Albedo " << Scene.Albedo.X << ", visibility " << Scene.Visibility << ", start depth " << StartDepth << ", max survival probability " << MaxSurvivalProbability
+					<< ": average path length " << WithoutRoulette.AveragePathLength << " -> " << WithRoulette.AveragePathLength);
+				CheckWithinConfidenceBounds(WithRoulette, Expected);
+
+				/// Paths only get shorter
+				CHECK(WithRoulette.AveragePathLength < WithoutRoulette.AveragePathLength);
+			}
+		}
+	}
+}
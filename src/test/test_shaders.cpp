@@ -0,0 +1,1013 @@
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/benchmark/catch_benchmark.hpp"
+
+#include "maths.h"
+#include "common_structures.h"
+#include "material_code_generator.h"
+#include "pipeline_cache.h"
+#include "shader_cache.h"
+#include "test_utils.h"
+#include "vk_shader_compiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <thread>
+
+/// Shader files use CRLF line endings
+void WriteShaderFile(const std::string& Path, const std::vector<std::string>& Lines)
+{
+	{
+		std::ofstream File(Path, std::ios::out | std::ios::binary);
+
+		for (auto& Line : Lines)
+		{
+			File << Line << "\r\n";
+		}
+	}
+
+	/// Tests rewrite files faster than the file system updates modification times, so the file table must not trust them
+	SHADER_FILE_TABLE()->Invalidate(Path);
+}
+
+/// Definitions the master shader gets from the render and the material system, with a simple generated material
+FCompileDefinitions GetMasterShaderDefinitions(uint32_t MaterialIndex)
+{
+	FCompileDefinitions CompileDefinitions;
+	CompileDefinitions.Push("LAST_BOUNCE", "3");
+	CompileDefinitions.Push("LAST_DIFFUSE_BOUNCE", "3");
+	CompileDefinitions.Push("LAST_REFLECTION_BOUNCE", "3");
+	CompileDefinitions.Push("LAST_REFRACTION_BOUNCE", "3");
+	CompileDefinitions.Push("FDeviceMaterial GetEmissiveMaterial(vec2 TextureCoords, uint MaterialIndex);",
+		"FDeviceMaterial GetEmissiveMaterial(vec2 TextureCoords, uint MaterialIndex)\r\n{\r\n    FDeviceMaterial Material;\r\n    return Material;\r\n};\r\n");
+	CompileDefinitions.Push("SIZE_OF_DEVICE_MATERIAL_STRUCT", std::to_string(sizeof(FDeviceMaterial) / sizeof(float)));
+
+	std::string MaterialCode;
+	MaterialCode += "FDeviceMaterial GetMaterial(vec2 TextureCoords)\r\n";
+	MaterialCode += "{\r\n";
+	MaterialCode += "    FDeviceMaterial Material;\r\n";
+	MaterialCode += "    Material.BaseWeight = SampleFloat(" + std::to_string(MaterialIndex) + ", 3);\r\n";
+	MaterialCode += "    Material.BaseColor = vec3(" + std::to_string(float(MaterialIndex % 10) / 10.f) + ");\r\n";
+	MaterialCode += "    return Material;\r\n";
+	MaterialCode += "};\r\n";
+	CompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords);", MaterialCode);
+
+	return CompileDefinitions;
+}
+
+std::vector<FShaderCompilationJob> GetMasterShaderJobs(uint32_t MaterialsCount)
+{
+	std::vector<FShaderCompilationJob> Jobs;
+
+	for (uint32_t i = 0; i < MaterialsCount; ++i)
+	{
+		Jobs.push_back({"../src/shaders/master_shader.rgen", GetMasterShaderDefinitions(i)});
+	}
+
+	return Jobs;
+}
+
+/// Valid SPIR-V magic number followed by some payload
+std::vector<uint32_t> FakeSpirV(uint32_t Size, uint32_t Value)
+{
+	std::vector<uint32_t> SpirV(Size, Value);
+	SpirV[0] = 0x07230203;
+	return SpirV;
+}
+
+TEST_CASE( "Shader cache hit and miss", "[Shaders]")
+{
+	FShaderCache ShaderCache(CreateTestDirectory("shader_cache_hit_miss"));
+	auto Key = ComputeShaderCacheKey("void main() {}", {}, 0, "", "");
+
+	CHECK_FALSE(ShaderCache.Load(Key));
+	CHECK(ShaderCache.GetMissesCount() == 1);
+
+	auto SpirV = FakeSpirV(64, 42);
+	ShaderCache.Store(Key, SpirV);
+
+	auto Cached = ShaderCache.Load(Key);
+	REQUIRE(Cached);
+	CHECK(*Cached == SpirV);
+	CHECK(ShaderCache.GetHitsCount() == 1);
+
+	/// Entries outlive the cache object
+	FShaderCache OtherShaderCache(std::filesystem::temp_directory_path().string() + "/rtracer_shader_cache_hit_miss");
+	CHECK(OtherShaderCache.Load(Key));
+
+	ShaderCache.Clear();
+	CHECK_FALSE(ShaderCache.Load(Key));
+	CHECK(ShaderCache.GetSize() == 0);
+}
+
+TEST_CASE( "Shader cache key", "[Shaders]")
+{
+	std::vector<std::pair<std::string, std::string>> Defines = {{"A", "1"}};
+	auto Key = ComputeShaderCacheKey("void main() {}", Defines, 0, "vulkan1.3", "shaderc-1");
+
+	CHECK(Key == ComputeShaderCacheKey("void main() {}", Defines, 0, "vulkan1.3", "shaderc-1"));
+	CHECK(Key.size() == 32);
+
+	/// Every input should change the key
+	CHECK(Key != ComputeShaderCacheKey("void main() { }", Defines, 0, "vulkan1.3", "shaderc-1"));
+	CHECK(Key != ComputeShaderCacheKey("void main() {}", {{"A", "2"}}, 0, "vulkan1.3", "shaderc-1"));
+	CHECK(Key != ComputeShaderCacheKey("void main() {}", {}, 0, "vulkan1.3", "shaderc-1"));
+	CHECK(Key != ComputeShaderCacheKey("void main() {}", Defines, 1, "vulkan1.3", "shaderc-1"));
+	CHECK(Key != ComputeShaderCacheKey("void main() {}", Defines, 0, "vulkan1.3;debug", "shaderc-1"));
+	/// Another build of the compiler might emit different SPIR-V even if it targets the same SPIR-V version
+	CHECK(Key != ComputeShaderCacheKey("void main() {}", Defines, 0, "vulkan1.3", "shaderc-2"));
+
+	/// Boundaries between defines matter
+	CHECK(ComputeShaderCacheKey("", {{"AB", "C"}}, 0, "", "") != ComputeShaderCacheKey("", {{"A", "BC"}}, 0, "", ""));
+}
+
+TEST_CASE( "Shader cache invalidation on include edits", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_cache_includes");
+	FShaderCache ShaderCache(Directory + "cache");
+
+	WriteShaderFile(Directory + "shader.comp", {"#version 460", "#include \"common.h\"", "void main() {}"});
+	WriteShaderFile(Directory + "common.h", {"#define VALUE 1"});
+
+	auto GetKey = [&]()
+	{
+		auto Source = ExpandShaderSource(Directory + "shader.comp", nullptr, Directory);
+		return ComputeShaderCacheKey(Source, {}, 0, "", "");
+	};
+
+	auto Key = GetKey();
+	CHECK_FALSE(ShaderCache.Load(Key));
+	ShaderCache.Store(Key, FakeSpirV(16, 1));
+	CHECK(ShaderCache.Load(GetKey()));
+
+	/// Shader itself didn't change, but the header did, so it has to be recompiled
+	WriteShaderFile(Directory + "common.h", {"#define VALUE 2"});
+	auto EditedKey = GetKey();
+	CHECK(EditedKey != Key);
+	CHECK_FALSE(ShaderCache.Load(EditedKey));
+
+	/// Reverting the edit brings back the old entry
+	WriteShaderFile(Directory + "common.h", {"#define VALUE 1"});
+	CHECK(GetKey() == Key);
+	CHECK(ShaderCache.Load(Key));
+}
+
+TEST_CASE( "Shader cache corruption", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_cache_corruption");
+	FShaderCache ShaderCache(Directory);
+	auto Key = ComputeShaderCacheKey("void main() {}", {}, 0, "", "");
+	auto EntryPath = Directory + Key + ".spv";
+
+	/// Flipped byte in the SPIR-V
+	ShaderCache.Store(Key, FakeSpirV(64, 7));
+	{
+		std::fstream File(EntryPath, std::ios::in | std::ios::out | std::ios::binary);
+		File.seekp(-1, std::ios::end);
+		File.put(char(0xFF));
+	}
+	CHECK_FALSE(ShaderCache.Load(Key));
+	CHECK_FALSE(std::filesystem::exists(EntryPath));
+
+	/// Truncated file
+	ShaderCache.Store(Key, FakeSpirV(64, 7));
+	std::filesystem::resize_file(EntryPath, std::filesystem::file_size(EntryPath) - 4);
+	CHECK_FALSE(ShaderCache.Load(Key));
+
+	/// Garbage that is shorter than the header
+	WriteShaderFile(EntryPath, {"garbage"});
+	CHECK_FALSE(ShaderCache.Load(Key));
+
+	/// Valid checksum, but not SPIR-V
+	ShaderCache.Store(Key, std::vector<uint32_t>(64, 7));
+	CHECK_FALSE(ShaderCache.Load(Key));
+
+	/// Temporary files of the writes are never left behind
+	ShaderCache.Store(Key, FakeSpirV(64, 7));
+	CHECK(ShaderCache.Load(Key));
+	uint32_t FilesCount = 0;
+
+	for (auto& Entry : std::filesystem::directory_iterator(Directory))
+	{
+		FilesCount++;
+	}
+
+	CHECK(FilesCount == 1);
+}
+
+TEST_CASE( "Shader cache eviction", "[Shaders]")
+{
+	/// Each entry takes 1024 bytes of SPIR-V and a header, so three of them don't fit
+	FShaderCache ShaderCache(CreateTestDirectory("shader_cache_eviction"), 2500);
+	std::vector<std::string> Keys;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		Keys.push_back(ComputeShaderCacheKey(std::to_string(i), {}, 0, "", ""));
+	}
+
+	/// Access times should differ even on file systems with a coarse time resolution
+	auto Wait = []()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	};
+
+	ShaderCache.Store(Keys[0], FakeSpirV(256, 0));
+	Wait();
+	ShaderCache.Store(Keys[1], FakeSpirV(256, 1));
+	Wait();
+	CHECK(ShaderCache.Load(Keys[0]));
+	Wait();
+	/// Entry 1 is the least recently used one now
+	ShaderCache.Store(Keys[2], FakeSpirV(256, 2));
+
+	CHECK(ShaderCache.GetSize() <= 2500);
+	CHECK(ShaderCache.Load(Keys[0]));
+	CHECK_FALSE(ShaderCache.Load(Keys[1]));
+	CHECK(ShaderCache.Load(Keys[2]));
+
+	Wait();
+	ShaderCache.Store(Keys[3], FakeSpirV(256, 3));
+	CHECK(ShaderCache.GetSize() <= 2500);
+	CHECK(ShaderCache.Load(Keys[3]));
+}
+
+TEST_CASE( "Shader cache stale temporary files", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_cache_stale_temporary_files");
+	auto StalePath = Directory + "stale.spv.tmp123";
+	auto FreshPath = Directory + "fresh.spv.tmp456";
+	std::ofstream(StalePath, std::ios::binary) << "partial";
+	std::ofstream(FreshPath, std::ios::binary) << "partial";
+	std::filesystem::last_write_time(StalePath, std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+
+	/// Files of crashed writers are removed when the cache is opened, files that might still be written are kept
+	FShaderCache ShaderCache(Directory);
+	CHECK_FALSE(std::filesystem::exists(StalePath));
+	CHECK(std::filesystem::exists(FreshPath));
+	CHECK(ShaderCache.GetSize() == 0);
+}
+
+TEST_CASE( "Parallel shader compilation matches serial", "[Shaders]")
+{
+	auto Jobs = GetMasterShaderJobs(8);
+	Jobs.push_back({"../src/shaders/master_shader.rchit"});
+	Jobs.push_back({"../src/shaders/accumulate.comp"});
+
+	/// Without the cache, so that both really compile
+	FShaderCompilationPool ShaderCompilationPool(4, nullptr);
+	auto ParallelSPIRV = ShaderCompilationPool.CompileBatch(Jobs);
+	REQUIRE(ParallelSPIRV.size() == Jobs.size());
+
+	for (uint32_t i = 0; i < Jobs.size(); ++i)
+	{
+		auto SerialSPIRV = CompileShaderToSpirVData(Jobs[i].Path, &Jobs[i].CompileDefinitions, nullptr);
+		CHECK(ParallelSPIRV[i] == SerialSPIRV);
+	}
+
+	/// Different materials give different shaders
+	CHECK(ParallelSPIRV[0] != ParallelSPIRV[1]);
+}
+
+TEST_CASE( "Parallel shader compilation errors", "[Shaders]")
+{
+	std::vector<FShaderCompilationJob> Jobs(6, {"../src/shaders/accumulate.comp"});
+	Jobs[1].CompileDefinitions.Push("void main()", "ERROR_UNKNOWN_TYPE main()");
+	Jobs[4].CompileDefinitions.Push("void main()", "ERROR_UNKNOWN_TYPE main()");
+
+	FShaderCompilationPool ShaderCompilationPool(4, nullptr);
+	std::string ErrorMessage;
+
+	try
+	{
+		ShaderCompilationPool.CompileBatch(Jobs);
+	}
+	catch (const std::runtime_error& Error)
+	{
+		ErrorMessage = Error.what();
+	}
+
+	/// Every failed job is reported, in the order of the jobs
+	REQUIRE(ErrorMessage.find("Job 1:") != std::string::npos);
+	REQUIRE(ErrorMessage.find("Job 4:") != std::string::npos);
+	CHECK(ErrorMessage.find("Job 1:") < ErrorMessage.find("Job 4:"));
+	CHECK(ErrorMessage.find("Job 0:") == std::string::npos);
+	CHECK(ErrorMessage.find("Job 2:") == std::string::npos);
+
+	/// The pool still works after a failed batch
+	CHECK(ShaderCompilationPool.CompileBatch({{"../src/shaders/accumulate.comp"}}).size() == 1);
+}
+
+TEST_CASE( "Shader nested includes", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_nested_includes");
+	std::filesystem::create_directories(Directory + "nested");
+	std::filesystem::create_directories(Directory + "include");
+
+	WriteShaderFile(Directory + "shader.comp", {"#version 460", "#include \"first.h\"", "void main() {}"});
+	WriteShaderFile(Directory + "first.h", {"#define FIRST 1", "#include \"nested/second.h\""});
+	/// Quoted includes are looked up next to the including file first
+	WriteShaderFile(Directory + "nested/second.h", {"#define SECOND 2", "#include \"third.h\"", "#include <fourth.h>"});
+	WriteShaderFile(Directory + "nested/third.h", {"#define THIRD 3"});
+	WriteShaderFile(Directory + "include/fourth.h", {"#define FOURTH 4"});
+
+	auto Source = ExpandShaderSource(Directory + "shader.comp", nullptr, Directory + "include");
+
+	CHECK(Source.find("#include") == std::string::npos);
+	CHECK(Source.find("FIRST 1") < Source.find("SECOND 2"));
+	CHECK(Source.find("SECOND 2") < Source.find("THIRD 3"));
+	CHECK(Source.find("THIRD 3") < Source.find("FOURTH 4"));
+	CHECK(Source.find("FOURTH 4") < Source.find("void main()"));
+
+	auto Dependencies = SHADER_DEPENDENCY_GRAPH()->GetDependencies(NormalizeShaderPath(Directory + "shader.comp"));
+	std::vector<std::string> ExpectedDependencies = {NormalizeShaderPath(Directory + "first.h"), NormalizeShaderPath(Directory + "include/fourth.h"),
+		NormalizeShaderPath(Directory + "nested/second.h"), NormalizeShaderPath(Directory + "nested/third.h")};
+	std::sort(Dependencies.begin(), Dependencies.end());
+	std::sort(ExpectedDependencies.begin(), ExpectedDependencies.end());
+	CHECK(Dependencies == ExpectedDependencies);
+
+	/// Missing includes are left for the compiler to report
+	WriteShaderFile(Directory + "missing.comp", {"#version 460", "#include \"missing.h\"", "void main() {}"});
+	CHECK(ExpandShaderSource(Directory + "missing.comp", nullptr, Directory).find("#include \"missing.h\"") != std::string::npos);
+}
+
+TEST_CASE( "Shader include cycles", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_include_cycles");
+
+	WriteShaderFile(Directory + "shader.comp", {"#version 460", "#include \"a.h\"", "#include \"b.h\"", "#include \"shader.comp\"", "void main() {}"});
+	WriteShaderFile(Directory + "a.h", {"#define A 1", "#include \"b.h\""});
+	WriteShaderFile(Directory + "b.h", {"#define B 1", "#include \"a.h\""});
+
+	/// Every file is included once, no matter how many times and from where it's requested
+	auto Source = ExpandShaderSource(Directory + "shader.comp", nullptr, Directory);
+	auto CountOccurrences = [&](const std::string& Text)
+	{
+		uint32_t Count = 0;
+
+		for (auto Position = Source.find(Text); Position != std::string::npos; Position = Source.find(Text, Position + 1))
+		{
+			Count++;
+		}
+
+		return Count;
+	};
+
+	CHECK(CountOccurrences("#define A 1") == 1);
+	CHECK(CountOccurrences("#define B 1") == 1);
+	CHECK(CountOccurrences("void main()") == 1);
+	CHECK(CountOccurrences("#include") == 0);
+}
+
+TEST_CASE( "Shader dependency invalidation", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_dependency_invalidation");
+
+	WriteShaderFile(Directory + "first.comp", {"#version 460", "#include \"common.h\"", "void main() {}"});
+	WriteShaderFile(Directory + "second.comp", {"#version 460", "#include \"other.h\"", "void main() {}"});
+	WriteShaderFile(Directory + "common.h", {"#define COMMON 1"});
+	WriteShaderFile(Directory + "other.h", {"#include \"common.h\"", "#define OTHER 1"});
+
+	auto FirstShader = NormalizeShaderPath(Directory + "first.comp");
+	auto SecondShader = NormalizeShaderPath(Directory + "second.comp");
+	auto FirstKey = ComputeShaderCacheKey(ExpandShaderSource(FirstShader, nullptr, Directory), {}, 0, "", "");
+	ExpandShaderSource(SecondShader, nullptr, Directory);
+
+	/// Header shared by both shaders is read from the disk once
+	FShaderFileTable FileTable;
+	FileTable.Read(Directory + "common.h");
+	FileTable.Read(Directory + "./common.h");
+	CHECK(FileTable.GetDiskReadsCount() == 1);
+	FileTable.Invalidate(Directory + "common.h");
+	FileTable.Read(Directory + "common.h");
+	CHECK(FileTable.GetDiskReadsCount() == 2);
+
+	/// Header change affects every shader including it, directly or not
+	auto AffectedShaders = SHADER_DEPENDENCY_GRAPH()->GetAffectedShaders(NormalizeShaderPath(Directory + "common.h"));
+	CHECK(AffectedShaders == std::vector<std::string>{FirstShader, SecondShader});
+	CHECK(SHADER_DEPENDENCY_GRAPH()->GetAffectedShaders(NormalizeShaderPath(Directory + "other.h")) == std::vector<std::string>{SecondShader});
+	CHECK(SHADER_DEPENDENCY_GRAPH()->GetAffectedShaders(FirstShader) == std::vector<std::string>{FirstShader});
+
+	/// Dependencies are recorded again on every expansion, so removed includes stop affecting the shader
+	WriteShaderFile(Directory + "second.comp", {"#version 460", "void main() {}"});
+	ExpandShaderSource(SecondShader, nullptr, Directory);
+	CHECK(SHADER_DEPENDENCY_GRAPH()->GetAffectedShaders(NormalizeShaderPath(Directory + "common.h")) == std::vector<std::string>{FirstShader});
+
+	WriteShaderFile(Directory + "common.h", {"#define COMMON 2"});
+	CHECK(ComputeShaderCacheKey(ExpandShaderSource(FirstShader, nullptr, Directory), {}, 0, "", "") != FirstKey);
+}
+
+TEST_CASE( "Shader file watcher", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("shader_file_watcher");
+	std::filesystem::create_directories(Directory + "nested");
+	WriteShaderFile(Directory + "shader.comp", {"#version 460", "void main() {}"});
+
+	FShaderFileWatcher ShaderFileWatcher(Directory);
+	CHECK(ShaderFileWatcher.PollChangedFiles().empty());
+
+	/// Modification times might have a coarse resolution, so give the file system some time before the edit
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	WriteShaderFile(Directory + "nested/common.h", {"#define VALUE 1"});
+
+	auto WaitForChange = [&](const std::string& Path)
+	{
+		auto Start = std::chrono::steady_clock::now();
+
+		while (std::chrono::steady_clock::now() - Start < std::chrono::seconds(2))
+		{
+			auto ChangedFiles = ShaderFileWatcher.PollChangedFiles();
+
+			if (std::find(ChangedFiles.begin(), ChangedFiles.end(), NormalizeShaderPath(Path)) != ChangedFiles.end())
+			{
+				return true;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		return false;
+	};
+
+	CHECK(WaitForChange(Directory + "nested/common.h"));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	WriteShaderFile(Directory + "shader.comp", {"#version 460", "#include \"nested/common.h\"", "void main() {}"});
+	CHECK(WaitForChange(Directory + "shader.comp"));
+
+	/// Changes are reported once
+	CHECK(ShaderFileWatcher.PollChangedFiles().empty());
+}
+
+FPipelineCacheDeviceInfo GetTestDeviceInfo()
+{
+	FPipelineCacheDeviceInfo DeviceInfo;
+	DeviceInfo.VendorID = 0x10DE;
+	DeviceInfo.DeviceID = 0x2684;
+	DeviceInfo.DriverVersion = 0x8A4C8000;
+
+	for (uint32_t i = 0; i < DeviceInfo.PipelineCacheUUID.size(); ++i)
+	{
+		DeviceInfo.PipelineCacheUUID[i] = uint8_t(i * 17);
+	}
+
+	return DeviceInfo;
+}
+
+/// Pipeline cache data like the driver returns it: VkPipelineCacheHeaderVersionOne followed by the driver's own data
+std::vector<char> FakePipelineCacheData(const FPipelineCacheDeviceInfo& DeviceInfo, uint32_t Size)
+{
+	std::vector<char> Data(PIPELINE_CACHE_HEADER_SIZE + Size);
+	uint32_t Header[] = {PIPELINE_CACHE_HEADER_SIZE, 1, DeviceInfo.VendorID, DeviceInfo.DeviceID};
+	std::memcpy(Data.data(), Header, sizeof(Header));
+	std::memcpy(Data.data() + sizeof(Header), DeviceInfo.PipelineCacheUUID.data(), DeviceInfo.PipelineCacheUUID.size());
+
+	for (uint32_t i = 0; i < Size; ++i)
+	{
+		Data[PIPELINE_CACHE_HEADER_SIZE + i] = char(i * 7);
+	}
+
+	return Data;
+}
+
+TEST_CASE( "Pipeline cache round trip", "[Shaders]")
+{
+	auto Path = CreateTestDirectory("pipeline_cache_round_trip") + "pipeline_cache.bin";
+	auto DeviceInfo = GetTestDeviceInfo();
+	auto Data = FakePipelineCacheData(DeviceInfo, 4096);
+
+	FPipelineCacheFile PipelineCacheFile(Path, DeviceInfo);
+	CHECK_FALSE(PipelineCacheFile.Load());
+
+	REQUIRE(PipelineCacheFile.Save(Data));
+	auto LoadedData = PipelineCacheFile.Load();
+	REQUIRE(LoadedData);
+	CHECK(*LoadedData == Data);
+
+	/// Newer data replaces the old one
+	auto NewData = FakePipelineCacheData(DeviceInfo, 8192);
+	REQUIRE(PipelineCacheFile.Save(NewData));
+	CHECK(*PipelineCacheFile.Load() == NewData);
+
+	/// Data of another device is never written
+	auto OtherDeviceInfo = DeviceInfo;
+	OtherDeviceInfo.DeviceID++;
+	CHECK_FALSE(PipelineCacheFile.Save(FakePipelineCacheData(OtherDeviceInfo, 4096)));
+	CHECK(*PipelineCacheFile.Load() == NewData);
+}
+
+TEST_CASE( "Pipeline cache header mismatch", "[Shaders]")
+{
+	auto DeviceInfo = GetTestDeviceInfo();
+	auto Data = FakePipelineCacheData(DeviceInfo, 256);
+	CHECK(IsPipelineCacheDataCompatible(Data, DeviceInfo));
+
+	/// Every field of the header that identifies the device is checked
+	std::vector<std::function<void(FPipelineCacheDeviceInfo&)>> Mismatches = {
+		[](FPipelineCacheDeviceInfo& Info){ Info.VendorID++; },
+		[](FPipelineCacheDeviceInfo& Info){ Info.DeviceID++; },
+		[](FPipelineCacheDeviceInfo& Info){ Info.PipelineCacheUUID[15]++; }};
+
+	for (auto& Modify : Mismatches)
+	{
+		auto OtherDeviceInfo = DeviceInfo;
+		Modify(OtherDeviceInfo);
+		CHECK_FALSE(IsPipelineCacheDataCompatible(Data, OtherDeviceInfo));
+	}
+
+	/// Broken Vulkan headers
+	auto ModifyHeader = [&](uint32_t Offset, uint32_t Value)
+	{
+		auto ModifiedData = Data;
+		std::memcpy(ModifiedData.data() + Offset, &Value, sizeof(Value));
+		return ModifiedData;
+	};
+
+	CHECK_FALSE(IsPipelineCacheDataCompatible(ModifyHeader(0, PIPELINE_CACHE_HEADER_SIZE - 1), DeviceInfo));
+	CHECK_FALSE(IsPipelineCacheDataCompatible(ModifyHeader(0, uint32_t(Data.size() + 1)), DeviceInfo));
+	CHECK_FALSE(IsPipelineCacheDataCompatible(ModifyHeader(4, 2), DeviceInfo));
+	CHECK_FALSE(IsPipelineCacheDataCompatible(std::vector<char>(Data.begin(), Data.begin() + PIPELINE_CACHE_HEADER_SIZE - 1), DeviceInfo));
+	CHECK_FALSE(IsPipelineCacheDataCompatible({}, DeviceInfo));
+
+	/// File written with another driver is not used and removed, even if the data itself looks fine
+	auto Path = CreateTestDirectory("pipeline_cache_header_mismatch") + "pipeline_cache.bin";
+	REQUIRE(FPipelineCacheFile(Path, DeviceInfo).Save(Data));
+
+	auto NewDriverInfo = DeviceInfo;
+	NewDriverInfo.DriverVersion++;
+	CHECK_FALSE(FPipelineCacheFile(Path, NewDriverInfo).Load());
+	CHECK_FALSE(std::filesystem::exists(Path));
+
+	REQUIRE(FPipelineCacheFile(Path, DeviceInfo).Save(Data));
+	auto OtherDeviceInfo = DeviceInfo;
+	OtherDeviceInfo.VendorID++;
+	CHECK_FALSE(FPipelineCacheFile(Path, OtherDeviceInfo).Load());
+	CHECK_FALSE(std::filesystem::exists(Path));
+}
+
+TEST_CASE( "Pipeline cache corruption", "[Shaders]")
+{
+	auto Directory = CreateTestDirectory("pipeline_cache_corruption");
+	auto Path = Directory + "pipeline_cache.bin";
+	auto DeviceInfo = GetTestDeviceInfo();
+	auto Data = FakePipelineCacheData(DeviceInfo, 1024);
+	FPipelineCacheFile PipelineCacheFile(Path, DeviceInfo);
+
+	auto ReadFile = [&]()
+	{
+		std::ifstream File(Path, std::ios::binary);
+		return std::vector<char>((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+	};
+
+	auto WriteFile = [&](const std::vector<char>& Contents)
+	{
+		std::ofstream File(Path, std::ios::out | std::ios::binary);
+		File.write(Contents.data(), Contents.size());
+	};
+
+	REQUIRE(PipelineCacheFile.Save(Data));
+	auto ValidFile = ReadFile();
+
+	auto FlippedByte = ValidFile;
+	FlippedByte[FlippedByte.size() - 10] ^= 0xFF;
+
+	std::vector<std::vector<char>> BrokenFiles = {
+		FlippedByte,
+		std::vector<char>(ValidFile.begin(), ValidFile.end() - 1),
+		std::vector<char>(ValidFile.begin(), ValidFile.begin() + 16),
+		std::vector<char>(ValidFile.size(), 0x5A)};
+
+	for (auto& BrokenFile : BrokenFiles)
+	{
+		WriteFile(BrokenFile);
+		CHECK_FALSE(PipelineCacheFile.Load());
+		/// Broken files are removed, so they aren't read again on every start
+		CHECK_FALSE(std::filesystem::exists(Path));
+	}
+
+	/// Leftovers of interrupted saves don't break anything
+	std::ofstream(Path + ".tmp123", std::ios::binary) << "partial";
+	REQUIRE(PipelineCacheFile.Save(Data));
+	CHECK(*PipelineCacheFile.Load() == Data);
+}
+
+/// Field of the material as the shader would see it. Textures are not sampled, the index of the texture which would be sampled is stored instead
+struct FDecodedMaterialField
+{
+	std::vector<uint32_t> Bits;
+	uint32_t TextureIndex = UINT32_MAX;
+	bool bConvertToLinear = false;
+
+	bool operator==(const FDecodedMaterialField& Other) const
+	{
+		return Bits == Other.Bits && TextureIndex == Other.TextureIndex && bConvertToLinear == Other.bConvertToLinear;
+	}
+};
+
+/// Evaluates expressions of the generated material accessors on the CPU, with the material buffer as an array of floats
+FDecodedMaterialField EvaluateMaterialExpression(const std::string& Expression, const std::vector<uint32_t>& MaterialData, uint32_t MaterialIndex)
+{
+	const uint32_t MaterialSize = sizeof(FDeviceMaterial) / sizeof(float);
+
+	/// (Condition) ? A : B
+	if (Expression[0] == '(')
+	{
+		auto ConditionEnd = Expression.find(") ? ");
+		auto AlternativeBegin = Expression.find(" : ");
+		auto Condition = Expression.substr(1, ConditionEnd - 1);
+		auto Comparison = Condition.find(" == ");
+		auto Left = EvaluateMaterialExpression(Condition.substr(0, Comparison), MaterialData, MaterialIndex);
+		auto Right = uint32_t(std::stoul(Condition.substr(Comparison + 4), nullptr, 16));
+		bool bCondition = Left.Bits[0] == Right;
+		auto Selected = bCondition ? Expression.substr(ConditionEnd + 4, AlternativeBegin - ConditionEnd - 4) : Expression.substr(AlternativeBegin + 3);
+		return EvaluateMaterialExpression(Selected, MaterialData, MaterialIndex);
+	}
+
+	const std::string SRGBToLinear = "SRGBToLinear(";
+
+	if (Expression.compare(0, SRGBToLinear.size(), SRGBToLinear) == 0)
+	{
+		auto Result = EvaluateMaterialExpression(Expression.substr(SRGBToLinear.size(), Expression.size() - SRGBToLinear.size() - 1), MaterialData, MaterialIndex);
+		Result.bConvertToLinear = true;
+		return Result;
+	}
+
+	/// vec3(X, Y, Z) literal
+	const std::string Vec3 = "vec3(";
+
+	if (Expression.compare(0, Vec3.size(), Vec3) == 0)
+	{
+		FDecodedMaterialField Result;
+		std::stringstream ComponentsStream(Expression.substr(Vec3.size(), Expression.size() - Vec3.size() - 1));
+
+		for (std::string Component; std::getline(ComponentsStream, Component, ',');)
+		{
+			Result.Bits.push_back(EvaluateMaterialExpression(Component.substr(Component.find_first_not_of(' ')), MaterialData, MaterialIndex).Bits[0]);
+		}
+
+		return Result;
+	}
+
+	/// Float literal
+	if (Expression.find_first_of(".e") != std::string::npos && Expression.compare(0, 6, "Sample") != 0)
+	{
+		float Value = std::stof(Expression);
+		uint32_t Bits;
+		std::memcpy(&Bits, &Value, sizeof(Bits));
+		return {{Bits}};
+	}
+
+	/// Integer literal
+	if (Expression.compare(0, 6, "Sample") != 0)
+	{
+		return {{uint32_t(std::stoul(Expression))}};
+	}
+
+	/// SampleX(MaterialIndex, Offset) or SampleX(MaterialIndex, Offset, TextureCoords)
+	auto ArgumentsBegin = Expression.find('(');
+	auto Function = Expression.substr(0, ArgumentsBegin);
+	std::vector<std::string> Arguments;
+	std::stringstream ArgumentsStream(Expression.substr(ArgumentsBegin + 1, Expression.size() - ArgumentsBegin - 2));
+
+	for (std::string Argument; std::getline(ArgumentsStream, Argument, ',');)
+	{
+		Arguments.push_back(Argument.substr(Argument.find_first_not_of(' ')));
+	}
+
+	uint32_t Index = Arguments[0] == "MaterialIndex" ? MaterialIndex : uint32_t(std::stoul(Arguments[0]));
+	uint32_t Offset = Index * MaterialSize + uint32_t(std::stoul(Arguments[1]));
+	FDecodedMaterialField Result;
+
+	if (Arguments.size() == 3)
+	{
+		Result.TextureIndex = MaterialData[Offset];
+		return Result;
+	}
+
+	std::map<std::string, uint32_t> ComponentsCount = {{"SampleFloat", 1}, {"SampleUint", 1}, {"SampleInt", 1}, {"SampleVec2", 2}, {"SampleVec3", 3}, {"SampleVec4", 4}};
+	Result.Bits.assign(MaterialData.begin() + Offset, MaterialData.begin() + Offset + ComponentsCount.at(Function));
+	return Result;
+}
+
+/// Every "Material.Field = Expression;" line of the accessor, evaluated
+std::map<std::string, FDecodedMaterialField> DecodeMaterialAccessor(const std::string& Code, const std::vector<uint32_t>& MaterialData, uint32_t MaterialIndex)
+{
+	std::map<std::string, FDecodedMaterialField> Fields;
+	std::stringstream CodeStream(Code);
+
+	for (std::string Line; std::getline(CodeStream, Line);)
+	{
+		auto FieldBegin = Line.find("Material.");
+		auto Assignment = Line.find(" = ");
+
+		if (FieldBegin == std::string::npos || Assignment == std::string::npos)
+		{
+			continue;
+		}
+
+		auto ExpressionEnd = Line.rfind(';');
+		auto Name = Line.substr(FieldBegin + 9, Assignment - FieldBegin - 9);
+		Fields[Name] = EvaluateMaterialExpression(Line.substr(Assignment + 3, ExpressionEnd - Assignment - 3), MaterialData, MaterialIndex);
+	}
+
+	return Fields;
+}
+
+TEST_CASE( "Generated and runtime material accessors", "[Shaders]")
+{
+	auto& Fields = GetMaterialFieldDescriptions();
+	const uint32_t MaterialsCount = 4;
+	std::vector<FDeviceMaterial> Materials(MaterialsCount);
+
+	for (uint32_t i = 0; i < MaterialsCount; ++i)
+	{
+		/// Every float of every material is different, so that reading a wrong offset or material is noticed
+		auto Words = reinterpret_cast<float*>(&Materials[i]);
+
+		for (uint32_t j = 0; j < sizeof(FDeviceMaterial) / sizeof(float); ++j)
+		{
+			Words[j] = float(i * 1000 + j) + 0.5f;
+		}
+
+		/// No textures, some of them, all of them
+		for (uint32_t j = 0; j < Fields.size(); ++j)
+		{
+			bool bTextured = (i == 1 && j % 2 == 0) || (i == 2 && j % 3 == 0) || i == 3;
+			uint32_t TextureIndex = bTextured ? i * 100 + j : UINT32_MAX;
+			std::memcpy(reinterpret_cast<char*>(&Materials[i]) + Fields[j].TextureOffset, &TextureIndex, sizeof(TextureIndex));
+		}
+
+		Materials[i].ThinWalled = i % 2;
+	}
+
+	std::vector<uint32_t> MaterialData(Materials.size() * sizeof(FDeviceMaterial) / sizeof(uint32_t));
+	std::memcpy(MaterialData.data(), Materials.data(), Materials.size() * sizeof(FDeviceMaterial));
+
+	auto RuntimeMaterialCode = GenerateRuntimeMaterialCode();
+
+	for (uint32_t i = 0; i < MaterialsCount; ++i)
+	{
+		auto GeneratedFields = DecodeMaterialAccessor(GenerateMaterialCode(Materials[i], i), MaterialData, i);
+		auto RuntimeFields = DecodeMaterialAccessor(RuntimeMaterialCode, MaterialData, i);
+
+		REQUIRE(GeneratedFields.size() == Fields.size() + 1);
+		CHECK(GeneratedFields == RuntimeFields);
+
+		/// And both match the structure itself
+		CHECK(GeneratedFields["ThinWalled"].Bits == std::vector<uint32_t>{Materials[i].ThinWalled});
+
+		if (Materials[i].BaseColorTexture == UINT32_MAX)
+		{
+			FVector3 BaseColor;
+			std::memcpy(&BaseColor, GeneratedFields["BaseColor"].Bits.data(), sizeof(BaseColor));
+			CHECK(BaseColor == Materials[i].BaseColor);
+		}
+		else
+		{
+			CHECK(GeneratedFields["BaseColor"].TextureIndex == Materials[i].BaseColorTexture);
+			CHECK(GeneratedFields["BaseColor"].bConvertToLinear);
+		}
+
+		if (Materials[i].EmissionWeightTexture == UINT32_MAX)
+		{
+			float EmissionWeight;
+			std::memcpy(&EmissionWeight, GeneratedFields["EmissionWeight"].Bits.data(), sizeof(EmissionWeight));
+			CHECK(EmissionWeight == Materials[i].EmissionWeight);
+		}
+		else
+		{
+			CHECK(GeneratedFields["EmissionWeight"].TextureIndex == Materials[i].EmissionWeightTexture);
+		}
+	}
+}
+
+/// Every field is zero and none of them is textured
+FDeviceMaterial CreateUntexturedMaterial()
+{
+	FDeviceMaterial Material;
+	std::memset(&Material, 0, sizeof(Material));
+
+	for (auto& Field : GetMaterialFieldDescriptions())
+	{
+		uint32_t NoTexture = UINT32_MAX;
+		std::memcpy(reinterpret_cast<char*>(&Material) + Field.TextureOffset, &NoTexture, sizeof(NoTexture));
+	}
+
+	return Material;
+}
+
+/// Number of lines of the accessor that read the material buffer or a texture, instead of using a literal
+uint32_t CountMaterialReads(const std::string& Code)
+{
+	uint32_t Count = 0;
+
+	for (auto Position = Code.find("Sample"); Position != std::string::npos; Position = Code.find("Sample", Position + 1))
+	{
+		++Count;
+	}
+
+	return Count;
+}
+
+TEST_CASE( "Material constant folding", "[Shaders]")
+{
+	auto Material = CreateUntexturedMaterial();
+
+	/// Values that are easy to get wrong when printed
+	Material.BaseColor = FVector3(0.1f, 1.f / 3.f, 1e-7f);
+	Material.SpecularIOR = 1.5f;
+	Material.TransmissionDepth = 3.4e38f;
+	Material.SubsurfaceScale = -0.f;
+	Material.EmissionWeight = 2.f;
+	Material.ThinWalled = 1;
+
+	std::vector<uint32_t> MaterialData(sizeof(FDeviceMaterial) / sizeof(uint32_t));
+	std::memcpy(MaterialData.data(), &Material, sizeof(Material));
+
+	/// Nothing is read when nothing is textured
+	auto FoldedCode = GenerateMaterialCode(Material, 0);
+	CHECK(CountMaterialReads(FoldedCode) == 0);
+	CHECK(FoldedCode.find("    Material.BaseColor = vec3(0.100000001, 0.333333343, 1.00000001e-07);\r\n") != std::string::npos);
+	CHECK(FoldedCode.find("    Material.SpecularIOR = 1.5;\r\n") != std::string::npos);
+	CHECK(FoldedCode.find("    Material.EmissionWeight = 2.0;\r\n") != std::string::npos);
+	CHECK(FoldedCode.find("    Material.ThinWalled = 1;\r\n") != std::string::npos);
+
+	/// Literals give back exactly the same values as the material buffer
+	auto FoldedFields = DecodeMaterialAccessor(FoldedCode, MaterialData, 0);
+	auto BufferFields = DecodeMaterialAccessor(GenerateMaterialCode(Material, 0, {}, false), MaterialData, 0);
+	REQUIRE(FoldedFields.size() == GetMaterialFieldDescriptions().size() + 1);
+	CHECK(FoldedFields == BufferFields);
+
+	/// Without folding, every field is read from the buffer
+	CHECK(CountMaterialReads(GenerateMaterialCode(Material, 0, {}, false)) == GetMaterialFieldDescriptions().size());
+
+	/// Textured and animatable fields are never folded
+	Material.SheenColorTexture = 7;
+	auto Code = GenerateMaterialCode(Material, 5, {"CoatWeight", "ThinWalled"});
+	CHECK(CountMaterialReads(Code) == 3);
+	CHECK(Code.find("    Material.SheenColor = SRGBToLinear(SampleVec3(5, " + std::to_string(offsetof(FDeviceMaterial, SheenColorTexture) / 4) + ", TextureCoords));\r\n") != std::string::npos);
+	CHECK(Code.find("    Material.CoatWeight = SampleFloat(5, " + std::to_string(offsetof(FDeviceMaterial, CoatWeight) / 4) + ");\r\n") != std::string::npos);
+	CHECK(Code.find("    Material.ThinWalled = SampleUint(5, " + std::to_string(offsetof(FDeviceMaterial, ThinWalled) / 4) + ");\r\n") != std::string::npos);
+
+	/// GLSL has no literals for NaN and infinity
+	Material.Metalness = std::numeric_limits<float>::quiet_NaN();
+	Material.Normal.Y = std::numeric_limits<float>::infinity();
+	Code = GenerateMaterialCode(Material, 5);
+	CHECK(Code.find("    Material.Metalness = SampleFloat(5, " + std::to_string(offsetof(FDeviceMaterial, Metalness) / 4) + ");\r\n") != std::string::npos);
+	CHECK(Code.find("    Material.Normal = SampleVec3(5, " + std::to_string(offsetof(FDeviceMaterial, Normal) / 4) + ");\r\n") != std::string::npos);
+}
+
+TEST_CASE( "Material layers specialization", "[Shaders]")
+{
+	auto Material = CreateUntexturedMaterial();
+
+	Material.BaseWeight = 1.f;
+	Material.SpecularWeight = 0.5f;
+
+	std::vector<std::string> Expected = {"DISABLE_TRANSMISSION_LAYER", "DISABLE_SUBSURFACE_LAYER", "DISABLE_SHEEN_LAYER", "DISABLE_COAT_LAYER"};
+	CHECK(GetDisabledMaterialLayers(Material) == Expected);
+
+	/// A textured or animatable weight might become non zero at any moment
+	Material.SheenWeightTexture = 3;
+	Expected = {"DISABLE_SUBSURFACE_LAYER", "DISABLE_COAT_LAYER"};
+	CHECK(GetDisabledMaterialLayers(Material, {"TransmissionWeight"}) == Expected);
+
+	/// Emission is never disabled, even when it's the only layer left
+	Material = CreateUntexturedMaterial();
+
+	auto DisabledLayers = GetDisabledMaterialLayers(Material);
+	CHECK(DisabledLayers.size() == 6);
+	CHECK(std::find(DisabledLayers.begin(), DisabledLayers.end(), "DISABLE_EMISSION_LAYER") == DisabledLayers.end());
+
+	/// The master shader should still compile with every layer disabled and every field folded
+	FCompileDefinitions CompileDefinitions = GetMasterShaderDefinitions(0);
+	CompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords);", GenerateMaterialCode(Material, 0));
+
+	for (auto& Define : DisabledLayers)
+	{
+		CompileDefinitions.Push(Define, "1");
+	}
+
+	CHECK_FALSE(CompileShaderToSpirVData("../src/shaders/master_shader.rgen", &CompileDefinitions, nullptr).empty());
+}
+
+TEST_CASE( "Uber shader compilation", "[Shaders]")
+{
+	/// Same definitions the master shader gets in EMaterialPipelineMode::Uber
+	FCompileDefinitions CompileDefinitions = GetMasterShaderDefinitions(0);
+	CompileDefinitions.Push("UBER_SHADER", "1");
+	CompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords, uint MaterialIndex);", GenerateRuntimeMaterialCode());
+
+	CHECK_FALSE(CompileShaderToSpirVData("../src/shaders/master_shader.rgen", &CompileDefinitions, nullptr).empty());
+}
+
+TEST_CASE( "Hierarchical IBL sampling shader compilation", "[Shaders]")
+{
+	/// Same definitions the master shader gets with EIBLSamplingMode::Hierarchical
+	FCompileDefinitions CompileDefinitions = GetMasterShaderDefinitions(0);
+	CompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords);", GenerateMaterialCode(CreateUntexturedMaterial(), 0));
+	CompileDefinitions.Push("IBL_HIERARCHICAL_SAMPLING", "1");
+
+	CHECK_FALSE(CompileShaderToSpirVData("../src/shaders/master_shader.rgen", &CompileDefinitions, nullptr).empty());
+}
+
+TEST_CASE( "Light BVH shader compilation", "[Shaders]")
+{
+	/// Same definitions the master shader gets with ELightSamplingMode::BVH for point lights
+	FCompileDefinitions CompileDefinitions = GetMasterShaderDefinitions(0);
+	CompileDefinitions.Push("FDeviceMaterial GetMaterial(vec2 TextureCoords);", GenerateMaterialCode(CreateUntexturedMaterial(), 0));
+	CompileDefinitions.Push("LIGHT_BVH", "1");
+
+	CHECK_FALSE(CompileShaderToSpirVData("../src/shaders/master_shader.rgen", &CompileDefinitions, nullptr).empty());
+}
+
+TEST_CASE( "Parallel shader compilation throughput", "[.Benchmark]")
+{
+	uint32_t MaxThreadsCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t MaterialsCount : {1, 16, 126})
+	{
+		auto Jobs = GetMasterShaderJobs(MaterialsCount);
+
+		for (uint32_t ThreadsCount = 1; ThreadsCount <= MaxThreadsCount; ThreadsCount = (ThreadsCount == MaxThreadsCount) ? ThreadsCount + 1 : std::min(ThreadsCount * 2, MaxThreadsCount))
+		{
+			FShaderCompilationPool ShaderCompilationPool(ThreadsCount, nullptr);
+
+			BENCHMARK(std::to_string(MaterialsCount) + " materials on " + std::to_string(ThreadsCount) + " threads")
+			{
+				return ShaderCompilationPool.CompileBatch(Jobs);
+			};
+		}
+	}
+}
+
+TEST_CASE( "Shader compilation startup", "[.Benchmark]")
+{
+	/// Shaders that tasks compile without extra definitions
+	const std::vector<std::string> Shaders = {
+		"../src/shaders/accumulate.comp",
+		"../src/shaders/advance_render_iteration.comp",
+		"../src/shaders/material_sort_clear_total_material_count.comp",
+		"../src/shaders/material_sort_compute_offsets_per_material.comp",
+		"../src/shaders/material_sort_compute_prefix_sums_down_sweep.comp",
+		"../src/shaders/material_sort_compute_prefix_sums_up_sweep.comp",
+		"../src/shaders/material_sort_count_materials_per_chunk.comp",
+		"../src/shaders/material_sort_prefix_sums_zero_out.comp",
+		"../src/shaders/material_sort_sort_materials.comp",
+		"../src/shaders/miss.comp",
+		"../src/shaders/reset_active_ray_count.comp",
+		"../src/shaders/passthrough.vert",
+		"../src/shaders/passthrough.frag"};
+
+	FShaderCache ShaderCache(CreateTestDirectory("shader_cache_benchmark"));
+
+	auto CompileAll = [&]()
+	{
+		size_t Size = 0;
+
+		for (auto& Shader : Shaders)
+		{
+			Size += CompileShaderToSpirVData(Shader, nullptr, &ShaderCache).size();
+		}
+
+		return Size;
+	};
+
+	/// Clearing the cache takes a fraction of the time of a single compilation, so it's measured together with the compilation
+	BENCHMARK("Cold cache")
+	{
+		ShaderCache.Clear();
+		return CompileAll();
+	};
+
+	BENCHMARK("Warm cache")
+	{
+		return CompileAll();
+	};
+
+	WARN("Cache hits: " << ShaderCache.GetHitsCount() << ", misses: " << ShaderCache.GetMissesCount());
+}
+
+TEST_CASE( "Shader preprocessing", "[.Benchmark]")
+{
+	auto CompileDefinitions = GetMasterShaderDefinitions(0);
+
+	/// Every header is read from the disk for every shader, like it was before the file table
+	BENCHMARK("Cold file table")
+	{
+		SHADER_FILE_TABLE()->Clear();
+		return ExpandShaderSource("../src/shaders/master_shader.rgen", &CompileDefinitions);
+	};
+
+	BENCHMARK("Warm file table")
+	{
+		return ExpandShaderSource("../src/shaders/master_shader.rgen", &CompileDefinitions);
+	};
+}
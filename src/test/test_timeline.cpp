@@ -0,0 +1,143 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include "timeline_schedule.h"
+
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t GRAPHICS_QUEUE = 1;
+	constexpr uint32_t COMPUTE_QUEUE = 2;
+
+	/// Submits of a frame done pass by pass: the passes before the bounces, the passes of every bounce and the passthrough on the graphics queue
+	std::vector<FTimelineValue> SubmitFrame(FTimelineSchedule& Schedule, uint32_t Bounces, bool bReset)
+	{
+		std::vector<FTimelineValue> Values;
+		uint32_t ComputeSubmits = (bReset ? 6 : 4) + Bounces * 11 + 2;
+
+		for (uint32_t i = 0; i < ComputeSubmits; ++i)
+		{
+			Values.push_back(Schedule.Signal(COMPUTE_QUEUE));
+		}
+
+		Values.push_back(Schedule.Signal(GRAPHICS_QUEUE));
+
+		return Values;
+	}
+}
+
+TEST_CASE( "Timeline values per queue", "[Synchronization]")
+{
+	FTimelineSchedule Schedule(2);
+
+	CHECK(Schedule.GetLastValue(COMPUTE_QUEUE) == 0);
+
+	/// Every queue counts on its own, starting from one, as zero is the initial value of the semaphores
+	CHECK(Schedule.Signal(COMPUTE_QUEUE) == FTimelineValue{COMPUTE_QUEUE, 1});
+	CHECK(Schedule.Signal(COMPUTE_QUEUE) == FTimelineValue{COMPUTE_QUEUE, 2});
+	CHECK(Schedule.Signal(GRAPHICS_QUEUE) == FTimelineValue{GRAPHICS_QUEUE, 1});
+	CHECK(Schedule.GetLastValue(COMPUTE_QUEUE) == 2);
+	CHECK(Schedule.GetLastValue(GRAPHICS_QUEUE) == 1);
+
+	/// Submits outside of frames don't hold any frame back
+	CHECK(Schedule.BeginFrame(0).empty());
+	CHECK(Schedule.GetFrameValues(0).empty());
+
+	Schedule.Signal(COMPUTE_QUEUE);
+	auto FrameValues = Schedule.GetFrameValues(0);
+	REQUIRE(FrameValues.size() == 1);
+	CHECK(FrameValues[0] == FTimelineValue{COMPUTE_QUEUE, 3});
+}
+
+TEST_CASE( "Timeline frames in flight wraparound", "[Synchronization]")
+{
+	for (uint32_t FramesInFlight : {1u, 2u, 3u})
+	{
+		FTimelineSchedule Schedule(FramesInFlight);
+		std::vector<std::vector<FTimelineValue>> SubmittedFrames;
+
+		for (uint64_t FrameIndex = 0; FrameIndex < 10; ++FrameIndex)
+		{
+			auto ValuesToWait = Schedule.BeginFrame(FrameIndex);
+
+			if (FrameIndex < FramesInFlight)
+			{
+				/// Nothing used the slot yet
+				CHECK(ValuesToWait.empty());
+			}
+			else
+			{
+				/// Exactly the last values the frame that used the slot signalled, nothing newer
+				auto& PreviousFrame = SubmittedFrames[FrameIndex - FramesInFlight];
+				REQUIRE(ValuesToWait.size() == 2);
+				CHECK(ValuesToWait[0] == PreviousFrame.back());
+				CHECK(ValuesToWait[1] == PreviousFrame[PreviousFrame.size() - 2]);
+			}
+
+			SubmittedFrames.push_back(SubmitFrame(Schedule, 2, FrameIndex % 3 == 0));
+		}
+
+		/// Only the frames still in flight are remembered
+		CHECK(Schedule.GetFrameValues(9).size() == 2);
+		CHECK(Schedule.GetFrameValues(10 - FramesInFlight).size() == 2);
+
+		if (FramesInFlight < 10)
+		{
+			CHECK(Schedule.GetFrameValues(9 - FramesInFlight).empty());
+		}
+	}
+}
+
+TEST_CASE( "Timeline bounce counts", "[Synchronization]")
+{
+	for (uint32_t Bounces : {1u, 4u, 7u})
+	{
+		FTimelineSchedule Schedule(2);
+		uint64_t ComputeValue = 0;
+
+		for (uint64_t FrameIndex = 0; FrameIndex < 6; ++FrameIndex)
+		{
+			Schedule.BeginFrame(FrameIndex);
+			/// Only the first frame resets the accumulation, so frames signal different numbers of values
+			bool bReset = FrameIndex == 0;
+			SubmitFrame(Schedule, Bounces, bReset);
+			ComputeValue += (bReset ? 6 : 4) + Bounces * 11 + 2;
+
+			auto FrameValues = Schedule.GetFrameValues(FrameIndex);
+			REQUIRE(FrameValues.size() == 2);
+			CHECK(FrameValues[0] == FTimelineValue{GRAPHICS_QUEUE, FrameIndex + 1});
+			CHECK(FrameValues[1] == FTimelineValue{COMPUTE_QUEUE, ComputeValue});
+		}
+
+		/// The sixth frame waits for the fourth one
+		auto ValuesToWait = Schedule.BeginFrame(6);
+		REQUIRE(ValuesToWait.size() == 2);
+		CHECK(ValuesToWait[1].Value == ComputeValue - (4 + Bounces * 11 + 2));
+	}
+}
+
+TEST_CASE( "Timeline frames in flight change", "[Synchronization]")
+{
+	FTimelineSchedule Schedule(2);
+
+	Schedule.BeginFrame(0);
+	SubmitFrame(Schedule, 1, true);
+	Schedule.BeginFrame(1);
+	SubmitFrame(Schedule, 1, false);
+	uint64_t LastValue = Schedule.GetLastValue(COMPUTE_QUEUE);
+
+	/// Slots are forgotten, values keep growing because semaphores can't be reset
+	Schedule.SetFramesInFlight(3);
+	CHECK(Schedule.GetFramesInFlight() == 3);
+	CHECK(Schedule.GetFrameValues(1).empty());
+
+	for (uint64_t FrameIndex = 0; FrameIndex < 3; ++FrameIndex)
+	{
+		CHECK(Schedule.BeginFrame(FrameIndex).empty());
+		CHECK(Schedule.Signal(COMPUTE_QUEUE).Value == ++LastValue);
+	}
+
+	auto ValuesToWait = Schedule.BeginFrame(3);
+	REQUIRE(ValuesToWait.size() == 1);
+	CHECK(ValuesToWait[0] == FTimelineValue{COMPUTE_QUEUE, LastValue - 2});
+}
@@ -0,0 +1,11 @@
+#include "test_utils.h"
+
+#include <filesystem>
+
+std::string CreateTestDirectory(const std::string& Name)
+{
+	auto Directory = std::filesystem::temp_directory_path() / ("rtracer_" + Name);
+	std::filesystem::remove_all(Directory);
+	std::filesystem::create_directories(Directory);
+	return Directory.string() + "/";
+}
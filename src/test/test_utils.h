@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string>
+
+/// Every test gets its own empty directory, so that they don't see each other's entries
+std::string CreateTestDirectory(const std::string& Name);
@@ -0,0 +1,52 @@
+#include "ray_compaction.h"
+
+#include "utils.h"
+
+#include <cassert>
+
+FCompactedRays CompactRays(const std::vector<uint32_t>& PixelIndices, uint32_t RayCount, const std::vector<uint32_t>& MaterialIndices, uint32_t MaterialCount, uint32_t ChunkSize)
+{
+    assert(RayCount <= PixelIndices.size() && "Can't compact more rays than there are");
+
+    uint32_t GroupCount = CalculateGroupCount(RayCount, ChunkSize);
+
+    /// Count materials per chunk, one row of chunks per material, same as the counted materials per chunk buffer
+    std::vector<uint32_t> ChunkOffsets(size_t(MaterialCount) * GroupCount, 0);
+
+    for (uint32_t i = 0; i < RayCount; ++i)
+    {
+        uint32_t MaterialIndex = MaterialIndices[PixelIndices[i]];
+        assert(MaterialIndex < MaterialCount && "Material index is out of range");
+        ++ChunkOffsets[size_t(MaterialIndex) * GroupCount + i / ChunkSize];
+    }
+
+    /// Exclusive scan of the rows, one after another, gives the first ray of every chunk, and the running total at the start of a row is the offset of its material
+    FCompactedRays CompactedRays;
+    CompactedRays.MaterialOffsets.resize(MaterialCount);
+    uint32_t MaterialOffset = 0;
+
+    for (uint32_t Material = 0; Material < MaterialCount; ++Material)
+    {
+        CompactedRays.MaterialOffsets[Material] = MaterialOffset;
+        uint32_t* Row = ChunkOffsets.data() + size_t(Material) * GroupCount;
+
+        for (uint32_t Chunk = 0; Chunk < GroupCount; ++Chunk)
+        {
+            uint32_t Count = Row[Chunk];
+            Row[Chunk] = MaterialOffset;
+            MaterialOffset += Count;
+        }
+    }
+
+    /// Scatter, every ray takes the next slot of its chunk
+    CompactedRays.PixelIndices.resize(RayCount);
+
+    for (uint32_t i = 0; i < RayCount; ++i)
+    {
+        uint32_t PixelIndex = PixelIndices[i];
+        uint32_t MaterialIndex = MaterialIndices[PixelIndex];
+        CompactedRays.PixelIndices[ChunkOffsets[size_t(MaterialIndex) * GroupCount + i / ChunkSize]++] = PixelIndex;
+    }
+
+    return CompactedRays;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// Rays of a bounce packed by material
+struct FCompactedRays
+{
+    /// Pixel of every ray, rays of the same material are contiguous and materials go in order
+    std::vector<uint32_t> PixelIndices;
+    /// First ray of every material
+    std::vector<uint32_t> MaterialOffsets;
+};
+
+/// CPU reference of the material sort passes: count the materials of every BASIC_CHUNK_SIZE like chunk of rays,
+/// exclusive scan the counts, then scatter every ray's pixel to its material's offset plus its chunk's offset.
+/// Only the first RayCount rays of PixelIndices are compacted, MaterialIndices is indexed by pixel like the material indices AOV.
+/// Keeps the order of rays within a material, which the GPU's atomics don't, so compare the packed sets, not the order
+FCompactedRays CompactRays(const std::vector<uint32_t>& PixelIndices, uint32_t RayCount, const std::vector<uint32_t>& MaterialIndices, uint32_t MaterialCount, uint32_t ChunkSize);
@@ -5,43 +5,6 @@ size_t FindString(const std::string& StringToCheck, const std::string& StringToF
     return StringToCheck.find(StringToFind);
 }
 
-std::string GetStringTillTheEOL(const std::string& StringToCheck, size_t StartingChar)
-{
-    auto StartingIndex = StartingChar;
-    size_t Length = 0;
-
-    while (StringToCheck[StartingChar] != '\r')
-    {
-        StartingChar++;
-        Length++;
-    }
-
-    std::string Result = StringToCheck.substr(StartingIndex, Length);
-    return Result;
-}
-
-std::string GetIncludeFileName(const std::string& StringToCheck, size_t StartingChar)
-{
-    while (StringToCheck[StartingChar] != '"')
-    {
-        StartingChar++;
-    }
-
-    StartingChar++;
-    size_t StartingIndex = StartingChar;
-    size_t Length = 0;
-
-    while (StringToCheck[StartingChar] != '"')
-    {
-        StartingChar++;
-        Length++;
-    }
-
-    std::string Result = StringToCheck.substr(StartingIndex, Length);
-
-    return Result;
-}
-
 size_t ReplaceString(std::string& StringToModify, const std::string& StringToBeReplaced, const std::string& StringToUseAsReplacements, size_t StartingChar)
 {
     auto CharIndex = RemoveString(StringToModify, StringToBeReplaced);
@@ -4,7 +4,8 @@
 
 uint32_t CalculateGroupCount(uint32_t NumberOfElements, uint32_t ElementsInGroup)
 {
-    return (NumberOfElements + ElementsInGroup - 1) / ElementsInGroup;
+    /// Rounding up by adding ElementsInGroup - 1 would overflow for large counts
+    return NumberOfElements / ElementsInGroup + ((NumberOfElements % ElementsInGroup) != 0 ? 1 : 0);
 }
 
 uint32_t CalculateMaxGroupCount(uint32_t NumberOfElements, uint32_t ElementsInGroup)
@@ -13,6 +14,21 @@ uint32_t CalculateMaxGroupCount(uint32_t NumberOfElements, uint32_t ElementsInGr
     return 2 << Log2(GroupCount);
 }
 
+std::vector<FBounceDispatchSizes> CalculateBounceDispatchSizes(uint32_t TotalSize, const std::vector<FBounceRayCounts>& RaySurvivalHistogram, uint32_t ElementsInGroup)
+{
+    std::vector<FBounceDispatchSizes> DispatchSizes;
+    DispatchSizes.reserve(RaySurvivalHistogram.size());
+    uint32_t TracedRays = TotalSize;
+
+    for (auto& RayCounts : RaySurvivalHistogram)
+    {
+        DispatchSizes.push_back({TracedRays, CalculateGroupCount(RayCounts.MissedRays, ElementsInGroup)});
+        TracedRays = RayCounts.ActiveRays;
+    }
+
+    return DispatchSizes;
+}
+
 void AddPrecedingZeroes(std::string& String, int ZeroesCount)
 {
 	if (String.size() >= ZeroesCount)
@@ -2,11 +2,31 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 uint32_t CalculateGroupCount(uint32_t NumberOfElements, uint32_t ElementsInGroup);
 
 uint32_t CalculateMaxGroupCount(uint32_t NumberOfElements, uint32_t ElementsInGroup);
 
+/// Rays of a bounce that hit a material and that missed everything, e.g. read back from the counted materials
+struct FBounceRayCounts
+{
+    uint32_t ActiveRays = 0;
+    uint32_t MissedRays = 0;
+};
+
+/// Indirect arguments the GPU writes for a bounce
+struct FBounceDispatchSizes
+{
+    /// Rays traced by the bounce
+    uint32_t TraceRaysWidth = 0;
+    uint32_t MissGroupCount = 0;
+};
+
+/// CPU reference of the indirect arguments for a ray survival histogram. The first bounce traces every pixel,
+/// the next ones trace the rays which hit a material in the previous bounce
+std::vector<FBounceDispatchSizes> CalculateBounceDispatchSizes(uint32_t TotalSize, const std::vector<FBounceRayCounts>& RaySurvivalHistogram, uint32_t ElementsInGroup);
+
 void AddPrecedingZeroes(std::string& s, int ZeroesCount);
 
 float LinearToSRGB(float X);
@@ -1,52 +1,27 @@
-#pragma once
-
 #include "buffer.h"
 
 #include <cassert>
 
 bool operator==(const FMemoryPtr& A, const FMemoryPtr& B)
 {
-    return (A.Offset == B.Offset);
+    return (A.Offset == B.Offset) && (A.Size == B.Size);
 }
 
-size_t std::hash<FMemoryPtr>::operator()(FMemoryPtr const& MemoryPtr) const
+FMemoryPtr FBuffer::Allocate(VkDeviceSize Size, VkDeviceSize Alignment)
 {
-    return std::hash<std::uint32_t>{}(MemoryPtr.Offset);
-}
+    auto Offset = MemoryRegion.Suballocator.Allocate(Size, Alignment);
 
-FMemoryPtr FBuffer::CheckAvailableMemory(VkDeviceSize Size)
-{
-    FMemoryPtr Result;
+    assert(Offset && "Failed to find big enough memory chunk in buffer");
 
-    for (auto& Entry : MemoryRegion.MemoryPtrs)
+    if (!Offset)
     {
-        if (Entry.Size >= Size)
-        {
-            Result.Size = Size;
-            Result.Offset = Entry.Offset;
-            return Result;
-        }
+        return FMemoryPtr{};
     }
 
-    assert("Failed to find big enough memory chunk in buffer");
-
-    return Result;
+    return {*Offset, Size};
 }
 
-FMemoryPtr FBuffer::ReserveMemory(FMemoryPtr MemoryChunk)
+void FBuffer::Free(const FMemoryPtr& MemoryChunk)
 {
-    auto Entry = MemoryRegion.MemoryPtrs.find(MemoryChunk);
-    if (Entry != MemoryRegion.MemoryPtrs.end())
-    {
-        FMemoryPtr NewValue;
-        NewValue.Size = Entry->Size - MemoryChunk.Size;
-        NewValue.Offset = Entry->Offset + MemoryChunk.Size;
-        MemoryRegion.MemoryPtrs.erase(Entry);
-        MemoryRegion.MemoryPtrs.insert(NewValue);
-        return MemoryChunk;
-    }
-
-    assert("Failed to find reserve memory chunk in buffer");
-
-    return FMemoryPtr{};
-}
\ No newline at end of file
+    MemoryRegion.Suballocator.Free(MemoryChunk.Offset, MemoryChunk.Size);
+}
@@ -2,7 +2,9 @@
 
 #include "vulkan/vulkan.h"
 
-#include <unordered_set>
+#include "memory_pool.h"
+#include "suballocator.h"
+
 #include <memory>
 
 struct FBuffer;
@@ -15,16 +17,17 @@ struct FMemoryPtr
 
 bool operator==(const FMemoryPtr& A, const FMemoryPtr& B);
 
-template<>
-struct std::hash<FMemoryPtr>
-{
-    size_t operator()(FMemoryPtr const& MemoryPtr) const;
-};
-
 struct FMemoryRegion
 {
+    /// Device memory block the resource is bound to. It might be shared with other resources
     VkDeviceMemory Memory = VK_NULL_HANDLE;
-    std::unordered_set<FMemoryPtr> MemoryPtrs;
+    /// Offset of the resource inside the memory block
+    VkDeviceSize Offset = 0;
+    /// Where the resource came from, so the memory can be returned to the right pool
+    FPoolAllocation Allocation;
+    bool bImageMemory = false;
+    /// Keeps track of which parts of the memory region are in use
+    FSuballocator Suballocator;
 };
 
 struct FBuffer
@@ -34,6 +37,8 @@ struct FBuffer
     VkDeviceSize CurrentOffset = 0;
     FMemoryRegion MemoryRegion;
 
-    FMemoryPtr CheckAvailableMemory(VkDeviceSize Size);
-    FMemoryPtr ReserveMemory(FMemoryPtr MemoryChunk);
+    /// Reserve a chunk of the buffer, returns a chunk with zero size if there's no free space
+    FMemoryPtr Allocate(VkDeviceSize Size, VkDeviceSize Alignment = 1);
+    /// Return the chunk back to the buffer
+    void Free(const FMemoryPtr& MemoryChunk);
 };
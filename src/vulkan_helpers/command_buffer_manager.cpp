@@ -110,8 +110,21 @@ void FCommandBufferManager::EndCommand(VkCommandBuffer &CommandBuffer)
 
 void FCommandBufferManager::SubmitCommandBuffer(VkCommandBuffer &CommandBuffer, VkQueueFlagBits QueueType)
 {
+    /// Single time commands might read uploaded data, and they might be submitted to a different queue, so they wait for the uploads on the GPU
+    FTimelinePoint UploadsFinished = RESOURCE_ALLOCATOR()->GetUploadsFinishedPoint();
+    VkPipelineStageFlags WaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    VkTimelineSemaphoreSubmitInfo TimelineSemaphoreSubmitInfo{};
+    TimelineSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    TimelineSemaphoreSubmitInfo.waitSemaphoreValueCount = 1;
+    TimelineSemaphoreSubmitInfo.pWaitSemaphoreValues = &UploadsFinished.Value;
+
     VkSubmitInfo SubmitInfo{};
     SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.pNext = &TimelineSemaphoreSubmitInfo;
+    SubmitInfo.waitSemaphoreCount = 1;
+    SubmitInfo.pWaitSemaphores = &UploadsFinished.Semaphore;
+    SubmitInfo.pWaitDstStageMask = &WaitStage;
     SubmitInfo.commandBufferCount = 1;
     SubmitInfo.pCommandBuffers = &CommandBuffer;
 
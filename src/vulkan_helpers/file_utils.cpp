@@ -0,0 +1,70 @@
+#include "file_utils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    const std::string TEMPORARY_FILE_MARKER = ".tmp";
+}
+
+uint64_t ComputeChecksum(const void* Data, size_t Size)
+{
+    auto Bytes = static_cast<const unsigned char*>(Data);
+    uint64_t Hash = 0xcbf29ce484222325;
+
+    for (size_t i = 0; i < Size; ++i)
+    {
+        Hash ^= Bytes[i];
+        Hash *= 0x100000001b3;
+    }
+
+    return Hash;
+}
+
+bool WriteFileAtomically(const std::string& Path, std::initializer_list<FFileChunk> Chunks)
+{
+    std::stringstream TemporaryPath;
+    TemporaryPath << Path << TEMPORARY_FILE_MARKER << std::hash<std::thread::id>()(std::this_thread::get_id()) << std::random_device()();
+
+    {
+        std::ofstream File(TemporaryPath.str(), std::ios::out | std::ios::binary);
+
+        if (!File.is_open())
+        {
+            return false;
+        }
+
+        for (auto& Chunk : Chunks)
+        {
+            File.write(static_cast<const char*>(Chunk.Data), Chunk.Size);
+        }
+
+        if (!File.good())
+        {
+            File.close();
+            std::error_code ErrorCode;
+            std::filesystem::remove(TemporaryPath.str(), ErrorCode);
+            return false;
+        }
+    }
+
+    std::error_code ErrorCode;
+    std::filesystem::rename(TemporaryPath.str(), Path, ErrorCode);
+
+    if (ErrorCode)
+    {
+        std::filesystem::remove(TemporaryPath.str(), ErrorCode);
+        return false;
+    }
+
+    return true;
+}
+
+bool IsTemporaryFile(const std::filesystem::path& Path)
+{
+    return Path.filename().string().find(TEMPORARY_FILE_MARKER) != std::string::npos;
+}
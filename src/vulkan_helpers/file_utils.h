@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/// FNV-1a hash of the data, used to detect corrupted cache files
+uint64_t ComputeChecksum(const void* Data, size_t Size);
+
+/// Part of the data written with WriteFileAtomically
+struct FFileChunk
+{
+    const void* Data = nullptr;
+    uint64_t Size = 0;
+};
+
+/**
+ * Writes the chunks one after another to a temporary file next to Path and then renames it to Path.
+ * Every writer gets its own temporary file, so neither a crash nor a concurrent writer leaves a half written file behind.
+ * Returns false if the file wasn't written, the temporary file is removed in that case
+ */
+bool WriteFileAtomically(const std::string& Path, std::initializer_list<FFileChunk> Chunks);
+
+/// Whether the file is a temporary file of WriteFileAtomically. They are only left behind if the process dies before the rename
+bool IsTemporaryFile(const std::filesystem::path& Path);
+
+/**
+ * Reads a file written as a header followed by the payload. The header should have Magic, Version, Size of the payload in bytes and its Checksum.
+ * Returns false if there's no file, the magic or the version doesn't match, the size doesn't match the file or the checksum is wrong
+ */
+template <typename HeaderType, typename ElementType>
+bool ReadCheckedFile(const std::string& Path, uint32_t Magic, uint32_t Version, HeaderType& Header, std::vector<ElementType>& Payload)
+{
+    std::ifstream File(Path, std::ios::ate | std::ios::binary);
+
+    if (!File.is_open())
+    {
+        return false;
+    }
+
+    uint64_t FileSize = (uint64_t)File.tellg();
+    File.seekg(0);
+
+    if (FileSize < sizeof(HeaderType) || !File.read(reinterpret_cast<char*>(&Header), sizeof(Header)))
+    {
+        return false;
+    }
+
+    if (Header.Magic != Magic || Header.Version != Version || Header.Size != FileSize - sizeof(HeaderType) || Header.Size % sizeof(ElementType) != 0)
+    {
+        return false;
+    }
+
+    Payload.resize(Header.Size / sizeof(ElementType));
+    return File.read(reinterpret_cast<char*>(Payload.data()), Header.Size) && ComputeChecksum(Payload.data(), Header.Size) == Header.Checksum;
+}
@@ -48,7 +48,12 @@ FImage::~FImage()
     if (!bIsWrappedImage)
     {
         vkDestroyImage(Device, Image, nullptr);
-        vkFreeMemory(Device, MemoryRegion.Memory, nullptr);
+
+        /// The allocator frees every memory block when it's destroyed, dedicated ones included, and RESOURCE_ALLOCATOR() would create a new one
+        if (IsResourceAllocatorAlive())
+        {
+            RESOURCE_ALLOCATOR()->FreeMemory(MemoryRegion);
+        }
     }
 }
 
@@ -235,12 +240,12 @@ void FImage::AllocateMemory()
 
     Size = MemRequirements.size;
 
-    MemoryRegion = RESOURCE_ALLOCATOR()->AllocateMemory(MemRequirements.size, MemRequirements, Properties);
+    MemoryRegion = RESOURCE_ALLOCATOR()->AllocateMemory(MemRequirements, Properties, true);
 }
 
 void FImage::BindMemoryToImage()
 {
-    vkBindImageMemory(Device, Image, MemoryRegion.Memory, 0);
+    vkBindImageMemory(Device, Image, MemoryRegion.Memory, MemoryRegion.Offset);
 }
 
 void FImage::CreateImageView()
@@ -374,6 +379,33 @@ void FImage::Resolve(FImage& ImageToResolveTo)
     }, VK_QUEUE_GRAPHICS_BIT, "Resolving_Image");
 }
 
+VkDeviceSize FImage::GetTexelSize() const
+{
+    switch (Format)
+    {
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        {
+            return 4;
+        }
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+        {
+            return 16;
+        }
+        case VK_FORMAT_R32_UINT:
+        {
+            return 4;
+        }
+        case VK_FORMAT_R32G32_UINT:
+        {
+            return 8;
+        }
+        default:
+        {
+            throw std::runtime_error("Unsupported image format!");
+        }
+    }
+}
+
 size_t FImage::GetHash()
 {
     return std::hash<FImage>()(*this);
@@ -46,6 +46,8 @@ struct FImage
 
     void GenerateMipMaps();
     void Resolve(FImage& Image);
+    /// Size of a single texel in bytes, only for formats we read back from the GPU
+    VkDeviceSize GetTexelSize() const;
 
     /// In case we need to put an image into a map or set
     size_t GetHash();
@@ -0,0 +1,375 @@
+#include "importance_map_cache.h"
+#include "file_utils.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// "RIBL" in little endian
+    constexpr uint32_t IMPORTANCE_MAP_CACHE_MAGIC = 0x4C424952;
+    /// Bump when the layout of the entries or the way the tables are built changes
+    constexpr uint32_t IMPORTANCE_MAP_CACHE_VERSION = 1;
+    const std::string IMPORTANCE_MAP_CACHE_EXTENSION = ".ibl";
+
+    struct FImportanceMapCacheHeader
+    {
+        uint32_t Magic = IMPORTANCE_MAP_CACHE_MAGIC;
+        uint32_t Version = IMPORTANCE_MAP_CACHE_VERSION;
+        FImportanceMapCacheKey Key;
+        /// Sizes of the tables in bytes, they follow the header one after another
+        uint64_t ImportanceSize = 0;
+        uint64_t PDFSize = 0;
+        /// ComputeTablesChecksum of both tables
+        uint64_t Checksum = 0;
+    };
+
+    static_assert(sizeof(FImportanceMapCacheHeader) % sizeof(uint64_t) == 0, "Tables should start aligned");
+
+    constexpr uint64_t CONTENT_HASH_PRIME = 0x100000001b3;
+    constexpr uint64_t CONTENT_HASH_SEEDS[] = {0xcbf29ce484222325, 0x84222325cbf29ce4, 0x9e3779b97f4a7c15, 0xc2b2ae3d27d4eb4f};
+
+    uint64_t Mix(uint64_t Value)
+    {
+        Value ^= Value >> 33;
+        Value *= 0xff51afd7ed558ccd;
+        Value ^= Value >> 33;
+        return Value;
+    }
+
+    uint64_t ComputeTablesChecksum(const void* ImportanceData, uint64_t ImportanceSize, const void* PDFData, uint64_t PDFSize)
+    {
+        return (ComputeContentHash(ImportanceData, ImportanceSize) * CONTENT_HASH_PRIME) ^ ComputeContentHash(PDFData, PDFSize);
+    }
+
+    /// Validates the file and fills the sizes of the tables, FileData is the whole file
+    bool ValidateEntry(const char* FileData, uint64_t FileSize, const FImportanceMapCacheKey& Key, uint64_t& ImportanceSize, uint64_t& PDFSize)
+    {
+        if (FileSize < sizeof(FImportanceMapCacheHeader))
+        {
+            return false;
+        }
+
+        FImportanceMapCacheHeader Header;
+        std::memcpy(&Header, FileData, sizeof(Header));
+
+        if (Header.Magic != IMPORTANCE_MAP_CACHE_MAGIC || Header.Version != IMPORTANCE_MAP_CACHE_VERSION)
+        {
+            return false;
+        }
+
+        /// Environment map changed since the entry was written
+        if (Header.Key != Key)
+        {
+            return false;
+        }
+
+        uint64_t PayloadSize = FileSize - sizeof(FImportanceMapCacheHeader);
+
+        if (Header.ImportanceSize == 0 || Header.ImportanceSize > PayloadSize || Header.PDFSize != PayloadSize - Header.ImportanceSize)
+        {
+            return false;
+        }
+
+        const char* ImportanceData = FileData + sizeof(FImportanceMapCacheHeader);
+
+        if (ComputeTablesChecksum(ImportanceData, Header.ImportanceSize, ImportanceData + Header.ImportanceSize, Header.PDFSize) != Header.Checksum)
+        {
+            return false;
+        }
+
+        ImportanceSize = Header.ImportanceSize;
+        PDFSize = Header.PDFSize;
+        return true;
+    }
+}
+
+uint64_t ComputeContentHash(const void* Data, size_t Size)
+{
+    auto Bytes = static_cast<const unsigned char*>(Data);
+    uint64_t Lanes[4] = {CONTENT_HASH_SEEDS[0], CONTENT_HASH_SEEDS[1], CONTENT_HASH_SEEDS[2], CONTENT_HASH_SEEDS[3]};
+
+    /// Lanes don't depend on each other, so the multiplications overlap
+    size_t BlocksCount = Size / (4 * sizeof(uint64_t));
+
+    for (size_t i = 0; i < BlocksCount; ++i)
+    {
+        uint64_t Words[4];
+        std::memcpy(Words, Bytes + i * sizeof(Words), sizeof(Words));
+
+        for (uint32_t j = 0; j < 4; ++j)
+        {
+            Lanes[j] = (Lanes[j] ^ Words[j]) * CONTENT_HASH_PRIME;
+        }
+    }
+
+    uint64_t Value = Size;
+
+    for (uint32_t j = 0; j < 4; ++j)
+    {
+        Value = (Value ^ Mix(Lanes[j])) * CONTENT_HASH_PRIME;
+    }
+
+    for (size_t i = BlocksCount * 4 * sizeof(uint64_t); i < Size; ++i)
+    {
+        Value = (Value ^ Bytes[i]) * CONTENT_HASH_PRIME;
+    }
+
+    return Mix(Value);
+}
+
+bool FImportanceMapCacheKey::operator==(const FImportanceMapCacheKey& Other) const
+{
+    return ContentHash == Other.ContentHash && Width == Other.Width && Height == Other.Height && SamplingMode == Other.SamplingMode && bSineWeighted == Other.bSineWeighted;
+}
+
+bool FImportanceMapCacheKey::operator!=(const FImportanceMapCacheKey& Other) const
+{
+    return !(*this == Other);
+}
+
+FImportanceMapCacheEntry::FImportanceMapCacheEntry(FImportanceMapCacheEntry&& Other) noexcept
+{
+    *this = std::move(Other);
+}
+
+FImportanceMapCacheEntry& FImportanceMapCacheEntry::operator=(FImportanceMapCacheEntry&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Reset();
+#ifdef __linux__
+        Mapping = Other.Mapping;
+        MappingSize = Other.MappingSize;
+        Other.Mapping = nullptr;
+        Other.MappingSize = 0;
+#else
+        FileData = std::move(Other.FileData);
+#endif
+        ImportanceSize = Other.ImportanceSize;
+        PDFSize = Other.PDFSize;
+        Other.ImportanceSize = 0;
+        Other.PDFSize = 0;
+    }
+
+    return *this;
+}
+
+FImportanceMapCacheEntry::~FImportanceMapCacheEntry()
+{
+    Reset();
+}
+
+const void* FImportanceMapCacheEntry::GetImportanceData() const
+{
+    return GetFileData() + sizeof(FImportanceMapCacheHeader);
+}
+
+uint64_t FImportanceMapCacheEntry::GetImportanceSize() const
+{
+    return ImportanceSize;
+}
+
+const void* FImportanceMapCacheEntry::GetPDFData() const
+{
+    return GetFileData() + sizeof(FImportanceMapCacheHeader) + ImportanceSize;
+}
+
+uint64_t FImportanceMapCacheEntry::GetPDFSize() const
+{
+    return PDFSize;
+}
+
+void FImportanceMapCacheEntry::Reset()
+{
+#ifdef __linux__
+    if (Mapping != nullptr)
+    {
+        munmap(Mapping, MappingSize);
+        Mapping = nullptr;
+        MappingSize = 0;
+    }
+#else
+    FileData.clear();
+    FileData.shrink_to_fit();
+#endif
+    ImportanceSize = 0;
+    PDFSize = 0;
+}
+
+const char* FImportanceMapCacheEntry::GetFileData() const
+{
+#ifdef __linux__
+    return static_cast<const char*>(Mapping);
+#else
+    return FileData.data();
+#endif
+}
+
+FImportanceMapCache::FImportanceMapCache(const std::string& DirectoryIn)
+{
+    SetDirectory(DirectoryIn);
+}
+
+std::optional<FImportanceMapCacheEntry> FImportanceMapCache::Load(const std::string& SourcePath, const FImportanceMapCacheKey& Key)
+{
+    if (Directory.empty())
+    {
+        MissesCount++;
+        return std::nullopt;
+    }
+
+    auto Path = GetEntryPath(SourcePath, Key);
+    FImportanceMapCacheEntry Entry;
+    uint64_t FileSize = 0;
+
+#ifdef __linux__
+    int FileDescriptor = open(Path.c_str(), O_RDONLY);
+
+    if (FileDescriptor < 0)
+    {
+        MissesCount++;
+        return std::nullopt;
+    }
+
+    struct stat FileStat;
+
+    if (fstat(FileDescriptor, &FileStat) == 0 && FileStat.st_size > 0)
+    {
+        FileSize = FileStat.st_size;
+        /// Tables are only read once to be copied into a staging buffer, so they're read straight from the page cache instead of being copied into memory first
+        void* Mapping = mmap(nullptr, FileSize, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+
+        if (Mapping != MAP_FAILED)
+        {
+            Entry.Mapping = Mapping;
+            Entry.MappingSize = FileSize;
+        }
+    }
+
+    close(FileDescriptor);
+#else
+    std::ifstream File(Path, std::ios::ate | std::ios::binary);
+
+    if (!File.is_open())
+    {
+        MissesCount++;
+        return std::nullopt;
+    }
+
+    FileSize = (uint64_t)File.tellg();
+    File.seekg(0);
+    Entry.FileData.resize(FileSize);
+
+    if (!File.read(Entry.FileData.data(), FileSize))
+    {
+        Entry.FileData.clear();
+    }
+
+    File.close();
+#endif
+
+    bool bValid = Entry.GetFileData() != nullptr && ValidateEntry(Entry.GetFileData(), FileSize, Key, Entry.ImportanceSize, Entry.PDFSize);
+
+    if (!bValid)
+    {
+        Entry.Reset();
+        /// Broken entry would be a miss every time, and a stale one is going to be replaced anyway
+        std::error_code ErrorCode;
+        std::filesystem::remove(Path, ErrorCode);
+        MissesCount++;
+        return std::nullopt;
+    }
+
+    HitsCount++;
+    return Entry;
+}
+
+bool FImportanceMapCache::Store(const std::string& SourcePath, const FImportanceMapCacheKey& Key, const void* ImportanceData, uint64_t ImportanceSize, const void* PDFData, uint64_t PDFSize)
+{
+    if (Directory.empty() || ImportanceSize == 0)
+    {
+        return false;
+    }
+
+    FImportanceMapCacheHeader Header;
+    Header.Key = Key;
+    Header.ImportanceSize = ImportanceSize;
+    Header.PDFSize = PDFSize;
+    Header.Checksum = ComputeTablesChecksum(ImportanceData, ImportanceSize, PDFData, PDFSize);
+
+    return WriteFileAtomically(GetEntryPath(SourcePath, Key), {{&Header, sizeof(Header)}, {ImportanceData, ImportanceSize}, {PDFData, PDFSize}});
+}
+
+void FImportanceMapCache::Clear()
+{
+    if (Directory.empty())
+    {
+        return;
+    }
+
+    std::error_code ErrorCode;
+
+    for (auto& Entry : std::filesystem::directory_iterator(Directory, ErrorCode))
+    {
+        if (Entry.path().extension() == IMPORTANCE_MAP_CACHE_EXTENSION)
+        {
+            std::filesystem::remove(Entry.path(), ErrorCode);
+        }
+    }
+}
+
+void FImportanceMapCache::SetDirectory(const std::string& DirectoryIn)
+{
+    Directory = DirectoryIn;
+
+    if (!Directory.empty())
+    {
+        std::error_code ErrorCode;
+        std::filesystem::create_directories(Directory, ErrorCode);
+    }
+}
+
+const std::string& FImportanceMapCache::GetDirectory() const
+{
+    return Directory;
+}
+
+uint32_t FImportanceMapCache::GetHitsCount() const
+{
+    return HitsCount;
+}
+
+uint32_t FImportanceMapCache::GetMissesCount() const
+{
+    return MissesCount;
+}
+
+std::string FImportanceMapCache::GetEntryPath(const std::string& SourcePath, const FImportanceMapCacheKey& Key) const
+{
+    /// Entry is named after the file and not after its content, so that an edited environment map replaces its old entry instead of piling up next to it
+    std::error_code ErrorCode;
+    auto AbsolutePath = std::filesystem::absolute(SourcePath, ErrorCode).lexically_normal().string();
+
+    if (ErrorCode)
+    {
+        AbsolutePath = SourcePath;
+    }
+
+    std::stringstream Name;
+    Name << std::filesystem::path(SourcePath).stem().string() << "_" << std::hex;
+    Name.width(16);
+    Name.fill('0');
+    Name << ComputeContentHash(AbsolutePath.data(), AbsolutePath.size()) << "_" << Key.SamplingMode << IMPORTANCE_MAP_CACHE_EXTENSION;
+
+    return (std::filesystem::path(Directory) / Name.str()).string();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Hash of large buffers like decoded images. Hashes 64 bit words in four independent lanes, so it runs close to memory speed
+uint64_t ComputeContentHash(const void* Data, size_t Size);
+
+/**
+ * Everything the importance tables of an environment map are built from
+ */
+struct FImportanceMapCacheKey
+{
+    /// ComputeContentHash of the decoded pixels
+    uint64_t ContentHash = 0;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    /// EIBLSamplingMode the tables were built for
+    uint32_t SamplingMode = 0;
+    /// Rows are weighted by the sine of their polar angle
+    uint32_t bSineWeighted = 0;
+
+    bool operator==(const FImportanceMapCacheKey& Other) const;
+    bool operator!=(const FImportanceMapCacheKey& Other) const;
+};
+
+/**
+ * Tables of a cache entry. On Linux the file is memory mapped and the tables point into it, elsewhere the file is read into memory.
+ * Move only, the mapping lives as long as the entry
+ */
+class FImportanceMapCacheEntry
+{
+public:
+    FImportanceMapCacheEntry() = default;
+    FImportanceMapCacheEntry(FImportanceMapCacheEntry&& Other) noexcept;
+    FImportanceMapCacheEntry& operator=(FImportanceMapCacheEntry&& Other) noexcept;
+    FImportanceMapCacheEntry(const FImportanceMapCacheEntry&) = delete;
+    FImportanceMapCacheEntry& operator=(const FImportanceMapCacheEntry&) = delete;
+    ~FImportanceMapCacheEntry();
+
+    const void* GetImportanceData() const;
+    uint64_t GetImportanceSize() const;
+    const void* GetPDFData() const;
+    uint64_t GetPDFSize() const;
+
+private:
+    friend class FImportanceMapCache;
+
+    /// Drops the mapping or the memory
+    void Reset();
+    const char* GetFileData() const;
+
+#ifdef __linux__
+    void* Mapping = nullptr;
+    size_t MappingSize = 0;
+#else
+    std::vector<char> FileData;
+#endif
+    uint64_t ImportanceSize = 0;
+    uint64_t PDFSize = 0;
+};
+
+/**
+ * On-disk cache of IBL importance tables, so that large environment maps don't rebuild them on every start.
+ * There's one entry per environment map file and sampling mode, the entry carries the key of the tables, so when the image changes the stale entry is rebuilt.
+ * Entries carry a checksum, broken and stale ones are removed on load. Files are written to a temporary file first and then renamed.
+ * Empty directory disables the cache.
+ */
+class FImportanceMapCache
+{
+public:
+    explicit FImportanceMapCache(const std::string& DirectoryIn);
+
+    /// Returns nothing if there's no valid entry for the environment map, or it was built from something else than the key
+    std::optional<FImportanceMapCacheEntry> Load(const std::string& SourcePath, const FImportanceMapCacheKey& Key);
+    /// Returns false if the entry wasn't written. Errors are not fatal, since the cache is only an optimization
+    bool Store(const std::string& SourcePath, const FImportanceMapCacheKey& Key, const void* ImportanceData, uint64_t ImportanceSize, const void* PDFData, uint64_t PDFSize);
+    /// Remove every entry
+    void Clear();
+
+    void SetDirectory(const std::string& DirectoryIn);
+    const std::string& GetDirectory() const;
+    uint32_t GetHitsCount() const;
+    uint32_t GetMissesCount() const;
+
+    /// Path of the entry of the environment map
+    std::string GetEntryPath(const std::string& SourcePath, const FImportanceMapCacheKey& Key) const;
+
+private:
+    std::string Directory;
+    std::atomic<uint32_t> HitsCount = 0;
+    std::atomic<uint32_t> MissesCount = 0;
+};
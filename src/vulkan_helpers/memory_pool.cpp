@@ -0,0 +1,154 @@
+#include "memory_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+FMemoryPools::FMemoryPools(IMemoryBlockProvider* ProviderIn, uint64_t BlockSizeIn, uint64_t DedicatedThresholdIn) :
+    Provider(ProviderIn), BlockSize(BlockSizeIn), DedicatedThreshold(std::min(DedicatedThresholdIn, BlockSizeIn))
+{
+    assert(Provider != nullptr && "Memory pools need a block provider");
+}
+
+FMemoryPools::~FMemoryPools()
+{
+    /// Resources destroyed after the pools can't free their memory, so dedicated blocks that are still alive are freed here too
+    for (auto& [MemoryTypeIndex, Pool] : Pools)
+    {
+        for (auto& Block : Pool.Blocks)
+        {
+            Provider->FreeBlock(Block.Handle);
+        }
+
+        for (auto& [Handle, Size] : Pool.DedicatedBlocks)
+        {
+            Provider->FreeBlock(Handle);
+        }
+    }
+}
+
+std::optional<FPoolAllocation> FMemoryPools::Allocate(uint32_t MemoryTypeIndex, uint64_t Size, uint64_t Alignment, bool bDedicated)
+{
+    auto& Pool = Pools[MemoryTypeIndex];
+
+    if (bDedicated || Size > DedicatedThreshold)
+    {
+        uint64_t Handle = Provider->AllocateBlock(MemoryTypeIndex, Size);
+
+        if (Handle == 0)
+        {
+            return std::nullopt;
+        }
+
+        Pool.DedicatedBlocks[Handle] = Size;
+        Pool.DedicatedSize += Size;
+
+        return FPoolAllocation{Handle, 0, Size, MemoryTypeIndex, true};
+    }
+
+    for (auto& Block : Pool.Blocks)
+    {
+        auto Offset = Block.Suballocator.Allocate(Size, Alignment);
+
+        if (Offset)
+        {
+            return FPoolAllocation{Block.Handle, *Offset, Size, MemoryTypeIndex, false};
+        }
+    }
+
+    /// No block has enough free space, so allocate a new one
+    uint64_t Handle = Provider->AllocateBlock(MemoryTypeIndex, BlockSize);
+
+    if (Handle == 0)
+    {
+        return std::nullopt;
+    }
+
+    auto& Block = Pool.Blocks.emplace_back(FMemoryBlock{Handle, FSuballocator(BlockSize)});
+    auto Offset = Block.Suballocator.Allocate(Size, Alignment);
+    assert(Offset && "Allocation doesn't fit into an empty memory block");
+
+    return FPoolAllocation{Handle, *Offset, Size, MemoryTypeIndex, false};
+}
+
+void FMemoryPools::Free(const FPoolAllocation& Allocation)
+{
+    assert(Pools.find(Allocation.MemoryTypeIndex) != Pools.end() && "Freeing memory of a type that was never allocated");
+    auto& Pool = Pools[Allocation.MemoryTypeIndex];
+
+    if (Allocation.bDedicated)
+    {
+        assert(Pool.DedicatedBlocks.find(Allocation.Block) != Pool.DedicatedBlocks.end() && "Freeing a dedicated allocation that doesn't belong to the pool");
+        Provider->FreeBlock(Allocation.Block);
+        Pool.DedicatedBlocks.erase(Allocation.Block);
+        Pool.DedicatedSize -= Allocation.Size;
+        return;
+    }
+
+    auto Block = std::find_if(Pool.Blocks.begin(), Pool.Blocks.end(), [&Allocation](const FMemoryBlock& Block){ return Block.Handle == Allocation.Block; });
+    assert(Block != Pool.Blocks.end() && "Freeing memory from a block that doesn't belong to the pool");
+
+    Block->Suballocator.Free(Allocation.Offset, Allocation.Size);
+
+    /// Keep the last block of the pool even if it's empty, so that a resource recreated every frame doesn't allocate a block every time
+    if (Block->Suballocator.GetAllocationsCount() == 0 && Pool.Blocks.size() > 1)
+    {
+        Provider->FreeBlock(Block->Handle);
+        Pool.Blocks.erase(Block);
+    }
+}
+
+FMemoryPoolStatistics FMemoryPools::GetStatistics(uint32_t MemoryTypeIndex) const
+{
+    FMemoryPoolStatistics Statistics;
+
+    auto Pool = Pools.find(MemoryTypeIndex);
+
+    if (Pool == Pools.end())
+    {
+        return Statistics;
+    }
+
+    Statistics.BlocksCount = Pool->second.Blocks.size();
+    Statistics.DedicatedAllocationsCount = Pool->second.DedicatedBlocks.size();
+    Statistics.AllocationsCount = Pool->second.DedicatedBlocks.size();
+    Statistics.ReservedSize = Pool->second.DedicatedSize;
+    Statistics.UsedSize = Pool->second.DedicatedSize;
+
+    for (auto& Block : Pool->second.Blocks)
+    {
+        Statistics.AllocationsCount += Block.Suballocator.GetAllocationsCount();
+        Statistics.ReservedSize += Block.Suballocator.GetSize();
+        Statistics.UsedSize += Block.Suballocator.GetUsedSize();
+    }
+
+    return Statistics;
+}
+
+FMemoryPoolStatistics FMemoryPools::GetTotalStatistics() const
+{
+    FMemoryPoolStatistics Total;
+
+    for (auto MemoryTypeIndex : GetMemoryTypes())
+    {
+        auto Statistics = GetStatistics(MemoryTypeIndex);
+        Total.BlocksCount += Statistics.BlocksCount;
+        Total.DedicatedAllocationsCount += Statistics.DedicatedAllocationsCount;
+        Total.AllocationsCount += Statistics.AllocationsCount;
+        Total.ReservedSize += Statistics.ReservedSize;
+        Total.UsedSize += Statistics.UsedSize;
+    }
+
+    return Total;
+}
+
+std::vector<uint32_t> FMemoryPools::GetMemoryTypes() const
+{
+    std::vector<uint32_t> MemoryTypes;
+
+    for (auto& [MemoryTypeIndex, Pool] : Pools)
+    {
+        MemoryTypes.push_back(MemoryTypeIndex);
+    }
+
+    return MemoryTypes;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "suballocator.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+/**
+ * Default size of a single memory block that is shared between several resources
+ */
+constexpr uint64_t DEFAULT_MEMORY_BLOCK_SIZE = uint64_t(64) * 1024 * 1024;
+
+/**
+ * Something that can allocate big blocks of memory of a given type.
+ * In the renderer it wraps vkAllocateMemory, in tests it's a fake that only counts allocations
+ */
+class IMemoryBlockProvider
+{
+public:
+    virtual ~IMemoryBlockProvider() = default;
+
+    /// Returns a non zero handle of the allocated block, or 0 if the allocation failed
+    virtual uint64_t AllocateBlock(uint32_t MemoryTypeIndex, uint64_t Size) = 0;
+    virtual void FreeBlock(uint64_t Block) = 0;
+};
+
+/// Part of a memory block that belongs to a single resource
+struct FPoolAllocation
+{
+    /// Handle returned by the block provider
+    uint64_t Block = 0;
+    uint64_t Offset = 0;
+    uint64_t Size = 0;
+    uint32_t MemoryTypeIndex = 0;
+    /// Dedicated allocations own the whole block
+    bool bDedicated = false;
+};
+
+struct FMemoryPoolStatistics
+{
+    uint32_t BlocksCount = 0;
+    uint32_t DedicatedAllocationsCount = 0;
+    /// Number of live resources, both suballocated and dedicated
+    uint32_t AllocationsCount = 0;
+    /// Bytes allocated from the block provider
+    uint64_t ReservedSize = 0;
+    /// Bytes actually used by resources
+    uint64_t UsedSize = 0;
+};
+
+/**
+ * Set of memory pools, one per memory type. Each pool is a list of big blocks that are suballocated between resources,
+ * so the number of allocations done by the block provider grows with the amount of memory used, not with the number of resources.
+ * Resources that are too big to share a block get a dedicated allocation.
+ * Blocks are opaque handles of the block provider.
+ */
+class FMemoryPools
+{
+public:
+    FMemoryPools(IMemoryBlockProvider* ProviderIn, uint64_t BlockSizeIn = DEFAULT_MEMORY_BLOCK_SIZE, uint64_t DedicatedThresholdIn = DEFAULT_MEMORY_BLOCK_SIZE / 2);
+    ~FMemoryPools();
+
+    FMemoryPools(const FMemoryPools&) = delete;
+    FMemoryPools& operator=(const FMemoryPools&) = delete;
+
+    /// Allocations bigger than the dedicated threshold, or ones that explicitly ask for it, get their own block
+    std::optional<FPoolAllocation> Allocate(uint32_t MemoryTypeIndex, uint64_t Size, uint64_t Alignment, bool bDedicated = false);
+    void Free(const FPoolAllocation& Allocation);
+
+    FMemoryPoolStatistics GetStatistics(uint32_t MemoryTypeIndex) const;
+    FMemoryPoolStatistics GetTotalStatistics() const;
+    /// Memory types that have a pool
+    std::vector<uint32_t> GetMemoryTypes() const;
+
+private:
+    struct FMemoryBlock
+    {
+        uint64_t Handle = 0;
+        FSuballocator Suballocator;
+    };
+
+    struct FPool
+    {
+        std::vector<FMemoryBlock> Blocks;
+        /// Sizes of the live dedicated blocks, freed with the pools if their resources outlive them
+        std::map<uint64_t, uint64_t> DedicatedBlocks;
+        uint64_t DedicatedSize = 0;
+    };
+
+    IMemoryBlockProvider* Provider = nullptr;
+    uint64_t BlockSize = DEFAULT_MEMORY_BLOCK_SIZE;
+    uint64_t DedicatedThreshold = DEFAULT_MEMORY_BLOCK_SIZE / 2;
+    std::map<uint32_t, FPool> Pools;
+};
@@ -0,0 +1,107 @@
+#include "pipeline_cache.h"
+#include "file_utils.h"
+
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    /// "RPLC" in little endian
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x434C5052;
+    /// Bump when the layout of the file changes
+    constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+    /// VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+    constexpr uint32_t VULKAN_PIPELINE_CACHE_HEADER_VERSION = 1;
+
+    struct FPipelineCacheFileHeader
+    {
+        uint32_t Magic = PIPELINE_CACHE_MAGIC;
+        uint32_t Version = PIPELINE_CACHE_VERSION;
+        uint32_t VendorID = 0;
+        uint32_t DeviceID = 0;
+        uint32_t DriverVersion = 0;
+        uint32_t Padding = 0;
+        std::array<uint8_t, 16> PipelineCacheUUID{};
+        /// Size of the pipeline cache data in bytes
+        uint64_t Size = 0;
+        uint64_t Checksum = 0;
+    };
+
+    uint32_t ReadUint32(const std::vector<char>& Data, size_t Offset)
+    {
+        uint32_t Value = 0;
+        std::memcpy(&Value, Data.data() + Offset, sizeof(Value));
+        return Value;
+    }
+}
+
+bool IsPipelineCacheDataCompatible(const std::vector<char>& Data, const FPipelineCacheDeviceInfo& DeviceInfo)
+{
+    if (Data.size() < PIPELINE_CACHE_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    /// Layout of VkPipelineCacheHeaderVersionOne: header size, header version, vendor ID, device ID and the UUID
+    uint32_t HeaderSize = ReadUint32(Data, 0);
+    uint32_t HeaderVersion = ReadUint32(Data, 4);
+    uint32_t VendorID = ReadUint32(Data, 8);
+    uint32_t DeviceID = ReadUint32(Data, 12);
+
+    if (HeaderSize < PIPELINE_CACHE_HEADER_SIZE || HeaderSize > Data.size() || HeaderVersion != VULKAN_PIPELINE_CACHE_HEADER_VERSION)
+    {
+        return false;
+    }
+
+    return VendorID == DeviceInfo.VendorID && DeviceID == DeviceInfo.DeviceID &&
+           std::memcmp(Data.data() + 16, DeviceInfo.PipelineCacheUUID.data(), DeviceInfo.PipelineCacheUUID.size()) == 0;
+}
+
+FPipelineCacheFile::FPipelineCacheFile(const std::string& PathIn, const FPipelineCacheDeviceInfo& DeviceInfoIn) : Path(PathIn), DeviceInfo(DeviceInfoIn)
+{
+    std::error_code ErrorCode;
+    auto Directory = std::filesystem::path(Path).parent_path();
+
+    if (!Directory.empty())
+    {
+        std::filesystem::create_directories(Directory, ErrorCode);
+    }
+}
+
+std::optional<std::vector<char>> FPipelineCacheFile::Load()
+{
+    FPipelineCacheFileHeader Header;
+    std::vector<char> Data;
+    bool bValid = ReadCheckedFile(Path, PIPELINE_CACHE_MAGIC, PIPELINE_CACHE_VERSION, Header, Data) &&
+                  Header.VendorID == DeviceInfo.VendorID && Header.DeviceID == DeviceInfo.DeviceID &&
+                  Header.DriverVersion == DeviceInfo.DriverVersion && Header.PipelineCacheUUID == DeviceInfo.PipelineCacheUUID &&
+                  IsPipelineCacheDataCompatible(Data, DeviceInfo);
+
+    if (!bValid)
+    {
+        /// Cache of another driver will never be valid again, and a broken one should not be read on every start
+        std::error_code ErrorCode;
+        std::filesystem::remove(Path, ErrorCode);
+        return std::nullopt;
+    }
+
+    return Data;
+}
+
+bool FPipelineCacheFile::Save(const std::vector<char>& Data)
+{
+    if (!IsPipelineCacheDataCompatible(Data, DeviceInfo))
+    {
+        return false;
+    }
+
+    FPipelineCacheFileHeader Header;
+    Header.VendorID = DeviceInfo.VendorID;
+    Header.DeviceID = DeviceInfo.DeviceID;
+    Header.DriverVersion = DeviceInfo.DriverVersion;
+    Header.PipelineCacheUUID = DeviceInfo.PipelineCacheUUID;
+    Header.Size = Data.size();
+    Header.Checksum = ComputeChecksum(Data.data(), Data.size());
+
+    return WriteFileAtomically(Path, {{&Header, sizeof(Header)}, {Data.data(), Data.size()}});
+}
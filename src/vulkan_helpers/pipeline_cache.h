@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Device and driver the pipeline cache was created for. Filled from VkPhysicalDeviceProperties
+ */
+struct FPipelineCacheDeviceInfo
+{
+    uint32_t VendorID = 0;
+    uint32_t DeviceID = 0;
+    uint32_t DriverVersion = 0;
+    std::array<uint8_t, 16> PipelineCacheUUID{};
+};
+
+/**
+ * Size of VkPipelineCacheHeaderVersionOne, which every driver puts in front of the pipeline cache data
+ */
+constexpr uint32_t PIPELINE_CACHE_HEADER_SIZE = 32;
+
+/// Checks the header of the data returned by vkGetPipelineCacheData against the device
+bool IsPipelineCacheDataCompatible(const std::vector<char>& Data, const FPipelineCacheDeviceInfo& DeviceInfo);
+
+/**
+ * Pipeline cache data stored between runs.
+ * Drivers are supposed to reject incompatible data themselves, but some of them crash instead, so the data is checked before it gets to the driver:
+ * the file carries the device, the driver version and a checksum, and the data itself must have a header matching the device.
+ * The file is written to a temporary file first and then renamed, so a crash while saving never leaves a half written cache
+ */
+class FPipelineCacheFile
+{
+public:
+    FPipelineCacheFile(const std::string& PathIn, const FPipelineCacheDeviceInfo& DeviceInfoIn);
+
+    /// Returns nothing if there's no file, or it was written for another device or driver, or it's broken. Files that can't be used are removed
+    std::optional<std::vector<char>> Load();
+    /// Returns false if the data wasn't written
+    bool Save(const std::vector<char>& Data);
+
+private:
+    std::string Path;
+    FPipelineCacheDeviceInfo DeviceInfo;
+};
@@ -3,6 +3,7 @@
 #include "vk_context.h"
 #include "vk_debug.h"
 
+#include <iostream>
 #include <stdexcept>
 #include <utility>
 
@@ -27,52 +28,158 @@ void FreeResourceAllocator()
     }
 }
 
+bool IsResourceAllocatorAlive()
+{
+    return ResourceAllocator != nullptr;
+}
+
+
+FDeviceMemoryProvider::FDeviceMemoryProvider(bool bDeviceAddressRequiredIn) : bDeviceAddressRequired(bDeviceAddressRequiredIn)
+{
+}
+
+uint64_t FDeviceMemoryProvider::AllocateBlock(uint32_t MemoryTypeIndex, uint64_t Size)
+{
+    VkMemoryAllocateInfo  AllocInfo{};
+    AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocInfo.allocationSize = Size;
+    AllocInfo.memoryTypeIndex = MemoryTypeIndex;
+
+    VkMemoryAllocateFlagsInfo MemoryAllocateFlagsInfo{};
+
+    if (bDeviceAddressRequired)
+    {
+        MemoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+        MemoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+        AllocInfo.pNext = &MemoryAllocateFlagsInfo;
+    }
+
+    VkDeviceMemory Memory = VK_NULL_HANDLE;
+
+    if (vkAllocateMemory(VK_CONTEXT()->LogicalDevice, &AllocInfo, nullptr, &Memory) != VK_SUCCESS)
+    {
+        return 0;
+    }
+
+    AllocationsCount++;
+
+    return (uint64_t)Memory;
+}
+
+void FDeviceMemoryProvider::FreeBlock(uint64_t Block)
+{
+    vkFreeMemory(VK_CONTEXT()->LogicalDevice, (VkDeviceMemory)Block, nullptr);
+    AllocationsCount--;
+}
+
+uint32_t FDeviceMemoryProvider::GetAllocationsCount() const
+{
+    return AllocationsCount;
+}
 
 FResourceAllocator::FResourceAllocator()
 {
     vkGetPhysicalDeviceMemoryProperties(VK_CONTEXT()->PhysicalDevice, &MemProperties);
 
+    BufferMemoryPools = std::make_unique<FMemoryPools>(&BufferMemoryProvider);
+    ImageMemoryPools = std::make_unique<FMemoryPools>(&ImageMemoryProvider);
+
     /// Create staging buffer
     StagingBuffer = CreateBuffer(StagingBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Staging_Buffer");
     RegisterBuffer(StagingBuffer, "Staging_Buffer");
+
+    /// Create upload ring buffer. It stays mapped for the whole lifetime of the allocator
+    UploadBuffer = CreateBuffer(UploadBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Upload_Buffer");
+    RegisterBuffer(UploadBuffer, "Upload_Buffer");
+    UploadBufferData = static_cast<char*>(Map(UploadBuffer));
+    UploadRing = FRingAllocator(UploadBufferSize);
+    UploadTimelineSemaphore = VK_CONTEXT()->CreateTimelineSemaphore();
+    V::SetName(VK_CONTEXT()->LogicalDevice, UploadTimelineSemaphore, "Upload_Timeline");
+
+    /// Create readback buffer. The CPU reads from it, which is much faster from cached memory
+    VkMemoryPropertyFlags ReadbackProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for (uint32_t i = 0; i < MemProperties.memoryTypeCount; ++i)
+    {
+        if ((MemProperties.memoryTypes[i].propertyFlags & (ReadbackProperties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) == (ReadbackProperties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+        {
+            ReadbackProperties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+            break;
+        }
+    }
+
+    ReadbackBuffer = CreateBuffer(ReadbackSlotSize * READBACK_SLOTS_COUNT, VK_BUFFER_USAGE_TRANSFER_DST_BIT, ReadbackProperties, "Readback_Buffer");
+    RegisterBuffer(ReadbackBuffer, "Readback_Buffer");
+    ReadbackBufferData = static_cast<char*>(Map(ReadbackBuffer));
+
+    VkCommandPoolCreateInfo PoolInfo{};
+    PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    PoolInfo.queueFamilyIndex = VK_CONTEXT()->GetQueueIndex(UPLOAD_QUEUE);
+    PoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(VK_CONTEXT()->LogicalDevice, &PoolInfo, nullptr, &TransferCommandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create transfer command pool!");
+    }
 }
 
 FResourceAllocator::~FResourceAllocator()
 {
+    WaitForReadbacks();
+    WaitForUploads();
+
+    for (auto Fence : FreeTransferFences)
+    {
+        vkDestroyFence(VK_CONTEXT()->LogicalDevice, Fence, nullptr);
+    }
+
+    vkDestroyCommandPool(VK_CONTEXT()->LogicalDevice, TransferCommandPool, nullptr);
+    vkDestroySemaphore(VK_CONTEXT()->LogicalDevice, UploadTimelineSemaphore, nullptr);
+    Unmap(UploadBuffer);
+    Unmap(ReadbackBuffer);
+
     for (auto& Buffer : Buffers)
     {
         DestroyBuffer(Buffer.second);
     }
 }
 
-FMemoryRegion FResourceAllocator::AllocateMemory(VkDeviceSize Size, VkMemoryRequirements MemRequirements, VkMemoryPropertyFlags Properties, bool bDeviceAddressRequired)
+FMemoryRegion FResourceAllocator::AllocateMemory(VkMemoryRequirements MemRequirements, VkMemoryPropertyFlags Properties, bool bImageMemory)
 {
-    /// Allocate Device Memory
-
     FMemoryRegion MemoryRegion;
 
-    VkMemoryAllocateInfo  AllocInfo{};
-    AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    AllocInfo.allocationSize = MemRequirements.size;
-    AllocInfo.memoryTypeIndex = FindMemoryType(MemRequirements.memoryTypeBits, Properties);
+    uint32_t MemoryTypeIndex = FindMemoryType(MemRequirements.memoryTypeBits, Properties);
+    /// vkMapMemory can't be called twice for the same memory, so host visible resources don't share blocks
+    bool bDedicated = (MemProperties.memoryTypes[MemoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 
-	VkMemoryAllocateFlagsInfo MemoryAllocateFlagsInfo{};
+    auto& MemoryPools = bImageMemory ? ImageMemoryPools : BufferMemoryPools;
+    auto Allocation = MemoryPools->Allocate(MemoryTypeIndex, MemRequirements.size, MemRequirements.alignment, bDedicated);
 
-    if (bDeviceAddressRequired)
+    if (!Allocation)
     {
-        MemoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-        MemoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
-        AllocInfo.pNext = &MemoryAllocateFlagsInfo;
+        throw std::runtime_error("Failed to allocate device memory!");
     }
 
-    if (vkAllocateMemory(VK_CONTEXT()->LogicalDevice, &AllocInfo, nullptr, &MemoryRegion.Memory) != VK_SUCCESS)
+    MemoryRegion.Memory = (VkDeviceMemory)Allocation->Block;
+    MemoryRegion.Offset = Allocation->Offset;
+    MemoryRegion.Allocation = *Allocation;
+    MemoryRegion.bImageMemory = bImageMemory;
+
+    return MemoryRegion;
+}
+
+void FResourceAllocator::FreeMemory(FMemoryRegion& MemoryRegion)
+{
+    if (MemoryRegion.Memory == VK_NULL_HANDLE)
     {
-        throw std::runtime_error("Failed to allocate buffer memory!");
+        return;
     }
 
-    MemoryRegion.MemoryPtrs = {{0, Size}};
+    auto& MemoryPools = MemoryRegion.bImageMemory ? ImageMemoryPools : BufferMemoryPools;
+    MemoryPools->Free(MemoryRegion.Allocation);
 
-    return MemoryRegion;
+    MemoryRegion.Memory = VK_NULL_HANDLE;
+    MemoryRegion.Offset = 0;
 }
 
 FBuffer FResourceAllocator::RegisterBuffer(FBuffer Buffer, const std::string& Name)
@@ -123,14 +230,18 @@ FBuffer FResourceAllocator::CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags U
     VkMemoryRequirements MemRequirements;
     vkGetBufferMemoryRequirements(VK_CONTEXT()->LogicalDevice, Buffer.Buffer, &MemRequirements);
 
-    bool bDeviceAddressRequired = (Usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) == VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-
-    Buffer.MemoryRegion = AllocateMemory(Size, MemRequirements, Properties, bDeviceAddressRequired);
+    Buffer.MemoryRegion = AllocateMemory(MemRequirements, Properties);
+    /// Chunks are handed out of the buffer itself, not of the memory block
+    Buffer.MemoryRegion.Suballocator = FSuballocator(Size);
 
-    V::SetName(VK_CONTEXT()->LogicalDevice, Buffer.MemoryRegion.Memory, DebugName);
+    /// Shared blocks would get the name of the last resource placed into them
+    if (Buffer.MemoryRegion.Allocation.bDedicated)
+    {
+        V::SetName(VK_CONTEXT()->LogicalDevice, Buffer.MemoryRegion.Memory, DebugName);
+    }
 
     /// Bind Buffer Memory
-    vkBindBufferMemory(VK_CONTEXT()->LogicalDevice, Buffer.Buffer, Buffer.MemoryRegion.Memory, 0);
+    vkBindBufferMemory(VK_CONTEXT()->LogicalDevice, Buffer.Buffer, Buffer.MemoryRegion.Memory, Buffer.MemoryRegion.Offset);
 
     return Buffer;
 }
@@ -143,6 +254,57 @@ FBuffer FResourceAllocator::LoadDataToBuffer(FBuffer& Buffer, std::vector<VkDevi
         return Buffer;
     }
 
+    RetireUploads();
+
+    for (int i = 0; i < SizesIn.size(); ++i)
+    {
+        /// Data that doesn't fit into the upload ring goes through the blocking path
+        if (SizesIn[i] > UploadBufferSize)
+        {
+            LoadDataToBufferImmediate(Buffer, {SizesIn[i]}, {OffsetsIn[i]}, {DataIn[i]});
+            continue;
+        }
+
+        auto UploadOffset = UploadRing.Allocate(SizesIn[i], UPLOAD_ALIGNMENT);
+
+        /// The ring is full, which only happens when a lot of data is uploaded at once, so we have to wait for the GPU to consume older uploads
+        while (!UploadOffset)
+        {
+            FlushUploads();
+            WaitForOldestUpload();
+            UploadOffset = UploadRing.Allocate(SizesIn[i], UPLOAD_ALIGNMENT);
+        }
+
+        memcpy(UploadBufferData + *UploadOffset, DataIn[i], (std::size_t)SizesIn[i]);
+
+        if (UploadCommandBuffer == VK_NULL_HANDLE)
+        {
+            BeginUploadCommandBuffer();
+        }
+
+        VkBufferCopy CopyRegion{};
+        CopyRegion.size = SizesIn[i];
+        CopyRegion.srcOffset = *UploadOffset;
+        CopyRegion.dstOffset = OffsetsIn[i];
+        vkCmdCopyBuffer(UploadCommandBuffer, UploadBuffer.Buffer, Buffer.Buffer, 1, &CopyRegion);
+
+        if (OffsetsIn[i] + SizesIn[i] > Buffer.CurrentOffset)
+        {
+            Buffer.CurrentOffset = OffsetsIn[i] + SizesIn[i];
+        }
+    }
+
+    return Buffer;
+}
+
+FBuffer FResourceAllocator::LoadDataToBufferImmediate(FBuffer& Buffer, std::vector<VkDeviceSize> SizesIn, std::vector<VkDeviceSize> OffsetsIn, std::vector<void*> DataIn)
+{
+    if (SizesIn.empty())
+    {
+        /// TODO: Log warning
+        return Buffer;
+    }
+
     struct CopySizeOffsetDataPtr
     {
         VkDeviceSize Size;
@@ -248,17 +410,355 @@ FBuffer FResourceAllocator::LoadDataToBuffer(const std::string& BufferName, VkDe
 	return LoadDataToBuffer(BufferName, std::vector<VkDeviceSize>{SizesIn}, std::vector<VkDeviceSize>{OffsetsIn}, std::vector<void*>{DataIn});
 }
 
+VkCommandBuffer FResourceAllocator::AcquireTransferCommandBuffer()
+{
+    VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+
+    if (FreeTransferCommandBuffers.empty())
+    {
+        VkCommandBufferAllocateInfo AllocInfo{};
+        AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        AllocInfo.commandPool = TransferCommandPool;
+        AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        AllocInfo.commandBufferCount = 1u;
+
+        if (vkAllocateCommandBuffers(VK_CONTEXT()->LogicalDevice, &AllocInfo, &CommandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate transfer command buffer!");
+        }
+
+        V::SetName(VK_CONTEXT()->LogicalDevice, CommandBuffer, "V::Transfer_Command_Buffer");
+    }
+    else
+    {
+        CommandBuffer = FreeTransferCommandBuffers.back();
+        FreeTransferCommandBuffers.pop_back();
+    }
+
+    VkCommandBufferBeginInfo BeginInfo{};
+    BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(CommandBuffer, &BeginInfo);
+
+    return CommandBuffer;
+}
+
+VkFence FResourceAllocator::SubmitTransferCommandBuffer(VkCommandBuffer CommandBuffer, uint64_t UploadTimelineValue)
+{
+    vkEndCommandBuffer(CommandBuffer);
+
+    VkFence Fence = VK_NULL_HANDLE;
+
+    if (FreeTransferFences.empty())
+    {
+        Fence = VK_CONTEXT()->CreateUnsignalledFence();
+    }
+    else
+    {
+        Fence = FreeTransferFences.back();
+        FreeTransferFences.pop_back();
+    }
+
+    VkSubmitInfo SubmitInfo{};
+    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.commandBufferCount = 1;
+    SubmitInfo.pCommandBuffers = &CommandBuffer;
+
+    VkTimelineSemaphoreSubmitInfo TimelineSemaphoreSubmitInfo{};
+    TimelineSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    TimelineSemaphoreSubmitInfo.signalSemaphoreValueCount = 1;
+    TimelineSemaphoreSubmitInfo.pSignalSemaphoreValues = &UploadTimelineValue;
+
+    if (UploadTimelineValue != 0)
+    {
+        SubmitInfo.pNext = &TimelineSemaphoreSubmitInfo;
+        SubmitInfo.signalSemaphoreCount = 1;
+        SubmitInfo.pSignalSemaphores = &UploadTimelineSemaphore;
+    }
+
+    if (vkQueueSubmit(VK_CONTEXT()->GetQueue(UPLOAD_QUEUE), 1, &SubmitInfo, Fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit transfer command buffer!");
+    }
+
+    return Fence;
+}
+
+void FResourceAllocator::ReleaseTransfer(VkFence Fence, VkCommandBuffer CommandBuffer)
+{
+    vkResetFences(VK_CONTEXT()->LogicalDevice, 1, &Fence);
+    FreeTransferFences.push_back(Fence);
+    FreeTransferCommandBuffers.push_back(CommandBuffer);
+}
+
+void FResourceAllocator::BeginUploadCommandBuffer()
+{
+    UploadCommandBuffer = AcquireTransferCommandBuffer();
+
+    /// Copies must not overwrite data that is still used by previously submitted work
+    VkMemoryBarrier MemoryBarrier{};
+    MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    MemoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    MemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(UploadCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void FResourceAllocator::FlushUploads()
+{
+    if (UploadCommandBuffer == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    /// Make the copied data visible to everything submitted after the uploads
+    VkMemoryBarrier MemoryBarrier{};
+    MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    MemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    MemoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(UploadCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+
+    VkFence Fence = SubmitTransferCommandBuffer(UploadCommandBuffer, NextUploadFenceValue);
+
+    UploadRing.Submit(NextUploadFenceValue);
+    UploadsInFlight.push_back({NextUploadFenceValue, Fence, UploadCommandBuffer});
+    NextUploadFenceValue++;
+    UploadCommandBuffer = VK_NULL_HANDLE;
+}
+
+void FResourceAllocator::RetireUploads()
+{
+    std::optional<uint64_t> LastCompletedFenceValue;
+
+    while (!UploadsInFlight.empty() && vkGetFenceStatus(VK_CONTEXT()->LogicalDevice, UploadsInFlight.front().Fence) == VK_SUCCESS)
+    {
+        auto& Upload = UploadsInFlight.front();
+        ReleaseTransfer(Upload.Fence, Upload.CommandBuffer);
+        LastCompletedFenceValue = Upload.FenceValue;
+        UploadsInFlight.pop_front();
+    }
+
+    if (LastCompletedFenceValue)
+    {
+        UploadRing.Retire(*LastCompletedFenceValue);
+    }
+}
+
+void FResourceAllocator::WaitForOldestUpload()
+{
+    if (UploadsInFlight.empty())
+    {
+        return;
+    }
+
+    vkWaitForFences(VK_CONTEXT()->LogicalDevice, 1, &UploadsInFlight.front().Fence, VK_TRUE, UINT64_MAX);
+    RetireUploads();
+}
+
+void FResourceAllocator::WaitForUploads()
+{
+    FlushUploads();
+
+    while (!UploadsInFlight.empty())
+    {
+        WaitForOldestUpload();
+    }
+}
+
+FTimelinePoint FResourceAllocator::GetUploadsFinishedPoint()
+{
+    FlushUploads();
+    /// Timeline starts at zero, so nothing is waited for if there were no uploads
+    return {UploadTimelineSemaphore, NextUploadFenceValue - 1};
+}
+
 void FResourceAllocator::LoadDataFromBuffer(FBuffer& Buffer, VkDeviceSize Size, VkDeviceSize Offset, void* Data)
 {
-    for (int i = 0; Size > 0; ++i)
+    WaitForReadback(LoadDataFromBufferAsync(Buffer, Size, Offset, Data));
+}
+
+FReadbackHandle FResourceAllocator::LoadDataFromBufferAsync(const FBuffer& Buffer, VkDeviceSize Size, VkDeviceSize Offset, void* Data, std::function<void()> OnFinished)
+{
+    FReadback Readback;
+    Readback.SrcBuffer = Buffer.Buffer;
+    Readback.Data = static_cast<char*>(Data);
+    Readback.OnFinished = std::move(OnFinished);
+
+    return StartReadback(std::move(Readback), Size, Offset);
+}
+
+FReadbackHandle FResourceAllocator::LoadDataFromImageAsync(const FImage& Image, VkDeviceSize TexelSize, void* Data, std::function<void()> OnFinished)
+{
+    VkDeviceSize Size = Image.Width * Image.Height * TexelSize;
+
+    FReadback Readback;
+    Readback.ImageBuffer = CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Image_Readback_Buffer");
+    Readback.SrcBuffer = Readback.ImageBuffer.Buffer;
+    Readback.Data = static_cast<char*>(Data);
+    Readback.OnFinished = std::move(OnFinished);
+
+    /// The whole image is copied in a single submit, so chunks read back in later frames all come from the same frame
+    FlushUploads();
+
+    VkCommandBuffer CommandBuffer = AcquireTransferCommandBuffer();
+
+    VkMemoryBarrier MemoryBarrier{};
+    MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    MemoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    MemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy Region{};
+    Region.bufferOffset = 0;
+    Region.bufferRowLength = 0;
+    Region.bufferImageHeight = 0;
+
+    Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    Region.imageSubresource.mipLevel = 0;
+    Region.imageSubresource.baseArrayLayer = 0;
+    Region.imageSubresource.layerCount = 1;
+
+    Region.imageOffset = {0, 0, 0};
+    Region.imageExtent = {Image.Width, Image.Height, 1};
+
+    vkCmdCopyImageToBuffer(CommandBuffer, Image.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Readback.ImageBuffer.Buffer, 1, &Region);
+
+    Readback.ImageCopy.Fence = SubmitTransferCommandBuffer(CommandBuffer);
+    Readback.ImageCopy.CommandBuffer = CommandBuffer;
+
+    /// Chunk copies go to the same queue and start with a barrier, so they see the copied image
+    return StartReadback(std::move(Readback), Size, 0);
+}
+
+FReadbackHandle FResourceAllocator::StartReadback(FReadback Readback, VkDeviceSize Size, VkDeviceSize Offset)
+{
+    Readback.Handle = NextReadbackHandle++;
+    Readback.Chunks = SplitTransfer(Size, Offset, ReadbackSlotSize, 1, READBACK_SLOTS_COUNT);
+
+    FReadbackHandle Handle = Readback.Handle;
+    Readbacks.push_back(std::move(Readback));
+
+    /// Submit the first chunks right away, so they see the data as it is now
+    ProcessReadbacks(std::nullopt);
+
+    return Handle;
+}
+
+void FResourceAllocator::SubmitReadbackChunk(FReadback& Readback)
+{
+    auto& Chunk = Readback.Chunks[Readback.NextChunkToSubmit];
+    auto& Slot = ReadbackSlots[Chunk.StagingSlot];
+    assert(Slot.Fence == VK_NULL_HANDLE && "Readback slot is still in use");
+
+    /// Readbacks should see data loaded before them, and they go to the same queue
+    FlushUploads();
+
+    VkCommandBuffer CommandBuffer = AcquireTransferCommandBuffer();
+
+    VkMemoryBarrier MemoryBarrier{};
+    MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    MemoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    MemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+
+    VkDeviceSize SlotOffset = Chunk.StagingSlot * ReadbackSlotSize;
+
+    VkBufferCopy CopyRegion{};
+    CopyRegion.size = Chunk.Size;
+    CopyRegion.srcOffset = Chunk.SourceOffset;
+    CopyRegion.dstOffset = SlotOffset;
+    vkCmdCopyBuffer(CommandBuffer, Readback.SrcBuffer, ReadbackBuffer.Buffer, 1, &CopyRegion);
+
+    /// Make the copied data visible to the host
+    MemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    MemoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &MemoryBarrier, 0, nullptr, 0, nullptr);
+
+    Slot.Fence = SubmitTransferCommandBuffer(CommandBuffer);
+    Slot.CommandBuffer = CommandBuffer;
+    Readback.NextChunkToSubmit++;
+}
+
+void FResourceAllocator::ProcessReadbacks(std::optional<FReadbackHandle> WaitFor)
+{
+    while (!Readbacks.empty())
     {
-        VkDeviceSize ChunkSize = (Size > StagingBufferSize) ? StagingBufferSize : Size;
-        CopyBuffer(Buffer, StagingBuffer, {ChunkSize}, {Offset + (StagingBufferSize * i)}, {0});
-        LoadDataFromStagingBuffer(Size, ((char*)Data + (StagingBufferSize * i)), 0);
-        Size -= ChunkSize;
+        auto& Readback = Readbacks.front();
+
+        if (Readback.NextChunkToCopy == Readback.Chunks.size())
+        {
+            if (Readback.ImageCopy.Fence != VK_NULL_HANDLE)
+            {
+                /// Chunks were copied after the image copy, but fences aren't guaranteed to be signalled in submission order
+                vkWaitForFences(VK_CONTEXT()->LogicalDevice, 1, &Readback.ImageCopy.Fence, VK_TRUE, UINT64_MAX);
+                ReleaseTransfer(Readback.ImageCopy.Fence, Readback.ImageCopy.CommandBuffer);
+
+                /// Not DestroyBuffer, it would wait for the other readbacks
+                vkDestroyBuffer(VK_CONTEXT()->LogicalDevice, Readback.ImageBuffer.Buffer, nullptr);
+                FreeMemory(Readback.ImageBuffer.MemoryRegion);
+            }
+
+            /// The callback might start a new readback, so the finished one is removed first
+            auto OnFinished = std::move(Readback.OnFinished);
+            Readbacks.pop_front();
+
+            if (OnFinished)
+            {
+                OnFinished();
+            }
+
+            continue;
+        }
+
+        /// Keep every slot busy, so the GPU copies the next chunks while the CPU copies the current one
+        while (Readback.NextChunkToSubmit < Readback.Chunks.size() && Readback.NextChunkToSubmit - Readback.NextChunkToCopy < READBACK_SLOTS_COUNT)
+        {
+            SubmitReadbackChunk(Readback);
+        }
+
+        auto& Chunk = Readback.Chunks[Readback.NextChunkToCopy];
+        auto& Slot = ReadbackSlots[Chunk.StagingSlot];
+
+        if (vkGetFenceStatus(VK_CONTEXT()->LogicalDevice, Slot.Fence) != VK_SUCCESS)
+        {
+            if (!WaitFor || *WaitFor < Readback.Handle)
+            {
+                return;
+            }
+
+            vkWaitForFences(VK_CONTEXT()->LogicalDevice, 1, &Slot.Fence, VK_TRUE, UINT64_MAX);
+        }
+
+        memcpy(Readback.Data + Chunk.DestinationOffset, ReadbackBufferData + Chunk.StagingSlot * ReadbackSlotSize, (std::size_t)Chunk.Size);
+
+        ReleaseTransfer(Slot.Fence, Slot.CommandBuffer);
+        Slot = FReadbackSlot();
+        Readback.NextChunkToCopy++;
+    }
+}
+
+bool FResourceAllocator::IsReadbackFinished(FReadbackHandle Handle) const
+{
+    return Readbacks.empty() || Readbacks.front().Handle > Handle;
+}
+
+void FResourceAllocator::WaitForReadback(FReadbackHandle Handle)
+{
+    ProcessReadbacks(Handle);
+}
+
+void FResourceAllocator::WaitForReadbacks()
+{
+    if (!Readbacks.empty())
+    {
+        ProcessReadbacks(Readbacks.back().Handle);
     }
 }
 
+void FResourceAllocator::UpdateReadbacks()
+{
+    ProcessReadbacks(std::nullopt);
+}
+
 void FResourceAllocator::LoadDataToStagingBuffer(std::vector<VkDeviceSize> Sizes, std::vector<void*> Datas)
 {
     VkDeviceSize TotalSize = 0;
@@ -274,7 +774,7 @@ void FResourceAllocator::LoadDataToStagingBuffer(std::vector<VkDeviceSize> Sizes
     }
 
     void *StagingData;
-    vkMapMemory(VK_CONTEXT()->LogicalDevice, StagingBuffer.MemoryRegion.Memory, 0, VK_WHOLE_SIZE, 0, &StagingData);
+    vkMapMemory(VK_CONTEXT()->LogicalDevice, StagingBuffer.MemoryRegion.Memory, StagingBuffer.MemoryRegion.Offset, VK_WHOLE_SIZE, 0, &StagingData);
 
     VkDeviceSize CurrentOffset = 0;
     for (int i = 0; i < Sizes.size(); ++i)
@@ -291,7 +791,7 @@ void FResourceAllocator::LoadDataFromStagingBuffer(VkDeviceSize Size, void* Data
     if (Offset + Size <= StagingBufferSize)
     {
         void *StagingData;
-        vkMapMemory(VK_CONTEXT()->LogicalDevice, StagingBuffer.MemoryRegion.Memory, Offset, Size, 0, &StagingData);
+        vkMapMemory(VK_CONTEXT()->LogicalDevice, StagingBuffer.MemoryRegion.Memory, StagingBuffer.MemoryRegion.Offset + Offset, Size, 0, &StagingData);
         memcpy(Data, StagingData, (std::size_t) Size);
         vkUnmapMemory(VK_CONTEXT()->LogicalDevice, StagingBuffer.MemoryRegion.Memory);
 
@@ -330,7 +830,7 @@ void FResourceAllocator::CopyBuffer(const FBuffer &SrcBuffer, FBuffer &DstBuffer
 void* FResourceAllocator::Map(FBuffer& Buffer)
 {
     void* Data;
-    vkMapMemory(VK_CONTEXT()->LogicalDevice, Buffer.MemoryRegion.Memory, 0, Buffer.BufferSize, 0, &Data);
+    vkMapMemory(VK_CONTEXT()->LogicalDevice, Buffer.MemoryRegion.Memory, Buffer.MemoryRegion.Offset, Buffer.BufferSize, 0, &Data);
     return Data;
 }
 
@@ -384,16 +884,23 @@ void FResourceAllocator::CopyImageToBuffer(const FImage& SrcImage, FBuffer& DstB
 
 void FResourceAllocator::GetImageData(FImage& SrcImage, void* Data)
 {
-    CopyImageToBuffer(SrcImage, StagingBuffer);
-    LoadDataFromStagingBuffer(SrcImage.Size, Data, 0);
+    WaitForReadback(LoadDataFromImageAsync(SrcImage, SrcImage.GetTexelSize(), Data));
 }
 
 void FResourceAllocator::DestroyBuffer(FBuffer& Buffer)
 {
+    /// Recorded uploads might still target the buffer
+    if (UploadCommandBuffer != VK_NULL_HANDLE || !UploadsInFlight.empty())
+    {
+        WaitForUploads();
+    }
+
+    /// Readbacks in flight might still read from it
+    WaitForReadbacks();
+
     vkDestroyBuffer(VK_CONTEXT()->LogicalDevice, Buffer.Buffer, nullptr);
-    vkFreeMemory(VK_CONTEXT()->LogicalDevice, Buffer.MemoryRegion.Memory, nullptr);
+    FreeMemory(Buffer.MemoryRegion);
     Buffer.Buffer = VK_NULL_HANDLE;
-    Buffer.MemoryRegion.Memory = VK_NULL_HANDLE;
 }
 
 uint32_t FResourceAllocator::FindMemoryType(uint32_t TypeFilter, VkMemoryPropertyFlags Properties)
@@ -407,4 +914,25 @@ uint32_t FResourceAllocator::FindMemoryType(uint32_t TypeFilter, VkMemoryPropert
     }
 
     throw std::runtime_error("Failed to find suitable memory type!");
-}
\ No newline at end of file
+}
+
+void FResourceAllocator::PrintMemoryStatistics()
+{
+    auto PrintPools = [this](const std::string& Name, FMemoryPools& MemoryPools)
+    {
+        for (auto MemoryTypeIndex : MemoryPools.GetMemoryTypes())
+        {
+            auto Statistics = MemoryPools.GetStatistics(MemoryTypeIndex);
+            std::cout << Name << " pool, memory type " << MemoryTypeIndex << ": " << Statistics.AllocationsCount << " resources in "
+                      << Statistics.BlocksCount << " blocks and " << Statistics.DedicatedAllocationsCount << " dedicated allocations, "
+                      << Statistics.UsedSize / (1024 * 1024) << "MB used of " << Statistics.ReservedSize / (1024 * 1024) << "MB" << std::endl;
+        }
+    };
+
+    PrintPools("Buffer", *BufferMemoryPools);
+    PrintPools("Image", *ImageMemoryPools);
+
+    uint32_t ResourcesCount = BufferMemoryPools->GetTotalStatistics().AllocationsCount + ImageMemoryPools->GetTotalStatistics().AllocationsCount;
+    uint32_t DeviceAllocationsCount = BufferMemoryProvider.GetAllocationsCount() + ImageMemoryProvider.GetAllocationsCount();
+    std::cout << "Device memory allocations: " << DeviceAllocationsCount << " for " << ResourcesCount << " resources" << std::endl;
+}
@@ -2,12 +2,54 @@
 
 #include "buffer.h"
 #include "image.h"
+#include "memory_pool.h"
+#include "ring_allocator.h"
+#include "transfer_chunks.h"
+#include "vk_utils.h"
 
+#include <deque>
+#include <functional>
 #include <memory>
 #include <map>
+#include <optional>
 
 class FVulkanContext;
 
+/**
+ * Queue used for uploads and readbacks. Frame tasks are submitted to the same queue, so they see uploaded data without extra semaphores
+ */
+constexpr VkQueueFlagBits UPLOAD_QUEUE = VK_QUEUE_COMPUTE_BIT;
+
+/**
+ * Alignment of allocations in the upload ring buffer
+ */
+constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+/**
+ * Number of slots in the readback buffer. While the CPU copies a chunk out of one slot, the GPU copies the next chunk into another one
+ */
+constexpr uint32_t READBACK_SLOTS_COUNT = 2;
+
+/// Identifies an asynchronous readback. Handles grow monotonically, so readbacks finish in the order of their handles
+using FReadbackHandle = uint64_t;
+
+/// Allocates device memory blocks for memory pools
+class FDeviceMemoryProvider : public IMemoryBlockProvider
+{
+public:
+    explicit FDeviceMemoryProvider(bool bDeviceAddressRequiredIn);
+
+    uint64_t AllocateBlock(uint32_t MemoryTypeIndex, uint64_t Size) override;
+    void FreeBlock(uint64_t Block) override;
+
+    uint32_t GetAllocationsCount() const;
+
+private:
+    /// Buffers sharing a block might need a device address, so every buffer block is allocated with that flag
+    bool bDeviceAddressRequired = false;
+    uint32_t AllocationsCount = 0;
+};
+
 class FResourceAllocator
 {
 public:
@@ -16,7 +58,9 @@ public:
 
     FBuffer CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags Properties, const std::string& DebugName = "");
     void DestroyBuffer(FBuffer& Buffer);
-    FMemoryRegion AllocateMemory(VkDeviceSize Size, VkMemoryRequirements MemRequirements, VkMemoryPropertyFlags Properties, bool bDeviceAddressRequired = false);
+    /// Suballocate memory from the pool of the required memory type. Host visible memory always gets a dedicated allocation, so it can be mapped independently
+    FMemoryRegion AllocateMemory(VkMemoryRequirements MemRequirements, VkMemoryPropertyFlags Properties, bool bImageMemory = false);
+    void FreeMemory(FMemoryRegion& MemoryRegion);
 
     FBuffer RegisterBuffer(FBuffer Buffer, const std::string& Name);
     FBuffer GetBuffer(const std::string& Name);
@@ -24,14 +68,44 @@ public:
     void UnregisterAndDestroyBuffer(const std::string& Name);
 
 	/// TODO: Make arguments &
+    /// Copy data into the upload ring and record copies into the upload command buffer. Doesn't wait for the GPU unless the ring is full
     FBuffer LoadDataToBuffer(FBuffer& Buffer, std::vector<VkDeviceSize> SizesIn, std::vector<VkDeviceSize> OffsetsIn, std::vector<void*> DataIn);
+    /// Copy data through the staging buffer and wait until the copy is finished
+    FBuffer LoadDataToBufferImmediate(FBuffer& Buffer, std::vector<VkDeviceSize> SizesIn, std::vector<VkDeviceSize> OffsetsIn, std::vector<void*> DataIn);
 	FBuffer LoadDataToBuffer(const std::string& BufferName, std::vector<VkDeviceSize> SizesIn, std::vector<VkDeviceSize> OffsetsIn, std::vector<void*> DataIn);
 	FBuffer LoadDataToBuffer(const std::string& BufferName, VkDeviceSize SizesIn, VkDeviceSize OffsetsIn, void* DataIn);
+    /// Copy data from the buffer and wait until it's in Data
     void LoadDataFromBuffer(FBuffer& Buffer, VkDeviceSize Size, VkDeviceSize Offset, void* Data);
+    /**
+     * Start copying data from the buffer to Data, which should stay alive until the readback is finished. OnFinished is called when it is.
+     * Data bigger than the readback buffer is copied in chunks, and a chunk is copied only when a slot is free,
+     * so the result is consistent only if the buffer isn't modified until the readback is finished
+     */
+    FReadbackHandle LoadDataFromBufferAsync(const FBuffer& Buffer, VkDeviceSize Size, VkDeviceSize Offset, void* Data, std::function<void()> OnFinished = {});
+    /**
+     * Same as LoadDataFromBufferAsync, but for the first mip of an image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL layout.
+     * The image is copied into a temporary buffer right away, so the image can be modified while the readback is in progress
+     */
+    FReadbackHandle LoadDataFromImageAsync(const FImage& Image, VkDeviceSize TexelSize, void* Data, std::function<void()> OnFinished = {});
     void LoadDataToStagingBuffer(std::vector<VkDeviceSize> Sizes, std::vector<void*> Datas);
     void LoadDataFromStagingBuffer(VkDeviceSize Size, void* Data, VkDeviceSize Offset);
     void CopyBuffer(const FBuffer &SrcBuffer, FBuffer &DstBuffer, std::vector<VkDeviceSize> Sizes, std::vector<VkDeviceSize> SourceOffsets, std::vector<VkDeviceSize> DestinationOffsets);
 
+    /// Submit uploads recorded since the last flush. Doesn't wait for them to finish
+    void FlushUploads();
+    /// Submit recorded uploads and wait until all of them are finished
+    void WaitForUploads();
+    /// Submit recorded uploads and return the point of the upload timeline reached when all of them are finished.
+    /// Submits reading uploaded data wait for it on the GPU, so the CPU doesn't wait for the uploads
+    FTimelinePoint GetUploadsFinishedPoint();
+
+    bool IsReadbackFinished(FReadbackHandle Handle) const;
+    /// Wait for the readback and every readback started before it
+    void WaitForReadback(FReadbackHandle Handle);
+    void WaitForReadbacks();
+    /// Copy out the chunks the GPU has finished and start the next ones. Doesn't wait for the GPU
+    void UpdateReadbacks();
+
     template <typename T>
     std::vector<T> DebugGetDataFromBuffer(const std::string& Name)
     {
@@ -45,8 +119,7 @@ public:
         std::vector<T> Result;
         Result.resize(Size / sizeof(T));
 
-        CopyBuffer(SrcBuffer, StagingBuffer, {(VkDeviceSize)Size}, {(VkDeviceSize)Offset}, {0});
-        LoadDataFromStagingBuffer(Size, Result.data(), 0);
+        WaitForReadback(LoadDataFromBufferAsync(SrcBuffer, Size, Offset, Result.data()));
 
         return Result;
     };
@@ -61,17 +134,97 @@ public:
 
     uint32_t FindMemoryType(uint32_t TypeFilter, VkMemoryPropertyFlags Properties);
 
+    /// Print the number of device memory allocations and how the pools are used
+    void PrintMemoryStatistics();
+
     VkDeviceSize StagingBufferSize = uint64_t(256) * 1024 * 1024;
     FBuffer StagingBuffer;
 
+    VkDeviceSize UploadBufferSize = uint64_t(64) * 1024 * 1024;
+    FBuffer UploadBuffer;
+
+    VkDeviceSize ReadbackSlotSize = uint64_t(32) * 1024 * 1024;
+    FBuffer ReadbackBuffer;
+
     VkPhysicalDeviceMemoryProperties MemProperties{};
 
 private:
+    /// Get a command buffer for uploads or readbacks and begin it
+    VkCommandBuffer AcquireTransferCommandBuffer();
+    /// End the command buffer and submit it to the upload queue. Returns the fence that is signalled when it's finished.
+    /// Uploads also signal their value on the upload timeline, zero means the submit doesn't signal it
+    VkFence SubmitTransferCommandBuffer(VkCommandBuffer CommandBuffer, uint64_t UploadTimelineValue = 0);
+    /// Return a finished submission to the free lists
+    void ReleaseTransfer(VkFence Fence, VkCommandBuffer CommandBuffer);
+
+    void BeginUploadCommandBuffer();
+    /// Release ring space of the uploads the GPU has finished
+    void RetireUploads();
+    void WaitForOldestUpload();
+
+    struct FReadbackSlot
+    {
+        VkFence Fence = VK_NULL_HANDLE;
+        VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+    };
+
+    struct FReadback
+    {
+        FReadbackHandle Handle = 0;
+        VkBuffer SrcBuffer = VK_NULL_HANDLE;
+        /// Copy of the image the chunks are read from, owned by the readback
+        FBuffer ImageBuffer;
+        FReadbackSlot ImageCopy;
+        std::vector<FTransferChunk> Chunks;
+        uint32_t NextChunkToSubmit = 0;
+        uint32_t NextChunkToCopy = 0;
+        char* Data = nullptr;
+        std::function<void()> OnFinished;
+    };
+
+    FReadbackHandle StartReadback(FReadback Readback, VkDeviceSize Size, VkDeviceSize Offset);
+    void SubmitReadbackChunk(FReadback& Readback);
+    /// Process readbacks in order. Waits for the GPU only while the readback with the WaitFor handle, or an older one, is not finished
+    void ProcessReadbacks(std::optional<FReadbackHandle> WaitFor);
+
     std::map<std::string, FBuffer> Buffers;
+
+    struct FUploadSubmission
+    {
+        uint64_t FenceValue = 0;
+        VkFence Fence = VK_NULL_HANDLE;
+        VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+    };
+
+    char* UploadBufferData = nullptr;
+    FRingAllocator UploadRing;
+    /// Pool of the command buffers used by both uploads and readbacks
+    VkCommandPool TransferCommandPool = VK_NULL_HANDLE;
+    /// Command buffer the uploads are currently recorded into
+    VkCommandBuffer UploadCommandBuffer = VK_NULL_HANDLE;
+    uint64_t NextUploadFenceValue = 1;
+    /// Timeline semaphore signalled with the fence value of every upload submit
+    VkSemaphore UploadTimelineSemaphore = VK_NULL_HANDLE;
+    std::deque<FUploadSubmission> UploadsInFlight;
+    std::vector<VkFence> FreeTransferFences;
+    std::vector<VkCommandBuffer> FreeTransferCommandBuffers;
+
+    char* ReadbackBufferData = nullptr;
+    FReadbackSlot ReadbackSlots[READBACK_SLOTS_COUNT];
+    FReadbackHandle NextReadbackHandle = 1;
+    std::deque<FReadback> Readbacks;
+
+    /// Buffers and images live in separate pools, so we don't have to care about bufferImageGranularity
+    FDeviceMemoryProvider BufferMemoryProvider = FDeviceMemoryProvider(true);
+    FDeviceMemoryProvider ImageMemoryProvider = FDeviceMemoryProvider(false);
+    std::unique_ptr<FMemoryPools> BufferMemoryPools;
+    std::unique_ptr<FMemoryPools> ImageMemoryPools;
 };
 
 FResourceAllocator* GetResourceAllocator();
 void FreeResourceAllocator();
+/// Unlike GetResourceAllocator, doesn't create the allocator
+bool IsResourceAllocatorAlive();
 
 #define RESOURCE_ALLOCATOR() GetResourceAllocator()
 #define FREE_RESOURCE_ALLOCATOR() FreeResourceAllocator()
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "ring_allocator.h"
+
+#include <cassert>
+
+FRingAllocator::FRingAllocator(uint64_t SizeIn) : Size(SizeIn)
+{
+}
+
+std::optional<uint64_t> FRingAllocator::Allocate(uint64_t AllocationSize, uint64_t Alignment)
+{
+    assert(Alignment > 0 && "Alignment should be greater than zero");
+
+    if (AllocationSize == 0 || AllocationSize > Size)
+    {
+        return std::nullopt;
+    }
+
+    /// Nothing is alive, so start from the beginning to get as much contiguous space as possible
+    if (UsedSize == 0)
+    {
+        Head = 0;
+        Tail = 0;
+    }
+
+    uint64_t AlignedHead = (Head + Alignment - 1) / Alignment * Alignment;
+    bool bWrapped = UsedSize > 0 && Head <= Tail;
+
+    if (!bWrapped)
+    {
+        if (AlignedHead + AllocationSize <= Size)
+        {
+            uint64_t TakenSize = AlignedHead + AllocationSize - Head;
+            UsedSize += TakenSize;
+            PendingSize += TakenSize;
+            Head = AlignedHead + AllocationSize;
+            return AlignedHead;
+        }
+
+        /// Not enough space at the end of the ring, so the end is skipped and the allocation starts from the beginning
+        if (AllocationSize <= Tail)
+        {
+            uint64_t TakenSize = Size - Head + AllocationSize;
+            UsedSize += TakenSize;
+            PendingSize += TakenSize;
+            Head = AllocationSize;
+            return 0;
+        }
+
+        return std::nullopt;
+    }
+
+    if (AlignedHead + AllocationSize <= Tail)
+    {
+        uint64_t TakenSize = AlignedHead + AllocationSize - Head;
+        UsedSize += TakenSize;
+        PendingSize += TakenSize;
+        Head = AlignedHead + AllocationSize;
+        return AlignedHead;
+    }
+
+    return std::nullopt;
+}
+
+void FRingAllocator::Submit(uint64_t FenceValue)
+{
+    if (PendingSize == 0)
+    {
+        return;
+    }
+
+    assert((Batches.empty() || Batches.back().FenceValue <= FenceValue) && "Fence values should grow monotonically");
+
+    Batches.push_back({FenceValue, Head, PendingSize});
+    PendingSize = 0;
+}
+
+void FRingAllocator::Retire(uint64_t CompletedFenceValue)
+{
+    while (!Batches.empty() && Batches.front().FenceValue <= CompletedFenceValue)
+    {
+        Tail = Batches.front().End;
+        UsedSize -= Batches.front().Size;
+        Batches.pop_front();
+    }
+}
+
+std::optional<uint64_t> FRingAllocator::GetOldestFenceValue() const
+{
+    if (Batches.empty())
+    {
+        return std::nullopt;
+    }
+
+    return Batches.front().FenceValue;
+}
+
+bool FRingAllocator::HasPendingAllocations() const
+{
+    return PendingSize > 0;
+}
+
+uint64_t FRingAllocator::GetSize() const
+{
+    return Size;
+}
+
+uint64_t FRingAllocator::GetUsedSize() const
+{
+    return UsedSize;
+}
+
+uint32_t FRingAllocator::GetBatchesInFlightCount() const
+{
+    return Batches.size();
+}
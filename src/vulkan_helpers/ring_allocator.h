@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+/**
+ * Allocator for a ring buffer that is filled by the CPU and consumed by the GPU, e.g. a staging buffer.
+ * Allocations are made one after another and are grouped into batches. Each batch is tagged with a fence value when it's submitted,
+ * and the memory of the batch is reused once the GPU reports that this value is reached.
+ */
+class FRingAllocator
+{
+public:
+    FRingAllocator() = default;
+    explicit FRingAllocator(uint64_t SizeIn);
+
+    /// Returns the offset of the allocated range, or nothing if the ring has no contiguous free space big enough
+    std::optional<uint64_t> Allocate(uint64_t AllocationSize, uint64_t Alignment = 1);
+    /// Close the current batch of allocations. They will be reused after the fence value is retired
+    void Submit(uint64_t FenceValue);
+    /// Release every batch that was submitted with a fence value less than or equal to CompletedFenceValue
+    void Retire(uint64_t CompletedFenceValue);
+
+    /// Fence value of the oldest submitted batch that is not retired yet
+    std::optional<uint64_t> GetOldestFenceValue() const;
+    bool HasPendingAllocations() const;
+
+    uint64_t GetSize() const;
+    /// Used size includes the padding that's skipped when an allocation wraps around
+    uint64_t GetUsedSize() const;
+    uint32_t GetBatchesInFlightCount() const;
+
+private:
+    struct FBatch
+    {
+        uint64_t FenceValue = 0;
+        /// Head of the ring when the batch was submitted. Everything before it is free once the batch is retired
+        uint64_t End = 0;
+        /// Number of bytes taken by the batch, including padding
+        uint64_t Size = 0;
+    };
+
+    uint64_t Size = 0;
+    /// Where the next allocation starts
+    uint64_t Head = 0;
+    /// Start of the oldest live allocation
+    uint64_t Tail = 0;
+    uint64_t UsedSize = 0;
+    /// Bytes taken by allocations that are not submitted yet
+    uint64_t PendingSize = 0;
+    std::deque<FBatch> Batches;
+};
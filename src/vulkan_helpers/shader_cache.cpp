@@ -0,0 +1,257 @@
+#include "shader_cache.h"
+#include "file_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+
+namespace
+{
+    /// "RSPV" in little endian
+    constexpr uint32_t SHADER_CACHE_MAGIC = 0x56505352;
+    /// Bump when the layout of the entries changes
+    constexpr uint32_t SHADER_CACHE_VERSION = 1;
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+    const std::string SHADER_CACHE_EXTENSION = ".spv";
+    /// Writers rename their temporary files right away, so older ones were left by a process that died while writing
+    constexpr auto STALE_TEMPORARY_FILE_AGE = std::chrono::minutes(10);
+
+    struct FShaderCacheHeader
+    {
+        uint32_t Magic = SHADER_CACHE_MAGIC;
+        uint32_t Version = SHADER_CACHE_VERSION;
+        /// Size of SPIR-V in bytes
+        uint64_t Size = 0;
+        uint64_t Checksum = 0;
+    };
+
+    /// FNV-1a, simple and good enough to detect corrupted files and to tell shaders apart when two of them with different seeds are combined
+    struct FHash
+    {
+        explicit FHash(uint64_t Seed) : Value(Seed)
+        {
+        }
+
+        void Add(const void* Data, size_t Size)
+        {
+            auto Bytes = static_cast<const unsigned char*>(Data);
+
+            for (size_t i = 0; i < Size; ++i)
+            {
+                Value ^= Bytes[i];
+                Value *= 0x100000001b3;
+            }
+        }
+
+        /// Strings are prefixed with their length, so that {"ab", "c"} and {"a", "bc"} give different hashes
+        void Add(const std::string& String)
+        {
+            uint64_t Size = String.size();
+            Add(&Size, sizeof(Size));
+            Add(String.data(), String.size());
+        }
+
+        uint64_t Value;
+    };
+
+    constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+    /// Second hash of the key uses a different seed, so a 128 bit key is built out of two 64 bit hashes
+    constexpr uint64_t SECOND_SEED = 0x84222325cbf29ce4;
+}
+
+std::string ComputeShaderCacheKey(const std::string& ExpandedSource, const std::vector<std::pair<std::string, std::string>>& Defines,
+                                  uint32_t Stage, const std::string& CompilerOptions, const std::string& CompilerIdentity)
+{
+    FHash Hashes[] = {FHash(FNV_OFFSET_BASIS), FHash(SECOND_SEED)};
+
+    for (auto& Hash : Hashes)
+    {
+        Hash.Add(ExpandedSource);
+
+        uint64_t DefinesCount = Defines.size();
+        Hash.Add(&DefinesCount, sizeof(DefinesCount));
+
+        for (auto& [Define, Value] : Defines)
+        {
+            Hash.Add(Define);
+            Hash.Add(Value);
+        }
+
+        Hash.Add(&Stage, sizeof(Stage));
+        Hash.Add(CompilerOptions);
+        Hash.Add(CompilerIdentity);
+    }
+
+    std::stringstream Key;
+    Key << std::hex;
+
+    for (auto& Hash : Hashes)
+    {
+        Key.width(16);
+        Key.fill('0');
+        Key << Hash.Value;
+    }
+
+    return Key.str();
+}
+
+FShaderCache::FShaderCache(const std::string& DirectoryIn, uint64_t MaxSizeIn) : Directory(DirectoryIn), MaxSize(MaxSizeIn)
+{
+    std::error_code ErrorCode;
+    std::filesystem::create_directories(Directory, ErrorCode);
+    Evict();
+}
+
+std::optional<std::vector<uint32_t>> FShaderCache::Load(const std::string& Key)
+{
+    auto Path = GetEntryPath(Key);
+    FShaderCacheHeader Header;
+    std::vector<uint32_t> SpirV;
+    bool bValid = ReadCheckedFile(Path, SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, Header, SpirV) && !SpirV.empty() && SpirV[0] == SPIRV_MAGIC;
+
+    std::error_code ErrorCode;
+
+    if (!bValid)
+    {
+        /// Broken entry would be a miss every time, so get rid of it
+        std::filesystem::remove(Path, ErrorCode);
+        MissesCount++;
+        return std::nullopt;
+    }
+
+    /// Modification time is used as the last access time for eviction
+    std::filesystem::last_write_time(Path, std::filesystem::file_time_type::clock::now(), ErrorCode);
+    HitsCount++;
+
+    return SpirV;
+}
+
+void FShaderCache::Store(const std::string& Key, const std::vector<uint32_t>& SpirV)
+{
+    if (SpirV.empty())
+    {
+        return;
+    }
+
+    FShaderCacheHeader Header;
+    Header.Size = SpirV.size() * sizeof(uint32_t);
+    Header.Checksum = ComputeChecksum(SpirV.data(), Header.Size);
+
+    if (!WriteFileAtomically(GetEntryPath(Key), {{&Header, sizeof(Header)}, {SpirV.data(), Header.Size}}))
+    {
+        return;
+    }
+
+    if ((KnownSize += sizeof(Header) + Header.Size) > MaxSize)
+    {
+        Evict();
+    }
+}
+
+void FShaderCache::Clear()
+{
+    std::error_code ErrorCode;
+
+    for (auto& Entry : std::filesystem::directory_iterator(Directory, ErrorCode))
+    {
+        if (Entry.path().extension() == SHADER_CACHE_EXTENSION)
+        {
+            std::filesystem::remove(Entry.path(), ErrorCode);
+        }
+    }
+
+    KnownSize = 0;
+}
+
+uint64_t FShaderCache::GetSize() const
+{
+    uint64_t Size = 0;
+    std::error_code ErrorCode;
+
+    for (auto& Entry : std::filesystem::directory_iterator(Directory, ErrorCode))
+    {
+        if (Entry.path().extension() == SHADER_CACHE_EXTENSION)
+        {
+            Size += Entry.file_size(ErrorCode);
+        }
+    }
+
+    return Size;
+}
+
+uint32_t FShaderCache::GetHitsCount() const
+{
+    return HitsCount;
+}
+
+uint32_t FShaderCache::GetMissesCount() const
+{
+    return MissesCount;
+}
+
+std::string FShaderCache::GetEntryPath(const std::string& Key) const
+{
+    return (std::filesystem::path(Directory) / (Key + SHADER_CACHE_EXTENSION)).string();
+}
+
+void FShaderCache::Evict()
+{
+    struct FEntry
+    {
+        std::filesystem::path Path;
+        uint64_t Size = 0;
+        std::filesystem::file_time_type LastAccessTime;
+    };
+
+    std::vector<FEntry> Entries;
+    uint64_t TotalSize = 0;
+    std::error_code ErrorCode;
+
+    auto Now = std::filesystem::file_time_type::clock::now();
+
+    for (auto& Entry : std::filesystem::directory_iterator(Directory, ErrorCode))
+    {
+        if (IsTemporaryFile(Entry.path()))
+        {
+            if (Now - Entry.last_write_time(ErrorCode) > STALE_TEMPORARY_FILE_AGE)
+            {
+                std::filesystem::remove(Entry.path(), ErrorCode);
+            }
+
+            continue;
+        }
+
+        if (Entry.path().extension() != SHADER_CACHE_EXTENSION)
+        {
+            continue;
+        }
+
+        FEntry CacheEntry{Entry.path(), Entry.file_size(ErrorCode), Entry.last_write_time(ErrorCode)};
+        TotalSize += CacheEntry.Size;
+        Entries.push_back(CacheEntry);
+    }
+
+    if (TotalSize <= MaxSize)
+    {
+        KnownSize = TotalSize;
+        return;
+    }
+
+    std::sort(Entries.begin(), Entries.end(), [](const FEntry& A, const FEntry& B){ return A.LastAccessTime < B.LastAccessTime; });
+
+    for (auto& Entry : Entries)
+    {
+        if (TotalSize <= MaxSize)
+        {
+            break;
+        }
+
+        if (std::filesystem::remove(Entry.Path, ErrorCode))
+        {
+            TotalSize -= Entry.Size;
+        }
+    }
+
+    KnownSize = TotalSize;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Default limit of the disk space used by the shader cache. Least recently used entries are removed when it's exceeded
+ */
+constexpr uint64_t DEFAULT_SHADER_CACHE_SIZE = uint64_t(256) * 1024 * 1024;
+
+/**
+ * Hash of everything that affects compiled SPIR-V: source with all includes expanded, defines, shader stage, compiler options and the build of the compiler.
+ * Returned as a hex string, so it can be used as a file name
+ */
+std::string ComputeShaderCacheKey(const std::string& ExpandedSource, const std::vector<std::pair<std::string, std::string>>& Defines,
+                                  uint32_t Stage, const std::string& CompilerOptions, const std::string& CompilerIdentity);
+
+/**
+ * Content addressed on-disk cache of compiled SPIR-V.
+ * Every entry is a separate file named after its key. Files are written to a temporary file first and then renamed,
+ * so a crash or a concurrent writer never leaves a half written entry. Entries carry a checksum, broken ones are removed on load.
+ */
+class FShaderCache
+{
+public:
+    explicit FShaderCache(const std::string& DirectoryIn, uint64_t MaxSizeIn = DEFAULT_SHADER_CACHE_SIZE);
+
+    /// Returns cached SPIR-V, or nothing if there's no valid entry for the key
+    std::optional<std::vector<uint32_t>> Load(const std::string& Key);
+    /// Errors are ignored, since the cache is only an optimization
+    void Store(const std::string& Key, const std::vector<uint32_t>& SpirV);
+    /// Remove every entry
+    void Clear();
+
+    /// Disk space used by entries
+    uint64_t GetSize() const;
+    uint32_t GetHitsCount() const;
+    uint32_t GetMissesCount() const;
+
+private:
+    std::string GetEntryPath(const std::string& Key) const;
+    /// Remove temporary files of crashed writers and least recently used entries until the cache fits into MaxSize
+    void Evict();
+
+    std::string Directory;
+    uint64_t MaxSize = DEFAULT_SHADER_CACHE_SIZE;
+    /// Size of the entries found by the last eviction plus everything stored since. The directory is scanned again only when it exceeds MaxSize
+    std::atomic<uint64_t> KnownSize = 0;
+    std::atomic<uint32_t> HitsCount = 0;
+    std::atomic<uint32_t> MissesCount = 0;
+};
@@ -0,0 +1,434 @@
+#include "shader_includes.h"
+
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+std::string NormalizeShaderPath(const std::string& Path)
+{
+    std::error_code ErrorCode;
+    auto AbsolutePath = std::filesystem::absolute(Path, ErrorCode);
+
+    if (ErrorCode)
+    {
+        AbsolutePath = Path;
+    }
+
+    return AbsolutePath.lexically_normal().generic_string();
+}
+
+std::shared_ptr<const std::string> FShaderFileTable::Read(const std::string& Path)
+{
+    auto NormalizedPath = NormalizeShaderPath(Path);
+
+    std::error_code ErrorCode;
+    auto LastWriteTime = std::filesystem::last_write_time(NormalizedPath, ErrorCode);
+
+    if (ErrorCode)
+    {
+        return nullptr;
+    }
+
+    auto Size = std::filesystem::file_size(NormalizedPath, ErrorCode);
+
+    if (ErrorCode)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    auto Entry = Files.find(NormalizedPath);
+
+    if (Entry != Files.end() && Entry->second.LastWriteTime == LastWriteTime && Entry->second.Size == Size)
+    {
+        return Entry->second.Contents;
+    }
+
+    std::ifstream File(NormalizedPath, std::ios::in | std::ios::binary);
+
+    if (!File.is_open())
+    {
+        return nullptr;
+    }
+
+    std::stringstream Buffer;
+    Buffer << File.rdbuf();
+    DiskReadsCount++;
+
+    auto Contents = std::make_shared<const std::string>(Buffer.str());
+    Files[NormalizedPath] = {Contents, LastWriteTime, Size};
+
+    return Contents;
+}
+
+void FShaderFileTable::Invalidate(const std::string& Path)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Files.erase(NormalizeShaderPath(Path));
+}
+
+void FShaderFileTable::Clear()
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Files.clear();
+}
+
+uint32_t FShaderFileTable::GetDiskReadsCount() const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return DiskReadsCount;
+}
+
+FShaderIncludeResolver::FShaderIncludeResolver(FShaderFileTable& FileTableIn, const std::vector<std::string>& IncludeDirectoriesIn, const std::string& MainFile) :
+    FileTable(FileTableIn), IncludeDirectories(IncludeDirectoriesIn)
+{
+    /// Main file including itself is a cycle too
+    IncludedFiles.insert(NormalizeShaderPath(MainFile));
+}
+
+std::optional<FResolvedInclude> FShaderIncludeResolver::Resolve(const std::string& RequestedSource, const std::string& RequestingSource, bool bRelative)
+{
+    std::vector<std::filesystem::path> Candidates;
+
+    if (bRelative)
+    {
+        Candidates.push_back(std::filesystem::path(RequestingSource).parent_path() / RequestedSource);
+    }
+
+    for (auto& IncludeDirectory : IncludeDirectories)
+    {
+        Candidates.push_back(std::filesystem::path(IncludeDirectory) / RequestedSource);
+    }
+
+    for (auto& Candidate : Candidates)
+    {
+        auto Path = NormalizeShaderPath(Candidate.string());
+
+        if (IncludedFiles.find(Path) != IncludedFiles.end())
+        {
+            return FResolvedInclude{Path, nullptr, true};
+        }
+
+        auto Contents = FileTable.Read(Path);
+
+        if (Contents)
+        {
+            IncludedFiles.insert(Path);
+            Dependencies.push_back(Path);
+            return FResolvedInclude{Path, Contents, false};
+        }
+    }
+
+    return std::nullopt;
+}
+
+const std::vector<std::string>& FShaderIncludeResolver::GetDependencies() const
+{
+    return Dependencies;
+}
+
+namespace
+{
+    /// Parses "#include "File"" or "#include <File>" at the beginning of the line
+    bool ParseIncludeDirective(const std::string& Source, size_t LineBegin, size_t LineEnd, std::string& RequestedSource, bool& bRelative)
+    {
+        auto SkipSpaces = [&](size_t Position)
+        {
+            while (Position < LineEnd && (Source[Position] == ' ' || Source[Position] == '\t'))
+            {
+                Position++;
+            }
+            return Position;
+        };
+
+        auto Position = SkipSpaces(LineBegin);
+
+        if (Position >= LineEnd || Source[Position] != '#')
+        {
+            return false;
+        }
+
+        Position = SkipSpaces(Position + 1);
+        const std::string Include = "include";
+
+        if (Source.compare(Position, Include.size(), Include) != 0)
+        {
+            return false;
+        }
+
+        Position = SkipSpaces(Position + Include.size());
+
+        if (Position >= LineEnd || (Source[Position] != '"' && Source[Position] != '<'))
+        {
+            return false;
+        }
+
+        bRelative = Source[Position] == '"';
+        char Terminator = bRelative ? '"' : '>';
+        auto NameEnd = Source.find(Terminator, Position + 1);
+
+        if (NameEnd == std::string::npos || NameEnd >= LineEnd)
+        {
+            return false;
+        }
+
+        RequestedSource = Source.substr(Position + 1, NameEnd - Position - 1);
+
+        return true;
+    }
+}
+
+std::string ExpandIncludes(const std::string& Source, const std::string& SourcePath, FShaderIncludeResolver& IncludeResolver)
+{
+    std::string Result;
+    Result.reserve(Source.size());
+
+    size_t LineBegin = 0;
+
+    while (LineBegin < Source.size())
+    {
+        auto LineEnd = Source.find('\n', LineBegin);
+        LineEnd = (LineEnd == std::string::npos) ? Source.size() : LineEnd;
+
+        std::string RequestedSource;
+        bool bRelative = true;
+        std::optional<FResolvedInclude> ResolvedInclude;
+
+        if (ParseIncludeDirective(Source, LineBegin, LineEnd, RequestedSource, bRelative))
+        {
+            ResolvedInclude = IncludeResolver.Resolve(RequestedSource, SourcePath, bRelative);
+        }
+
+        if (ResolvedInclude)
+        {
+            if (!ResolvedInclude->bAlreadyIncluded)
+            {
+                Result += ExpandIncludes(*ResolvedInclude->Contents, ResolvedInclude->Path, IncludeResolver);
+            }
+        }
+        else
+        {
+            Result.append(Source, LineBegin, LineEnd - LineBegin);
+        }
+
+        if (LineEnd < Source.size())
+        {
+            Result += '\n';
+        }
+
+        LineBegin = LineEnd + 1;
+    }
+
+    return Result;
+}
+
+void FShaderDependencyGraph::SetDependencies(const std::string& Shader, const std::vector<std::string>& Dependencies)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    auto& ShaderFiles = ShaderDependencies[Shader];
+
+    for (auto& File : ShaderFiles)
+    {
+        FileDependents[File].erase(Shader);
+    }
+
+    ShaderFiles = std::set<std::string>(Dependencies.begin(), Dependencies.end());
+
+    for (auto& File : ShaderFiles)
+    {
+        FileDependents[File].insert(Shader);
+    }
+}
+
+std::vector<std::string> FShaderDependencyGraph::GetDependencies(const std::string& Shader) const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    auto Entry = ShaderDependencies.find(Shader);
+
+    if (Entry == ShaderDependencies.end())
+    {
+        return {};
+    }
+
+    return {Entry->second.begin(), Entry->second.end()};
+}
+
+std::vector<std::string> FShaderDependencyGraph::GetAffectedShaders(const std::string& File) const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    std::set<std::string> AffectedShaders;
+
+    if (ShaderDependencies.find(File) != ShaderDependencies.end())
+    {
+        AffectedShaders.insert(File);
+    }
+
+    auto Entry = FileDependents.find(File);
+
+    if (Entry != FileDependents.end())
+    {
+        AffectedShaders.insert(Entry->second.begin(), Entry->second.end());
+    }
+
+    return {AffectedShaders.begin(), AffectedShaders.end()};
+}
+
+void FShaderDependencyGraph::Clear()
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ShaderDependencies.clear();
+    FileDependents.clear();
+}
+
+#ifdef __linux__
+
+FShaderFileWatcher::FShaderFileWatcher(const std::string& DirectoryIn) : Directory(NormalizeShaderPath(DirectoryIn))
+{
+    INotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (INotifyDescriptor < 0)
+    {
+        return;
+    }
+
+    AddWatch(Directory);
+
+    std::error_code ErrorCode;
+
+    for (auto& Entry : std::filesystem::recursive_directory_iterator(Directory, ErrorCode))
+    {
+        if (Entry.is_directory(ErrorCode))
+        {
+            AddWatch(NormalizeShaderPath(Entry.path().string()));
+        }
+    }
+}
+
+FShaderFileWatcher::~FShaderFileWatcher()
+{
+    if (INotifyDescriptor >= 0)
+    {
+        close(INotifyDescriptor);
+    }
+}
+
+void FShaderFileWatcher::AddWatch(const std::string& Path)
+{
+    /// Editors often save by writing a temporary file and renaming it, so moves count as modifications
+    int WatchDescriptor = inotify_add_watch(INotifyDescriptor, Path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+    if (WatchDescriptor >= 0)
+    {
+        WatchedDirectories[WatchDescriptor] = Path;
+    }
+}
+
+std::vector<std::string> FShaderFileWatcher::PollChangedFiles()
+{
+    std::set<std::string> ChangedFiles;
+
+    if (INotifyDescriptor < 0)
+    {
+        return {};
+    }
+
+    alignas(inotify_event) char Buffer[4096];
+
+    while (true)
+    {
+        auto BytesRead = read(INotifyDescriptor, Buffer, sizeof(Buffer));
+
+        if (BytesRead <= 0)
+        {
+            break;
+        }
+
+        for (char* Pointer = Buffer; Pointer < Buffer + BytesRead;)
+        {
+            auto Event = reinterpret_cast<inotify_event*>(Pointer);
+            Pointer += sizeof(inotify_event) + Event->len;
+
+            auto WatchedDirectory = WatchedDirectories.find(Event->wd);
+
+            if (WatchedDirectory == WatchedDirectories.end() || Event->len == 0)
+            {
+                continue;
+            }
+
+            auto Path = NormalizeShaderPath(WatchedDirectory->second + "/" + Event->name);
+
+            if (Event->mask & IN_ISDIR)
+            {
+                if (Event->mask & IN_CREATE)
+                {
+                    AddWatch(Path);
+                }
+                continue;
+            }
+
+            /// Files are reported when they are closed after writing, not when they are created empty
+            if (Event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                ChangedFiles.insert(Path);
+            }
+        }
+    }
+
+    return {ChangedFiles.begin(), ChangedFiles.end()};
+}
+
+#else
+
+FShaderFileWatcher::FShaderFileWatcher(const std::string& DirectoryIn) : Directory(NormalizeShaderPath(DirectoryIn))
+{
+    LastWriteTimes = ScanDirectory();
+}
+
+FShaderFileWatcher::~FShaderFileWatcher() = default;
+
+std::map<std::string, std::filesystem::file_time_type> FShaderFileWatcher::ScanDirectory() const
+{
+    std::map<std::string, std::filesystem::file_time_type> WriteTimes;
+    std::error_code ErrorCode;
+
+    for (auto& Entry : std::filesystem::recursive_directory_iterator(Directory, ErrorCode))
+    {
+        if (Entry.is_regular_file(ErrorCode))
+        {
+            WriteTimes[NormalizeShaderPath(Entry.path().string())] = Entry.last_write_time(ErrorCode);
+        }
+    }
+
+    return WriteTimes;
+}
+
+std::vector<std::string> FShaderFileWatcher::PollChangedFiles()
+{
+    auto WriteTimes = ScanDirectory();
+    std::vector<std::string> ChangedFiles;
+
+    for (auto& [Path, WriteTime] : WriteTimes)
+    {
+        auto Entry = LastWriteTimes.find(Path);
+
+        if (Entry == LastWriteTimes.end() || Entry->second != WriteTime)
+        {
+            ChangedFiles.push_back(Path);
+        }
+    }
+
+    LastWriteTimes = std::move(WriteTimes);
+
+    return ChangedFiles;
+}
+
+#endif
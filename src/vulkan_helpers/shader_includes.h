@@ -0,0 +1,135 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Absolute path without "." and "..", so that every file has a single name in the file table and in the dependency graph
+std::string NormalizeShaderPath(const std::string& Path);
+
+/**
+ * Contents of shader files shared by all compilations, so that headers like common_structures.h are read once and not once per shader.
+ * A file is read again when its modification time or size changes, or when it's invalidated. Thread safe
+ */
+class FShaderFileTable
+{
+public:
+    /// Returns nullptr if the file can't be read
+    std::shared_ptr<const std::string> Read(const std::string& Path);
+    /// Force the file to be read from the disk next time
+    void Invalidate(const std::string& Path);
+    void Clear();
+
+    /// Number of times files were actually read from the disk
+    uint32_t GetDiskReadsCount() const;
+
+private:
+    struct FEntry
+    {
+        std::shared_ptr<const std::string> Contents;
+        std::filesystem::file_time_type LastWriteTime;
+        uintmax_t Size = 0;
+    };
+
+    mutable std::mutex Mutex;
+    std::unordered_map<std::string, FEntry> Files;
+    uint32_t DiskReadsCount = 0;
+};
+
+struct FResolvedInclude
+{
+    /// Normalized path of the included file
+    std::string Path;
+    /// Empty if the file was already included into this shader
+    std::shared_ptr<const std::string> Contents;
+    bool bAlreadyIncluded = false;
+};
+
+/**
+ * Resolves includes of a single shader. Every file is included at most once, like with #pragma once,
+ * so include cycles end on the first repeated file instead of recursing until the compiler gives up.
+ * Quoted includes are looked up next to the including file first, then in the include directories. Includes in <> only in the include directories
+ */
+class FShaderIncludeResolver
+{
+public:
+    FShaderIncludeResolver(FShaderFileTable& FileTableIn, const std::vector<std::string>& IncludeDirectoriesIn, const std::string& MainFile);
+
+    /// Returns nothing if the file wasn't found
+    std::optional<FResolvedInclude> Resolve(const std::string& RequestedSource, const std::string& RequestingSource, bool bRelative);
+
+    /// Every file included into the shader, in the order they were included first. The main file is not included
+    const std::vector<std::string>& GetDependencies() const;
+
+private:
+    FShaderFileTable& FileTable;
+    std::vector<std::string> IncludeDirectories;
+    std::set<std::string> IncludedFiles;
+    std::vector<std::string> Dependencies;
+};
+
+/**
+ * Substitute every #include directive with the contents of the file, recursively. Directives are recognized at the beginning of a line only,
+ * commented out or disabled by #if ones are substituted too, so the result might depend on more files than the compiler actually reads.
+ * Includes that can't be resolved are left as they are for the compiler to report
+ */
+std::string ExpandIncludes(const std::string& Source, const std::string& SourcePath, FShaderIncludeResolver& IncludeResolver);
+
+/**
+ * Which files every shader depends on, directly or through other headers.
+ * Used to find the shaders, and in the end the pipelines, that must be rebuilt when a header changes. Thread safe
+ */
+class FShaderDependencyGraph
+{
+public:
+    /// Replace the recorded dependencies of the shader
+    void SetDependencies(const std::string& Shader, const std::vector<std::string>& Dependencies);
+    std::vector<std::string> GetDependencies(const std::string& Shader) const;
+    /// Shaders which include the file, directly or not. The file itself if it's a shader
+    std::vector<std::string> GetAffectedShaders(const std::string& File) const;
+    void Clear();
+
+private:
+    mutable std::mutex Mutex;
+    /// Shader -> files it includes
+    std::map<std::string, std::set<std::string>> ShaderDependencies;
+    /// File -> shaders including it
+    std::map<std::string, std::set<std::string>> FileDependents;
+};
+
+/**
+ * Reports files changed in a directory, including its subdirectories.
+ * Uses inotify on Linux, other platforms compare modification times on every poll
+ */
+class FShaderFileWatcher
+{
+public:
+    explicit FShaderFileWatcher(const std::string& DirectoryIn);
+    ~FShaderFileWatcher();
+
+    FShaderFileWatcher(const FShaderFileWatcher&) = delete;
+    FShaderFileWatcher& operator=(const FShaderFileWatcher&) = delete;
+
+    /// Normalized paths of the files modified since the last call. Doesn't block
+    std::vector<std::string> PollChangedFiles();
+
+private:
+    std::string Directory;
+#ifdef __linux__
+    int INotifyDescriptor = -1;
+    /// Watch descriptor -> directory it watches
+    std::map<int, std::string> WatchedDirectories;
+
+    void AddWatch(const std::string& Path);
+#else
+    std::map<std::string, std::filesystem::file_time_type> LastWriteTimes;
+
+    std::map<std::string, std::filesystem::file_time_type> ScanDirectory() const;
+#endif
+};
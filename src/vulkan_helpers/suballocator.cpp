@@ -0,0 +1,220 @@
+#include "suballocator.h"
+
+#include <cassert>
+#include <iterator>
+
+FSuballocator::FSuballocator(uint64_t SizeIn) : Size(SizeIn)
+{
+    if (Size > 0)
+    {
+        InsertFreeBlock(0, Size);
+    }
+}
+
+std::optional<uint64_t> FSuballocator::Allocate(uint64_t AllocationSize, uint64_t Alignment)
+{
+    assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0 && "Alignment should be a power of two!");
+
+    if (AllocationSize == 0)
+    {
+        return std::nullopt;
+    }
+
+    uint64_t BlockOffset = 0;
+    uint64_t BlockSize = 0;
+    std::optional<uint64_t> AlignedOffset;
+
+    /// Blocks are ordered by size inside a bucket, so we start from the smallest block that is big enough
+    /// and take the first one that also fits the alignment padding
+    for (uint64_t Mask = NonEmptyBuckets & (~uint64_t(0) << GetBucketIndex(AllocationSize)); Mask != 0 && !AlignedOffset; Mask &= Mask - 1)
+    {
+        uint32_t i = GetLowestSetBit(Mask);
+
+        for (auto Candidate = Buckets[i].lower_bound({AllocationSize, 0}); Candidate != Buckets[i].end(); ++Candidate)
+        {
+            AlignedOffset = Fit(Candidate->second, Candidate->first, AllocationSize, Alignment);
+
+            if (AlignedOffset)
+            {
+                BlockSize = Candidate->first;
+                BlockOffset = Candidate->second;
+                break;
+            }
+        }
+    }
+
+    if (!AlignedOffset)
+    {
+        return std::nullopt;
+    }
+
+    RemoveFreeBlock(FreeBlocks.find(BlockOffset));
+
+    /// Padding in front of the aligned allocation and the remainder after it stay free
+    if (*AlignedOffset > BlockOffset)
+    {
+        InsertFreeBlock(BlockOffset, *AlignedOffset - BlockOffset);
+    }
+
+    uint64_t AllocationEnd = *AlignedOffset + AllocationSize;
+    uint64_t BlockEnd = BlockOffset + BlockSize;
+
+    if (BlockEnd > AllocationEnd)
+    {
+        InsertFreeBlock(AllocationEnd, BlockEnd - AllocationEnd);
+    }
+
+    UsedSize += AllocationSize;
+    ++AllocationsCount;
+
+    return AlignedOffset;
+}
+
+void FSuballocator::Free(uint64_t Offset, uint64_t FreeSize)
+{
+    assert(Offset + FreeSize <= Size && "Freeing memory outside of the suballocator's range!");
+    assert(AllocationsCount > 0 && "Freeing memory, but nothing was allocated!");
+
+    uint64_t NewOffset = Offset;
+    uint64_t NewSize = FreeSize;
+
+    /// Merge with the next free block
+    auto Next = FreeBlocks.lower_bound(Offset);
+
+    if (Next != FreeBlocks.end())
+    {
+        assert(Next->first >= Offset + FreeSize && "Freeing memory that is already free!");
+
+        if (Next->first == Offset + FreeSize)
+        {
+            NewSize += Next->second;
+            auto ToRemove = Next++;
+            RemoveFreeBlock(ToRemove);
+        }
+    }
+
+    /// Merge with the previous free block
+    if (Next != FreeBlocks.begin())
+    {
+        auto Previous = std::prev(Next);
+
+        assert(Previous->first + Previous->second <= Offset && "Freeing memory that is already free!");
+
+        if (Previous->first + Previous->second == Offset)
+        {
+            NewOffset = Previous->first;
+            NewSize += Previous->second;
+            RemoveFreeBlock(Previous);
+        }
+    }
+
+    InsertFreeBlock(NewOffset, NewSize);
+
+    UsedSize -= FreeSize;
+    --AllocationsCount;
+}
+
+uint64_t FSuballocator::GetSize() const
+{
+    return Size;
+}
+
+uint64_t FSuballocator::GetUsedSize() const
+{
+    return UsedSize;
+}
+
+uint64_t FSuballocator::GetFreeSize() const
+{
+    return Size - UsedSize;
+}
+
+uint64_t FSuballocator::GetLargestFreeBlock() const
+{
+    if (NonEmptyBuckets == 0)
+    {
+        return 0;
+    }
+
+    return Buckets[GetBucketIndex(NonEmptyBuckets)].rbegin()->first;
+}
+
+uint32_t FSuballocator::GetFreeBlocksCount() const
+{
+    return FreeBlocks.size();
+}
+
+uint32_t FSuballocator::GetAllocationsCount() const
+{
+    return AllocationsCount;
+}
+
+double FSuballocator::GetFragmentation() const
+{
+    uint64_t FreeSize = GetFreeSize();
+
+    if (FreeSize == 0)
+    {
+        return 0.;
+    }
+
+    return 1. - double(GetLargestFreeBlock()) / double(FreeSize);
+}
+
+uint32_t FSuballocator::GetBucketIndex(uint64_t BlockSize)
+{
+    uint32_t Result = 0;
+
+    while (BlockSize >>= 1)
+    {
+        ++Result;
+    }
+
+    return Result;
+}
+
+uint32_t FSuballocator::GetLowestSetBit(uint64_t Mask)
+{
+    uint32_t Result = 0;
+
+    while ((Mask & 1) == 0)
+    {
+        Mask >>= 1;
+        ++Result;
+    }
+
+    return Result;
+}
+
+void FSuballocator::InsertFreeBlock(uint64_t Offset, uint64_t BlockSize)
+{
+    FreeBlocks[Offset] = BlockSize;
+    uint32_t BucketIndex = GetBucketIndex(BlockSize);
+    Buckets[BucketIndex].insert({BlockSize, Offset});
+    NonEmptyBuckets |= uint64_t(1) << BucketIndex;
+}
+
+void FSuballocator::RemoveFreeBlock(std::map<uint64_t, uint64_t>::iterator Block)
+{
+    uint32_t BucketIndex = GetBucketIndex(Block->second);
+    Buckets[BucketIndex].erase({Block->second, Block->first});
+
+    if (Buckets[BucketIndex].empty())
+    {
+        NonEmptyBuckets &= ~(uint64_t(1) << BucketIndex);
+    }
+
+    FreeBlocks.erase(Block);
+}
+
+std::optional<uint64_t> FSuballocator::Fit(uint64_t BlockOffset, uint64_t BlockSize, uint64_t AllocationSize, uint64_t Alignment)
+{
+    uint64_t AlignedOffset = (BlockOffset + Alignment - 1) & ~(Alignment - 1);
+
+    if (AlignedOffset + AllocationSize <= BlockOffset + BlockSize)
+    {
+        return AlignedOffset;
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+
+/**
+ * Free list suballocator for a linear range of memory, e.g. a buffer or a device memory block.
+ * It only manages offsets, the memory itself belongs to the caller.
+ * Free blocks are kept in two structures:
+ *  - an offset ordered map, so a freed block can be merged with its free neighbours
+ *  - size buckets (one per power of two), so a fitting block can be found without walking all free blocks
+ */
+class FSuballocator
+{
+public:
+    FSuballocator() = default;
+    explicit FSuballocator(uint64_t SizeIn);
+
+    /// Returns the offset of the allocated range, or nothing if there's no free block big enough
+    std::optional<uint64_t> Allocate(uint64_t AllocationSize, uint64_t Alignment = 1);
+    /// Return the range back into the free list, merging it with free neighbours
+    void Free(uint64_t Offset, uint64_t FreeSize);
+
+    uint64_t GetSize() const;
+    uint64_t GetUsedSize() const;
+    uint64_t GetFreeSize() const;
+    uint64_t GetLargestFreeBlock() const;
+    uint32_t GetFreeBlocksCount() const;
+    uint32_t GetAllocationsCount() const;
+    /// 0 means all the free memory is in a single block, close to 1 means free memory is scattered across many small blocks
+    double GetFragmentation() const;
+
+private:
+    /// Index of the highest set bit, which is floor(log2(BlockSize))
+    static uint32_t GetBucketIndex(uint64_t BlockSize);
+    static uint32_t GetLowestSetBit(uint64_t Mask);
+    void InsertFreeBlock(uint64_t Offset, uint64_t BlockSize);
+    void RemoveFreeBlock(std::map<uint64_t, uint64_t>::iterator Block);
+    /// Try to place an aligned allocation into the free block, returns the aligned offset if it fits
+    static std::optional<uint64_t> Fit(uint64_t BlockOffset, uint64_t BlockSize, uint64_t AllocationSize, uint64_t Alignment);
+
+    static constexpr uint32_t BUCKETS_COUNT = 64;
+
+    uint64_t Size = 0;
+    uint64_t UsedSize = 0;
+    uint32_t AllocationsCount = 0;
+    /// Offset -> Size of every free block
+    std::map<uint64_t, uint64_t> FreeBlocks;
+    /// (Size, Offset) of free blocks with sizes in [2^i, 2^(i+1)), ordered by size
+    std::array<std::set<std::pair<uint64_t, uint64_t>>, BUCKETS_COUNT> Buckets;
+    /// Bit i is set when bucket i is not empty, so empty buckets are skipped without touching them
+    uint64_t NonEmptyBuckets = 0;
+};
@@ -0,0 +1,84 @@
+#include "timeline_schedule.h"
+
+#include <cassert>
+
+bool FTimelineValue::operator==(const FTimelineValue& Other) const
+{
+    return Queue == Other.Queue && Value == Other.Value;
+}
+
+FTimelineSchedule::FTimelineSchedule(uint32_t FramesInFlightIn)
+{
+    SetFramesInFlight(FramesInFlightIn);
+}
+
+void FTimelineSchedule::SetFramesInFlight(uint32_t FramesInFlightIn)
+{
+    assert(FramesInFlightIn > 0 && "There should be at least one frame in flight");
+
+    FramesInFlight = FramesInFlightIn;
+    Frames.assign(FramesInFlight, {});
+    CurrentSlot = UINT32_MAX;
+}
+
+uint32_t FTimelineSchedule::GetFramesInFlight() const
+{
+    return FramesInFlight;
+}
+
+std::vector<FTimelineValue> FTimelineSchedule::BeginFrame(uint64_t FrameIndex)
+{
+    CurrentSlot = FrameIndex % FramesInFlight;
+    auto& Frame = Frames[CurrentSlot];
+
+    assert((Frame.FrameIndex == UINT64_MAX || Frame.FrameIndex < FrameIndex) && "Frames should begin in increasing order");
+
+    std::vector<FTimelineValue> ValuesToWait;
+
+    for (auto& [Queue, Value] : Frame.Values)
+    {
+        ValuesToWait.push_back({Queue, Value});
+    }
+
+    Frame.FrameIndex = FrameIndex;
+    Frame.Values.clear();
+
+    return ValuesToWait;
+}
+
+std::vector<FTimelineValue> FTimelineSchedule::GetFrameValues(uint64_t FrameIndex) const
+{
+    auto& Frame = Frames[FrameIndex % FramesInFlight];
+
+    if (Frame.FrameIndex != FrameIndex)
+    {
+        return {};
+    }
+
+    std::vector<FTimelineValue> Values;
+
+    for (auto& [Queue, Value] : Frame.Values)
+    {
+        Values.push_back({Queue, Value});
+    }
+
+    return Values;
+}
+
+FTimelineValue FTimelineSchedule::Signal(uint32_t Queue)
+{
+    uint64_t Value = ++LastValues[Queue];
+
+    if (CurrentSlot != UINT32_MAX)
+    {
+        Frames[CurrentSlot].Values[Queue] = Value;
+    }
+
+    return {Queue, Value};
+}
+
+uint64_t FTimelineSchedule::GetLastValue(uint32_t Queue) const
+{
+    auto LastValue = LastValues.find(Queue);
+    return LastValue == LastValues.end() ? 0 : LastValue->second;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * Value of a queue's timeline semaphore
+ */
+struct FTimelineValue
+{
+    uint32_t Queue = 0;
+    uint64_t Value = 0;
+
+    bool operator==(const FTimelineValue& Other) const;
+};
+
+/**
+ * Values of the timeline semaphores, one per queue, signalled by the submits.
+ * Every submit signals the next value of its queue, so waiting for a value waits for that submit and everything submitted to the queue before it.
+ * The values reached by a frame are remembered until the frame slot is reused, so that the new frame waits exactly for the work that used the slot's resources.
+ */
+class FTimelineSchedule
+{
+public:
+    explicit FTimelineSchedule(uint32_t FramesInFlightIn = 1);
+
+    /// Forget the values of the frames in flight, the counters keep going as semaphores can't go back
+    void SetFramesInFlight(uint32_t FramesInFlightIn);
+    uint32_t GetFramesInFlight() const;
+
+    /// Start recording the values signalled by the frame. Returns the values reached by the frame that used the same slot,
+    /// which have to be waited for before the slot's resources are reused. Empty for the first frames
+    std::vector<FTimelineValue> BeginFrame(uint64_t FrameIndex);
+    /// Values reached by the submits of the frame, one per queue it was submitted to
+    std::vector<FTimelineValue> GetFrameValues(uint64_t FrameIndex) const;
+
+    /// Reserve the value the next submit to the queue signals
+    FTimelineValue Signal(uint32_t Queue);
+    /// Last value reserved on the queue, zero if nothing was submitted to it
+    uint64_t GetLastValue(uint32_t Queue) const;
+
+private:
+    uint32_t FramesInFlight = 1;
+    std::map<uint32_t, uint64_t> LastValues;
+    /// Frame that used each slot and the last value it signalled on every queue
+    struct FFrameValues
+    {
+        uint64_t FrameIndex = UINT64_MAX;
+        std::map<uint32_t, uint64_t> Values;
+    };
+    std::vector<FFrameValues> Frames;
+    /// Slot of the frame being recorded, signals outside of frames aren't remembered
+    uint32_t CurrentSlot = UINT32_MAX;
+};
@@ -0,0 +1,27 @@
+#include "transfer_chunks.h"
+
+#include <algorithm>
+#include <cassert>
+
+std::vector<FTransferChunk> SplitTransfer(uint64_t Size, uint64_t SourceOffset, uint64_t ChunkSize, uint64_t Granularity, uint32_t StagingSlotsCount)
+{
+    assert(Granularity > 0 && StagingSlotsCount > 0 && "Granularity and number of staging slots should be greater than zero");
+
+    ChunkSize = ChunkSize / Granularity * Granularity;
+    assert(ChunkSize > 0 && "Chunk should be able to hold at least one granule");
+
+    std::vector<FTransferChunk> Chunks;
+    Chunks.reserve((Size + ChunkSize - 1) / ChunkSize);
+
+    for (uint64_t TransferredSize = 0; TransferredSize < Size; TransferredSize += ChunkSize)
+    {
+        FTransferChunk Chunk;
+        Chunk.SourceOffset = SourceOffset + TransferredSize;
+        Chunk.DestinationOffset = TransferredSize;
+        Chunk.Size = std::min(ChunkSize, Size - TransferredSize);
+        Chunk.StagingSlot = Chunks.size() % StagingSlotsCount;
+        Chunks.push_back(Chunk);
+    }
+
+    return Chunks;
+}
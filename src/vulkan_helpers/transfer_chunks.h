@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// Part of a transfer that fits into a single staging slot
+struct FTransferChunk
+{
+    /// Offset in the resource the data is copied from
+    uint64_t SourceOffset = 0;
+    /// Offset in the memory the data is copied to
+    uint64_t DestinationOffset = 0;
+    uint64_t Size = 0;
+    /// Staging slot used for the chunk. Chunks alternate between slots, so the next chunk can be copied while the previous one is read
+    uint32_t StagingSlot = 0;
+};
+
+/**
+ * Split a transfer of Size bytes starting at SourceOffset into chunks no bigger than ChunkSize.
+ * Every chunk, except maybe the last one, is a multiple of Granularity bytes, e.g. a row of an image
+ */
+std::vector<FTransferChunk> SplitTransfer(uint64_t Size, uint64_t SourceOffset, uint64_t ChunkSize, uint64_t Granularity = 1, uint32_t StagingSlotsCount = 2);
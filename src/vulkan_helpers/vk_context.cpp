@@ -7,10 +7,14 @@
 #include "utils.h"
 
 #include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <iostream>
+#include <optional>
 #include <random>
 #include <set>
 #include <stdexcept>
+#include <tuple>
 #include <unordered_map>
 
 #include "stb_image.h"
@@ -45,6 +49,12 @@ void FreeVulkanContext()
 	}
 }
 
+FImportanceMapCache* GetImportanceMapCache()
+{
+	static FImportanceMapCache ImportanceMapCache("../cache/ibl/");
+	return &ImportanceMapCache;
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL FVulkanContext::DebugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT MessageSeverity,
         VkDebugUtilsMessageTypeFlagsEXT MessageType,
@@ -110,6 +120,11 @@ FVulkanContext::FVulkanContext(const std::vector<std::string>& AdditionalDeviceE
     PhysicalDeviceMaintenance4Features.maintenance4 = VK_TRUE;
     VulkanContextOptions.AddDeviceExtension(VK_KHR_MAINTENANCE_4_EXTENSION_NAME, &PhysicalDeviceMaintenance4Features, sizeof(PhysicalDeviceMaintenance4Features));
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures PhysicalDeviceTimelineSemaphoreFeatures{};
+    PhysicalDeviceTimelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    PhysicalDeviceTimelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+    VulkanContextOptions.AddDeviceExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, &PhysicalDeviceTimelineSemaphoreFeatures, sizeof(VkPhysicalDeviceTimelineSemaphoreFeatures));
+
     VulkanContextOptions.AddDeviceExtension(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
     VulkanContextOptions.AddDeviceExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);
 
@@ -140,6 +155,15 @@ FVulkanContext::FVulkanContext(const std::vector<std::string>& AdditionalDeviceE
     LogicalDevice = CreateLogicalDevice(PhysicalDevice, VulkanContextOptions);
 
     GetDeviceQueues(Surface);
+
+    /// Every queue counts its submits on its own timeline
+    for (auto& Entry : Queues)
+    {
+        TimelineSemaphores[Entry.first] = CreateTimelineSemaphore();
+        V::SetName(LogicalDevice, TimelineSemaphores[Entry.first], "Timeline", Entry.first);
+    }
+
+    CreatePipelineCache();
 }
 
 #ifndef NDEBUG
@@ -1027,16 +1051,36 @@ void FVulkanContext::SaveImagePng(const std::string& ImageName, const std::strin
 void FVulkanContext::SaveImageExr(const std::string& ImageName, const std::string& FileName)
 {
 	auto Image = TEXTURE_MANAGER()->GetFramebufferImage(ImageName);
-	std::string FileNameToUse = (FileName.empty()) ? (Image->DebugName) : (FileName);
+	const uint32_t Width = Image->Width;
+	const uint32_t Height = Image->Height;
+	const VkFormat Format = Image->Format;
+
+	auto Data = std::make_shared<std::vector<char>>();
+
+	FetchImageDataAsync(*Image, *Data, [this, Data, Width, Height, Format, FileName]()
+	{
+		/// Drop writes that are already finished
+		ImageWrites.erase(std::remove_if(ImageWrites.begin(), ImageWrites.end(), [](std::future<void>& Write)
+		{
+			return Write.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}), ImageWrites.end());
+
+		ImageWrites.push_back(std::async(std::launch::async, [this, Data, Width, Height, Format, FileName]()
+		{
+			SaveImageDataExr(*Data, Width, Height, Format, FileName);
+		}));
+	});
+}
+
+void FVulkanContext::SaveImageDataExr(const std::vector<char>& Data, uint32_t Width, uint32_t Height, VkFormat Format, const std::string& FileName)
+{
 	std::vector<float> ImageData;
 	int NumberOfComponents = 0;
-	const uint32_t ImageSize = Image->Width * Image->Height;
+	const uint32_t ImageSize = Width * Height;
 
-	if (Image->Format == VK_FORMAT_B8G8R8A8_SRGB)
+	if (Format == VK_FORMAT_B8G8R8A8_SRGB)
 	{
 		NumberOfComponents = 4;
-		std::vector<char> Data;
-		FetchImageData(*Image, Data);
 		ImageData.resize(Data.size());
 
 		for (int i = 0; i < Data.size() / 4; ++i)
@@ -1048,24 +1092,22 @@ void FVulkanContext::SaveImageExr(const std::string& ImageName, const std::strin
 			ImageData[i * NumberOfComponents + 3] = float(Data[i * NumberOfComponents + 3]) / 255;
 		}
 	}
-	if (Image->Format == VK_FORMAT_R32G32B32A32_SFLOAT)
+	if (Format == VK_FORMAT_R32G32B32A32_SFLOAT)
 	{
 		NumberOfComponents = 4;
-		std::vector<float> Data;
-		FetchImageData(*Image, Data);
-		ImageData = std::move(Data);
+		ImageData.resize(Data.size() / sizeof(float));
+		memcpy(ImageData.data(), Data.data(), Data.size());
 	}
-	if (Image->Format == VK_FORMAT_R32G32_UINT)
+	if (Format == VK_FORMAT_R32G32_UINT)
 	{
 		NumberOfComponents = 3;
-		std::vector<float> Data;
-		FetchImageData(*Image, Data);
+		const float* FloatData = reinterpret_cast<const float*>(Data.data());
 
 		ImageData.resize(ImageSize * 3);
 		for (int i = 0; i < ImageSize; ++i)
 		{
-			ImageData[i * NumberOfComponents] = Data[i * 2];
-			ImageData[i * NumberOfComponents + 1] = Data[i * 2 + 1];
+			ImageData[i * NumberOfComponents] = FloatData[i * 2];
+			ImageData[i * NumberOfComponents + 1] = FloatData[i * 2 + 1];
 			ImageData[i * NumberOfComponents + 2] = 0;
 		};
 
@@ -1077,47 +1119,21 @@ void FVulkanContext::SaveImageExr(const std::string& ImageName, const std::strin
 		throw std::runtime_error("Number of components can not be 0");
 	}
 
-	SaveEXRWrapper(ImageData.data(), Image->Width, Image->Height, NumberOfComponents, false, FileName + ".exr");
+	SaveEXRWrapper(ImageData.data(), Width, Height, NumberOfComponents, false, FileName + ".exr");
 }
 
 template <typename T>
 void FVulkanContext::FetchImageData(const FImage& Image, std::vector<T>& Data)
 {
-    uint32_t NumberOfComponents = 0;
-	uint32_t ComponentSize = 0;
-
-    switch (Image.Format) {
-        case VK_FORMAT_B8G8R8A8_SRGB:
-        {
-            NumberOfComponents = 4;
-			ComponentSize = 1;
-            break;
-        }
-        case VK_FORMAT_R32G32B32A32_SFLOAT:
-        {
-            NumberOfComponents = 4;
-			ComponentSize = 4;
-            break;
-        }
-        case VK_FORMAT_R32_UINT:
-        {
-            NumberOfComponents = 1;
-			ComponentSize = 4;
-            break;
-        }
-		case VK_FORMAT_R32G32_UINT:
-		{
-			NumberOfComponents = 2;
-			ComponentSize = 4;
-			break;
-		}
-    }
-
-    RESOURCE_ALLOCATOR()->CopyImageToBuffer(Image, RESOURCE_ALLOCATOR()->StagingBuffer);
+    RESOURCE_ALLOCATOR()->WaitForReadback(FetchImageDataAsync(Image, Data));
+}
 
-    Data.resize(Image.Height * Image.Width * NumberOfComponents * ComponentSize / sizeof(T));
+template <typename T>
+FReadbackHandle FVulkanContext::FetchImageDataAsync(const FImage& Image, std::vector<T>& Data, std::function<void()> OnFinished)
+{
+    Data.resize(Image.Height * Image.Width * Image.GetTexelSize() / sizeof(T));
 
-    RESOURCE_ALLOCATOR()->LoadDataFromStagingBuffer(Data.size() * sizeof(T), Data.data(), 0);
+    return RESOURCE_ALLOCATOR()->LoadDataFromImageAsync(Image, Image.GetTexelSize(), Data.data(), std::move(OnFinished));
 }
 
 template void FVulkanContext::FetchImageData<uint32_t>(const FImage& Image, std::vector<uint32_t>& Data);
@@ -1132,7 +1148,7 @@ ImagePtr FVulkanContext::CreateImage2D(uint32_t Width, uint32_t Height, bool bMi
     return Image;
 }
 
-ImagePtr FVulkanContext::CreateEXRImageFromFile(const std::string& Path, const std::string& DebugImageName)
+ImagePtr FVulkanContext::CreateEXRImageFromFile(const std::string& Path, const std::string& DebugImageName, EIBLSamplingMode IBLSamplingMode)
 {
     float* Out;
     int Width;
@@ -1153,7 +1169,47 @@ ImagePtr FVulkanContext::CreateEXRImageFromFile(const std::string& Path, const s
     Image->Transition(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
     RESOURCE_ALLOCATOR()->LoadDataToImage(*Image, Width * Height * 4 * sizeof(float), Out);
 
-	auto [ImportanceBuffer, IBLPDF] = GenerateImportanceMapFast<FVector4>((void*)Out, Width, Height, [](FVector4 Val){return 0.2126 * Val.x+ 0.7152 * Val.y + 0.0722 * Val.z;});
+	auto Luminance = [](FVector4 Val){return 0.2126 * Val.x+ 0.7152 * Val.y + 0.0722 * Val.z;};
+	std::vector<FAliasTableEntry> AliasTable;
+	std::vector<float> CDFs;
+	std::vector<float> IBLPDF;
+	const void* ImportanceData = nullptr;
+	VkDeviceSize ImportanceDataSize = 0;
+	const void* PDFData = nullptr;
+	VkDeviceSize PDFDataSize = 0;
+
+	/// Tables are keyed by the decoded pixels, so they're rebuilt when the file changes. Rows are always sine weighted here
+	FImportanceMapCacheKey CacheKey{ComputeContentHash(Out, Width * Height * 4 * sizeof(float)), uint32_t(Width), uint32_t(Height), uint32_t(IBLSamplingMode), 1};
+	auto CacheEntry = IMPORTANCE_MAP_CACHE()->Load(Path, CacheKey);
+
+	if (CacheEntry)
+	{
+		ImportanceData = CacheEntry->GetImportanceData();
+		ImportanceDataSize = CacheEntry->GetImportanceSize();
+		PDFData = CacheEntry->GetPDFData();
+		PDFDataSize = CacheEntry->GetPDFSize();
+	}
+	else
+	{
+		if (IBLSamplingMode == EIBLSamplingMode::Hierarchical)
+		{
+			CDFs = GenerateHierarchicalImportanceMap<FVector4, true>((void*)Out, Width, Height, Luminance);
+			/// Probabilities are taken from the CDFs, the PDF buffer only stays bound
+			IBLPDF = {0.f};
+			ImportanceData = CDFs.data();
+			ImportanceDataSize = sizeof(float) * CDFs.size();
+		}
+		else
+		{
+			std::tie(AliasTable, IBLPDF) = GenerateImportanceMapFast<FVector4, true>((void*)Out, Width, Height, Luminance);
+			ImportanceData = AliasTable.data();
+			ImportanceDataSize = sizeof(FAliasTableEntry) * AliasTable.size();
+		}
+
+		PDFData = IBLPDF.data();
+		PDFDataSize = sizeof(float) * IBLPDF.size();
+		IMPORTANCE_MAP_CACHE()->Store(Path, CacheKey, ImportanceData, ImportanceDataSize, PDFData, PDFDataSize);
+	}
 
 	FBuffer IBLImportanceBuffer;
 
@@ -1163,17 +1219,17 @@ ImagePtr FVulkanContext::CreateEXRImageFromFile(const std::string& Path, const s
 	}
 	else
 	{
-		IBLImportanceBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(sizeof(FAliasTableEntry) * ImportanceBuffer.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "IBLImportanceBuffer");
+		IBLImportanceBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(ImportanceDataSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "IBLImportanceBuffer");
 		RESOURCE_ALLOCATOR()->RegisterBuffer(IBLImportanceBuffer, "IBLImportanceBuffer");
 	}
 
-	if (IBLImportanceBuffer.BufferSize != ImportanceBuffer.size() * sizeof(FAliasTableEntry))
+	if (IBLImportanceBuffer.BufferSize != ImportanceDataSize)
 	{
 		RESOURCE_ALLOCATOR()->DestroyBuffer(IBLImportanceBuffer);
-		IBLImportanceBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(sizeof(FAliasTableEntry) * ImportanceBuffer.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "IBLImportanceBuffer");
+		IBLImportanceBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(ImportanceDataSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "IBLImportanceBuffer");
 	}
 
-	RESOURCE_ALLOCATOR()->LoadDataToBuffer(IBLImportanceBuffer, {sizeof(FAliasTableEntry) * ImportanceBuffer.size()}, {0}, {ImportanceBuffer.data()});
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(IBLImportanceBuffer, {ImportanceDataSize}, {0}, {const_cast<void*>(ImportanceData)});
 
 	FBuffer IBLPDFBuffer;
 
@@ -1183,19 +1239,19 @@ ImagePtr FVulkanContext::CreateEXRImageFromFile(const std::string& Path, const s
 	}
 	else
 	{
-		IBLPDFBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(sizeof(float) * IBLPDF.size(),
+		IBLPDFBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(PDFDataSize,
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "IBLPDFBuffer");
 		RESOURCE_ALLOCATOR()->RegisterBuffer(IBLPDFBuffer, "IBLPDFBuffer");
 	}
 
-	if (IBLPDFBuffer.BufferSize != IBLPDF.size() * sizeof(float))
+	if (IBLPDFBuffer.BufferSize != PDFDataSize)
 	{
 		RESOURCE_ALLOCATOR()->DestroyBuffer(IBLPDFBuffer);
-		IBLPDFBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(sizeof(float) * IBLPDF.size(),
+		IBLPDFBuffer = RESOURCE_ALLOCATOR()->CreateBuffer(PDFDataSize,
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "IBLPDFBuffer");
 	}
 
-	RESOURCE_ALLOCATOR()->LoadDataToBuffer(IBLPDFBuffer, {sizeof(float) * IBLPDF.size()}, {0}, {IBLPDF.data()});
+	RESOURCE_ALLOCATOR()->LoadDataToBuffer(IBLPDFBuffer, {PDFDataSize}, {0}, {const_cast<void*>(PDFData)});
 
     return Image;
 }
@@ -1554,11 +1610,13 @@ VkPipeline FVulkanContext::CreateGraphicsPipeline(VkShaderModule VertexShader, V
 
     VkPipeline Pipeline = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(LogicalDevice, VK_NULL_HANDLE, 1, &PipelineInfo, nullptr, &Pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(LogicalDevice, PipelineCache, 1, &PipelineInfo, nullptr, &Pipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create graphics pipeline!");
     }
 
+    bPipelineCacheChanged = true;
+
     return Pipeline;
 }
 
@@ -1632,7 +1690,8 @@ VkPipeline FVulkanContext::CreateRayTracingPipeline(VkShaderModule RayGenShader,
 
     VkPipeline Pipeline = VK_NULL_HANDLE;
 
-    V::vkCreateRayTracingPipelinesKHR(LogicalDevice, {}, {}, 1, &RayTracingPipelineCreateInfo, nullptr, &Pipeline);
+    V::vkCreateRayTracingPipelinesKHR(LogicalDevice, {}, PipelineCache, 1, &RayTracingPipelineCreateInfo, nullptr, &Pipeline);
+    bPipelineCacheChanged = true;
 
     return Pipeline;
 }
@@ -1652,14 +1711,102 @@ VkPipeline FVulkanContext::CreateComputePipeline(VkShaderModule ComputeShader, V
 
     VkPipeline Pipeline = VK_NULL_HANDLE;
 
-    if (vkCreateComputePipelines(LogicalDevice, nullptr, 1, &ComputePipelineCreateInfo, nullptr, &Pipeline) != VK_SUCCESS)
+    if (vkCreateComputePipelines(LogicalDevice, PipelineCache, 1, &ComputePipelineCreateInfo, nullptr, &Pipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create compute pipeline!");
     }
 
+    bPipelineCacheChanged = true;
+
     return Pipeline;
 }
 
+void FVulkanContext::CreatePipelineCache(bool bLoadFromFile)
+{
+    if (PipelineCacheFile == nullptr)
+    {
+        VkPhysicalDeviceProperties PhysicalDeviceProperties;
+        vkGetPhysicalDeviceProperties(PhysicalDevice, &PhysicalDeviceProperties);
+
+        FPipelineCacheDeviceInfo DeviceInfo;
+        DeviceInfo.VendorID = PhysicalDeviceProperties.vendorID;
+        DeviceInfo.DeviceID = PhysicalDeviceProperties.deviceID;
+        DeviceInfo.DriverVersion = PhysicalDeviceProperties.driverVersion;
+        std::memcpy(DeviceInfo.PipelineCacheUUID.data(), PhysicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+
+        PipelineCacheFile = std::make_unique<FPipelineCacheFile>("../cache/pipeline_cache.bin", DeviceInfo);
+    }
+
+    std::optional<std::vector<char>> PipelineCacheData;
+
+    if (bLoadFromFile)
+    {
+        PipelineCacheData = PipelineCacheFile->Load();
+    }
+
+    VkPipelineCacheCreateInfo PipelineCacheCreateInfo{};
+    PipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (PipelineCacheData)
+    {
+        PipelineCacheCreateInfo.initialDataSize = PipelineCacheData->size();
+        PipelineCacheCreateInfo.pInitialData = PipelineCacheData->data();
+    }
+
+    if (vkCreatePipelineCache(LogicalDevice, &PipelineCacheCreateInfo, nullptr, &PipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline cache!");
+    }
+
+    bPipelineCacheChanged = false;
+    PipelineCacheSaveTime = std::chrono::steady_clock::now();
+}
+
+void FVulkanContext::DestroyPipelineCache()
+{
+    vkDestroyPipelineCache(LogicalDevice, PipelineCache, nullptr);
+    PipelineCache = VK_NULL_HANDLE;
+}
+
+void FVulkanContext::SavePipelineCache()
+{
+    if (PipelineCache == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    size_t DataSize = 0;
+
+    if (vkGetPipelineCacheData(LogicalDevice, PipelineCache, &DataSize, nullptr) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    std::vector<char> Data(DataSize);
+
+    /// Errors are ignored, since the cache is only an optimization
+    if (vkGetPipelineCacheData(LogicalDevice, PipelineCache, &DataSize, Data.data()) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    Data.resize(DataSize);
+    PipelineCacheFile->Save(Data);
+
+    bPipelineCacheChanged = false;
+    PipelineCacheSaveTime = std::chrono::steady_clock::now();
+}
+
+void FVulkanContext::FlushPipelineCache()
+{
+    if (!bPipelineCacheChanged || PipelineCacheFlushInterval.count() == 0 || std::chrono::steady_clock::now() - PipelineCacheSaveTime < PipelineCacheFlushInterval)
+    {
+        return;
+    }
+
+    SavePipelineCache();
+}
+
 VkSemaphore FVulkanContext::CreateSemaphore() const
 {
     VkSemaphoreCreateInfo SemaphoreInfo{};
@@ -1675,6 +1822,139 @@ VkSemaphore FVulkanContext::CreateSemaphore() const
     return Semaphore;
 }
 
+VkSemaphore FVulkanContext::CreateTimelineSemaphore(uint64_t InitialValue) const
+{
+    VkSemaphoreTypeCreateInfo SemaphoreTypeInfo{};
+    SemaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    SemaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    SemaphoreTypeInfo.initialValue = InitialValue;
+
+    VkSemaphoreCreateInfo SemaphoreInfo{};
+    SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    SemaphoreInfo.pNext = &SemaphoreTypeInfo;
+
+    VkSemaphore Semaphore;
+
+    if (vkCreateSemaphore(LogicalDevice, &SemaphoreInfo, nullptr, &Semaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create timeline semaphore!");
+    }
+
+    return Semaphore;
+}
+
+VkSemaphore FVulkanContext::GetTimelineSemaphore(VkQueueFlagBits QueueFlagBits) const
+{
+    auto TimelineSemaphore = TimelineSemaphores.find(QueueFlagBits);
+
+    if (TimelineSemaphore == TimelineSemaphores.end())
+    {
+        throw std::runtime_error("Failed to find a timeline semaphore of the requested queue!");
+    }
+
+    return TimelineSemaphore->second;
+}
+
+FTimelinePoint FVulkanContext::GetTimelinePoint(const FTimelineValue& TimelineValue) const
+{
+    return {GetTimelineSemaphore(VkQueueFlagBits(TimelineValue.Queue)), TimelineValue.Value};
+}
+
+void FVulkanContext::WaitTimeline(const std::vector<FTimelinePoint>& TimelinePoints) const
+{
+    if (TimelinePoints.empty())
+    {
+        return;
+    }
+
+    std::vector<VkSemaphore> Semaphores;
+    std::vector<uint64_t> Values;
+
+    for (auto& TimelinePoint : TimelinePoints)
+    {
+        Semaphores.push_back(TimelinePoint.Semaphore);
+        Values.push_back(TimelinePoint.Value);
+    }
+
+    VkSemaphoreWaitInfo SemaphoreWaitInfo{};
+    SemaphoreWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    SemaphoreWaitInfo.semaphoreCount = Semaphores.size();
+    SemaphoreWaitInfo.pSemaphores = Semaphores.data();
+    SemaphoreWaitInfo.pValues = Values.data();
+
+    if (vkWaitSemaphores(LogicalDevice, &SemaphoreWaitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to wait for timeline semaphores!");
+    }
+}
+
+FSynchronizationPoint FVulkanContext::Submit(VkQueueFlagBits QueueFlagBits, const std::vector<VkCommandBuffer>& CommandBuffers, const FSynchronizationPoint& SynchronizationPoint, VkPipelineStageFlags WaitStages)
+{
+    /// Values of binary semaphores are ignored, so both kinds go into the same arrays
+    std::vector<VkSemaphore> WaitSemaphores = SynchronizationPoint.SemaphoresToWait;
+    std::vector<uint64_t> WaitValues(WaitSemaphores.size(), 0);
+
+    for (auto& TimelinePoint : SynchronizationPoint.TimelinePointsToWait)
+    {
+        WaitSemaphores.push_back(TimelinePoint.Semaphore);
+        WaitValues.push_back(TimelinePoint.Value);
+    }
+
+    std::vector<VkPipelineStageFlags> WaitStageMasks(WaitSemaphores.size(), WaitStages);
+
+    FTimelinePoint SubmitFinished = GetTimelinePoint(TimelineSchedule.Signal(QueueFlagBits));
+    std::vector<VkSemaphore> SignalSemaphores = SynchronizationPoint.SemaphoresToSignal;
+    std::vector<uint64_t> SignalValues(SignalSemaphores.size(), 0);
+
+    for (auto& TimelinePoint : SynchronizationPoint.TimelinePointsToSignal)
+    {
+        SignalSemaphores.push_back(TimelinePoint.Semaphore);
+        SignalValues.push_back(TimelinePoint.Value);
+    }
+
+    SignalSemaphores.push_back(SubmitFinished.Semaphore);
+    SignalValues.push_back(SubmitFinished.Value);
+
+    VkTimelineSemaphoreSubmitInfo TimelineSemaphoreSubmitInfo{};
+    TimelineSemaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    TimelineSemaphoreSubmitInfo.waitSemaphoreValueCount = WaitValues.size();
+    TimelineSemaphoreSubmitInfo.pWaitSemaphoreValues = WaitValues.empty() ? nullptr : WaitValues.data();
+    TimelineSemaphoreSubmitInfo.signalSemaphoreValueCount = SignalValues.size();
+    TimelineSemaphoreSubmitInfo.pSignalSemaphoreValues = SignalValues.data();
+
+    VkSubmitInfo SubmitInfo{};
+    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.pNext = &TimelineSemaphoreSubmitInfo;
+    SubmitInfo.waitSemaphoreCount = WaitSemaphores.size();
+    SubmitInfo.pWaitSemaphores = WaitSemaphores.empty() ? nullptr : WaitSemaphores.data();
+    SubmitInfo.pWaitDstStageMask = WaitStageMasks.empty() ? nullptr : WaitStageMasks.data();
+    SubmitInfo.commandBufferCount = CommandBuffers.size();
+    SubmitInfo.pCommandBuffers = CommandBuffers.data();
+    SubmitInfo.signalSemaphoreCount = SignalSemaphores.size();
+    SubmitInfo.pSignalSemaphores = SignalSemaphores.data();
+
+    if (!SynchronizationPoint.FencesToWait.empty())
+    {
+        vkWaitForFences(LogicalDevice, SynchronizationPoint.FencesToWait.size(), SynchronizationPoint.FencesToWait.data(), VK_TRUE, UINT64_MAX);
+    }
+
+    VkFence FenceToSignal = VK_NULL_HANDLE;
+
+    if (!SynchronizationPoint.FencesToSignal.empty())
+    {
+        assert(SynchronizationPoint.FencesToSignal.size() == 1 && "A submit can signal only one fence");
+        FenceToSignal = SynchronizationPoint.FencesToSignal[0];
+        vkResetFences(LogicalDevice, 1, &FenceToSignal);
+    }
+
+    if (vkQueueSubmit(GetQueue(QueueFlagBits), 1, &SubmitInfo, FenceToSignal) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit command buffers!");
+    }
+
+    return {{}, {}, {}, {}, {SubmitFinished}, {}};
+}
+
 VkFence FVulkanContext::CreateSignalledFence() const
 {
     VkFenceCreateInfo FenceInfo{};
@@ -1832,12 +2112,32 @@ void FVulkanContext::DestroyDebugUtilsMessengerEXT(VkDebugUtilsMessengerEXT& Deb
 
 void FVulkanContext::CleanUp()
 {
+    /// Readbacks in flight still use images
+    RESOURCE_ALLOCATOR()->WaitForReadbacks();
+
+    for (auto& Write : ImageWrites)
+    {
+        Write.wait();
+    }
+
+    ImageWrites.clear();
+
     FREE_TEXTURE_MANAGER();
 
     DescriptorSetManager = nullptr;
     FREE_COMMAND_BUFFER_MANAGER();
     FREE_RESOURCE_ALLOCATOR();
 
+    SavePipelineCache();
+    DestroyPipelineCache();
+
+    for (auto& [QueueFlagBits, TimelineSemaphore] : TimelineSemaphores)
+    {
+        vkDestroySemaphore(LogicalDevice, TimelineSemaphore, nullptr);
+    }
+
+    TimelineSemaphores.clear();
+
     vkDestroyDevice(LogicalDevice, nullptr);
 
 #ifndef NDEBUG
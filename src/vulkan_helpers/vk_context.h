@@ -8,12 +8,17 @@
 #include "buffer.h"
 #include "descriptors.h"
 #include "image.h"
+#include "importance_map_cache.h"
 #include "vk_acceleration_structure.h"
 #include "vk_utils.h"
 #include "vk_pipeline.h"
+#include "pipeline_cache.h"
+#include "timeline_schedule.h"
 
 #include <array>
+#include <chrono>
 #include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
@@ -108,13 +113,17 @@ public:
     ImagePtr CreateImage2D(uint32_t Width, uint32_t Height, bool bMipMapsRequired, VkSampleCountFlagBits NumSamples, VkFormat Format,
                                VkImageTiling Tiling, VkImageUsageFlags Usage, VkMemoryPropertyFlags Properties,
                                VkImageAspectFlags AspectFlags, VkDevice Device, const std::string& DebugImageName);
-    ImagePtr CreateEXRImageFromFile(const std::string& Path, const std::string& DebugImageName);
+    ImagePtr CreateEXRImageFromFile(const std::string& Path, const std::string& DebugImageName, EIBLSamplingMode IBLSamplingMode = EIBLSamplingMode::AliasTable);
     ImagePtr LoadImageFromFile(const std::string& Path, const std::string& DebugImageName);
     ImagePtr Wrap(VkImage ImageToWrap, uint32_t WidthIn, uint32_t HeightIn, VkFormat Format, VkImageAspectFlags AspectFlags, VkDevice LogicalDevice, const std::string& DebugImageName);
 	void SaveImagePng(const std::string& ImageName, const std::string& FileName = "");
+	/// Doesn't wait for the GPU, the image is read back and written to the file in the background
 	void SaveImageExr(const std::string& ImageName, const std::string& FileName = "");
     template <typename T>
     void FetchImageData(const FImage& Image, std::vector<T>& Data);
+    /// Data is resized right away, and should stay alive until OnFinished is called
+    template <typename T>
+    FReadbackHandle FetchImageDataAsync(const FImage& Image, std::vector<T>& Data, std::function<void()> OnFinished = {});
 
     VkSampler CreateTextureSampler(uint32_t MipLevel, VkFilter Filter);
 
@@ -128,7 +137,23 @@ public:
     VkPipeline CreateRayTracingPipeline(VkShaderModule RayGenShader, VkShaderModule RayMissShader, VkShaderModule VertexShader, VkPipelineLayout PipelineLayout);
     VkPipeline CreateComputePipeline(VkShaderModule ComputeShader, VkPipelineLayout PipelineLayout);
 
+    /// Pipeline cache used for every pipeline. It's loaded from the file when the device is created and saved on clean up
+    void CreatePipelineCache(bool bLoadFromFile = true);
+    void DestroyPipelineCache();
+    void SavePipelineCache();
+    /// Save the pipeline cache if new pipelines were created and PipelineCacheFlushInterval passed since the last save
+    void FlushPipelineCache();
+
     VkSemaphore CreateSemaphore() const;
+    VkSemaphore CreateTimelineSemaphore(uint64_t InitialValue = 0) const;
+    /// Timeline semaphore of the queue, created with the device. Its values come from TimelineSchedule
+    VkSemaphore GetTimelineSemaphore(VkQueueFlagBits QueueFlagBits) const;
+    FTimelinePoint GetTimelinePoint(const FTimelineValue& TimelineValue) const;
+    /// Block until every semaphore reaches its value
+    void WaitTimeline(const std::vector<FTimelinePoint>& TimelinePoints) const;
+    /// Submit the command buffers after everything the synchronization point waits for, signalling what it signals.
+    /// The submit also signals the next value of the queue's timeline, the returned synchronization point waits for it
+    FSynchronizationPoint Submit(VkQueueFlagBits QueueFlagBits, const std::vector<VkCommandBuffer>& CommandBuffers, const FSynchronizationPoint& SynchronizationPoint, VkPipelineStageFlags WaitStages);
     VkFence CreateSignalledFence() const;
     VkFence CreateUnsignalledFence() const;
 
@@ -176,6 +201,26 @@ public:
     std::shared_ptr<FDescriptorSetManager>DescriptorSetManager = nullptr;
 
     bool bFramebufferResized = false;
+
+    VkPipelineCache PipelineCache = VK_NULL_HANDLE;
+    /// How often FlushPipelineCache saves the pipeline cache, so that it survives a crash. Zero saves it only on clean up
+    std::chrono::seconds PipelineCacheFlushInterval{0};
+
+    /// Values signalled by the submits of every queue, and reached by the frames in flight
+    FTimelineSchedule TimelineSchedule;
+
+private:
+    void SaveImageDataExr(const std::vector<char>& Data, uint32_t Width, uint32_t Height, VkFormat Format, const std::string& FileName);
+
+    /// Images that are being written to files in the background
+    std::vector<std::future<void>> ImageWrites;
+
+    std::unique_ptr<FPipelineCacheFile> PipelineCacheFile = nullptr;
+    /// New pipelines were created since the pipeline cache was saved
+    bool bPipelineCacheChanged = false;
+    std::chrono::steady_clock::time_point PipelineCacheSaveTime;
+
+    std::map<VkQueueFlagBits, VkSemaphore> TimelineSemaphores;
 };
 
 FVulkanContext* GetVulkanContext(const std::vector<std::string>& AdditionalDeviceExtensions);
@@ -184,3 +229,8 @@ void FreeVulkanContext();
 #define VK_CONTEXT() GetVulkanContext({})
 #define INIT_VK_CONTEXT(AdditionalDeviceExtensions) GetVulkanContext(AdditionalDeviceExtensions)
 #define FREE_VK_CONTEXT()
+
+/// Importance tables of environment maps loaded by CreateEXRImageFromFile
+FImportanceMapCache* GetImportanceMapCache();
+
+#define IMPORTANCE_MAP_CACHE() GetImportanceMapCache()
@@ -2,26 +2,61 @@
 #include "vk_utils.h"
 #include "vk_context.h"
 
-#include "string_manipulation.h"
-
 #include "shaderc/shaderc.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <iostream>
 #include <map>
+#include <memory>
 
 shaderc_shader_kind GetShaderType(const std::string& Path);
-std::vector<uint32_t> CompileShaderToSpirVData(const std::string &Path,  const FCompileDefinitions* CompileDefinitions);
+
+/// SPIR-V of the shader, or the error message if the compilation failed
+struct FShaderCompilationResult
+{
+    std::vector<uint32_t> SPIRVData;
+    std::string ErrorMessage;
+};
+
+FShaderCompilationResult CompileShader(shaderc::Compiler& Compiler, const std::string& Path, const FCompileDefinitions* CompileDefinitions, FShaderCache* ShaderCache);
+
+FShaderCache* GetShaderCache()
+{
+    static FShaderCache ShaderCache("../cache/shaders/");
+    return &ShaderCache;
+}
+
+FShaderFileTable* GetShaderFileTable()
+{
+    static FShaderFileTable ShaderFileTable;
+    return &ShaderFileTable;
+}
+
+FShaderDependencyGraph* GetShaderDependencyGraph()
+{
+    static FShaderDependencyGraph ShaderDependencyGraph;
+    return &ShaderDependencyGraph;
+}
 
 void FCompileDefinitions::Push(const std::string& Define, const std::string& Value)
 {
     Defines.emplace_back(Define, Value);
 }
 
-FShader::FShader(const std::string &Path, const FCompileDefinitions* CompileDefinitions)
+FShaderCompilationPool* GetShaderCompilationPool()
+{
+    static FShaderCompilationPool ShaderCompilationPool;
+    return &ShaderCompilationPool;
+}
+
+FShader::FShader(const std::string &Path, const FCompileDefinitions* CompileDefinitions) : FShader(CompileShaderToSpirVData(Path, CompileDefinitions, SHADER_CACHE()))
 {
-    auto SPIRVData = CompileShaderToSpirVData(Path, CompileDefinitions);
+}
 
+FShader::FShader(const std::vector<uint32_t>& SPIRVData)
+{
     VkShaderModuleCreateInfo CreateInfo{};
     CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     CreateInfo.codeSize = SPIRVData.size() * sizeof(uint32_t);
@@ -71,69 +106,330 @@ shaderc_shader_kind GetShaderType(const std::string& Path)
     return ExtensionToShaderTypeMap[Extension];
 }
 
-std::vector<uint32_t> CompileShaderToSpirVData(const std::string &Path,  const FCompileDefinitions* CompileDefinitions)
+namespace
 {
-    auto ShaderType = GetShaderType(Path);
-    auto ShaderCode = ReadFileToString(Path);
-
-	auto StartingIndex = FindString(ShaderCode, "#include \"");
+    bool IsMacroDefinition(const std::string& Define)
+    {
+        if (Define.empty() || std::isdigit(static_cast<unsigned char>(Define[0])))
+        {
+            return false;
+        }
 
-	while (StartingIndex != std::string::npos)
-	{
-		auto IncludedFile = GetIncludeFileName(ShaderCode, StartingIndex);
-		auto IncludeString = ReadFileToString("../src/shaders/" + IncludedFile);
-		auto FullString = GetStringTillTheEOL(ShaderCode, StartingIndex);
-		ReplaceString(ShaderCode, FullString, IncludeString, StartingIndex);
-		StartingIndex = FindString(ShaderCode, "#include \"", StartingIndex);
-	}
+        return std::all_of(Define.begin(), Define.end(), [](char Character){ return std::isalnum(static_cast<unsigned char>(Character)) || Character == '_'; });
+    }
 
-    if (CompileDefinitions)
+    /// Main file of the shader with code definitions substituted. Includes are resolved later, by the compiler or by ExpandIncludes
+    std::string GetShaderSource(const std::string& Path, const FCompileDefinitions* CompileDefinitions)
     {
-        for (auto &Define: CompileDefinitions->Defines)
+        auto ShaderCode = SHADER_FILE_TABLE()->Read(Path);
+
+        if (!ShaderCode)
         {
-            while (true)
+            throw std::runtime_error("Failed to open file " + Path);
+        }
+
+        std::string Source = *ShaderCode;
+
+        if (CompileDefinitions)
+        {
+            for (auto& [Define, Value] : CompileDefinitions->Defines)
             {
-                auto StartingIndex = FindString(ShaderCode, Define.first);
+                if (IsMacroDefinition(Define))
+                {
+                    continue;
+                }
 
-                if (StartingIndex == std::string::npos)
+                /// Search continues after the inserted value, so a value containing the definition is fine
+                for (auto Position = Source.find(Define); Position != std::string::npos; Position = Source.find(Define, Position + Value.size()))
                 {
-                    break;
+                    Source.replace(Position, Define.size(), Value);
                 }
-                ReplaceString(ShaderCode, Define.first, Define.second, StartingIndex);
             }
-            /// TODO: What if Define was not found? looks like an error...
         }
+
+        return Source;
     }
 
-    std::map<shaderc_shader_kind, std::string> ShaderTypeToExtensionMap
+    std::string ExpandShaderIncludes(const std::string& Path, const std::string& Source, const std::string& IncludeDirectory)
     {
-        {shaderc_shader_kind::shaderc_closesthit_shader, "rchit"},
-        {shaderc_shader_kind::shaderc_raygen_shader, "rgen"},
-        {shaderc_shader_kind::shaderc_miss_shader, "rmiss"},
-        {shaderc_shader_kind::shaderc_vertex_shader, "vert"},
-        {shaderc_shader_kind::shaderc_fragment_shader, "frag"},
-        {shaderc_shader_kind::shaderc_compute_shader, "comp"}
+        FShaderIncludeResolver IncludeResolver(*SHADER_FILE_TABLE(), {IncludeDirectory}, Path);
+        auto ExpandedSource = ExpandIncludes(Source, Path, IncludeResolver);
+
+        SHADER_DEPENDENCY_GRAPH()->SetDependencies(NormalizeShaderPath(Path), IncludeResolver.GetDependencies());
+
+        return ExpandedSource;
+    }
+
+    /// Keeps the contents of an include alive until the compiler releases it
+    struct FIncludeResult
+    {
+        shaderc_include_result IncludeResult{};
+        std::string SourceName;
+        std::shared_ptr<const std::string> Contents;
+        std::string ErrorMessage;
     };
 
-    FTimer Timer("Shader : " + Path + " compilation time: ");
-    static shaderc::Compiler Compiler;
-    static shaderc::CompileOptions CompileOptions;
+    /// Resolves includes for shaderc through the shared file table. Every shader is compiled with its own includer, since it remembers included files
+    class FShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+    {
+    public:
+        FShaderIncluder(const std::string& IncludeDirectory, const std::string& MainFile) : IncludeResolver(*SHADER_FILE_TABLE(), {IncludeDirectory}, MainFile)
+        {
+        }
+
+        shaderc_include_result* GetInclude(const char* RequestedSource, shaderc_include_type Type, const char* RequestingSource, size_t IncludeDepth) override
+        {
+            auto Result = new FIncludeResult;
+            auto ResolvedInclude = IncludeResolver.Resolve(RequestedSource, RequestingSource, Type == shaderc_include_type_relative);
+
+            if (ResolvedInclude)
+            {
+                Result->SourceName = ResolvedInclude->Path;
+                Result->Contents = ResolvedInclude->Contents;
+            }
+            else
+            {
+                /// Empty source name tells shaderc that the include failed, and the content is the error message
+                Result->ErrorMessage = "Can't find included file " + std::string(RequestedSource);
+            }
+
+            Result->IncludeResult.source_name = Result->SourceName.c_str();
+            Result->IncludeResult.source_name_length = Result->SourceName.size();
+            Result->IncludeResult.content = Result->Contents ? Result->Contents->c_str() : Result->ErrorMessage.c_str();
+            Result->IncludeResult.content_length = Result->Contents ? Result->Contents->size() : Result->ErrorMessage.size();
+            Result->IncludeResult.user_data = Result;
+
+            return &Result->IncludeResult;
+        }
+
+        void ReleaseInclude(shaderc_include_result* Data) override
+        {
+            delete static_cast<FIncludeResult*>(Data->user_data);
+        }
+
+    private:
+        FShaderIncludeResolver IncludeResolver;
+    };
+}
+
+std::string ExpandShaderSource(const std::string& Path, const FCompileDefinitions* CompileDefinitions, const std::string& IncludeDirectory)
+{
+    return ExpandShaderIncludes(Path, GetShaderSource(Path, CompileDefinitions), IncludeDirectory);
+}
+
+FShaderCompilationResult CompileShader(shaderc::Compiler& Compiler, const std::string& Path, const FCompileDefinitions* CompileDefinitions, FShaderCache* ShaderCache)
+{
+    auto ShaderType = GetShaderType(Path);
+    std::string ShaderCode;
+    std::string ExpandedShaderCode;
+
+    try
+    {
+        ShaderCode = GetShaderSource(Path, CompileDefinitions);
+        ExpandedShaderCode = ExpandShaderIncludes(Path, ShaderCode, SHADER_DIRECTORY);
+    }
+    catch (const std::runtime_error& Error)
+    {
+        return {{}, "Failed to compile shader " + Path + ":\n" + Error.what()};
+    }
+
+    shaderc::CompileOptions CompileOptions;
     CompileOptions.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version::shaderc_env_version_vulkan_1_3);
     CompileOptions.SetTargetSpirv(shaderc_spirv_version_1_6);
 	//CompileOptions.SetOptimizationLevel(shaderc_optimization_level::shaderc_optimization_level_performance);
 #ifndef NDEBUG
 	CompileOptions.SetGenerateDebugInfo();
 #endif
-    shaderc::CompilationResult CompilationResult = Compiler.CompileGlslToSpv(ShaderCode.c_str(), ShaderType, ShaderTypeToExtensionMap[ShaderType].c_str(), CompileOptions);
+    CompileOptions.SetIncluder(std::make_unique<FShaderIncluder>(SHADER_DIRECTORY, Path));
 
-    if (CompilationResult.GetCompilationStatus() != shaderc_compilation_status_success) {
-        std::string ErrorMassage = CompilationResult.GetErrorMessage();
-        std::cout << ErrorMassage << '\n';
-        assert(false && "Failed to compile shader");
+    if (CompileDefinitions)
+    {
+        for (auto& [Define, Value] : CompileDefinitions->Defines)
+        {
+            if (IsMacroDefinition(Define))
+            {
+                CompileOptions.AddMacroDefinition(Define, Value);
+            }
+        }
+    }
+
+    /// Should describe every option set above, so that changing them invalidates cached shaders.
+    /// Name of the file goes into error messages and debug info
+    std::string CompilerOptions = "vulkan1.3;spirv1.6;file=" + Path;
+#ifndef NDEBUG
+    CompilerOptions += ";debug";
+#endif
+
+    std::string CacheKey;
+
+    if (ShaderCache)
+    {
+        CacheKey = ComputeShaderCacheKey(ExpandedShaderCode, CompileDefinitions ? CompileDefinitions->Defines : std::vector<std::pair<std::string, std::string>>{},
+                                         ShaderType, CompilerOptions, SHADER_COMPILER_IDENTITY);
+        auto CachedSPIRV = ShaderCache->Load(CacheKey);
+
+        if (CachedSPIRV)
+        {
+            return {std::move(*CachedSPIRV), ""};
+        }
+    }
+
+    FTimer Timer("Shader : " + Path + " compilation time: ");
+    shaderc::CompilationResult CompilationResult = Compiler.CompileGlslToSpv(ShaderCode.c_str(), ShaderType, Path.c_str(), CompileOptions);
+
+    if (CompilationResult.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        return {{}, "Failed to compile shader " + Path + ":\n" + CompilationResult.GetErrorMessage()};
     }
 
     std::vector<uint32_t> SPIRVByteCode;
     SPIRVByteCode.assign(CompilationResult.begin(), CompilationResult.end());
 
-    return SPIRVByteCode;
+    if (ShaderCache)
+    {
+        ShaderCache->Store(CacheKey, SPIRVByteCode);
+    }
+
+    return {std::move(SPIRVByteCode), ""};
+}
+
+std::vector<uint32_t> CompileShaderToSpirVData(const std::string &Path, const FCompileDefinitions* CompileDefinitions, FShaderCache* ShaderCache)
+{
+    static shaderc::Compiler Compiler;
+    auto Result = CompileShader(Compiler, Path, CompileDefinitions, ShaderCache);
+
+    if (!Result.ErrorMessage.empty())
+    {
+        std::cout << Result.ErrorMessage << '\n';
+        assert(false && "Failed to compile shader");
+    }
+
+    return Result.SPIRVData;
+}
+
+FShaderCompilationPool::FShaderCompilationPool(uint32_t ThreadsCount, FShaderCache* ShaderCacheIn) : ShaderCache(ShaderCacheIn)
+{
+    assert(ThreadsCount > 0 && "Shader compilation pool needs at least one thread");
+
+    for (uint32_t i = 0; i < ThreadsCount; ++i)
+    {
+        Workers.emplace_back(&FShaderCompilationPool::WorkerLoop, this);
+    }
+}
+
+FShaderCompilationPool::~FShaderCompilationPool()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        bStopping = true;
+    }
+
+    Condition.notify_all();
+
+    for (auto& Worker : Workers)
+    {
+        Worker.join();
+    }
+}
+
+std::shared_future<std::vector<uint32_t>> FShaderCompilationPool::Compile(FShaderCompilationJob Job)
+{
+    auto Promise = std::make_shared<std::promise<std::vector<uint32_t>>>();
+    std::shared_future<std::vector<uint32_t>> Future = Promise->get_future().share();
+
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Jobs.push_back([this, Job = std::move(Job), Promise](shaderc::Compiler& Compiler)
+        {
+            auto Result = CompileShader(Compiler, Job.Path, &Job.CompileDefinitions, ShaderCache);
+
+            if (Result.ErrorMessage.empty())
+            {
+                Promise->set_value(std::move(Result.SPIRVData));
+            }
+            else
+            {
+                Promise->set_exception(std::make_exception_ptr(std::runtime_error(Result.ErrorMessage)));
+            }
+        });
+    }
+
+    Condition.notify_one();
+
+    return Future;
+}
+
+std::vector<std::vector<uint32_t>> FShaderCompilationPool::CompileBatch(const std::vector<FShaderCompilationJob>& JobsIn)
+{
+    std::vector<std::shared_future<std::vector<uint32_t>>> Futures;
+    Futures.reserve(JobsIn.size());
+
+    for (auto& Job : JobsIn)
+    {
+        Futures.push_back(Compile(Job));
+    }
+
+    return WaitForBatch(Futures);
+}
+
+std::vector<std::vector<uint32_t>> FShaderCompilationPool::WaitForBatch(const std::vector<std::shared_future<std::vector<uint32_t>>>& Futures)
+{
+    std::vector<std::vector<uint32_t>> SPIRVData(Futures.size());
+    std::string ErrorMessage;
+
+    /// Errors are collected in the order of the jobs, not in the order they happened, so the message doesn't depend on scheduling
+    for (size_t i = 0; i < Futures.size(); ++i)
+    {
+        try
+        {
+            SPIRVData[i] = Futures[i].get();
+        }
+        catch (const std::runtime_error& Error)
+        {
+            ErrorMessage += GetJobErrorMessage(i, Error);
+        }
+    }
+
+    if (!ErrorMessage.empty())
+    {
+        throw std::runtime_error(ErrorMessage);
+    }
+
+    return SPIRVData;
+}
+
+std::string FShaderCompilationPool::GetJobErrorMessage(size_t JobIndex, const std::runtime_error& Error)
+{
+    return "Job " + std::to_string(JobIndex) + ": " + Error.what() + "\n";
+}
+
+uint32_t FShaderCompilationPool::GetThreadsCount() const
+{
+    return Workers.size();
+}
+
+void FShaderCompilationPool::WorkerLoop()
+{
+    /// shaderc::Compiler is not thread safe, so every worker has its own
+    shaderc::Compiler Compiler;
+
+    while (true)
+    {
+        std::function<void(shaderc::Compiler&)> Job;
+
+        {
+            std::unique_lock<std::mutex> Lock(Mutex);
+            Condition.wait(Lock, [this](){ return bStopping || !Jobs.empty(); });
+
+            if (Jobs.empty())
+            {
+                return;
+            }
+
+            Job = std::move(Jobs.front());
+            Jobs.pop_front();
+        }
+
+        Job(Compiler);
+    }
 }
\ No newline at end of file
@@ -2,9 +2,32 @@
 
 #include "vulkan/vulkan.h"
 
+#include "shader_cache.h"
+#include "shader_includes.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+namespace shaderc
+{
+    class Compiler;
+}
+
+/**
+ * Directory with the shaders. Includes are looked up there, and it's watched for changes
+ */
+constexpr const char* SHADER_DIRECTORY = "../src/shaders/";
+
+/// Definitions which are identifiers, e.g. LAST_BOUNCE, become preprocessor macros visible in every included file.
+/// Others, e.g. declarations of generated functions, are substituted by their values in the main file of the shader
 struct FCompileDefinitions
 {
     std::vector<std::pair<std::string, std::string>> Defines;
@@ -16,8 +39,76 @@ class FShader
 {
 public:
     FShader(const std::string &Path, const FCompileDefinitions* CompileDefinitions = nullptr);
+    /// Create the shader module from already compiled SPIR-V
+    explicit FShader(const std::vector<uint32_t>& SPIRVData);
     ~FShader();
     VkShaderModule operator()();
 
     VkShaderModule ShaderModule = VK_NULL_HANDLE;
-};
\ No newline at end of file
+};
+
+/// Source of the shader with includes and code definitions substituted. Everything the compiled SPIR-V depends on, except macro definitions.
+/// Files the shader includes are recorded in the dependency graph
+std::string ExpandShaderSource(const std::string& Path, const FCompileDefinitions* CompileDefinitions, const std::string& IncludeDirectory = SHADER_DIRECTORY);
+/// Shaders are looked up in the cache before compilation. Pass nullptr to always compile
+std::vector<uint32_t> CompileShaderToSpirVData(const std::string& Path, const FCompileDefinitions* CompileDefinitions, FShaderCache* ShaderCache);
+
+/// Cache of compiled shaders shared by the whole application, stored in "../cache/shaders/"
+FShaderCache* GetShaderCache();
+
+#define SHADER_CACHE() GetShaderCache()
+
+/// Contents of shader files shared by all compilations
+FShaderFileTable* GetShaderFileTable();
+/// Files every compiled shader depends on
+FShaderDependencyGraph* GetShaderDependencyGraph();
+
+#define SHADER_FILE_TABLE() GetShaderFileTable()
+#define SHADER_DEPENDENCY_GRAPH() GetShaderDependencyGraph()
+
+struct FShaderCompilationJob
+{
+    std::string Path;
+    FCompileDefinitions CompileDefinitions;
+};
+
+/**
+ * Pool of threads compiling shaders in the background. Every thread has its own compiler.
+ * Results are futures, so whoever creates a pipeline waits only for the shaders this pipeline needs
+ */
+class FShaderCompilationPool
+{
+public:
+    explicit FShaderCompilationPool(uint32_t ThreadsCount = std::max(1u, std::thread::hardware_concurrency()), FShaderCache* ShaderCacheIn = SHADER_CACHE());
+    ~FShaderCompilationPool();
+
+    FShaderCompilationPool(const FShaderCompilationPool&) = delete;
+    FShaderCompilationPool& operator=(const FShaderCompilationPool&) = delete;
+
+    /// Queue the job. If compilation fails, getting the result throws std::runtime_error with the compiler output
+    std::shared_future<std::vector<uint32_t>> Compile(FShaderCompilationJob Job);
+    /// Compile all jobs and wait for them. SPIR-V is returned in the order of the jobs.
+    /// If some jobs fail, a single std::runtime_error listing all of them in the order of the jobs is thrown
+    std::vector<std::vector<uint32_t>> CompileBatch(const std::vector<FShaderCompilationJob>& JobsIn);
+    /// Wait for the jobs compiled by Compile, with the same errors as CompileBatch
+    static std::vector<std::vector<uint32_t>> WaitForBatch(const std::vector<std::shared_future<std::vector<uint32_t>>>& Futures);
+    /// Line of the CompileBatch error about the failed job
+    static std::string GetJobErrorMessage(size_t JobIndex, const std::runtime_error& Error);
+
+    uint32_t GetThreadsCount() const;
+
+private:
+    void WorkerLoop();
+
+    FShaderCache* ShaderCache = nullptr;
+    std::vector<std::thread> Workers;
+    std::deque<std::function<void(shaderc::Compiler&)>> Jobs;
+    std::mutex Mutex;
+    std::condition_variable Condition;
+    bool bStopping = false;
+};
+
+/// Pool shared by the whole application. It uses the shader cache
+FShaderCompilationPool* GetShaderCompilationPool();
+
+#define SHADER_COMPILATION_POOL() GetShaderCompilationPool()
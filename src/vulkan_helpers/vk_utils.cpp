@@ -43,6 +43,8 @@ FSynchronizationPoint operator+(const FSynchronizationPoint& A, const FSynchroni
 	Result.FencesToWait.insert(A.FencesToWait.end(), B.FencesToWait.begin(), B.FencesToWait.end());
 	Result.SemaphoresToSignal.insert(A.SemaphoresToSignal.end(), B.SemaphoresToSignal.begin(), B.SemaphoresToSignal.end());
 	Result.FencesToSignal.insert(A.FencesToSignal.end(), B.FencesToSignal.begin(), B.FencesToSignal.end());
+	Result.TimelinePointsToWait.insert(Result.TimelinePointsToWait.end(), B.TimelinePointsToWait.begin(), B.TimelinePointsToWait.end());
+	Result.TimelinePointsToSignal.insert(Result.TimelinePointsToSignal.end(), B.TimelinePointsToSignal.begin(), B.TimelinePointsToSignal.end());
 
 	return Result;
 }
@@ -60,6 +62,8 @@ FSynchronizationPoint& operator+=(FSynchronizationPoint& A, const FSynchronizati
 	A.FencesToWait.insert(A.FencesToWait.end(), B.FencesToWait.begin(), B.FencesToWait.end());
 	A.SemaphoresToSignal.insert(A.SemaphoresToSignal.end(), B.SemaphoresToSignal.begin(), B.SemaphoresToSignal.end());
 	A.FencesToSignal.insert(A.FencesToSignal.end(), B.FencesToSignal.begin(), B.FencesToSignal.end());
+	A.TimelinePointsToWait.insert(A.TimelinePointsToWait.end(), B.TimelinePointsToWait.begin(), B.TimelinePointsToWait.end());
+	A.TimelinePointsToSignal.insert(A.TimelinePointsToSignal.end(), B.TimelinePointsToSignal.begin(), B.TimelinePointsToSignal.end());
 
 	return A;
 }
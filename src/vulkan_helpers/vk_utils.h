@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <functional>
 #include <numeric>
@@ -13,6 +14,7 @@
 #include <set>
 #include <stdexcept>
 #include <queue>
+#include <thread>
 #include <vector>
 
 struct FVersion3
@@ -29,12 +31,23 @@ struct BaseVulkanStructure
     const void*                             pNext;
 };
 
+/// Value of a timeline semaphore
+struct FTimelinePoint
+{
+	VkSemaphore Semaphore = VK_NULL_HANDLE;
+	uint64_t Value = 0;
+};
+
 struct FSynchronizationPoint
 {
+	/// Binary semaphores, only needed to talk to the swapchain, submits are chained with timeline points
 	std::vector<VkSemaphore> SemaphoresToWait;
 	std::vector<VkFence> FencesToWait;
 	std::vector<VkSemaphore> SemaphoresToSignal;
 	std::vector<VkFence> FencesToSignal;
+	/// A timeline value can be waited for any number of times, so these are never checked for collisions
+	std::vector<FTimelinePoint> TimelinePointsToWait;
+	std::vector<FTimelinePoint> TimelinePointsToSignal;
 
 	friend FSynchronizationPoint operator+(const FSynchronizationPoint& A, const FSynchronizationPoint& B);
 	friend FSynchronizationPoint& operator+=(FSynchronizationPoint& A, const FSynchronizationPoint& B);
@@ -155,47 +168,97 @@ struct FAliasTableEntry
 	uint32_t Alias;
 };
 
+/// Splits [0, Count) into at most ChunksCount contiguous chunks and calls Function(ChunkIndex, Begin, End) on each of them in its own thread.
+/// A single chunk runs on the calling thread
+template <typename F>
+void ParallelForChunks(uint32_t Count, uint32_t ChunksCount, F&& Function)
+{
+	uint32_t ChunkSize = (Count + ChunksCount - 1) / std::max(ChunksCount, 1u);
+
+	if (ChunksCount <= 1 || ChunkSize == 0)
+	{
+		Function(0u, 0u, Count);
+		return;
+	}
+
+	std::vector<std::thread> Threads;
+	Threads.reserve(ChunksCount);
+
+	for (uint32_t i = 0; i < ChunksCount; ++i)
+	{
+		uint32_t Begin = std::min(Count, i * ChunkSize);
+		uint32_t End = std::min(Count, Begin + ChunkSize);
+		Threads.emplace_back([&Function, i, Begin, End]() { Function(i, Begin, End); });
+	}
+
+	for (auto& Thread : Threads)
+	{
+		Thread.join();
+	}
+}
+
+/// Number of chunks the importance map is built in: one per hardware thread, but not less than this many entries per chunk,
+/// so that light lists of a few entries don't pay for the threads
+static constexpr uint32_t IMPORTANCE_MAP_MIN_CHUNK_SIZE = 1u << 16;
+
 /// @brief Generate importance sampling map and a weight map.
 /// WidthIn and HeightIn are dimensions of the incoming DataIn.
-/// Evaluator is a function that measures a value of a single T. For example in case of rbg color it can be luminosity of that color.
+/// Evaluator is a callable that measures a value of a single T. For example in case of rbg color it can be luminosity of that color.
+/// bSineWeighted should be set for latitude-longitude maps, every row is weighted by the sine of its polar angle, the solid angle it covers.
 /// The result is a pair of two vectors: Importance map of FAliasTableEntry and a vector(map) of each value weight.
-template <typename T, bool bSineWeighted = false>
-std::pair<std::vector<FAliasTableEntry>, std::vector<float>> GenerateImportanceMapFast(void* DataIn, uint32_t Width, uint32_t Height, std::function<double(T)> Evaluator)
+template <typename T, bool bSineWeighted = false, typename FEvaluator>
+std::pair<std::vector<FAliasTableEntry>, std::vector<float>> GenerateImportanceMapFast(void* DataIn, uint32_t Width, uint32_t Height, FEvaluator&& Evaluator)
 {
 	/// Cast the pointer;
 	T* Data = static_cast<T*>(DataIn);
 	/// Total number of pixels in the output image
 	uint32_t PixelsCount = Width * Height;
+	uint32_t ChunksCount = std::clamp(PixelsCount / IMPORTANCE_MAP_MIN_CHUNK_SIZE, 1u, std::max(1u, std::thread::hardware_concurrency()));
 
-	/// We have to use double, cause the precision of float might not be enough in some cases
-	std::vector<double> PDF(PixelsCount);
+	/// Weight of every entry, later scaled so that the average is 1
+	std::vector<float> Weights(PixelsCount);
+	std::vector<double> ChunkSums(ChunksCount, 0.);
 
 	/// Calculate measured value of each entry (For example if we have a FVector4 as T, we need a function that will return it's 'value' (like Luminosity)
-	/// Also we need to account for cases whe we evaluate IBL image - it's not uniformely wraps the sphere
+	/// Every chunk sums its values with Kahan summation, so that millions of small values are not lost next to a bright sun
+	ParallelForChunks(PixelsCount, ChunksCount, [&](uint32_t Chunk, uint32_t Begin, uint32_t End)
 	{
-		int i = 0;
+		double Sum = 0.;
+		double Compensation = 0.;
 
-		for (int h = 0; h < Height; ++h)
+		for (uint32_t i = Begin; i < End;)
 		{
-			double SinTheta = bSineWeighted ? 1 : sin((double(h) + 0.5) * M_PI / Height);
+			uint32_t Row = i / Width;
+			uint32_t RowEnd = std::min(End, (Row + 1) * Width);
+			double SinTheta = bSineWeighted ? std::sin((double(Row) + 0.5) * M_PI / Height) : 1.;
 
-			for (int w = 0; w < Width; ++w)
+			for (; i < RowEnd; ++i)
 			{
-				PDF[i] = Evaluator(Data[i]) * SinTheta;
-				i++;
+				/// Negative and NaN values can't be sampled
+				double Value = std::max(0., double(Evaluator(Data[i])) * SinTheta);
+				Weights[i] = float(Value);
+
+				double Corrected = double(Weights[i]) - Compensation;
+				double NewSum = Sum + Corrected;
+				Compensation = (NewSum - Sum) - Corrected;
+				Sum = NewSum;
 			}
 		}
-	}
 
-	/// Calculate 'total value' by copying sorting and adding all the values
-	auto Copy = PDF;
-	std::sort(Copy.begin(), Copy.end());
-	double TotalValueSum = std::accumulate(Copy.begin(), Copy.end(), 0.);
+		ChunkSums[Chunk] = Sum;
+	});
+
+	double TotalValueSum = 0.;
+
+	for (auto ChunkSum : ChunkSums)
+	{
+		TotalValueSum += ChunkSum;
+	}
 
 	std::vector<FAliasTableEntry> IBLSamplingMap;
 	std::vector<float> PDFResult;
 
-	if (TotalValueSum <= 0.)
+	if (!(TotalValueSum > 0.) || std::isinf(TotalValueSum))
 	{
 		/// For cases like totally black IBL
 		IBLSamplingMap.emplace_back(FAliasTableEntry{1.f, 0});
@@ -206,81 +269,176 @@ std::pair<std::vector<FAliasTableEntry>, std::vector<float>> GenerateImportanceM
 	IBLSamplingMap.resize(PixelsCount);
 	PDFResult.resize(PixelsCount);
 
-	for (uint32_t i = 0; i < PixelsCount; ++i)
+	/// Normalize and count the entries that are below the average in every chunk
+	std::vector<uint32_t> SmallOffsets(ChunksCount + 1, 0);
+	double Scale = double(PixelsCount) / TotalValueSum;
+
+	ParallelForChunks(PixelsCount, ChunksCount, [&](uint32_t Chunk, uint32_t Begin, uint32_t End)
 	{
-		PDF[i] /= TotalValueSum;
-		PDFResult[i] = PDF[i];
+		uint32_t SmallCount = 0;
+
+		for (uint32_t i = Begin; i < End; ++i)
+		{
+			PDFResult[i] = float(Weights[i] / TotalValueSum);
+			Weights[i] = float(Weights[i] * Scale);
+			SmallCount += Weights[i] < 1.f ? 1 : 0;
+		}
+
+		SmallOffsets[Chunk + 1] = SmallCount;
+	});
+
+	/// Prefix sum of the counts gives every chunk the place of its small entries, large ones go after the ones of previous chunks likewise
+	for (uint32_t i = 0; i < ChunksCount; ++i)
+	{
+		SmallOffsets[i + 1] += SmallOffsets[i];
 	}
 
-	std::vector<double> NormalizedValues(PixelsCount);
-	std::queue<uint32_t> IndicesThatGreater;
-	std::queue<uint32_t> IndicesThatSmaller;
+	uint32_t SmallCount = SmallOffsets[ChunksCount];
+	uint32_t LargeCount = PixelsCount - SmallCount;
+	std::vector<uint32_t> Small(SmallCount);
+	std::vector<uint32_t> Large(LargeCount);
 
-	for (uint32_t i = 0; i < PixelsCount; ++i)
+	ParallelForChunks(PixelsCount, ChunksCount, [&](uint32_t Chunk, uint32_t Begin, uint32_t End)
 	{
-		NormalizedValues[i] = {PDF[i] * PixelsCount};
-		if (NormalizedValues[i] < 1.)
-		{
-			IndicesThatSmaller.push(i);
-			continue;
-		}
-		if (NormalizedValues[i] > 1.)
+		uint32_t SmallIndex = SmallOffsets[Chunk];
+		uint32_t LargeIndex = Begin - SmallOffsets[Chunk];
+
+		for (uint32_t i = Begin; i < End; ++i)
 		{
-			IndicesThatGreater.push(i);
+			if (Weights[i] < 1.f)
+			{
+				Small[SmallIndex++] = i;
+			}
+			else
+			{
+				Large[LargeIndex++] = i;
+			}
 		}
-	}
+	});
 
-	std::vector<double> Probabilities(PixelsCount, 1);
-	std::vector<uint32_t> Alias(PixelsCount);
+	/// Vose's construction over the two arrays. Every small entry takes the rest of its cell from the current large one.
+	/// Once the large one falls under 1 itself, it's done the same way with the next large one, which keeps all reads in order.
+	/// The remainder of the current large entry is kept in double, as it's carried over a lot of small entries
+	uint32_t SmallIndex = 0;
+	uint32_t LargeIndex = 0;
 
-	/// We run it until there's only one element left in each group
-	/// Because of floating point precision they wouldn't get to perfect 1.
-	while (!IndicesThatSmaller.empty() && !IndicesThatGreater.empty())
+	if (LargeCount > 0)
 	{
-		uint32_t SmallIndex = IndicesThatSmaller.front();
-		uint32_t LargeIndex = IndicesThatGreater.front();
-		IndicesThatSmaller.pop();
-		IndicesThatGreater.pop();
+		uint32_t Current = Large[0];
+		double Residual = Weights[Current];
 
-		Probabilities[SmallIndex] = NormalizedValues[SmallIndex];
-		Alias[SmallIndex] = LargeIndex;
+		while (true)
+		{
+			if (Residual < 1. && LargeIndex + 1 < LargeCount)
+			{
+				uint32_t Next = Large[++LargeIndex];
+				IBLSamplingMap[Current] = FAliasTableEntry(float(Residual), Next);
+				Residual = double(Weights[Next]) - (1. - Residual);
+				Current = Next;
+				continue;
+			}
 
-		NormalizedValues[LargeIndex] = NormalizedValues[LargeIndex] - (1. - NormalizedValues[SmallIndex]);
+			if (SmallIndex == SmallCount)
+			{
+				break;
+			}
 
-		if (NormalizedValues[LargeIndex] < 1.)
-		{
-			IndicesThatSmaller.push(LargeIndex);
+			uint32_t SmallEntry = Small[SmallIndex++];
+			IBLSamplingMap[SmallEntry] = FAliasTableEntry(Weights[SmallEntry], Current);
+			Residual -= 1. - double(Weights[SmallEntry]);
 		}
-		else
+
+		/// Because of floating point precision what's left wouldn't get to perfect 1
+		IBLSamplingMap[Current] = FAliasTableEntry(1.f, Current);
+
+		for (uint32_t i = LargeIndex + 1; i < LargeCount; ++i)
 		{
-			IndicesThatGreater.push(LargeIndex);
+			IBLSamplingMap[Large[i]] = FAliasTableEntry(1.f, Large[i]);
 		}
 	}
 
-	while (!IndicesThatGreater.empty())
+	for (uint32_t i = SmallIndex; i < SmallCount; ++i)
+	{
+		IBLSamplingMap[Small[i]] = FAliasTableEntry(1.f, Small[i]);
+	}
+
+	return {IBLSamplingMap, PDFResult};
+}
+
+/// How the IBL is importance sampled
+enum class EIBLSamplingMode {
+	/// Single alias table over every texel, plus the probability of every texel. 12 bytes per texel, O(1) sampling with random memory access
+	AliasTable,
+	/// Marginal CDF of the rows and a conditional CDF of the columns of every row, probabilities are taken from them. 4 bytes per texel, two binary searches
+	Hierarchical};
+
+/// @brief Generate CDFs for hierarchical importance sampling of a 2D map.
+/// The result holds Height inclusive CDF values of the rows, followed by Width inclusive CDF values of the columns of every row, the layout ibl_sampling.h reads.
+/// Evaluator and bSineWeighted are the same as in GenerateImportanceMapFast. Rows without any value get uniform CDFs, they are never picked anyway.
+template <typename T, bool bSineWeighted = false, typename FEvaluator>
+std::vector<float> GenerateHierarchicalImportanceMap(void* DataIn, uint32_t Width, uint32_t Height, FEvaluator&& Evaluator)
+{
+	if (Width == 0 || Height == 0)
 	{
-		uint32_t L = IndicesThatGreater.back();
-		IndicesThatGreater.pop();
-		Probabilities[L] = 1.;
-		Alias[L] = L;
+		/// Same as GenerateImportanceMapFast does for an empty map, a single texel map
+		return {1.f, 1.f};
 	}
 
-	while (!IndicesThatSmaller.empty())
+	T* Data = static_cast<T*>(DataIn);
+	uint32_t ChunksCount = std::clamp((Width * Height) / IMPORTANCE_MAP_MIN_CHUNK_SIZE, 1u, std::max(1u, std::thread::hardware_concurrency()));
+
+	std::vector<float> Result(Height + Width * Height);
+	std::vector<double> RowSums(Height);
+
+	/// Every row is independent, chunks of rows are built in parallel. Sums are accumulated in double and only the normalized CDF is stored as float
+	ParallelForChunks(Height, ChunksCount, [&](uint32_t, uint32_t Begin, uint32_t End)
 	{
-		uint32_t S = IndicesThatSmaller.back();
-		IndicesThatSmaller.pop();
-		Probabilities[S] = 1.;
-		Alias[S] = S;
+		for (uint32_t Row = Begin; Row < End; ++Row)
+		{
+			double SinTheta = bSineWeighted ? std::sin((double(Row) + 0.5) * M_PI / Height) : 1.;
+			float* RowCDF = &Result[Height + Row * Width];
+			T* RowData = &Data[Row * Width];
+			double Sum = 0.;
+
+			for (uint32_t Column = 0; Column < Width; ++Column)
+			{
+				/// Negative and NaN values can't be sampled
+				RowCDF[Column] = float(std::max(0., double(Evaluator(RowData[Column])) * SinTheta));
+				Sum += RowCDF[Column];
+			}
+
+			RowSums[Row] = Sum;
+			double RunningSum = 0.;
+
+			for (uint32_t Column = 0; Column < Width; ++Column)
+			{
+				RunningSum += RowCDF[Column];
+				RowCDF[Column] = Sum > 0. ? float(RunningSum / Sum) : float(Column + 1) / float(Width);
+			}
+
+			/// Rounding must not leave a gap at the end, random values up to 1 have to find a column
+			RowCDF[Width - 1] = 1.f;
+		}
+	});
+
+	double TotalSum = 0.;
+
+	for (auto RowSum : RowSums)
+	{
+		TotalSum += RowSum;
 	}
 
-	std::vector<FAliasTableEntry> Result(PixelsCount);
-	for (uint32_t i = 0; i < PixelsCount; ++i)
+	double RunningSum = 0.;
+
+	for (uint32_t Row = 0; Row < Height; ++Row)
 	{
-		Result[i].Threshold = Probabilities[i];
-		Result[i].Alias = Alias[i];
+		RunningSum += RowSums[Row];
+		Result[Row] = TotalSum > 0. && !std::isinf(TotalSum) ? float(RunningSum / TotalSum) : float(Row + 1) / float(Height);
 	}
 
-	return {Result, PDFResult};
+	Result[Height - 1] = 1.f;
+
+	return Result;
 }
 
 std::string ReadFileToString(const std::string& FileName);